@@ -237,6 +237,8 @@ int main(int argc, char** argv) {
              "Use the specified log level (default info). "
              "Overridden by log level in configuration file")
             ("syslog", "Log to syslog instead of file or standard out")
+            ("sync-log", "Write log messages from the logging thread "
+             "instead of a background log writer")
             ("daemon", "Run the agent as a daemon");
     } catch (const boost::bad_lexical_cast& e) {
         std::cerr << e.what() << std::endl;
@@ -246,6 +248,7 @@ int main(int argc, char** argv) {
     bool daemon = false;
     bool watch = false;
     bool logToSyslog = false;
+    bool syncLog = false;
     std::string log_file;
     std::string level_str;
 
@@ -276,6 +279,9 @@ int main(int argc, char** argv) {
         if (vm.count("syslog")) {
             logToSyslog = true;
         }
+        if (vm.count("sync-log")) {
+            syncLog = true;
+        }
     } catch (const po::unknown_option& e) {
         std::cerr << e.what() << std::endl;
         return 2;
@@ -288,6 +294,8 @@ int main(int argc, char** argv) {
         daemonize();
 
     initLogging(level_str, logToSyslog, log_file);
+    if (!syncLog)
+        enableAsyncLogging();
 
     // Initialize agent and configuration
     std::vector<string> configFiles;
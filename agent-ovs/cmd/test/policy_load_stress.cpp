@@ -0,0 +1,836 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Self-contained load generator for the OpFlex policy repository.
+ * Runs an in-process policy repository loaded with a generated policy
+ * universe and drives it with a set of local agents.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/Agent.h>
+#include <opflexagent/EndpointSource.h>
+#include <opflexagent/logging.h>
+#include <modelgbp/dmtree/Root.hpp>
+#include <modelgbp/metadata/metadata.hpp>
+#include <modelgbp/l2/EtherTypeEnumT.hpp>
+#include <modelgbp/gbp/DirectionEnumT.hpp>
+#include <opflex/test/GbpOpflexServer.h>
+#include <opflex/ofcore/OFFramework.h>
+#include <opflex/ofcore/OFConstants.h>
+#include <opflex/modb/Mutator.h>
+
+#include <boost/program_options.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/prettywriter.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+using std::make_pair;
+using boost::lexical_cast;
+using opflex::modb::URI;
+using opflex::modb::Mutator;
+using opflex::test::GbpOpflexServer;
+using opflex::ofcore::OFConstants;
+using namespace opflexagent;
+namespace po = boost::program_options;
+
+typedef std::chrono::steady_clock load_clock;
+
+#define SERVER_ROLES \
+        (OFConstants::POLICY_REPOSITORY |     \
+         OFConstants::ENDPOINT_REGISTRY |     \
+         OFConstants::OBSERVER)
+#define LOCALHOST "127.0.0.1"
+
+static long currentRssKb() {
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, rss = 0;
+    statm >> pages >> rss;
+    return rss * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static uint64_t usSince(load_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>
+        (load_clock::now() - start).count();
+}
+
+/**
+ * Latency samples in microseconds
+ */
+class Samples {
+public:
+    void add(uint64_t us) {
+        std::lock_guard<std::mutex> guard(mutex);
+        samples.push_back(us);
+    }
+
+    void write(rapidjson::PrettyWriter<rapidjson::OStreamWrapper>& w) {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::sort(samples.begin(), samples.end());
+        w.StartObject();
+        w.Key("count");
+        w.Uint64(samples.size());
+        if (!samples.empty()) {
+            w.Key("min_us");
+            w.Uint64(samples.front());
+            w.Key("p50_us");
+            w.Uint64(samples[(samples.size() - 1) / 2]);
+            w.Key("p90_us");
+            w.Uint64(samples[(samples.size() - 1) * 9 / 10]);
+            w.Key("p99_us");
+            w.Uint64(samples[(samples.size() - 1) * 99 / 100]);
+            w.Key("max_us");
+            w.Uint64(samples.back());
+        }
+        w.EndObject();
+    }
+
+private:
+    std::mutex mutex;
+    vector<uint64_t> samples;
+};
+
+/**
+ * Generated policy universe served by the policy repository
+ */
+class PolicyGenerator {
+public:
+    PolicyGenerator(const string& space_, const string& domain_)
+        : space(space_), domain(domain_) {}
+
+    /**
+     * Write the policy universe to the given file in the format
+     * understood by GbpOpflexServer::readPolicy
+     */
+    void generate(uint32_t numEpgs, uint32_t numContracts,
+                  uint32_t numRules, uint32_t numSubnets,
+                  const string& file) {
+        using namespace modelgbp;
+        using namespace modelgbp::gbp;
+        using namespace modelgbp::gbpe;
+
+        opflex::ofcore::MockOFFramework mframework;
+        mframework.setModel(modelgbp::getMetadata());
+        mframework.start();
+
+        {
+            Mutator mutator(mframework, "init");
+            shared_ptr<dmtree::Root> root =
+                dmtree::Root::createRootElement(mframework);
+            root->addPolicyUniverse();
+            root->addRelatorUniverse();
+            root->addEprL2Universe();
+            root->addEprL3Universe();
+            root->addEpdrL2Discovered();
+            root->addEpdrL3Discovered();
+            mutator.commit();
+        }
+
+        Mutator mutator(mframework, "policyreg");
+        shared_ptr<policy::Universe> universe =
+            policy::Universe::resolve(mframework).get();
+        shared_ptr<policy::Space> pspace = universe->addPolicySpace(space);
+        universe->addPlatformConfig(domain)
+            ->setMulticastGroupIP("224.1.1.1");
+
+        shared_ptr<RoutingDomain> rd = pspace->addGbpRoutingDomain("rd");
+        rd->addGbpeInstContext()->setEncapId(1);
+        shared_ptr<BridgeDomain> bd = pspace->addGbpBridgeDomain("bd");
+        bd->addGbpBridgeDomainToNetworkRSrc()
+            ->setTargetRoutingDomain(rd->getURI());
+        bd->addGbpeInstContext()->setEncapId(2);
+
+        shared_ptr<Subnets> subnets = pspace->addGbpSubnets("subnets");
+        for (uint32_t i = 0; i < numSubnets; ++i) {
+            boost::asio::ip::address_v4 net(0x0a000000 + (i << 8));
+            boost::asio::ip::address_v4 router(0x0a000001 + (i << 8));
+            subnets->addGbpSubnet("subnet" + lexical_cast<string>(i))
+                ->setAddress(net.to_string())
+                .setPrefixLen(24)
+                .setVirtualRouterIp(router.to_string());
+        }
+        bd->addGbpForwardingBehavioralGroupToSubnetsRSrc()
+            ->setTargetSubnets(subnets->getURI());
+        rd->addGbpRoutingDomainToIntSubnetsRSrc(subnets->getURI()
+                                                .toString());
+
+        for (uint32_t i = 0; i < numEpgs; ++i) {
+            const string id = lexical_cast<string>(i);
+            shared_ptr<FloodDomain> fd = pspace->addGbpFloodDomain("fd" + id);
+            fd->addGbpFloodDomainToNetworkRSrc()
+                ->setTargetBridgeDomain(bd->getURI());
+
+            shared_ptr<EpGroup> epg = pspace->addGbpEpGroup("epg" + id);
+            epg->addGbpEpGroupToNetworkRSrc()
+                ->setTargetFloodDomain(fd->getURI());
+            shared_ptr<InstContext> ctx = epg->addGbpeInstContext();
+            ctx->setEncapId(0x1000 + i).setClassid(0x2000 + i);
+            epgs.push_back(epg->getURI());
+            epgContexts.push_back(ctx->getURI());
+        }
+
+        for (uint32_t i = 0; i < numContracts; ++i) {
+            const string id = lexical_cast<string>(i);
+            shared_ptr<Contract> con = pspace->addGbpContract("contract" + id);
+            shared_ptr<Subject> subj = con->addGbpSubject("subject");
+            for (uint32_t r = 0; r < numRules; ++r) {
+                const string rid = id + "_" + lexical_cast<string>(r);
+                shared_ptr<L24Classifier> cls =
+                    pspace->addGbpeL24Classifier("classifier" + rid);
+                cls->setOrder(r)
+                    .setEtherT(l2::EtherTypeEnumT::CONST_IPV4)
+                    .setProt(6 /* TCP */)
+                    .setDFromPort(1000 + r)
+                    .setDToPort(1000 + r);
+                subj->addGbpRule("rule" + lexical_cast<string>(r))
+                    ->setDirection(DirectionEnumT::CONST_BIDIRECTIONAL)
+                    .setOrder(r)
+                    .addGbpRuleToClassifierRSrc(cls->getURI().toString());
+            }
+            if (epgs.empty()) continue;
+            shared_ptr<EpGroup> prov =
+                EpGroup::resolve(mframework, epgs[i % epgs.size()]).get();
+            shared_ptr<EpGroup> cons =
+                EpGroup::resolve(mframework,
+                                 epgs[(i + 1) % epgs.size()]).get();
+            prov->addGbpEpGroupToProvContractRSrc(con->getURI().toString());
+            cons->addGbpEpGroupToConsContractRSrc(con->getURI().toString());
+        }
+        mutator.commit();
+
+        mframework.dumpMODB(file);
+        mframework.stop();
+    }
+
+    /**
+     * Build a policy update that changes the encap ID of the given
+     * group
+     */
+    void buildEncapUpdate(size_t epg, uint32_t encapId,
+                          rapidjson::Document& d) {
+        rapidjson::Document::AllocatorType& alloc = d.GetAllocator();
+        d.SetArray();
+
+        rapidjson::Value mo(rapidjson::kObjectType);
+        mo.AddMember("subject", "GbpeInstContext", alloc);
+        mo.AddMember("uri", rapidjson::Value(epgContexts[epg].toString()
+                                             .c_str(), alloc), alloc);
+
+        rapidjson::Value props(rapidjson::kArrayType);
+        rapidjson::Value encap(rapidjson::kObjectType);
+        encap.AddMember("name", "encapId", alloc);
+        encap.AddMember("data", uint64_t(encapId), alloc);
+        props.PushBack(encap, alloc);
+        rapidjson::Value classid(rapidjson::kObjectType);
+        classid.AddMember("name", "classid", alloc);
+        classid.AddMember("data", uint64_t(0x2000 + epg), alloc);
+        props.PushBack(classid, alloc);
+        mo.AddMember("properties", props, alloc);
+
+        mo.AddMember("parent_subject", "GbpEpGroup", alloc);
+        mo.AddMember("parent_uri", rapidjson::Value(epgs[epg].toString()
+                                                    .c_str(), alloc), alloc);
+        mo.AddMember("parent_relation", "GbpeInstContext", alloc);
+        d.PushBack(mo, alloc);
+    }
+
+    string space;
+    string domain;
+    vector<URI> epgs;
+    vector<URI> epgContexts;
+};
+
+/**
+ * Tracks when each agent first resolves a group and how long policy
+ * updates take to reach each agent
+ */
+class LoadTracker {
+public:
+    /**
+     * Listener registered with the policy manager of one agent
+     */
+    class AgentListener : public PolicyListener {
+    public:
+        AgentListener(LoadTracker& tracker_, Agent& agent_)
+            : tracker(tracker_), agent(agent_) {}
+
+        virtual void egDomainUpdated(const URI& egURI) {
+            boost::optional<uint32_t> vnid =
+                agent.getPolicyManager().getVnidForGroup(egURI);
+            if (vnid)
+                tracker.groupResolved(this, egURI, vnid.get());
+        }
+
+        LoadTracker& tracker;
+        Agent& agent;
+    };
+
+    void declared(AgentListener* l, const URI& epg) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto key = make_pair(l, epg.toString());
+        if (resolved.find(key) == resolved.end())
+            pendingResolve.emplace(key, load_clock::now());
+    }
+
+    void updateSent(const URI& epg, uint32_t vnid) {
+        std::lock_guard<std::mutex> guard(mutex);
+        pendingUpdate[epg.toString()] = make_pair(vnid, load_clock::now());
+    }
+
+    void groupResolved(AgentListener* l, const URI& epg, uint32_t vnid) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto key = make_pair(l, epg.toString());
+        auto rit = pendingResolve.find(key);
+        if (rit != pendingResolve.end()) {
+            resolveLatency.add(usSince(rit->second));
+            pendingResolve.erase(rit);
+        }
+        resolved.insert(key);
+
+        auto uit = pendingUpdate.find(epg.toString());
+        if (uit != pendingUpdate.end() && uit->second.first == vnid) {
+            auto& seen = updateSeen[key];
+            if (seen != vnid) {
+                seen = vnid;
+                updateLatency.add(usSince(uit->second.second));
+            }
+        }
+    }
+
+    size_t getPendingResolves() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return pendingResolve.size();
+    }
+
+    typedef std::pair<AgentListener*, string> agent_group_t;
+    struct agent_group_hash {
+        size_t operator()(const agent_group_t& k) const {
+            return std::hash<void*>()(k.first) ^
+                std::hash<string>()(k.second);
+        }
+    };
+
+    std::mutex mutex;
+    std::unordered_map<agent_group_t, load_clock::time_point,
+                       agent_group_hash> pendingResolve;
+    std::unordered_set<agent_group_t, agent_group_hash> resolved;
+    std::unordered_map<string,
+                       std::pair<uint32_t,
+                                 load_clock::time_point>> pendingUpdate;
+    std::unordered_map<agent_group_t, uint32_t,
+                       agent_group_hash> updateSeen;
+
+    Samples resolveLatency;
+    Samples declareLatency;
+    Samples updateLatency;
+};
+
+class TestAgent {
+public:
+    TestAgent(const string& domain, const string& identity,
+              LoadTracker& tracker) :
+        framework(new opflex::ofcore::OFFramework()),
+        agent(new Agent(*framework, std::make_tuple("debug", false, ""))),
+        listener(new LoadTracker::AgentListener(tracker, *agent)) {
+        framework->setOpflexIdentity(identity, domain);
+        agent->getPolicyManager().setOpflexDomain(domain);
+        agent->getPolicyManager().registerListener(listener.get());
+    }
+
+    /**
+     * Sum the opflex message counters over all peers of this agent
+     */
+    void getCounters(uint64_t& declares, uint64_t& declareResps,
+                     uint64_t& frames) {
+        std::unordered_map<string,
+                           shared_ptr<opflex::ofcore::OFStats>> stats;
+        framework->getOpflexPeerStats(stats);
+        declares = declareResps = frames = 0;
+        for (auto& s : stats) {
+            opflex::ofcore::OFStats& st = *s.second;
+            declares += st.getEpDeclares();
+            declareResps += st.getEpDeclareResps();
+            frames += st.getIdentReqs() + st.getIdentResps() +
+                st.getPolResolves() + st.getPolResolveResps() +
+                st.getPolUnresolves() + st.getPolUnresolveResps() +
+                st.getPolUpdates() +
+                st.getEpDeclares() + st.getEpDeclareResps() +
+                st.getEpUndeclares() + st.getEpUndeclareResps() +
+                st.getStateReports() + st.getStateReportResps();
+        }
+    }
+
+    std::unique_ptr<opflex::ofcore::OFFramework> framework;
+    std::unique_ptr<Agent> agent;
+    std::unique_ptr<LoadTracker::AgentListener> listener;
+
+    /**
+     * The time each endpoint was declared, in declaration order
+     */
+    vector<load_clock::time_point> declareTimes;
+
+    /**
+     * Number of declarations acknowledged so far
+     */
+    uint64_t acked = 0;
+};
+
+static Endpoint createEndpoint(uint32_t epId, const URI& epg) {
+    Endpoint ep("load-ep-" + lexical_cast<string>(epId));
+    ep.setInterfaceName("veth" + lexical_cast<string>(epId));
+
+    uint8_t mac[6] = {0xfe, 0xff, 0, 0, 0, 0};
+    memcpy(mac + 2, &epId, 4);
+    ep.setMAC(opflex::modb::MAC(mac));
+
+    boost::asio::ip::address_v4 ipAddr(0x0a000000 + epId);
+    ep.addIP(ipAddr.to_string());
+    ep.setEgURI(epg);
+    return ep;
+}
+
+struct Phase {
+    string name;
+    double seconds;
+    uint64_t frames;
+    long rssKb;
+};
+
+/**
+ * Periodically samples the send rate and write queue depth of the
+ * policy repository along with the process RSS
+ */
+class ServerSampler {
+public:
+    /**
+     * @param server_ the server to sample
+     * @param phase_ the index of the phase in progress
+     * @param intervalMs_ milliseconds between samples
+     */
+    ServerSampler(GbpOpflexServer& server_,
+                  const std::atomic<size_t>& phase_, uint32_t intervalMs_)
+        : server(server_), phase(phase_), interval(intervalMs_),
+          stopping(false) {}
+
+    ~ServerSampler() { stop(); }
+
+    void start() {
+        begin = load_clock::now();
+        thread = std::thread([this]() { run(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        cond.notify_all();
+        if (thread.joinable())
+            thread.join();
+    }
+
+    void write(rapidjson::PrettyWriter<rapidjson::OStreamWrapper>& w,
+               const vector<Phase>& phases) {
+        std::lock_guard<std::mutex> guard(mutex);
+        w.StartArray();
+        for (const Sample& s : samples) {
+            w.StartObject();
+            w.Key("seconds");
+            w.Double(s.seconds);
+            if (s.phase < phases.size()) {
+                w.Key("phase");
+                w.String(phases[s.phase].name.c_str());
+            }
+            w.Key("messages_sent");
+            w.Uint64(s.sent);
+            w.Key("send_rate");
+            w.Double(s.sendRate);
+            w.Key("queue_depth");
+            w.Uint64(s.queueDepth);
+            w.Key("rss_kb");
+            w.Int64(s.rssKb);
+            w.EndObject();
+        }
+        w.EndArray();
+    }
+
+private:
+    struct Sample {
+        double seconds;
+        size_t phase;
+        uint64_t sent;
+        double sendRate;
+        size_t queueDepth;
+        long rssKb;
+    };
+
+    void run() {
+        uint64_t lastSent = 0;
+        auto last = begin;
+        std::unique_lock<std::mutex> guard(mutex);
+        while (!stopping) {
+            cond.wait_for(guard, interval, [this]() { return stopping; });
+            auto now = load_clock::now();
+            uint64_t sent;
+            size_t queueDepth;
+            server.getStats(sent, queueDepth);
+            double elapsed =
+                std::chrono::duration<double>(now - last).count();
+            samples.push_back({std::chrono::duration<double>
+                        (now - begin).count(), phase.load(), sent,
+                        elapsed > 0 ? (sent - lastSent) / elapsed : 0,
+                        queueDepth, currentRssKb()});
+            lastSent = sent;
+            last = now;
+        }
+    }
+
+    GbpOpflexServer& server;
+    const std::atomic<size_t>& phase;
+    std::chrono::milliseconds interval;
+    load_clock::time_point begin;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool stopping;
+    vector<Sample> samples;
+};
+
+int main(int argc, char** argv) {
+    signal(SIGPIPE, SIG_IGN);
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "Print this help message")
+        ("level", po::value<string>()->default_value("error"),
+         "Use the specified log level (default error).")
+        ("port", po::value<int>()->default_value(8009),
+         "Port for the local policy repository")
+        ("domain", po::value<string>()->
+         default_value("comp/prov-OpenStack/ctrlr-[load]-load/sw-load"),
+         "OpFlex domain")
+        ("agents,a", po::value<uint32_t>()->default_value(16),
+         "Number of agents to create")
+        ("endpoints,e", po::value<uint32_t>()->default_value(50),
+         "Number of endpoints per agent to declare")
+        ("epgroups,g", po::value<uint32_t>()->default_value(100),
+         "Number of EP groups in the policy universe")
+        ("contracts,c", po::value<uint32_t>()->default_value(100),
+         "Number of contracts in the policy universe")
+        ("rules,r", po::value<uint32_t>()->default_value(5),
+         "Number of rules per contract")
+        ("subnets,s", po::value<uint32_t>()->default_value(16),
+         "Number of subnets in the policy universe")
+        ("update_rate", po::value<uint32_t>()->default_value(50),
+         "Policy updates per second to send during the churn phase")
+        ("duration,d", po::value<uint32_t>()->default_value(30),
+         "Duration of the churn phase in seconds")
+        ("timeout", po::value<uint32_t>()->default_value(60),
+         "Seconds to wait for endpoints to be declared and resolved")
+        ("sample_interval", po::value<uint32_t>()->default_value(1000),
+         "Milliseconds between samples of the policy repository send "
+         "rate, queue depth and memory use")
+        ("output,o", po::value<string>()->default_value(""),
+         "Write the JSON report to this file instead of standard out")
+        ;
+
+    string level_str;
+    string domain;
+    string output;
+    int port;
+    uint32_t num_agents, num_endpoints, num_epgs, num_contracts;
+    uint32_t num_rules, num_subnets, update_rate, duration, timeout;
+    uint32_t sample_interval;
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).
+                  options(desc).run(), vm);
+        po::notify(vm);
+        if (vm.count("help")) {
+            std::cout << "Usage: " << argv[0] << " [options]\n";
+            std::cout << desc;
+            return 0;
+        }
+        level_str = vm["level"].as<string>();
+        domain = vm["domain"].as<string>();
+        output = vm["output"].as<string>();
+        port = vm["port"].as<int>();
+        num_agents = vm["agents"].as<uint32_t>();
+        num_endpoints = vm["endpoints"].as<uint32_t>();
+        num_epgs = vm["epgroups"].as<uint32_t>();
+        num_contracts = vm["contracts"].as<uint32_t>();
+        num_rules = vm["rules"].as<uint32_t>();
+        num_subnets = vm["subnets"].as<uint32_t>();
+        update_rate = vm["update_rate"].as<uint32_t>();
+        duration = vm["duration"].as<uint32_t>();
+        timeout = vm["timeout"].as<uint32_t>();
+        sample_interval = vm["sample_interval"].as<uint32_t>();
+    } catch (const po::unknown_option& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (const std::bad_cast& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    if (num_epgs == 0) {
+        std::cerr << "At least one EP group is required" << std::endl;
+        return 1;
+    }
+    if (sample_interval == 0) {
+        std::cerr << "The sample interval must be positive" << std::endl;
+        return 1;
+    }
+
+    initLogging(level_str, false, "", "policy-load-stress");
+
+    vector<Phase> phases;
+    uint64_t lastFrames = 0;
+    vector<std::unique_ptr<TestAgent>> agents;
+    auto totalFrames = [&agents]() {
+        uint64_t total = 0;
+        for (auto& a : agents) {
+            uint64_t d, dr, f;
+            a->getCounters(d, dr, f);
+            total += f;
+        }
+        return total;
+    };
+    std::atomic<size_t> currentPhase(0);
+    auto endPhase = [&](const string& name, load_clock::time_point start) {
+        uint64_t frames = totalFrames();
+        phases.push_back({name, usSince(start) / 1e6,
+                    frames - lastFrames, currentRssKb()});
+        lastFrames = frames;
+        currentPhase = phases.size();
+    };
+
+    LoadTracker tracker;
+    PolicyGenerator generator("load", domain);
+    long baseRss = currentRssKb();
+
+    try {
+        auto start = load_clock::now();
+        char policyFile[] = "/tmp/policy-load-XXXXXX";
+        int fd = mkstemp(policyFile);
+        if (fd < 0) {
+            LOG(ERROR) << "Could not create policy file: "
+                       << strerror(errno);
+            return 3;
+        }
+        close(fd);
+        generator.generate(num_epgs, num_contracts, num_rules,
+                           num_subnets, policyFile);
+
+        GbpOpflexServer::peer_vec_t peer_vec;
+        string peer = LOCALHOST ":" + lexical_cast<string>(port);
+        peer_vec.push_back(make_pair(SERVER_ROLES, peer));
+        GbpOpflexServer server(port, SERVER_ROLES, peer_vec,
+                               vector<string>(),
+                               modelgbp::getMetadata(), 30);
+        server.readPolicy(policyFile);
+        unlink(policyFile);
+        server.start();
+        ServerSampler sampler(server, currentPhase, sample_interval);
+        sampler.start();
+        endPhase("load_policy", start);
+        long serverRss = currentRssKb();
+
+        start = load_clock::now();
+        for (uint32_t i = 0; i < num_agents; ++i) {
+            agents.emplace_back(new TestAgent(domain,
+                                              "load_agent_" +
+                                              lexical_cast<string>(i),
+                                              tracker));
+            agents.back()->agent->start();
+            agents.back()->framework->addPeer(LOCALHOST, port);
+        }
+        endPhase("start_agents", start);
+
+        start = load_clock::now();
+        uint32_t epId = 0;
+        uint64_t expectedDeclares = 0;
+        for (auto& a : agents) {
+            EndpointSource source(&a->agent->getEndpointManager());
+            for (uint32_t j = 0; j < num_endpoints; ++j) {
+                const URI& epg = generator.epgs[epId % num_epgs];
+                tracker.declared(a->listener.get(), epg);
+                a->declareTimes.push_back(load_clock::now());
+                source.updateEndpoint(createEndpoint(epId, epg));
+                epId += 1;
+                expectedDeclares += 1;
+            }
+        }
+
+        // Wait for all declarations to be acknowledged and all
+        // groups to be resolved.  Acknowledgements are only counted
+        // per peer, but each agent has a single peer that answers its
+        // declarations in order, so the kth acknowledgement of an
+        // agent is timed from its kth declaration.
+        uint64_t acked = 0;
+        auto deadline = load_clock::now() + std::chrono::seconds(timeout);
+        while (load_clock::now() < deadline) {
+            acked = 0;
+            for (auto& a : agents) {
+                uint64_t d, dr, f;
+                a->getCounters(d, dr, f);
+                uint64_t nacked =
+                    std::min<uint64_t>(dr, a->declareTimes.size());
+                for (uint64_t k = a->acked; k < nacked; ++k)
+                    tracker.declareLatency
+                        .add(usSince(a->declareTimes[k]));
+                a->acked = nacked;
+                acked += nacked;
+            }
+            if (acked >= expectedDeclares &&
+                tracker.getPendingResolves() == 0)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (acked < expectedDeclares || tracker.getPendingResolves() > 0)
+            LOG(WARNING) << "Timed out with " << (expectedDeclares - acked)
+                         << " unacknowledged declarations and "
+                         << tracker.getPendingResolves()
+                         << " unresolved groups";
+        endPhase("declare_and_resolve", start);
+        long clientRss = currentRssKb();
+
+        start = load_clock::now();
+        uint64_t updates = 0;
+        if (update_rate > 0) {
+            std::mt19937 urng(42);
+            std::uniform_int_distribution<size_t> pick(0, num_epgs - 1);
+            auto interval = std::chrono::microseconds(1000000 / update_rate);
+            auto next = load_clock::now();
+            auto end = next + std::chrono::seconds(duration);
+            while (load_clock::now() < end) {
+                size_t epg = pick(urng);
+                uint32_t vnid = 0x100000 + updates;
+                rapidjson::Document d;
+                generator.buildEncapUpdate(epg, vnid, d);
+                tracker.updateSent(generator.epgs[epg], vnid);
+                server.updatePolicy(d, opflex::gbp::PolicyUpdateOp::ADD);
+                updates += 1;
+                next += interval;
+                std::this_thread::sleep_until(next);
+            }
+        }
+        // let the final updates drain
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        endPhase("policy_churn", start);
+        sampler.stop();
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        std::ofstream file;
+        if (!output.empty())
+            file.open(output.c_str());
+        std::ostream& os = output.empty() ? std::cout : file;
+        rapidjson::OStreamWrapper osw(os);
+        rapidjson::PrettyWriter<rapidjson::OStreamWrapper> w(osw);
+        w.StartObject();
+        w.Key("config");
+        w.StartObject();
+        w.Key("agents");
+        w.Uint(num_agents);
+        w.Key("endpoints_per_agent");
+        w.Uint(num_endpoints);
+        w.Key("epgroups");
+        w.Uint(num_epgs);
+        w.Key("contracts");
+        w.Uint(num_contracts);
+        w.Key("rules");
+        w.Uint(num_rules);
+        w.Key("subnets");
+        w.Uint(num_subnets);
+        w.Key("update_rate");
+        w.Uint(update_rate);
+        w.EndObject();
+
+        w.Key("phases");
+        w.StartArray();
+        for (const Phase& p : phases) {
+            w.StartObject();
+            w.Key("name");
+            w.String(p.name.c_str());
+            w.Key("seconds");
+            w.Double(p.seconds);
+            w.Key("frames");
+            w.Uint64(p.frames);
+            w.Key("frames_per_sec");
+            w.Double(p.seconds > 0 ? p.frames / p.seconds : 0);
+            w.Key("rss_kb");
+            w.Int64(p.rssKb);
+            w.EndObject();
+        }
+        w.EndArray();
+
+        w.Key("declared");
+        w.Uint64(expectedDeclares);
+        w.Key("declare_acks");
+        w.Uint64(acked);
+        w.Key("policy_updates_sent");
+        w.Uint64(updates);
+        w.Key("resolve_latency");
+        tracker.resolveLatency.write(w);
+        w.Key("declare_ack_latency");
+        tracker.declareLatency.write(w);
+        w.Key("update_latency");
+        tracker.updateLatency.write(w);
+        w.Key("server_samples");
+        sampler.write(w, phases);
+
+        // Both sides share the process, so memory is attributed by
+        // the growth across the phases that load each side
+        w.Key("memory");
+        w.StartObject();
+        w.Key("server_rss_kb");
+        w.Int64(serverRss - baseRss);
+        w.Key("agents_rss_kb");
+        w.Int64(clientRss - serverRss);
+        w.Key("peak_rss_kb");
+        w.Int64(usage.ru_maxrss);
+        w.EndObject();
+        w.EndObject();
+        os << std::endl;
+
+        for (auto& a : agents)
+            a->agent->stop();
+        server.stop();
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Fatal error: " << e.what();
+        return 4;
+    } catch (...) {
+        LOG(ERROR) << "Unknown fatal error";
+        return 5;
+    }
+    return 0;
+}
@@ -159,6 +159,8 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
 #endif
     static const std::string ENDPOINT_SOURCE_FSPATH("endpoint-sources.filesystem");
     static const std::string ENDPOINT_SOURCE_MODEL_LOCAL("endpoint-sources.model-local");
+    static const std::string ENDPOINT_SOURCE_SCAN_THREADS("endpoint-sources.scan-threads");
+    static const std::string ENDPOINT_SOURCE_SUPPRESS_UNCHANGED("endpoint-sources.suppress-unchanged");
     static const std::string SERVICE_SOURCE_PATH("service-sources.filesystem");
     static const std::string SNAT_SOURCE_PATH("snat-sources.filesystem");
     static const std::string DROP_LOG_CFG_SOURCE_FSPATH("drop-log-config-sources.filesystem");
@@ -177,6 +179,9 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     static const std::string OPFLEX_NOTIF_OWNER("opflex.notif.socket-owner");
     static const std::string OPFLEX_NOTIF_GROUP("opflex.notif.socket-group");
     static const std::string OPFLEX_NOTIF_PERMS("opflex.notif.socket-permissions");
+    static const std::string OPFLEX_LATENCY_TRACE("opflex.latency-trace.enabled");
+    static const std::string OPFLEX_LATENCY_SLOW("opflex.latency-trace.slow-threshold");
+    static const std::string OPFLEX_LATENCY_MAX_AGE("opflex.latency-trace.max-age");
 
     static const std::string OPFLEX_NAME("opflex.name");
     static const std::string OPFLEX_DOMAIN("opflex.domain");
@@ -247,6 +252,22 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     if (notOwner) notifOwner = notOwner;
     if (notGrp) notifGroup = notGrp;
     if (notPerms) notifPerms = notPerms;
+
+    boost::optional<bool> latencyTrace =
+        properties.get_optional<bool>(OPFLEX_LATENCY_TRACE);
+    boost::optional<uint32_t> latencySlow =
+        properties.get_optional<uint32_t>(OPFLEX_LATENCY_SLOW);
+    boost::optional<uint32_t> latencyMaxAge =
+        properties.get_optional<uint32_t>(OPFLEX_LATENCY_MAX_AGE);
+    if (latencyTrace)
+        latencyTracker.setEnabled(latencyTrace.get());
+    if (latencySlow)
+        latencyTracker
+            .setSlowThreshold(std::chrono::milliseconds(latencySlow.get()));
+    if (latencyMaxAge)
+        latencyTracker
+            .setMaxAge(std::chrono::milliseconds(latencyMaxAge.get()));
+
     if (statMode_json) {
         statMode = getStatModeFromString(statMode_json.get());
     }
@@ -302,6 +323,18 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
             endpointSourceFSPaths.insert(v.second.data());
     }
 
+    optional<uint32_t> scanThreads =
+        properties.get_optional<uint32_t>(ENDPOINT_SOURCE_SCAN_THREADS);
+    if (scanThreads) {
+        fsWatcher.setScanThreads(scanThreads.get());
+        LOG(INFO) << "Initial filesystem scan using "
+                  << scanThreads.get() << " threads";
+    }
+    optional<bool> suppressUnchanged =
+        properties.get_optional<bool>(ENDPOINT_SOURCE_SUPPRESS_UNCHANGED);
+    if (suppressUnchanged)
+        fsWatcher.setSuppressUnchanged(suppressUnchanged.get());
+
     optional<const ptree&> modelLocalEndpointSource =
         properties.get_child_optional(ENDPOINT_SOURCE_MODEL_LOCAL);
 
@@ -523,6 +556,7 @@ void Agent::applyProperties() {
     if (!enableNotif || enableNotif.get()) {
         if (!notifSock) notifSock = DEF_NOTIF_SOCKET;
         notifServer.setSocketName(notifSock.get());
+        notifServer.setLatencyTracker(&latencyTracker);
         if (notifOwner)
             notifServer.setSocketOwner(notifOwner.get());
         if (notifGroup)
@@ -670,6 +704,7 @@ void Agent::start() {
         // disable reporting of some stats for now (MODB only)
         LOG(INFO) << "Disable unsupported stat reporting";
         framework.overrideObservableReporting(modelgbp::observer::OpflexCounter::CLASS_ID, false);
+        framework.overrideObservableReporting(modelgbp::observer::FsWatcherCounter::CLASS_ID, false);
         framework.overrideObservableReporting(modelgbp::gbpe::EpToSvcCounter::CLASS_ID, false);
         framework.overrideObservableReporting(modelgbp::gbpe::SvcToEpCounter::CLASS_ID, false);
         framework.overrideObservableReporting(modelgbp::gbpe::TableDropCounter::CLASS_ID, false);
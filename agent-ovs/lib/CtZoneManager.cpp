@@ -16,14 +16,17 @@
 #endif /* HAVE_LIBCFCT */
 
 #include <limits>
+#include <chrono>
 
 namespace opflexagent {
 
 CtZoneManager::CtZoneManager(IdGenerator& gen_)
-    : minId(1), maxId(65534), useNetLink(false), gen(gen_) { }
+    : minId(1), maxId(65534), useNetLink(false), gen(gen_),
+      flushStopping(false), flushedZones(0), flushedEntries(0),
+      lastFlushDuration(0) { }
 
 CtZoneManager::~CtZoneManager() {
-
+    stop();
 }
 
 #ifdef HAVE_LIBNFCT
@@ -45,7 +48,8 @@ public:
 struct delete_ctx {
     NfCtP cth;
     NfCtP ith;
-    uint16_t zoneId;
+    const CtZoneManager::zone_set_t* zones;
+    uint64_t deleted;
 };
 
 static int delete_cb(enum nf_conntrack_msg_type type,
@@ -54,7 +58,7 @@ static int delete_cb(enum nf_conntrack_msg_type type,
 {
     struct delete_ctx* ctx = (struct delete_ctx*)data;
 
-    if (ctx->zoneId != nfct_get_attr_u16(ct, ATTR_ZONE))
+    if (!ctx->zones->test(nfct_get_attr_u16(ct, ATTR_ZONE)))
         return NFCT_CB_CONTINUE;
 
     int res = nfct_query(ctx->ith.handle, NFCT_Q_DESTROY, ct);
@@ -62,46 +66,200 @@ static int delete_cb(enum nf_conntrack_msg_type type,
         LOG(ERROR) << "Failed to delete conntrack entry "
                    << nfct_get_attr_u32(ct, ATTR_ID)
                    << ": " << res;
+    } else {
+        ctx->deleted += 1;
     }
 
     return NFCT_CB_CONTINUE;
 }
-#endif /* HAVE_LIBNFCT */
-
-bool CtZoneManager::ctZoneAllocHook(const std::string&, uint32_t id) {
-#ifdef HAVE_LIBNFCT
-    LOG(DEBUG) << "Clearing connection tracking zone " << id;
 
+/*
+ * Delete the entries in the given zones with one dump per address
+ * family.  If filterZone is nonzero, only that zone is dumped.
+ */
+static bool delete_zones(const CtZoneManager::zone_set_t& zones,
+                         uint16_t filterZone, uint64_t& deleted) {
     delete_ctx ctx;
     if (!ctx.cth.handle || !ctx.ith.handle)
         return false;
-    ctx.zoneId = static_cast<uint16_t>(id);
+    ctx.zones = &zones;
+    ctx.deleted = 0;
 
     nfct_callback_register(ctx.cth.handle, NFCT_T_ALL, delete_cb, &ctx);
 
     typedef decltype(&nfct_filter_dump_destroy) destroy_t;
-    std::unique_ptr<struct nfct_filter_dump, destroy_t>
-        filter_dump(nfct_filter_dump_create(), nfct_filter_dump_destroy);
-    if (!filter_dump) {
-        LOG(ERROR) << "Could not create nfct_filter_dump";
-        return false;
+    for (uint8_t family : {AF_INET, AF_INET6}) {
+        std::unique_ptr<struct nfct_filter_dump, destroy_t>
+            filter_dump(nfct_filter_dump_create(), nfct_filter_dump_destroy);
+        if (!filter_dump) {
+            LOG(ERROR) << "Could not create nfct_filter_dump";
+            return false;
+        }
+
+        nfct_filter_dump_set_attr_u8(filter_dump.get(),
+                                     NFCT_FILTER_DUMP_L3NUM,
+                                     family);
+#ifdef HAVE_NFCT_FILTER_DUMP_ZONE
+        // Let the kernel skip entries in other zones.  Kernels that
+        // don't filter dumps by zone return every entry, which
+        // delete_cb filters instead.
+        if (filterZone)
+            nfct_filter_dump_set_attr_u16(filter_dump.get(),
+                                          NFCT_FILTER_DUMP_ZONE,
+                                          filterZone);
+#endif /* HAVE_NFCT_FILTER_DUMP_ZONE */
+        int res = nfct_query(ctx.cth.handle, NFCT_Q_DUMP_FILTER,
+                             filter_dump.get());
+        if (res < 0) {
+            LOG(ERROR) << "Failed to query connection tracking: " << res;
+            return false;
+        }
     }
 
-    nfct_filter_dump_set_attr_u8(filter_dump.get(),
-                                 NFCT_FILTER_DUMP_L3NUM,
-                                 AF_INET);
-    int res = nfct_query(ctx.cth.handle, NFCT_Q_DUMP_FILTER, filter_dump.get());
-    if (res < 0) {
-        LOG(ERROR) << "Failed to query connection tracking for zone "
-                   << id << ": " << res;
+    deleted = ctx.deleted;
+    return true;
+}
+#endif /* HAVE_LIBNFCT */
+
+bool CtZoneManager::flushZone(uint16_t zoneId) {
+#ifdef HAVE_LIBNFCT
+    auto start = std::chrono::steady_clock::now();
+
+    zone_set_t zones;
+    zones.set(zoneId);
+    uint64_t deleted = 0;
+    if (!delete_zones(zones, zoneId, deleted))
         return false;
-    }
 
+    uint64_t duration =
+        std::chrono::duration_cast<std::chrono::milliseconds>
+        (std::chrono::steady_clock::now() - start).count();
+    flushedEntries += deleted;
+    lastFlushDuration = duration;
+    LOG(DEBUG) << "Cleared " << deleted
+               << " entries from connection tracking zone " << zoneId
+               << " in " << duration << "ms";
 #endif /* HAVE_LIBNFCT */
 
     return true;
 }
 
+bool CtZoneManager::flushZones(const zone_set_t& zones) {
+#ifdef HAVE_LIBNFCT
+    auto start = std::chrono::steady_clock::now();
+
+    uint64_t deleted = 0;
+    if (!delete_zones(zones, 0, deleted))
+        return false;
+
+    uint64_t duration =
+        std::chrono::duration_cast<std::chrono::milliseconds>
+        (std::chrono::steady_clock::now() - start).count();
+    flushedEntries += deleted;
+    lastFlushDuration = duration;
+    LOG(DEBUG) << "Cleared " << deleted
+               << " entries from " << zones.count()
+               << " connection tracking zones in " << duration << "ms";
+#endif /* HAVE_LIBNFCT */
+
+    return true;
+}
+
+bool CtZoneManager::ctZoneAllocHook(const std::string&, uint32_t id) {
+    {
+        std::unique_lock<std::mutex> guard(flushMutex);
+        // zones that were free at startup are flushed together by
+        // flushWorker; wait for that rather than flushing the zone
+        // again here
+        startupCond.wait(guard, [this, id] {
+                return flushStopping || id >= startupZones.size() ||
+                    !startupZones.test(id);
+            });
+        if (id < cleanZones.size() && cleanZones.test(id)) {
+            // flushed when it was released and unused since
+            cleanZones.reset(id);
+            return true;
+        }
+    }
+
+    LOG(DEBUG) << "Clearing connection tracking zone " << id;
+    return flushZone(static_cast<uint16_t>(id));
+}
+
+bool CtZoneManager::ctZoneFreeHook(const std::string&, uint32_t id) {
+    std::lock_guard<std::mutex> guard(flushMutex);
+    if (!flushThread || flushStopping)
+        return true;
+
+    // hold the zone back from reuse until flushWorker has cleared it
+    flushQueue.push_back(static_cast<uint16_t>(id));
+    flushCond.notify_one();
+    return false;
+}
+
+void CtZoneManager::flushWorker() {
+    std::unique_lock<std::mutex> guard(flushMutex);
+    if (startupZones.any()) {
+        // We don't know what state was left behind for zones that
+        // were free at startup, so clear them all with a single dump
+        // of the connection tracking table
+        zone_set_t zones = startupZones;
+        guard.unlock();
+        bool clean = flushZones(zones);
+        guard.lock();
+        if (clean) {
+            cleanZones |= zones;
+            flushedZones += zones.count();
+        }
+        startupZones.reset();
+        startupCond.notify_all();
+    }
+
+    while (true) {
+        flushCond.wait(guard, [this] {
+                return flushStopping || !flushQueue.empty();
+            });
+        if (flushStopping)
+            break;
+
+        // the zone stays queued while it is flushed so that it
+        // counts towards the queue depth
+        uint16_t zoneId = flushQueue.front();
+        guard.unlock();
+        bool clean = flushZone(zoneId);
+        guard.lock();
+        flushQueue.pop_front();
+        if (clean) {
+            cleanZones.set(zoneId);
+            flushedZones += 1;
+        }
+        guard.unlock();
+
+        // A zone that failed to flush is still released, and is
+        // flushed again when it is allocated
+        gen.release(nmspc, zoneId);
+        guard.lock();
+    }
+}
+
+void CtZoneManager::stop() {
+    {
+        std::lock_guard<std::mutex> guard(flushMutex);
+        if (!flushThread)
+            return;
+        flushStopping = true;
+    }
+    flushCond.notify_all();
+    startupCond.notify_all();
+    flushThread->join();
+    flushThread.reset();
+}
+
+size_t CtZoneManager::getFlushQueueDepth() {
+    std::lock_guard<std::mutex> guard(flushMutex);
+    return flushQueue.size();
+}
+
 void CtZoneManager::setCtZoneRange(uint16_t min, uint16_t max) {
     if (min >= 1) minId = min;
     if (max < std::numeric_limits<uint16_t>::max()) maxId = max;
@@ -111,17 +269,41 @@ void CtZoneManager::enableNetLink(bool useNetLink_) {
     useNetLink = useNetLink_;
 }
 
-void CtZoneManager::init(const std::string& nmspc_) {
+void CtZoneManager::startZoneFlush() {
     using std::placeholders::_1;
     using std::placeholders::_2;
 
+    zone_set_t freeZones;
+    gen.forEachFreeId(nmspc, [&freeZones](uint32_t id) {
+            if (id < freeZones.size())
+                freeZones.set(id);
+        });
+
+    IdGenerator::alloc_hook_t
+        hook(std::bind(&CtZoneManager::ctZoneAllocHook, this, _1, _2));
+    gen.setAllocHook(nmspc, hook);
+
+    {
+        std::lock_guard<std::mutex> guard(flushMutex);
+        if (!flushThread) {
+            flushStopping = false;
+            startupZones = freeZones & ~cleanZones;
+            flushThread.reset(new std::thread([this]() {
+                        flushWorker();
+                    }));
+        }
+    }
+    IdGenerator::free_hook_t
+        freeHook(std::bind(&CtZoneManager::ctZoneFreeHook, this, _1, _2));
+    gen.setFreeHook(nmspc, freeHook);
+}
+
+void CtZoneManager::init(const std::string& nmspc_) {
     nmspc = nmspc_;
     gen.initNamespace(nmspc, minId, maxId);
     if (useNetLink) {
 #ifdef HAVE_LIBNFCT
-        IdGenerator::alloc_hook_t
-            hook(std::bind(&CtZoneManager::ctZoneAllocHook, this, _1, _2));
-        gen.setAllocHook(nmspc, hook);
+        startZoneFlush();
 #else /* HAVE_LIBNFCT */
         LOG(WARNING) << "Netlink library not available and connection "
             "tracking is enabled.";
@@ -64,7 +64,8 @@ EndpointManager::EndpointManager(Agent& agent_,
                                  PolicyManager& policyManager_,
                                  PrometheusManager& prometheusManager_)
     : agent(agent_), framework(framework_), policyManager(policyManager_),
-      prometheusManager(prometheusManager_), epgMappingListener(*this) {
+      prometheusManager(prometheusManager_), batch_update(false),
+      epgMappingListener(*this) {
 
 }
 #else
@@ -72,7 +73,7 @@ EndpointManager::EndpointManager(Agent& agent_,
                                  opflex::ofcore::OFFramework& framework_,
                                  PolicyManager& policyManager_)
     : agent(agent_), framework(framework_), policyManager(policyManager_),
-      epgMappingListener(*this) {
+      batch_update(false), epgMappingListener(*this) {
 
 }
 #endif
@@ -111,7 +112,7 @@ void EndpointManager::stop() {
 
     policyManager.unregisterListener(this);
 
-    unique_lock<mutex> guard(ep_mutex);
+    EpWriteLock guard(*this);
     ep_map.clear();
     ext_ep_map.clear();
     group_ep_map.clear();
@@ -125,6 +126,12 @@ void EndpointManager::stop() {
     access_iface_ep_map.clear();
     access_uplink_ep_map.clear();
     epgmapping_ep_map.clear();
+    dirty_eps.clear();
+    dirty_groups.clear();
+    dirty_ifaces.clear();
+    ep_snapshot.clear();
+    group_ep_snapshot.clear();
+    iface_ep_snapshot.clear();
 }
 
 void EndpointManager::registerListener(EndpointListener* listener) {
@@ -174,21 +181,68 @@ void EndpointManager::notifyLocalExternalDomainListeners(
     }
 }
 
+EndpointManager::EpWriteLock::EpWriteLock(EndpointManager& epmanager_)
+    : epmanager(epmanager_), guard(epmanager_.ep_mutex) {}
+
+EndpointManager::EpWriteLock::~EpWriteLock() {
+    if (guard.owns_lock())
+        epmanager.publishSnapshots();
+}
+
+void EndpointManager::EpWriteLock::unlock() {
+    epmanager.publishSnapshots();
+    guard.unlock();
+}
+
+void EndpointManager::publishSnapshots() {
+    for (const string& uuid : dirty_eps) {
+        ep_map_t::const_iterator it = ep_map.find(uuid);
+        if (it != ep_map.end()) {
+            ep_snapshot.put(uuid, it->second.endpoint);
+            continue;
+        }
+        it = ext_ep_map.find(uuid);
+        if (it != ext_ep_map.end())
+            ep_snapshot.put(uuid, it->second.endpoint);
+        else
+            ep_snapshot.erase(uuid);
+    }
+    dirty_eps.clear();
+
+    // only the partitions of a group holding endpoints that joined
+    // or left are copied, so large groups are cheap to republish
+    for (const auto& dirty : dirty_groups) {
+        const URI& egURI = dirty.first;
+        group_ep_map_t::const_iterator it = group_ep_map.find(egURI);
+        if (it != group_ep_map.end())
+            group_ep_snapshot.put(egURI,
+                                  str_pset_t::update(group_ep_snapshot
+                                                     .get(egURI),
+                                                     it->second,
+                                                     dirty.second));
+        else
+            group_ep_snapshot.erase(egURI);
+    }
+    dirty_groups.clear();
+
+    for (const string& iface : dirty_ifaces) {
+        string_ep_map_t::const_iterator it = iface_ep_map.find(iface);
+        if (it != iface_ep_map.end())
+            iface_ep_snapshot.put(iface,
+                                  make_shared<const str_uset_t>(it->second));
+        else
+            iface_ep_snapshot.erase(iface);
+    }
+    dirty_ifaces.clear();
+}
+
 Agent& EndpointManager::getAgent (void)
 {
     return agent;
 }
 
 shared_ptr<const Endpoint> EndpointManager::getEndpoint(const string& uuid) {
-    unique_lock<mutex> guard(ep_mutex);
-
-    ep_map_t::const_iterator it = ep_map.find(uuid);
-    if (it != ep_map.end())
-        return it->second.endpoint;
-    it = ext_ep_map.find(uuid);
-    if (it != ext_ep_map.end())
-        return it->second.endpoint;
-    return shared_ptr<const Endpoint>();
+    return ep_snapshot.get(uuid);
 }
 
 optional<URI> EndpointManager::getComputedEPG(const std::string& uuid) {
@@ -229,16 +283,93 @@ static void updateEpMap(const optional<std::string>& oldVal,
     }
 }
 
+template <typename T, typename S>
+static void markDirty(const optional<T>& oldVal,
+                      const optional<T>& val,
+                      S& dirty) {
+    if (oldVal != val) {
+        if (oldVal) dirty.insert(oldVal.get());
+        if (val) dirty.insert(val.get());
+    }
+}
+
 void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
+    unordered_set<uri_set_t> notifySecGroupSets;
+    uri_set_t notifyExtDomSets;
+    LatencyTracker& tracker = agent.getLatencyTracker();
+    tracker.begin(endpoint.getUUID());
+    {
+        EpWriteLock guard(*this);
+        updateEndpointState(endpoint, notifySecGroupSets, notifyExtDomSets);
+    }
+    tracker.mark(endpoint.getUUID(), LatencyTracker::SOURCE);
+    for (auto& s : notifyExtDomSets) {
+        notifyLocalExternalDomainListeners(s);
+    }
+    notifyListeners(endpoint.getUUID());
+
+    for (auto& s : notifySecGroupSets) {
+        notifyListeners(s);
+    }
+}
+
+void EndpointManager::updateEndpoints(const std::vector<Endpoint>& endpoints) {
+    if (endpoints.empty()) return;
+
+    unordered_set<uri_set_t> notifySecGroupSets;
+    uri_set_t notifyExtDomSets;
+    vector<string> notifyEps;
+    LatencyTracker& tracker = agent.getLatencyTracker();
+    for (const Endpoint& endpoint : endpoints)
+        tracker.begin(endpoint.getUUID());
+    {
+        EpWriteLock guard(*this);
+        Mutator mutator(framework, "policyelement");
+        str_uset_t seen;
+        batch_update = true;
+        for (const Endpoint& endpoint : endpoints) {
+            // The endpoint map is updated before the model, so a
+            // failure part way through an endpoint must not discard
+            // the model changes made for the rest of the batch
+            try {
+                updateEndpointState(endpoint, notifySecGroupSets,
+                                    notifyExtDomSets);
+            } catch (const std::exception& ex) {
+                LOG(ERROR) << "Could not update endpoint "
+                           << endpoint.getUUID() << ": " << ex.what();
+            } catch (...) {
+                LOG(ERROR) << "Unknown error while updating endpoint "
+                           << endpoint.getUUID();
+            }
+            if (seen.insert(endpoint.getUUID()).second)
+                notifyEps.push_back(endpoint.getUUID());
+        }
+        batch_update = false;
+        mutator.commit();
+    }
+    for (const string& uuid : notifyEps)
+        tracker.mark(uuid, LatencyTracker::SOURCE);
+    for (auto& s : notifyExtDomSets) {
+        notifyLocalExternalDomainListeners(s);
+    }
+    for (const string& uuid : notifyEps) {
+        notifyListeners(uuid);
+    }
+    for (auto& s : notifySecGroupSets) {
+        notifyListeners(s);
+    }
+}
+
+void EndpointManager::
+updateEndpointState(const Endpoint& endpoint,
+                    unordered_set<uri_set_t>& notifySecGroupSets,
+                    uri_set_t& notifyExtDomSets) {
     using namespace modelgbp::gbp;
     using namespace modelgbp::gbpe;
     using namespace modelgbp::epdr;
 
-    unique_lock<mutex> guard(ep_mutex);
     const string& uuid = endpoint.getUUID();
     EndpointState& es = ep_map[uuid];
-    unordered_set<uri_set_t> notifySecGroupSets;
-    EndpointListener::uri_set_t notifyExtDomSets;
 
     // Refresh IP to EP map for this endpoint, to track delete/update
     // of this IP list
@@ -273,6 +404,7 @@ void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
     const optional<std::string>& oldIface = es.endpoint->getInterfaceName();
     const optional<std::string>& iface = endpoint.getInterfaceName();
     updateEpMap(oldIface, iface, iface_ep_map, uuid);
+    markDirty(oldIface, iface, dirty_ifaces);
 
     // update access interface name to endpoint mapping
     const optional<std::string>& oldAccess = es.endpoint->getAccessInterface();
@@ -307,29 +439,82 @@ void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
     updateEpMap(oldEpgmap, epgmap, epgmapping_ep_map, uuid);
 
     es.endpoint = make_shared<const Endpoint>(endpoint);
+    dirty_eps.insert(uuid);
     optional<EndpointListener::uri_set_t &> extDomSets(notifyExtDomSets);
     updateEndpointLocal(uuid, extDomSets);
-    guard.unlock();
-    for (auto& s : notifyExtDomSets) {
+}
+
+void EndpointManager::removeEndpoint(const std::string& uuid) {
+    unordered_set<uri_set_t> notifySecGroupSets;
+    uri_set_t notifyExtDomSets;
+    LatencyTracker& tracker = agent.getLatencyTracker();
+    tracker.begin(uuid);
+    {
+        EpWriteLock guard(*this);
+        Mutator mutator(framework, "policyelement");
+        removeEndpointState(uuid, notifySecGroupSets, notifyExtDomSets);
+        mutator.commit();
+    }
+    tracker.mark(uuid, LatencyTracker::SOURCE);
+    notifyListeners(uuid);
+    for (auto& s : notifySecGroupSets) {
+        notifyListeners(s);
+    }
+    for(auto& s: notifyExtDomSets) {
         notifyLocalExternalDomainListeners(s);
     }
-    notifyListeners(uuid);
+}
 
+void EndpointManager::removeEndpoints(const std::vector<std::string>& uuids) {
+    if (uuids.empty()) return;
+
+    unordered_set<uri_set_t> notifySecGroupSets;
+    uri_set_t notifyExtDomSets;
+    vector<string> notifyEps;
+    LatencyTracker& tracker = agent.getLatencyTracker();
+    for (const string& uuid : uuids)
+        tracker.begin(uuid);
+    {
+        EpWriteLock guard(*this);
+        Mutator mutator(framework, "policyelement");
+        str_uset_t seen;
+        for (const string& uuid : uuids) {
+            if (!seen.insert(uuid).second) continue;
+            try {
+                removeEndpointState(uuid, notifySecGroupSets,
+                                    notifyExtDomSets);
+            } catch (const std::exception& ex) {
+                LOG(ERROR) << "Could not remove endpoint "
+                           << uuid << ": " << ex.what();
+            } catch (...) {
+                LOG(ERROR) << "Unknown error while removing endpoint "
+                           << uuid;
+            }
+            notifyEps.push_back(uuid);
+        }
+        mutator.commit();
+    }
+    for (const string& uuid : notifyEps)
+        tracker.mark(uuid, LatencyTracker::SOURCE);
+    for (const string& uuid : notifyEps) {
+        notifyListeners(uuid);
+    }
     for (auto& s : notifySecGroupSets) {
         notifyListeners(s);
     }
+    for(auto& s: notifyExtDomSets) {
+        notifyLocalExternalDomainListeners(s);
+    }
 }
 
-void EndpointManager::removeEndpoint(const std::string& uuid) {
+void EndpointManager::
+removeEndpointState(const std::string& uuid,
+                    unordered_set<uri_set_t>& notifySecGroupSets,
+                    uri_set_t& notifyExtDomSets) {
     using namespace modelgbp::epdr;
     using namespace modelgbp::epr;
     using namespace modelgbp::gbpe;
 
-    unique_lock<mutex> guard(ep_mutex);
-    Mutator mutator(framework, "policyelement");
-    unordered_set<uri_set_t> notifySecGroupSets;
-    uri_set_t notifyExtDomSets;
-
     ep_map_t::iterator it = ep_map.find(uuid);
     if (it != ep_map.end()) {
         EndpointState& es = it->second;
@@ -387,6 +572,7 @@ void EndpointManager::removeEndpoint(const std::string& uuid) {
         }
         EpCounter::remove(framework, uuid);
         if (es.egURI) {
+            dirty_groups[es.egURI.get()].insert(uuid);
             group_ep_map_t::iterator it = group_ep_map.find(es.egURI.get());
             if (it != group_ep_map.end()) {
                 it->second.erase(uuid);
@@ -424,6 +610,8 @@ void EndpointManager::removeEndpoint(const std::string& uuid) {
 
         updateEpMap(es.endpoint->getInterfaceName(), boost::none,
                     iface_ep_map, uuid);
+        if (es.endpoint->getInterfaceName())
+            dirty_ifaces.insert(es.endpoint->getInterfaceName().get());
         updateEpMap(es.endpoint->getAccessInterface(), boost::none,
                     access_iface_ep_map, uuid);
         updateEpMap(es.endpoint->getAccessUplinkInterface(), boost::none,
@@ -443,15 +631,7 @@ void EndpointManager::removeEndpoint(const std::string& uuid) {
                     epgmapping_ep_map, uuid);
 
         ep_map.erase(it);
-    }
-    mutator.commit();
-    guard.unlock();
-    notifyListeners(uuid);
-    for (auto& s : notifySecGroupSets) {
-        notifyListeners(s);
-    }
-    for(auto& s: notifyExtDomSets) {
-        notifyLocalExternalDomainListeners(s);
+        dirty_eps.insert(uuid);
     }
 }
 
@@ -594,7 +774,7 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
     using namespace modelgbp::gbpe;
     using namespace modelgbp::epdr;
 
-    unique_lock<mutex> guard(ep_mutex);
+    EpWriteLock guard(*this);
     const string& uuid = endpoint.getUUID();
     EndpointState& es = ext_ep_map[uuid];
     unordered_set<uri_set_t> notifySecGroupSets;
@@ -625,6 +805,8 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
     optional<URI> egURI = endpoint.getEgURI();
    // update endpoint group to endpoint mapping
     if(oldEgURI != egURI) {
+        if (oldEgURI) dirty_groups[oldEgURI.get()].insert(uuid);
+        if (egURI) dirty_groups[egURI.get()].insert(uuid);
         if (oldEgURI) {
             unordered_set<string>& eps = group_ep_map[oldEgURI.get()];
             eps.erase(uuid);
@@ -641,6 +823,7 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
     const optional<std::string>& oldIface = es.endpoint->getInterfaceName();
     const optional<std::string>& iface = endpoint.getInterfaceName();
     updateEpMap(oldIface, iface, iface_ep_map, uuid);
+    markDirty(oldIface, iface, dirty_ifaces);
 
     // update access interface name to endpoint mapping
     const optional<std::string>& oldAccess = es.endpoint->getAccessInterface();
@@ -716,6 +899,7 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
         }
     }
     es.endpoint = ep;
+    dirty_eps.insert(uuid);
     mutator.commit();
     guard.unlock();
     notifyExternalEndpointListeners(uuid);
@@ -731,7 +915,7 @@ void EndpointManager::removeEndpointExternal(const std::string& uuid) {
     using namespace modelgbp::gbp;
     unordered_set<uri_set_t> notifySecGroupSets;
 
-    unique_lock<mutex> guard(ep_mutex);
+    EpWriteLock guard(*this);
     Mutator mutator(framework, "policyelement");
 
     ep_map_t::iterator it = ext_ep_map.find(uuid);
@@ -761,6 +945,7 @@ void EndpointManager::removeEndpointExternal(const std::string& uuid) {
             }
         }
         if (es.egURI) {
+            dirty_groups[es.egURI.get()].insert(uuid);
             group_ep_map_t::iterator it = group_ep_map.find(es.egURI.get());
             if (it != group_ep_map.end()) {
                 it->second.erase(uuid);
@@ -782,12 +967,15 @@ void EndpointManager::removeEndpointExternal(const std::string& uuid) {
         }
         updateEpMap(es.endpoint->getInterfaceName(), boost::none,
                     iface_ep_map, uuid);
+        if (es.endpoint->getInterfaceName())
+            dirty_ifaces.insert(es.endpoint->getInterfaceName().get());
         updateEpMap(es.endpoint->getAccessInterface(), boost::none,
                     access_iface_ep_map, uuid);
         updateEpMap(es.endpoint->getAccessUplinkInterface(), boost::none,
                     access_uplink_ep_map, uuid);
 
         ext_ep_map.erase(it);
+        dirty_eps.insert(uuid);
     }
     mutator.commit();
     guard.unlock();
@@ -820,6 +1008,8 @@ bool EndpointManager::updateEndpointLocal(const std::string& uuid,
     }
 
     if (oldEgURI != egURI) {
+        if (oldEgURI) dirty_groups[oldEgURI.get()].insert(uuid);
+        if (egURI) dirty_groups[egURI.get()].insert(uuid);
         if (oldEgURI) {
             unordered_set<string>& eps = group_ep_map[oldEgURI.get()];
             eps.erase(uuid);
@@ -855,7 +1045,10 @@ bool EndpointManager::updateEndpointLocal(const std::string& uuid,
     unordered_set<URI> newlocall2eps;
     unordered_set<URI> newipmgroups;
 
-    Mutator mutator(framework, "policyelement");
+    // changes made during a batch update are committed by the batch
+    std::unique_ptr<Mutator> mutator;
+    if (!batch_update)
+        mutator.reset(new Mutator(framework, "policyelement"));
 
     const optional<MAC>& mac = es.endpoint->getMAC();
 
@@ -984,7 +1177,8 @@ bool EndpointManager::updateEndpointLocal(const std::string& uuid,
     }
     es.ipMappingGroups = newipmgroups;
 
-    mutator.commit();
+    if (mutator)
+        mutator->commit();
 
     if(es.endpoint->isExternal()) {
        return updated;
@@ -1130,7 +1324,9 @@ bool EndpointManager::updateEndpointReg(const std::string& uuid) {
         bd = policyManager.getBDForGroup(egURI.get());
     }
 
-    Mutator mutator(framework, "policyelement");
+    std::unique_ptr<Mutator> mutator;
+    if (!batch_update)
+        mutator.reset(new Mutator(framework, "policyelement"));
 
     optional<shared_ptr<L2Universe> > l2u =
         L2Universe::resolve(framework);
@@ -1220,14 +1416,15 @@ bool EndpointManager::updateEndpointReg(const std::string& uuid) {
     }
     es.l3EPs = newl3eps;
 
-    mutator.commit();
+    if (mutator)
+        mutator->commit();
     return true;
 }
 
 void EndpointManager::egDomainUpdated(const URI& egURI) {
     unordered_set<string> notify;
     unordered_set<string> remoteNotify;
-    unique_lock<mutex> guard(ep_mutex);
+    EpWriteLock guard(*this);
 
     group_ep_map_t::const_iterator it = group_ep_map.find(egURI);
     if (it != group_ep_map.end()) {
@@ -1314,17 +1511,11 @@ static void getEps(const K& key, const M& map,
     }
 }
 
-template <typename M>
-static void getEps(const M& map, /* out */ unordered_set<string>& eps) {
-    for (const auto& elem : map) {
-        eps.insert(elem.second.begin(), elem.second.end());
-    }
-}
-
 void EndpointManager::getEndpointsForGroup(const URI& egURI,
                                            /*out*/ unordered_set<string>& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(egURI, group_ep_map, eps);
+    auto snapshot = group_ep_snapshot.get(egURI);
+    if (snapshot)
+        snapshot->insertInto(eps);
 }
 
 bool EndpointManager::secGrpSetEmpty(const uri_set_t& secGrps) {
@@ -1350,8 +1541,9 @@ void EndpointManager::getEndpointsForIPMGroup(const URI& egURI,
 
 void EndpointManager::getEndpointsByIface(const std::string& ifaceName,
                                           /* out */ str_uset_t& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(ifaceName, iface_ep_map, eps);
+    auto snapshot = iface_ep_snapshot.get(ifaceName);
+    if (snapshot)
+        eps.insert(snapshot->begin(), snapshot->end());
 }
 
 const ip_ep_map_t& EndpointManager::getIPLocalEpMap (void) {
@@ -1360,8 +1552,10 @@ const ip_ep_map_t& EndpointManager::getIPLocalEpMap (void) {
 }
 
 void EndpointManager::getEndpointUUIDs( /* out */ str_uset_t& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(iface_ep_map, eps);
+    iface_ep_snapshot.forEach([&eps](const string&,
+                                     const shared_ptr<const str_uset_t>& s) {
+            eps.insert(s->begin(), s->end());
+        });
 }
 
 void EndpointManager::getEndpointsByAccessIface(const std::string& ifaceName,
@@ -1430,14 +1624,15 @@ void EndpointManager::updateEndpointCounters(const std::string& uuid,
 
     mutator.commit();
 #ifdef HAVE_PROMETHEUS_SUPPORT
-    ep_map_t::iterator it = ep_map.find(uuid);
-    if (it != ep_map.end()) {
-        EndpointState& es = it->second;
-        auto& ep_name = es.endpoint->getAccessInterface();
+    // read the endpoint from its snapshot so that the stats cycle
+    // does not contend with endpoint churn on ep_mutex
+    shared_ptr<const Endpoint> ep = ep_snapshot.get(uuid);
+    if (ep) {
+        auto& ep_name = ep->getAccessInterface();
         if (ep_name)
             prometheusManager.addNUpdateEpCounter(uuid, ep_name.get(),
-                                                  es.endpoint->getAttributeHash(),
-                                                  es.endpoint->getAttributes());
+                                                  ep->getAttributeHash(),
+                                                  ep->getAttributes());
         else
             LOG(ERROR) << "ep name not found for uuid:" << uuid;
     }
@@ -1454,7 +1649,7 @@ void EndpointManager::EPGMappingListener::objectUpdated(class_id_t classId,
     using namespace modelgbp::gbpe;
 
     if (classId == EpAttributeSet::CLASS_ID) {
-        unique_lock<mutex> guard(epmanager.ep_mutex);
+        EpWriteLock guard(epmanager);
         optional<shared_ptr<EpAttributeSet> > attrSet =
             EpAttributeSet::resolve(epmanager.framework, uri);
         if (!attrSet) return;
@@ -1486,7 +1681,7 @@ void EndpointManager::EPGMappingListener::objectUpdated(class_id_t classId,
             epmanager.notifyListeners(uuid.get());
         }
     } else if (classId == EpgMapping::CLASS_ID) {
-        unique_lock<mutex> guard(epmanager.ep_mutex);
+        EpWriteLock guard(epmanager);
         optional<shared_ptr<EpgMapping> > epgMapping =
             EpgMapping::resolve(epmanager.framework, uri);
         if (!epgMapping) return;
@@ -27,6 +27,14 @@ void EndpointSource::removeEndpoint(const std::string& uuid) {
     manager->removeEndpoint(uuid);
 }
 
+void EndpointSource::updateEndpoints(const std::vector<Endpoint>& endpoints) {
+    manager->updateEndpoints(endpoints);
+}
+
+void EndpointSource::removeEndpoints(const std::vector<std::string>& uuids) {
+    manager->removeEndpoints(uuids);
+}
+
 void EndpointSource::updateEndpointExternal(const Endpoint& endpoint) {
     manager->updateEndpointExternal(endpoint);
 }
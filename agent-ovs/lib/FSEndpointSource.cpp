@@ -19,14 +19,13 @@
 #include <stdexcept>
 #include <sstream>
 
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <opflex/modb/URIBuilder.h>
 
 #include <opflexagent/FSEndpointSource.h>
 #include <opflexagent/Agent.h>
 #include <opflexagent/EndpointManager.h>
+#include <opflexagent/JsonUtil.h>
 #include <opflexagent/logging.h>
 #ifdef HAVE_PROMETHEUS_SUPPORT
 #include <opflexagent/PrometheusManager.h>
@@ -45,7 +44,7 @@ using opflex::modb::MAC;
 FSEndpointSource::FSEndpointSource(EndpointManager* manager_,
                                    FSWatcher& listener,
                                    const std::string& endpointDir)
-    : EndpointSource(manager_) {
+    : EndpointSource(manager_), batching(false) {
     LOG(INFO) << "Watching " << endpointDir << " for endpoint data";
     listener.addWatch(endpointDir, *this);
 }
@@ -56,440 +55,361 @@ static bool isep(fs::path filePath) {
             !boost::algorithm::starts_with(fstr, "."));
 }
 
-void FSEndpointSource::updated(const fs::path& filePath) {
-    if (!isep(filePath)) return;
-
-    static const std::string EP_UUID("uuid");
-    static const std::string EP_MAC("mac");
-    static const std::string EP_IP("ip");
-    static const std::string EP_ANYCAST_RETURN_IP("anycast-return-ip");
-    static const std::string EP_VIRTUAL_IP("virtual-ip");
-    static const std::string EP_GROUP("endpoint-group");
-    static const std::string POLICY_SPACE_NAME("policy-space-name");
-    static const std::string EG_POLICY_SPACE("eg-policy-space");
-    static const std::string EG_MAPPING_ALIAS("eg-mapping-alias");
-    static const std::string EP_GROUP_NAME("endpoint-group-name");
-    static const std::string EP_SEC_GROUP("security-group");
-    static const std::string SEC_GROUP_POLICY_SPACE("policy-space");
-    static const std::string SEC_GROUP_NAME("name");
-    static const std::string EP_IFACE_NAME("interface-name");
-    static const std::string EP_ACCESS_IFACE("access-interface");
-    static const std::string EP_ACCESS_IFACE_VLAN("access-interface-vlan");
-    static const std::string EP_ACCESS_UPLINK_IFACE("access-uplink-interface");
-    static const std::string EP_PROMISCUOUS("promiscuous-mode");
-    static const std::string EP_DISC_PROXY("discovery-proxy-mode");
-    static const std::string EP_NAT_MODE("nat-mode");
+namespace {
+
+class ParsedEndpoint : public FSWatcher::Watcher::Parsed {
+public:
+    Endpoint ep;
+    LatencyTracker::clock::time_point loaded;
+};
+
+} // anonymous namespace
+
+static boost::optional<URI> parseEgURI(const rapidjson::Value& obj,
+                                       const char* egPSKey) {
+    optional<string> eg = json::getString(obj, "endpoint-group");
+    if (eg)
+        return URI(eg.get());
+
+    optional<string> eg_name = json::getString(obj, "endpoint-group-name");
+    optional<string> ps_name = json::getString(obj, egPSKey);
+    if (!ps_name)
+        ps_name = json::getString(obj, "policy-space-name");
+    if (eg_name && ps_name) {
+        return opflex::modb::URIBuilder()
+            .addElement("PolicyUniverse")
+            .addElement("PolicySpace")
+            .addElement(ps_name.get())
+            .addElement("GbpEpGroup")
+            .addElement(eg_name.get()).build();
+    }
+    return boost::none;
+}
+
+std::unique_ptr<FSWatcher::Watcher::Parsed>
+FSEndpointSource::parse(const fs::path& filePath) {
+    if (!isep(filePath)) return nullptr;
+
+    static const char* EP_UUID("uuid");
+    static const char* EP_MAC("mac");
+    static const char* EP_IP("ip");
+    static const char* EP_ANYCAST_RETURN_IP("anycast-return-ip");
+    static const char* EP_VIRTUAL_IP("virtual-ip");
+    static const char* EG_POLICY_SPACE("eg-policy-space");
+    static const char* POLICY_SPACE_NAME("policy-space-name");
+    static const char* EG_MAPPING_ALIAS("eg-mapping-alias");
+    static const char* EP_SEC_GROUP("security-group");
+    static const char* SEC_GROUP_POLICY_SPACE("policy-space");
+    static const char* SEC_GROUP_NAME("name");
+    static const char* EP_IFACE_NAME("interface-name");
+    static const char* EP_ACCESS_IFACE("access-interface");
+    static const char* EP_ACCESS_IFACE_VLAN("access-interface-vlan");
+    static const char* EP_ACCESS_UPLINK_IFACE("access-uplink-interface");
+    static const char* EP_PROMISCUOUS("promiscuous-mode");
+    static const char* EP_DISC_PROXY("discovery-proxy-mode");
+    static const char* EP_NAT_MODE("nat-mode");
     static const std::string EP_ATTRIBUTE_VM_NAME("vm-name");
-    static const std::string EP_ATTRIBUTES("attributes");
-    static const std::string EP_PROVIDER_VLAN_FLAG("provider-vlan");
-    static const std::string EP_EXT_ENCAP_TYPE("ext-encap-type");
-    static const std::string EP_EXT_ENCAP_ID("ext-encap-id");
-
-    static const std::string DHCP4("dhcp4");
-    static const std::string DHCP6("dhcp6");
-    static const std::string DHCP_IP("ip");
-    static const std::string DHCP_PREFIX_LEN("prefix-len");
-    static const std::string DHCP_SERVER_IP("server-ip");
-    static const std::string DHCP_SERVER_MAC("server-mac");
-    static const std::string DHCP_ROUTERS("routers");
-    static const std::string DHCP_DNS_SERVERS("dns-servers");
-    static const std::string DHCP_DOMAIN("domain");
-    static const std::string DHCP_SEARCH_LIST("search-list");
-    static const std::string DHCP_STATIC_ROUTES("static-routes");
-    static const std::string DHCP_STATIC_ROUTE_DEST("dest");
-    static const std::string DHCP_STATIC_ROUTE_DEST_PREFIX("dest-prefix");
-    static const std::string DHCP_STATIC_ROUTE_NEXTHOP("next-hop");
-    static const std::string DHCP_INTERFACE_MTU("interface-mtu");
-    static const std::string DHCP_LEASE_TIME("lease-time");
-    static const std::string DHCP_T1("t1");
-    static const std::string DHCP_T2("t2");
-    static const std::string DHCP_PREFERRED_LIFETIME("preferred-lifetime");
-    static const std::string DHCP_VALID_LIFETIME("valid-lifetime");
-
-    static const std::string IP_ADDRESS_MAPPING("ip-address-mapping");
-    static const std::string IPM_MAPPED_IP("mapped-ip");
-    static const std::string IPM_FLOATING_IP("floating-ip");
-    static const std::string IPM_NEXTHOP_IF("next-hop-if");
-    static const std::string IPM_NEXTHOP_MAC("next-hop-mac");
-
-    static const std::string SNAT_UUIDS("snat-uuids");
-    static const std::string ACTIVE_ACTIVE_AAP("active-active-aap");
-    static const std::string EP_DISABLE_ADV("disable-adv");
-    static const std::string EP_ACCESS_ALLOW_UNTAGGED("access-allow-untagged");
+    static const char* EP_ATTRIBUTES("attributes");
+    static const char* EP_PROVIDER_VLAN_FLAG("provider-vlan");
+    static const char* EP_EXT_ENCAP_TYPE("ext-encap-type");
+    static const char* EP_EXT_ENCAP_ID("ext-encap-id");
+
+    static const char* DHCP4("dhcp4");
+    static const char* DHCP6("dhcp6");
+    static const char* DHCP_IP("ip");
+    static const char* DHCP_PREFIX_LEN("prefix-len");
+    static const char* DHCP_SERVER_IP("server-ip");
+    static const char* DHCP_SERVER_MAC("server-mac");
+    static const char* DHCP_ROUTERS("routers");
+    static const char* DHCP_DNS_SERVERS("dns-servers");
+    static const char* DHCP_DOMAIN("domain");
+    static const char* DHCP_SEARCH_LIST("search-list");
+    static const char* DHCP_STATIC_ROUTES("static-routes");
+    static const char* DHCP_STATIC_ROUTE_DEST("dest");
+    static const char* DHCP_STATIC_ROUTE_DEST_PREFIX("dest-prefix");
+    static const char* DHCP_STATIC_ROUTE_NEXTHOP("next-hop");
+    static const char* DHCP_INTERFACE_MTU("interface-mtu");
+    static const char* DHCP_LEASE_TIME("lease-time");
+    static const char* DHCP_T1("t1");
+    static const char* DHCP_T2("t2");
+    static const char* DHCP_PREFERRED_LIFETIME("preferred-lifetime");
+    static const char* DHCP_VALID_LIFETIME("valid-lifetime");
+
+    static const char* IP_ADDRESS_MAPPING("ip-address-mapping");
+    static const char* IPM_MAPPED_IP("mapped-ip");
+    static const char* IPM_FLOATING_IP("floating-ip");
+    static const char* IPM_NEXTHOP_IF("next-hop-if");
+    static const char* IPM_NEXTHOP_MAC("next-hop-mac");
+
+    static const char* SNAT_UUIDS("snat-uuids");
+    static const char* ACTIVE_ACTIVE_AAP("active-active-aap");
+    static const char* EP_DISABLE_ADV("disable-adv");
+    static const char* EP_ACCESS_ALLOW_UNTAGGED("access-allow-untagged");
 
     try {
-        using boost::property_tree::ptree;
-        Endpoint newep;
-        ptree properties;
-
-        string pathstr = filePath.string();
-
-        read_json(pathstr, properties);
-        newep.setUUID(properties.get<string>(EP_UUID));
-        optional<string> mac = properties.get_optional<string>(EP_MAC);
+        std::unique_ptr<ParsedEndpoint> parsed(new ParsedEndpoint());
+        parsed->loaded = LatencyTracker::clock::now();
+        Endpoint& newep = parsed->ep;
+        rapidjson::Document properties;
+
+        json::readFile(filePath.string(), properties);
+
+        optional<string> uuid = json::getString(properties, EP_UUID);
+        if (!uuid)
+            throw runtime_error(string("No such node (") + EP_UUID + ")");
+        newep.setUUID(uuid.get());
+        optional<string> mac = json::getString(properties, EP_MAC);
         if (mac) {
             newep.setMAC(MAC(mac.get()));
         }
-        optional<ptree&> ips = properties.get_child_optional(EP_IP);
-        if (ips) {
-            for (const ptree::value_type &v : ips.get())
-                newep.addIP(v.second.data());
-        }
-        optional<ptree&> anycastReturnIps =
-            properties.get_child_optional(EP_ANYCAST_RETURN_IP);
-        if (anycastReturnIps) {
-            for (const ptree::value_type &v : anycastReturnIps.get())
-                newep.addAnycastReturnIP(v.second.data());
-        }
-        optional<ptree&> virtualIps =
-            properties.get_child_optional(EP_VIRTUAL_IP);
-        if (virtualIps) {
-            for (const ptree::value_type &v : virtualIps.get()) {
-                 optional<string> vmac =
-                     v.second.get_optional<string>(EP_MAC);
-                 optional<string> vip =
-                     v.second.get_optional<string>(EP_IP);
-                 if (vip) {
-                     if (vmac) {
-                         newep.addVirtualIP(make_pair(MAC(vmac.get()),
-                                                      vip.get()));
-                     } else if (mac) {
-                         newep.addVirtualIP(make_pair(MAC(mac.get()),
-                                                      vip.get()));
-                     }
-                 }
+        json::forEachString(properties, EP_IP,
+                            [&](const string& ip) { newep.addIP(ip); });
+        json::forEachString(properties, EP_ANYCAST_RETURN_IP,
+                            [&](const string& ip) {
+                                newep.addAnycastReturnIP(ip);
+                            });
+        json::forEachElement(properties, EP_VIRTUAL_IP,
+                             [&](const rapidjson::Value& v) {
+            optional<string> vmac = json::getString(v, EP_MAC);
+            optional<string> vip = json::getString(v, EP_IP);
+            if (vip) {
+                if (vmac) {
+                    newep.addVirtualIP(make_pair(MAC(vmac.get()),
+                                                 vip.get()));
+                } else if (mac) {
+                    newep.addVirtualIP(make_pair(MAC(mac.get()),
+                                                 vip.get()));
+                }
             }
-        }
+        });
 
-        optional<string> eg =
-            properties.get_optional<string>(EP_GROUP);
-        if (eg) {
-            newep.setEgURI(URI(eg.get()));
+        optional<URI> egURI = parseEgURI(properties, EG_POLICY_SPACE);
+        if (egURI) {
+            newep.setEgURI(egURI.get());
         } else {
-            optional<string> eg_name =
-                properties.get_optional<string>(EP_GROUP_NAME);
-            optional<string> ps_name =
-                properties.get_optional<string>(EG_POLICY_SPACE);
-            if (!ps_name)
-                ps_name = properties.get_optional<string>(POLICY_SPACE_NAME);
-            if (eg_name && ps_name) {
-                newep.setEgURI(opflex::modb::URIBuilder()
-                               .addElement("PolicyUniverse")
-                               .addElement("PolicySpace")
-                               .addElement(ps_name.get())
-                               .addElement("GbpEpGroup")
-                               .addElement(eg_name.get()).build());
-            } else {
-                optional<string> eg_mapping_alias =
-                    properties.get_optional<string>(EG_MAPPING_ALIAS);
-                if (eg_mapping_alias) {
-                    newep.setEgMappingAlias(eg_mapping_alias.get());
-                }
+            optional<string> eg_mapping_alias =
+                json::getString(properties, EG_MAPPING_ALIAS);
+            if (eg_mapping_alias) {
+                newep.setEgMappingAlias(eg_mapping_alias.get());
             }
         }
 
-        optional<ptree&> secGrps =
-            properties.get_child_optional(EP_SEC_GROUP);
-        if (secGrps) {
-            for (const ptree::value_type &v : secGrps.get()) {
-                optional<string> secGrpPS =
-                    v.second.get_optional<string>(SEC_GROUP_POLICY_SPACE);
-                optional<string> secGrpName =
-                    v.second.get_optional<string>(SEC_GROUP_NAME);
-                if (secGrpName && secGrpPS) {
-                    newep.addSecurityGroup(opflex::modb::URIBuilder()
-                                           .addElement("PolicyUniverse")
-                                           .addElement("PolicySpace")
-                                           .addElement(secGrpPS.get())
-                                           .addElement("GbpSecGroup")
-                                           .addElement(secGrpName.get())
-                                           .build());
-                }
+        json::forEachElement(properties, EP_SEC_GROUP,
+                             [&](const rapidjson::Value& v) {
+            optional<string> secGrpPS =
+                json::getString(v, SEC_GROUP_POLICY_SPACE);
+            optional<string> secGrpName = json::getString(v, SEC_GROUP_NAME);
+            if (secGrpName && secGrpPS) {
+                newep.addSecurityGroup(opflex::modb::URIBuilder()
+                                       .addElement("PolicyUniverse")
+                                       .addElement("PolicySpace")
+                                       .addElement(secGrpPS.get())
+                                       .addElement("GbpSecGroup")
+                                       .addElement(secGrpName.get())
+                                       .build());
             }
-        }
+        });
 
-        optional<string> iface =
-            properties.get_optional<string>(EP_IFACE_NAME);
+        optional<string> iface = json::getString(properties, EP_IFACE_NAME);
         if (iface)
             newep.setInterfaceName(iface.get());
         optional<string> accessIface =
-            properties.get_optional<string>(EP_ACCESS_IFACE);
+            json::getString(properties, EP_ACCESS_IFACE);
         if (accessIface)
             newep.setAccessInterface(accessIface.get());
         optional<uint16_t> accessIfaceVlan =
-            properties.get_optional<uint16_t>(EP_ACCESS_IFACE_VLAN);
+            json::getUint<uint16_t>(properties, EP_ACCESS_IFACE_VLAN);
         if (accessIfaceVlan)
             newep.setAccessIfaceVlan(accessIfaceVlan.get());
         optional<string> accessUplinkIface =
-            properties.get_optional<string>(EP_ACCESS_UPLINK_IFACE);
+            json::getString(properties, EP_ACCESS_UPLINK_IFACE);
         if (accessUplinkIface)
             newep.setAccessUplinkInterface(accessUplinkIface.get());
-        optional<bool> promisc =
-            properties.get_optional<bool>(EP_PROMISCUOUS);
+        optional<bool> promisc = json::getBool(properties, EP_PROMISCUOUS);
         if (promisc)
             newep.setPromiscuousMode(promisc.get());
-        optional<bool> discprox =
-            properties.get_optional<bool>(EP_DISC_PROXY);
+        optional<bool> discprox = json::getBool(properties, EP_DISC_PROXY);
         if (discprox)
             newep.setDiscoveryProxyMode(discprox.get());
-        optional<bool> natMode =
-            properties.get_optional<bool>(EP_NAT_MODE);
+        optional<bool> natMode = json::getBool(properties, EP_NAT_MODE);
         if (natMode)
             newep.setNatMode(natMode.get());
 
-        optional<ptree&> attrs =
-            properties.get_child_optional(EP_ATTRIBUTES);
-        if (attrs) {
-            for (const ptree::value_type &v : attrs.get()) {
-                newep.addAttribute(v.first, v.second.data());
-                if (v.first == EP_ATTRIBUTE_VM_NAME &&
-                    // vm-name attribute starts with snat|
-                    v.second.data().rfind("snat|", 0) == 0) {
-                    newep.setNatMode(true);
-                }
+        json::forEachMember(properties, EP_ATTRIBUTES,
+                            [&](const string& name, const string& value) {
+            newep.addAttribute(name, value);
+            if (name == EP_ATTRIBUTE_VM_NAME &&
+                // vm-name attribute starts with snat|
+                value.rfind("snat|", 0) == 0) {
+                newep.setNatMode(true);
             }
-        }
+        });
 
-#ifdef HAVE_PROMETHEUS_SUPPORT
-        auto acc_intf = newep.getAccessInterface();
-        if (acc_intf) {
-            newep.setAttributeHash(
-                PrometheusManager::calcHashEpAttributes(
-                                            acc_intf.get(),
-                                            newep.getAttributes(),
-                                            manager->getAgent().getPrometheusEpAttributes()));
-        }
-#endif
-
-        optional<ptree&> dhcp4 = properties.get_child_optional(DHCP4);
+        const rapidjson::Value* dhcp4 = json::member(properties, DHCP4);
         if (dhcp4) {
             Endpoint::DHCPv4Config c;
 
-            optional<string> ip =
-                dhcp4.get().get_optional<string>(DHCP_IP);
+            optional<string> ip = json::getString(*dhcp4, DHCP_IP);
             if (ip)
                 c.setIpAddress(ip.get());
 
             optional<string> serverIp =
-                dhcp4.get().get_optional<string>(DHCP_SERVER_IP);
+                json::getString(*dhcp4, DHCP_SERVER_IP);
             if (serverIp)
                 c.setServerIp(serverIp.get());
 
             optional<string> serverMac =
-                dhcp4.get().get_optional<string>(DHCP_SERVER_MAC);
+                json::getString(*dhcp4, DHCP_SERVER_MAC);
             if (serverMac)
                 c.setServerMac(MAC(serverMac.get()));
 
             optional<uint8_t> prefix =
-                dhcp4.get().get_optional<uint8_t>(DHCP_PREFIX_LEN);
+                json::getUint<uint8_t>(*dhcp4, DHCP_PREFIX_LEN);
             if (prefix)
                 c.setPrefixLen(prefix.get());
 
-            optional<ptree&> routers =
-                dhcp4.get().get_child_optional(DHCP_ROUTERS);
-            if (routers) {
-                for (const ptree::value_type &u : routers.get())
-                    c.addRouter(u.second.data());
-            }
-
-            optional<ptree&> dns =
-                dhcp4.get().get_child_optional(DHCP_DNS_SERVERS);
-            if (dns) {
-                for (const ptree::value_type &u : dns.get())
-                    c.addDnsServer(u.second.data());
-            }
+            json::forEachString(*dhcp4, DHCP_ROUTERS,
+                                [&](const string& r) { c.addRouter(r); });
+            json::forEachString(*dhcp4, DHCP_DNS_SERVERS,
+                                [&](const string& d) { c.addDnsServer(d); });
 
-            optional<string> domain =
-                dhcp4.get().get_optional<string>(DHCP_DOMAIN);
+            optional<string> domain = json::getString(*dhcp4, DHCP_DOMAIN);
             if (domain)
                 c.setDomain(domain.get());
 
-            optional<ptree&> staticRoutes =
-                dhcp4.get().get_child_optional(DHCP_STATIC_ROUTES);
-            if (staticRoutes) {
-                for (const ptree::value_type &u : staticRoutes.get()) {
-                    optional<string> dst = u.second.get_optional<string>
-                        (DHCP_STATIC_ROUTE_DEST);
-                    uint8_t dstPrefix =
-                        u.second.get<uint8_t>
-                        (DHCP_STATIC_ROUTE_DEST_PREFIX, 32);
-                    optional<string> nextHop = u.second.get_optional<string>
-                        (DHCP_STATIC_ROUTE_NEXTHOP);
-                    if (dst && nextHop)
-                            c.addStaticRoute(dst.get(),
-                                             dstPrefix,
-                                             nextHop.get());
-                }
-            }
+            json::forEachElement(*dhcp4, DHCP_STATIC_ROUTES,
+                                 [&](const rapidjson::Value& u) {
+                optional<string> dst =
+                    json::getString(u, DHCP_STATIC_ROUTE_DEST);
+                uint8_t dstPrefix =
+                    json::getUint<uint8_t>(u, DHCP_STATIC_ROUTE_DEST_PREFIX)
+                    .value_or(32);
+                optional<string> nextHop =
+                    json::getString(u, DHCP_STATIC_ROUTE_NEXTHOP);
+                if (dst && nextHop)
+                    c.addStaticRoute(dst.get(), dstPrefix, nextHop.get());
+            });
 
             optional<uint16_t> interfaceMtu =
-                dhcp4.get().get_optional<uint16_t>(DHCP_INTERFACE_MTU);
+                json::getUint<uint16_t>(*dhcp4, DHCP_INTERFACE_MTU);
             if (interfaceMtu)
                 c.setInterfaceMtu(interfaceMtu.get());
 
             optional<uint32_t> leaseTime =
-                dhcp4.get().get_optional<uint32_t>(DHCP_LEASE_TIME);
+                json::getUint<uint32_t>(*dhcp4, DHCP_LEASE_TIME);
             if (leaseTime)
                 c.setLeaseTime(leaseTime.get());
 
             newep.setDHCPv4Config(c);
         }
 
-        optional<ptree&> dhcp6 = properties.get_child_optional(DHCP6);
+        const rapidjson::Value* dhcp6 = json::member(properties, DHCP6);
         if (dhcp6) {
             Endpoint::DHCPv6Config c;
 
-            optional<ptree&> searchPath =
-                dhcp6.get().get_child_optional(DHCP_SEARCH_LIST);
-            if (searchPath) {
-                for (const ptree::value_type &u : searchPath.get())
-                    c.addSearchListEntry(u.second.data());
-            }
-
-            optional<ptree&> dns =
-                dhcp6.get().get_child_optional(DHCP_DNS_SERVERS);
-            if (dns) {
-                for (const ptree::value_type &u : dns.get())
-                    c.addDnsServer(u.second.data());
-            }
+            json::forEachString(*dhcp6, DHCP_SEARCH_LIST,
+                                [&](const string& s) {
+                                    c.addSearchListEntry(s);
+                                });
+            json::forEachString(*dhcp6, DHCP_DNS_SERVERS,
+                                [&](const string& d) { c.addDnsServer(d); });
 
-            optional<uint32_t> t1 =
-                dhcp6.get().get_optional<uint32_t>(DHCP_T1);
+            optional<uint32_t> t1 = json::getUint<uint32_t>(*dhcp6, DHCP_T1);
             if (t1)
                 c.setT1(t1.get());
 
-            optional<uint32_t> t2 =
-                dhcp6.get().get_optional<uint32_t>(DHCP_T2);
+            optional<uint32_t> t2 = json::getUint<uint32_t>(*dhcp6, DHCP_T2);
             if (t2)
                 c.setT2(t2.get());
 
             optional<uint32_t> validLifetime =
-                dhcp6.get().get_optional<uint32_t>(DHCP_VALID_LIFETIME);
+                json::getUint<uint32_t>(*dhcp6, DHCP_VALID_LIFETIME);
             if (validLifetime)
                 c.setValidLifetime(validLifetime.get());
 
             optional<uint32_t> preferredLifetime =
-                dhcp6.get().get_optional<uint32_t>(DHCP_PREFERRED_LIFETIME);
+                json::getUint<uint32_t>(*dhcp6, DHCP_PREFERRED_LIFETIME);
             if (preferredLifetime)
                 c.setPreferredLifetime(preferredLifetime.get());
 
             newep.setDHCPv6Config(c);
         }
 
-        optional<ptree&> ipms =
-            properties.get_child_optional(IP_ADDRESS_MAPPING);
-        if (ipms) {
-            for (const ptree::value_type &v : ipms.get()) {
-                optional<string> fuuid =
-                    v.second.get_optional<string>(EP_UUID);
-                if (!fuuid) continue;
-
-                Endpoint::IPAddressMapping ipm(fuuid.get());
-
-                optional<string> floatingIp =
-                    v.second.get_optional<string>(IPM_FLOATING_IP);
-                if (floatingIp)
-                    ipm.setFloatingIP(floatingIp.get());
-
-                optional<string> mappedIp =
-                    v.second.get_optional<string>(IPM_MAPPED_IP);
-                if (mappedIp)
-                    ipm.setMappedIP(mappedIp.get());
-
-                optional<string> feg =
-                    v.second.get_optional<string>(EP_GROUP);
-                if (feg) {
-                    ipm.setEgURI(URI(feg.get()));
-                } else {
-                    optional<string> feg_name =
-                        v.second.get_optional<string>(EP_GROUP_NAME);
-                    optional<string> fps_name =
-                        v.second.get_optional<string>(POLICY_SPACE_NAME);
-                    if (feg_name && fps_name) {
-                        ipm.setEgURI(opflex::modb::URIBuilder()
-                                     .addElement("PolicyUniverse")
-                                     .addElement("PolicySpace")
-                                     .addElement(fps_name.get())
-                                     .addElement("GbpEpGroup")
-                                     .addElement(feg_name.get()).build());
-                    }
-                }
+        json::forEachElement(properties, IP_ADDRESS_MAPPING,
+                             [&](const rapidjson::Value& v) {
+            optional<string> fuuid = json::getString(v, EP_UUID);
+            if (!fuuid) return;
 
-                optional<string> nextHopIf =
-                    v.second.get_optional<string>(IPM_NEXTHOP_IF);
-                if (nextHopIf)
-                    ipm.setNextHopIf(nextHopIf.get());
+            Endpoint::IPAddressMapping ipm(fuuid.get());
 
-                optional<string> nextHopMac =
-                    v.second.get_optional<string>(IPM_NEXTHOP_MAC);
-                if (nextHopMac) {
-                    ipm.setNextHopMAC(MAC(nextHopMac.get()));
-                }
+            optional<string> floatingIp = json::getString(v, IPM_FLOATING_IP);
+            if (floatingIp)
+                ipm.setFloatingIP(floatingIp.get());
+
+            optional<string> mappedIp = json::getString(v, IPM_MAPPED_IP);
+            if (mappedIp)
+                ipm.setMappedIP(mappedIp.get());
+
+            optional<URI> feg = parseEgURI(v, POLICY_SPACE_NAME);
+            if (feg)
+                ipm.setEgURI(feg.get());
 
-                if (ipm.getMappedIP())
-                    newep.addIPAddressMapping(ipm);
+            optional<string> nextHopIf = json::getString(v, IPM_NEXTHOP_IF);
+            if (nextHopIf)
+                ipm.setNextHopIf(nextHopIf.get());
+
+            optional<string> nextHopMac = json::getString(v, IPM_NEXTHOP_MAC);
+            if (nextHopMac) {
+                ipm.setNextHopMAC(MAC(nextHopMac.get()));
             }
-        }
 
-        optional<ptree&> snats =
-            properties.get_child_optional(SNAT_UUIDS);
+            if (ipm.getMappedIP())
+                newep.addIPAddressMapping(ipm);
+        });
 
-        if (snats) {
-            for (const ptree::value_type &v : snats.get())
-                newep.addSnatUuid(v.second.data());
-        }
+        json::forEachString(properties, SNAT_UUIDS,
+                            [&](const string& u) { newep.addSnatUuid(u); });
 
-        optional<bool> aapModeAA =
-            properties.get_optional<bool>(ACTIVE_ACTIVE_AAP);
+        optional<bool> aapModeAA = json::getBool(properties, ACTIVE_ACTIVE_AAP);
         if (aapModeAA)
             newep.setAapModeAA(aapModeAA.get());
 
-        optional<bool> disableAdv =
-            properties.get_optional<bool>(EP_DISABLE_ADV);
+        optional<bool> disableAdv = json::getBool(properties, EP_DISABLE_ADV);
         if (disableAdv)
             newep.setDisableAdv(disableAdv.get());
 
         optional<bool> accessAllowUntagged =
-            properties.get_optional<bool>(EP_ACCESS_ALLOW_UNTAGGED);
+            json::getBool(properties, EP_ACCESS_ALLOW_UNTAGGED);
         if (accessAllowUntagged)
             newep.setAccessAllowUntagged(accessAllowUntagged.get());
 
         optional<bool> provider_vlan =
-                properties.get_optional<bool>(EP_PROVIDER_VLAN_FLAG);
+            json::getBool(properties, EP_PROVIDER_VLAN_FLAG);
         if(provider_vlan && provider_vlan.get()) {
             newep.setExternal();
         }
 
         if(newep.isExternal() && !newep.getEgURI()) {
             LOG(ERROR) << "endpoint-group not specified for external endpoint";
-            return;
+            return nullptr;
         }
-        std::string ext_encap_type = properties.get(EP_EXT_ENCAP_TYPE,"vlan");
+        std::string ext_encap_type =
+            json::getString(properties, EP_EXT_ENCAP_TYPE).value_or("vlan");
         if(ext_encap_type != "vlan") {
             LOG(ERROR) << "No encap other than vlan is supported for external EP";
-            return;
+            return nullptr;
         }
         optional<uint32_t> ext_encap =
-                properties.get_optional<uint32_t>(EP_EXT_ENCAP_ID);
+            json::getUint<uint32_t>(properties, EP_EXT_ENCAP_ID);
         if(ext_encap) {
             newep.setExtEncap(ext_encap.get());
         } else if(newep.isExternal()) {
             LOG(ERROR) << EP_EXT_ENCAP_ID << " not provided for external EP: "
                     << filePath;
-            return;
-        }
-
-        ep_map_t::const_iterator it = knownEps.find(pathstr);
-        if (it != knownEps.end()) {
-            if (newep.getUUID() != it->second)
-                deleted(filePath);
+            return nullptr;
         }
-        knownEps[pathstr] = newep.getUUID();
-        updateEndpoint(newep);
-
-        LOG(INFO) << "Updated endpoint " << newep
-                  << " from " << filePath;
 
+        return std::move(parsed);
     } catch (const std::exception& ex) {
         LOG(ERROR) << "Could not load endpoint from: "
                    << filePath << ": "
@@ -498,6 +418,71 @@ void FSEndpointSource::updated(const fs::path& filePath) {
         LOG(ERROR) << "Unknown error while loading endpoint information from "
                    << filePath;
     }
+    return nullptr;
+}
+
+void FSEndpointSource::apply(const fs::path& filePath,
+                             std::unique_ptr<Parsed> parsed) {
+    if (!parsed) return;
+    ParsedEndpoint& pep = static_cast<ParsedEndpoint&>(*parsed);
+    Endpoint& newep = pep.ep;
+    manager->getAgent().getLatencyTracker().begin(newep.getUUID(),
+                                                  pep.loaded);
+
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    auto acc_intf = newep.getAccessInterface();
+    if (acc_intf) {
+        newep.setAttributeHash(
+            PrometheusManager::calcHashEpAttributes(
+                                        acc_intf.get(),
+                                        newep.getAttributes(),
+                                        manager->getAgent().getPrometheusEpAttributes()));
+    }
+#endif
+
+    string pathstr = filePath.string();
+    ep_map_t::const_iterator it = knownEps.find(pathstr);
+    if (it != knownEps.end()) {
+        if (newep.getUUID() != it->second) {
+            deleted(filePath);
+        }
+    }
+    knownEps[pathstr] = newep.getUUID();
+
+    LOG(INFO) << "Updated endpoint " << newep
+              << " from " << filePath;
+    if (batching) {
+        // updates must not overtake the pending removals
+        if (!pendingRemovals.empty())
+            flushBatch();
+        pendingEps.push_back(std::move(newep));
+    } else {
+        updateEndpoint(newep);
+    }
+}
+
+void FSEndpointSource::beginBatch() {
+    batching = true;
+}
+
+void FSEndpointSource::endBatch() {
+    flushBatch();
+    batching = false;
+}
+
+void FSEndpointSource::flushBatch() {
+    if (!pendingEps.empty()) {
+        updateEndpoints(pendingEps);
+        pendingEps.clear();
+    }
+    if (!pendingRemovals.empty()) {
+        removeEndpoints(pendingRemovals);
+        pendingRemovals.clear();
+    }
+}
+
+void FSEndpointSource::updated(const fs::path& filePath) {
+    apply(filePath, parse(filePath));
 }
 
 void FSEndpointSource::deleted(const fs::path& filePath) {
@@ -508,7 +493,14 @@ void FSEndpointSource::deleted(const fs::path& filePath) {
             LOG(INFO) << "Removed endpoint "
                       << it->second
                       << " at " << filePath;
-            removeEndpoint(it->second);
+            if (batching) {
+                // removals must not overtake the pending updates
+                if (!pendingEps.empty())
+                    flushBatch();
+                pendingRemovals.push_back(it->second);
+            } else {
+                removeEndpoint(it->second);
+            }
             knownEps.erase(it);
         }
     } catch (const std::exception& ex) {
@@ -17,12 +17,11 @@
 #include <stdexcept>
 #include <sstream>
 
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <opflex/modb/URIBuilder.h>
 
 #include <opflexagent/FSServiceSource.h>
+#include <opflexagent/JsonUtil.h>
 #include <opflexagent/logging.h>
 
 namespace opflexagent {
@@ -49,44 +48,56 @@ static bool isservice(fs::path filePath) {
             !boost::algorithm::starts_with(fstr, "."));
 }
 
-void FSServiceSource::updated(const fs::path& filePath) {
-    if (!isservice(filePath)) return;
-
-    static const std::string UUID("uuid");
-    static const std::string SERVICE_MAC("service-mac");
-    static const std::string INTERFACE_NAME("interface-name");
-    static const std::string INTERFACE_VLAN("interface-vlan");
-    static const std::string INTERFACE_IP("interface-ip");
-    static const std::string SERVICE_MODE("service-mode");
-    static const std::string SERVICE_TYPE("service-type");
-    static const std::string SERVICE_DOMAIN("domain");
-    static const std::string DOMAIN_POLICY_SPACE("domain-policy-space");
-    static const std::string DOMAIN_NAME("domain-name");
-
-    static const std::string SERVICE_MAPPING("service-mapping");
-    static const std::string SM_SERVICE_IP("service-ip");
-    static const std::string SM_SERVICE_PROTO("service-proto");
-    static const std::string SM_SERVICE_PORT("service-port");
-    static const std::string SM_GATEWAY_IP("gateway-ip");
-    static const std::string SM_NEXT_HOP_IP("next-hop-ip");
-    static const std::string SM_NEXT_HOP_IPS("next-hop-ips");
-    static const std::string SM_NEXT_HOP_PORT("next-hop-port");
-    static const std::string SM_NODE_PORT("node-port");
-    static const std::string SM_CONNTRACK("conntrack-enabled");
-    static const std::string SVC_ATTRIBUTES("attributes");
+namespace {
+
+class ParsedService : public FSWatcher::Watcher::Parsed {
+public:
+    Service service;
+};
+
+} // anonymous namespace
+
+std::unique_ptr<FSWatcher::Watcher::Parsed>
+FSServiceSource::parse(const fs::path& filePath) {
+    if (!isservice(filePath)) return nullptr;
+
+    static const char* UUID("uuid");
+    static const char* SERVICE_MAC("service-mac");
+    static const char* INTERFACE_NAME("interface-name");
+    static const char* INTERFACE_VLAN("interface-vlan");
+    static const char* INTERFACE_IP("interface-ip");
+    static const char* SERVICE_MODE("service-mode");
+    static const char* SERVICE_TYPE("service-type");
+    static const char* SERVICE_DOMAIN("domain");
+    static const char* DOMAIN_POLICY_SPACE("domain-policy-space");
+    static const char* DOMAIN_NAME("domain-name");
+
+    static const char* SERVICE_MAPPING("service-mapping");
+    static const char* SM_SERVICE_IP("service-ip");
+    static const char* SM_SERVICE_PROTO("service-proto");
+    static const char* SM_SERVICE_PORT("service-port");
+    static const char* SM_GATEWAY_IP("gateway-ip");
+    static const char* SM_NEXT_HOP_IP("next-hop-ip");
+    static const char* SM_NEXT_HOP_IPS("next-hop-ips");
+    static const char* SM_NEXT_HOP_PORT("next-hop-port");
+    static const char* SM_NODE_PORT("node-port");
+    static const char* SM_CONNTRACK("conntrack-enabled");
+    static const char* SVC_ATTRIBUTES("attributes");
     try {
-        using boost::property_tree::ptree;
-        Service newserv;
-        ptree properties;
+        std::unique_ptr<ParsedService> parsed(new ParsedService());
+        Service& newserv = parsed->service;
+        rapidjson::Document properties;
 
-        string pathstr = filePath.string();
+        json::readFile(filePath.string(), properties);
 
-        read_json(pathstr, properties);
-        newserv.setUUID(properties.get<string>(UUID));
+        optional<string> servUuid = json::getString(properties, UUID);
+        if (!servUuid)
+            throw runtime_error(string("No such node (") + UUID + ")");
+        newserv.setUUID(servUuid.get());
 
         std::string serviceModeStr =
-            properties.get<std::string>(SERVICE_MODE,
-                                        "local-anycast");
+            json::getString(properties, SERVICE_MODE)
+            .value_or("local-anycast");
         if (serviceModeStr == "loadbalancer") {
             newserv.setServiceMode(Service::LOADBALANCER);
         } else {
@@ -94,8 +105,7 @@ void FSServiceSource::updated(const fs::path& filePath) {
         }
 
         std::string serviceTypeStr =
-            properties.get<std::string>(SERVICE_TYPE,
-                                        "clusterIp");
+            json::getString(properties, SERVICE_TYPE).value_or("clusterIp");
         if (serviceTypeStr == "clusterIp") {
             newserv.setServiceType(Service::CLUSTER_IP);
         } else if (serviceTypeStr == "nodePort") {
@@ -104,37 +114,34 @@ void FSServiceSource::updated(const fs::path& filePath) {
             newserv.setServiceType(Service::LOAD_BALANCER);
         }
 
-        optional<string> serviceMac =
-            properties.get_optional<string>(SERVICE_MAC);
+        optional<string> serviceMac = json::getString(properties, SERVICE_MAC);
         if (serviceMac) {
             newserv.setServiceMAC(MAC(serviceMac.get()));
         }
 
         optional<string> ifaceName =
-            properties.get_optional<string>(INTERFACE_NAME);
+            json::getString(properties, INTERFACE_NAME);
         if (ifaceName)
             newserv.setInterfaceName(ifaceName.get());
 
         optional<uint16_t> ifaceVlan =
-            properties.get_optional<uint16_t>(INTERFACE_VLAN);
+            json::getUint<uint16_t>(properties, INTERFACE_VLAN);
         if (ifaceVlan)
             newserv.setIfaceVlan(ifaceVlan.get());
 
-        optional<string> ifaceIp =
-            properties.get_optional<string>(INTERFACE_IP);
+        optional<string> ifaceIp = json::getString(properties, INTERFACE_IP);
         if (ifaceIp) {
             newserv.setIfaceIP(ifaceIp.get());
         }
 
-        optional<string> domain =
-            properties.get_optional<string>(SERVICE_DOMAIN);
+        optional<string> domain = json::getString(properties, SERVICE_DOMAIN);
         if (domain) {
             newserv.setDomainURI(URI(domain.get()));
         } else {
             optional<string> domainName =
-                properties.get_optional<string>(DOMAIN_NAME);
+                json::getString(properties, DOMAIN_NAME);
             optional<string> domainPSpace =
-                properties.get_optional<string>(DOMAIN_POLICY_SPACE);
+                json::getString(properties, DOMAIN_POLICY_SPACE);
             if (domainName && domainPSpace) {
                 newserv.setDomainURI(opflex::modb::URIBuilder()
                                      .addElement("PolicyUniverse")
@@ -145,13 +152,12 @@ void FSServiceSource::updated(const fs::path& filePath) {
             }
         }
 
-        optional<ptree&> attrs =
-            properties.get_child_optional(SVC_ATTRIBUTES);
-        if (attrs) {
-            for (const ptree::value_type &v : attrs.get()) {
-                newserv.addAttribute(v.first, v.second.data());
-            }
-        } else {
+        bool hasAttrs =
+            json::forEachMember(properties, SVC_ATTRIBUTES,
+                                [&](const string& name, const string& value) {
+                                    newserv.addAttribute(name, value);
+                                });
+        if (!hasAttrs) {
             // In pod<--> svc stats MOs, we want to mention name of the service.
             // For k8s, "name" will be part of attr map. For OpenStack, there
             // wont be any attr map, in which case we instead use svc intf name.
@@ -196,75 +202,55 @@ void FSServiceSource::updated(const fs::path& filePath) {
             newserv.addAttribute("scope", "cluster");
         }
 
-        optional<ptree&> sms =
-            properties.get_child_optional(SERVICE_MAPPING);
-        if (sms) {
-            for (const ptree::value_type &v : sms.get()) {
-                Service::ServiceMapping sm;
-
-                optional<string> serviceIp =
-                    v.second.get_optional<string>(SM_SERVICE_IP);
-                if (serviceIp)
-                    sm.setServiceIP(serviceIp.get());
-
-                optional<string> serviceProto =
-                    v.second.get_optional<string>(SM_SERVICE_PROTO);
-                if (serviceProto)
-                    sm.setServiceProto(serviceProto.get());
-
-                optional<uint16_t> servicePort =
-                    v.second.get_optional<uint16_t>(SM_SERVICE_PORT);
-                if (servicePort)
-                    sm.setServicePort(servicePort.get());
-
-                optional<string> gatewayIp =
-                    v.second.get_optional<string>(SM_GATEWAY_IP);
-                if (gatewayIp)
-                    sm.setGatewayIP(gatewayIp.get());
-
-                optional<string> nextHopIp =
-                    v.second.get_optional<string>(SM_NEXT_HOP_IP);
-                if (nextHopIp)
-                    sm.addNextHopIP(nextHopIp.get());
-
-                optional<const ptree&> nhips =
-                    v.second.get_child_optional(SM_NEXT_HOP_IPS);
-                if (nhips) {
-                    for (auto& nhip : nhips.get()) {
-                        sm.addNextHopIP(nhip.second.data());
-                    }
-                }
-
-                optional<uint16_t> nextHopPort =
-                    v.second.get_optional<uint16_t>(SM_NEXT_HOP_PORT);
-                if (nextHopPort)
-                    sm.setNextHopPort(nextHopPort.get());
-
-                optional<uint16_t> nodePort =
-                    v.second.get_optional<uint16_t>(SM_NODE_PORT);
-                if (nodePort)
-                    sm.setNodePort(nodePort.get());
-
-                optional<bool> conntrack =
-                    v.second.get_optional<bool>(SM_CONNTRACK);
-                if (conntrack)
-                    sm.setConntrackMode(conntrack.get());
-
-                newserv.addServiceMapping(sm);
-            }
-        }
+        json::forEachElement(properties, SERVICE_MAPPING,
+                             [&](const rapidjson::Value& v) {
+            Service::ServiceMapping sm;
 
-        serv_map_t::const_iterator it = knownServs.find(pathstr);
-        if (it != knownServs.end()) {
-            if (newserv.getUUID() != it->second)
-                deleted(filePath);
-        }
-        knownServs[pathstr] = newserv.getUUID();
-        updateService(newserv);
+            optional<string> serviceIp = json::getString(v, SM_SERVICE_IP);
+            if (serviceIp)
+                sm.setServiceIP(serviceIp.get());
+
+            optional<string> serviceProto =
+                json::getString(v, SM_SERVICE_PROTO);
+            if (serviceProto)
+                sm.setServiceProto(serviceProto.get());
+
+            optional<uint16_t> servicePort =
+                json::getUint<uint16_t>(v, SM_SERVICE_PORT);
+            if (servicePort)
+                sm.setServicePort(servicePort.get());
+
+            optional<string> gatewayIp = json::getString(v, SM_GATEWAY_IP);
+            if (gatewayIp)
+                sm.setGatewayIP(gatewayIp.get());
+
+            optional<string> nextHopIp = json::getString(v, SM_NEXT_HOP_IP);
+            if (nextHopIp)
+                sm.addNextHopIP(nextHopIp.get());
 
-        LOG(INFO) << "Updated service " << newserv
-                  << " from " << filePath;
+            json::forEachString(v, SM_NEXT_HOP_IPS,
+                                [&](const string& nhip) {
+                                    sm.addNextHopIP(nhip);
+                                });
 
+            optional<uint16_t> nextHopPort =
+                json::getUint<uint16_t>(v, SM_NEXT_HOP_PORT);
+            if (nextHopPort)
+                sm.setNextHopPort(nextHopPort.get());
+
+            optional<uint16_t> nodePort =
+                json::getUint<uint16_t>(v, SM_NODE_PORT);
+            if (nodePort)
+                sm.setNodePort(nodePort.get());
+
+            optional<bool> conntrack = json::getBool(v, SM_CONNTRACK);
+            if (conntrack)
+                sm.setConntrackMode(conntrack.get());
+
+            newserv.addServiceMapping(sm);
+        });
+
+        return std::move(parsed);
     } catch (const std::exception& ex) {
         LOG(ERROR) << "Could not load service from: "
                    << filePath << ": "
@@ -274,6 +260,29 @@ void FSServiceSource::updated(const fs::path& filePath) {
                    << "information from "
                    << filePath;
     }
+    return nullptr;
+}
+
+void FSServiceSource::apply(const fs::path& filePath,
+                            std::unique_ptr<Parsed> parsed) {
+    if (!parsed) return;
+    const Service& newserv = static_cast<ParsedService&>(*parsed).service;
+
+    string pathstr = filePath.string();
+    serv_map_t::const_iterator it = knownServs.find(pathstr);
+    if (it != knownServs.end()) {
+        if (newserv.getUUID() != it->second)
+            deleted(filePath);
+    }
+    knownServs[pathstr] = newserv.getUUID();
+    updateService(newserv);
+
+    LOG(INFO) << "Updated service " << newserv
+              << " from " << filePath;
+}
+
+void FSServiceSource::updated(const fs::path& filePath) {
+    apply(filePath, parse(filePath));
 }
 
 void FSServiceSource::deleted(const fs::path& filePath) {
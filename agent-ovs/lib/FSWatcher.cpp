@@ -16,6 +16,10 @@
 
 #include <stdexcept>
 #include <sstream>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <unordered_set>
 
 #ifdef USE_INOTIFY
 #include <sys/inotify.h>
@@ -24,6 +28,9 @@
 #include <poll.h>
 #include <cerrno>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <arpa/inet.h>
 
 #include <boost/algorithm/string/predicate.hpp>
@@ -44,7 +51,22 @@ namespace fs = boost::filesystem;
 using opflex::modb::URI;
 using opflex::modb::MAC;
 
-FSWatcher::FSWatcher() : eventFd(-1), initialScan(true) {
+/**
+ * Number of files parsed during a parallel scan that are applied to
+ * the watchers at a time
+ */
+static const size_t SCAN_BATCH_SIZE = 256;
+
+/**
+ * Minimum age of a file modification time before it is used to
+ * detect unchanged files without reading them
+ */
+static const int64_t STABLE_MTIME_NS = 2000000000;
+
+FSWatcher::FSWatcher()
+    : eventFd(-1), initialScan(true), scanThreads(0),
+      suppressUnchanged(true), updateEvents(0), suppressedEvents(0),
+      deleteEvents(0) {
 
 }
 
@@ -64,6 +86,90 @@ void FSWatcher::setInitialScan(bool scan) {
     this->initialScan = scan;
 }
 
+void FSWatcher::setScanThreads(size_t threads) {
+    this->scanThreads = threads;
+}
+
+void FSWatcher::setSuppressUnchanged(bool suppress) {
+    this->suppressUnchanged = suppress;
+}
+
+/**
+ * Compute a 64-bit FNV-1a digest of the file contents
+ */
+static bool digestFile(const char* path, uint64_t& digest) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    uint64_t h = 14695981039346656037ULL;
+    char buf[8192];
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof(buf))) != 0) {
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            return false;
+        }
+        for (ssize_t i = 0; i < len; ++i) {
+            h ^= static_cast<uint8_t>(buf[i]);
+            h *= 1099511628211ULL;
+        }
+    }
+    close(fd);
+    digest = h;
+    return true;
+}
+
+bool FSWatcher::checkChanged(const fs::path& filePath) {
+    if (!suppressUnchanged) return true;
+
+    struct stat st;
+    if (stat(filePath.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        fileStates.erase(filePath);
+        return true;
+    }
+    FileState ns;
+    ns.size = st.st_size;
+    ns.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+        st.st_mtim.tv_nsec;
+    ns.ctime = static_cast<int64_t>(st.st_ctim.tv_sec) * 1000000000 +
+        st.st_ctim.tv_nsec;
+    ns.dev = st.st_dev;
+    ns.ino = st.st_ino;
+    ns.digest = 0;
+
+    // The size and timestamps are only trusted to skip hashing if
+    // the file was last modified well before its state was recorded,
+    // so that a rewrite within the timestamp granularity is not
+    // missed.  A file renamed into place is a different inode with a
+    // new ctime, even if its mtime was preserved, and is hashed.
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t nowNs = static_cast<int64_t>(now.tv_sec) * 1000000000 +
+        now.tv_nsec;
+    ns.stable = nowNs - std::max(ns.mtime, ns.ctime) > STABLE_MTIME_NS;
+
+    auto it = fileStates.find(filePath);
+    if (it != fileStates.end() && it->second.stable &&
+        it->second.dev == ns.dev && it->second.ino == ns.ino &&
+        it->second.size == ns.size && it->second.mtime == ns.mtime &&
+        it->second.ctime == ns.ctime)
+        return false;
+
+    if (!digestFile(filePath.c_str(), ns.digest)) {
+        fileStates.erase(filePath);
+        return true;
+    }
+    if (it != fileStates.end()) {
+        bool changed = it->second.digest != ns.digest ||
+            it->second.size != ns.size;
+        it->second = ns;
+        return changed;
+    }
+    fileStates.emplace(filePath, ns);
+    return true;
+}
+
 void FSWatcher::start() {
 #ifdef USE_INOTIFY
     if (regWatches.empty()) return;
@@ -124,6 +230,8 @@ void FSWatcher::scanPath(const WatchState* ws,
         fs::directory_iterator end;
         for (fs::directory_iterator it(watchPath); it != end; ++it) {
             if (fs::is_regular_file(it->status())) {
+                checkChanged(it->path());
+                updateEvents += 1;
                 for (Watcher* watcher : ws->watchers) {
                     watcher->updated(it->path());
                 }
@@ -132,6 +240,73 @@ void FSWatcher::scanPath(const WatchState* ws,
     }
 }
 
+void FSWatcher::parallelScanPath(const WatchState* ws,
+                                 const boost::filesystem::path& watchPath,
+                                 size_t threads) {
+    if (!fs::is_directory(watchPath)) return;
+
+    std::vector<fs::path> files;
+    fs::directory_iterator end;
+    for (fs::directory_iterator it(watchPath); it != end; ++it) {
+        if (fs::is_regular_file(it->status())) {
+            checkChanged(it->path());
+            files.push_back(it->path());
+        }
+    }
+    if (files.empty()) return;
+    updateEvents += files.size();
+
+    // parse all the files on the worker pool, then apply the results
+    // from this thread in directory order
+    size_t nwatchers = ws->watchers.size();
+    std::vector<std::unique_ptr<Watcher::Parsed>> results(files.size() *
+                                                          nwatchers);
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < files.size()) {
+            for (size_t w = 0; w < nwatchers; ++w) {
+                try {
+                    results[i * nwatchers + w] =
+                        ws->watchers[w]->parse(files[i]);
+                } catch (const std::exception& ex) {
+                    LOG(ERROR) << "Could not parse " << files[i]
+                               << ": " << ex.what();
+                } catch (...) {
+                    LOG(ERROR) << "Unknown error while parsing "
+                               << files[i];
+                }
+            }
+        }
+    };
+
+    threads = std::min(threads, files.size());
+    std::vector<thread> pool;
+    for (size_t t = 1; t < threads; ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (thread& t : pool)
+        t.join();
+
+    LOG(DEBUG) << "Parsed " << files.size() << " files from "
+               << watchPath << " using " << threads << " threads";
+
+    for (size_t start = 0; start < files.size(); start += SCAN_BATCH_SIZE) {
+        size_t bend = std::min(files.size(), start + SCAN_BATCH_SIZE);
+        for (size_t w = 0; w < nwatchers; ++w) {
+            Watcher* watcher = ws->watchers[w];
+            watcher->beginBatch();
+            for (size_t i = start; i < bend; ++i) {
+                std::unique_ptr<Watcher::Parsed>& r =
+                    results[i * nwatchers + w];
+                if (r)
+                    watcher->apply(files[i], std::move(r));
+            }
+            watcher->endBatch();
+        }
+    }
+}
+
 void FSWatcher::operator()() {
 #ifdef USE_INOTIFY
 #define EVENT_SIZE  ( sizeof (struct inotify_event) )
@@ -139,6 +314,7 @@ void FSWatcher::operator()() {
     struct pollfd fds[2];
     nfds_t nfds;
     char buf[EVENT_BUF_LEN];
+    std::unordered_set<Watcher*> allWatchers;
 
     int fd = inotify_init1(IN_NONBLOCK);
     if (fd < 0) {
@@ -157,10 +333,20 @@ void FSWatcher::operator()() {
             goto cleanup;
         }
         activeWatches[wd] = &w.second;
-        if (initialScan)
-            scanPath(&w.second, w.first);
+        if (initialScan) {
+            if (scanThreads > 1)
+                parallelScanPath(&w.second, w.first, scanThreads);
+            else
+                scanPath(&w.second, w.first);
+        }
     }
 
+    // watchers that see the events from a single read are given
+    // them as one batch
+    for (const path_map_t::value_type& w : regWatches)
+        allWatchers.insert(w.second.watchers.begin(),
+                           w.second.watchers.end());
+
     nfds = 2;
     // eventfd input
     fds[0].fd = eventFd;
@@ -197,6 +383,8 @@ void FSWatcher::operator()() {
 
                     if (len < 0) break;
 
+                    for (Watcher* watcher : allWatchers)
+                        watcher->beginBatch();
                     const struct inotify_event *event;
                     for (char* ptr = buf; ptr < buf + len;
                          ptr += sizeof(struct inotify_event) + event->len) {
@@ -204,17 +392,29 @@ void FSWatcher::operator()() {
 
                         if (event->len) {
                             const WatchState* ws = activeWatches.at(event->wd);
-                            for (Watcher* watcher : ws->watchers) {
-                                if ((event->mask & IN_CLOSE_WRITE) ||
-                                    (event->mask & IN_MOVED_TO)) {
-                                    watcher->updated(ws->watchPath / event->name);
-                                } else if ((event->mask & IN_DELETE) ||
-                                           (event->mask & IN_MOVED_FROM)) {
-                                    watcher->deleted(ws->watchPath / event->name);
+                            fs::path filePath = ws->watchPath / event->name;
+                            if ((event->mask & IN_CLOSE_WRITE) ||
+                                (event->mask & IN_MOVED_TO)) {
+                                if (!checkChanged(filePath)) {
+                                    LOG(DEBUG) << "Ignoring unchanged file "
+                                               << filePath;
+                                    suppressedEvents += 1;
+                                    continue;
                                 }
+                                updateEvents += 1;
+                                for (Watcher* watcher : ws->watchers)
+                                    watcher->updated(filePath);
+                            } else if ((event->mask & IN_DELETE) ||
+                                       (event->mask & IN_MOVED_FROM)) {
+                                fileStates.erase(filePath);
+                                deleteEvents += 1;
+                                for (Watcher* watcher : ws->watchers)
+                                    watcher->deleted(filePath);
                             }
                         }
                     }
+                    for (Watcher* watcher : allWatchers)
+                        watcher->endBatch();
                 }
             }
         }
@@ -39,6 +39,29 @@ void IdGenerator::setAllocHook(const std::string& nmspc,
     nitr->second.allocHook = allocHook;
 }
 
+void IdGenerator::setFreeHook(const std::string& nmspc,
+                              free_hook_t& freeHook) {
+    lock_guard<mutex> guard(id_mutex);
+    NamespaceMap::iterator nitr = namespaces.find(nmspc);
+    if (nitr == namespaces.end()) {
+        LOG(ERROR) << "Cannot set hook for uninitialized namespace: " << nmspc;
+        return;
+    }
+
+    nitr->second.freeHook = freeHook;
+}
+
+void IdGenerator::release(const std::string& nmspc, uint32_t id) {
+    lock_guard<mutex> guard(id_mutex);
+    NamespaceMap::iterator nitr = namespaces.find(nmspc);
+    if (nitr == namespaces.end()) {
+        return;
+    }
+
+    freeIdLocked(nitr->second, id);
+    LOG(DEBUG) << "Released ID " << id << " in namespace " << nmspc;
+}
+
 // The below method doesnt do any alloc if ID isnt created already
 uint32_t IdGenerator::getIdNoAlloc (const string& nmspc, const string& str) {
     lock_guard<mutex> guard(id_mutex);
@@ -52,14 +75,12 @@ uint32_t IdGenerator::getIdNoAlloc (const string& nmspc, const string& str) {
     // either the id will get deleted from "ids" during garbage collection
     // or if new alloc happens, then the id will get freed from erasedIds
     IdMap& idmap = nitr->second;
-    IdMap::Str2EIdMap::iterator eit = idmap.erasedIds.find(str);
-    if (eit != idmap.erasedIds.end())
-        return -1;
-
     IdMap::Str2IdMap::const_iterator it = idmap.ids.find(str);
     if (it == idmap.ids.end()) {
         return -1;
     }
+    if (idmap.erasedIds.find(it->second) != idmap.erasedIds.end())
+        return -1;
 
     return it->second;
 }
@@ -73,18 +94,14 @@ uint32_t IdGenerator::getId(const string& nmspc, const string& str) {
     }
 
     IdMap& idmap = nitr->second;
-    IdMap::Str2EIdMap::iterator eit = idmap.erasedIds.find(str);
-    if (eit != idmap.erasedIds.end())
-        idmap.erasedIds.erase(eit);
-
-    IdMap::Str2IdMap::const_iterator it = idmap.ids.find(str);
+    IdMap::Str2IdMap::iterator it = idmap.ids.find(str);
     if (it == idmap.ids.end()) {
         if (idmap.freeIds.empty()) {
             LOG(ERROR) << "No free IDS in namespace: " << nmspc;
             return -1;
         }
         id_range start = *idmap.freeIds.begin();
-        uint32_t newId = idmap.ids[str] = start.start;
+        uint32_t newId = start.start;
         if (idmap.allocHook) {
             if (!idmap.allocHook.get()(str, newId)) {
                 LOG(ERROR) << "ID allocation canceled by allocation hook";
@@ -95,7 +112,8 @@ uint32_t IdGenerator::getId(const string& nmspc, const string& str) {
         if (start.start < start.end)
             idmap.freeIds.insert(id_range(start.start + 1, start.end));
 
-        idmap.reverseMap[newId] = str;
+        it = idmap.ids.emplace(str, newId).first;
+        idmap.reverseMap[newId] = &it->first;
 
         LOG(DEBUG) << "Assigned " << nmspc << ":" << newId
             << " to id: " << str;
@@ -104,6 +122,7 @@ uint32_t IdGenerator::getId(const string& nmspc, const string& str) {
         return newId;
     }
 
+    idmap.erasedIds.erase(it->second);
     return it->second;
 }
 
@@ -122,7 +141,7 @@ IdGenerator::getStringForId(const std::string& nmspc, uint32_t id) {
     IdMap::Id2StrMap::iterator itr = idmap.reverseMap.find(id);
 
     if (itr != idmap.reverseMap.end()) {
-        return itr->second;
+        return *itr->second;
     }
 
     LOG(DEBUG) << "Unable to map to string for id:"
@@ -138,9 +157,9 @@ void IdGenerator::erase(const string& nmspc, const string& str) {
     }
 
     IdMap& idmap = nitr->second;
-    IdMap::Str2EIdMap::const_iterator it = idmap.erasedIds.find(str);
-    if (it == idmap.erasedIds.end()) {
-        idmap.erasedIds[str] = std::chrono::steady_clock::now();
+    IdMap::Str2IdMap::const_iterator it = idmap.ids.find(str);
+    if (it != idmap.ids.end()) {
+        idmap.erasedIds.emplace(it->second, std::chrono::steady_clock::now());
     }
 }
 
@@ -160,6 +179,21 @@ uint32_t IdGenerator::getFreeRangeCount(const std::string& nmspc) {
     return idmap.freeIds.size();
 }
 
+void IdGenerator::forEachFreeId(const std::string& nmspc,
+                                const std::function<void(uint32_t)>& visitor) {
+    lock_guard<mutex> guard(id_mutex);
+    NamespaceMap::iterator nitr = namespaces.find(nmspc);
+    if (nitr == namespaces.end()) {
+        return;
+    }
+
+    for (const id_range& r : nitr->second.freeIds) {
+        for (uint64_t id = r.start; id <= r.end; ++id) {
+            visitor(static_cast<uint32_t>(id));
+        }
+    }
+}
+
 uint32_t IdGenerator::getRemainingIdsLocked(const std::string& nmspc) {
     NamespaceMap::iterator nitr = namespaces.find(nmspc);
     if (nitr == namespaces.end()) {
@@ -180,63 +214,31 @@ void IdGenerator::cleanup() {
     for (NamespaceMap::value_type& nmv : namespaces) {
         bool changed = false;
         IdMap& idmap = nmv.second;
-        IdMap::Str2EIdMap::iterator it = idmap.erasedIds.begin();
+        IdMap::Id2EIdMap::iterator it = idmap.erasedIds.begin();
         while (it != idmap.erasedIds.end()) {
             if ((now - it->second) > cleanupInterval) {
-                IdMap::Str2IdMap::iterator iit = idmap.ids.find(it->first);
-                if (iit != idmap.ids.end()) {
-                    uint32_t erasedId = iit->second;
-
-                    // return erasedId to free set
-                    std::set<id_range>::iterator ub =
-                        std::upper_bound(idmap.freeIds.begin(),
-                                         idmap.freeIds.end(),
-                                         id_range(erasedId, erasedId));
-                    std::set<id_range>::iterator prev;
-                    if (ub != idmap.freeIds.end()) {
-                        prev = ub;
-                        prev--;
-                    } else {
-                        prev = idmap.freeIds.begin();
-                    }
-
-                    if (prev != idmap.freeIds.end() &&
-                        ub != idmap.freeIds.end() &&
-                        prev->end + 1 == erasedId &&
-                        erasedId + 1 == ub->start) {
-                        // merge prev and upper bound
-                        id_range newr(prev->start, ub->end);
-                        idmap.freeIds.erase(*prev);
-                        idmap.freeIds.erase(*ub);
-                        idmap.freeIds.insert(newr);
-                    } else if (prev != idmap.freeIds.end() &&
-                               prev->end + 1 == erasedId) {
-                        // extend prev bound range to include erased id
-                        id_range newprev(prev->start, erasedId);
-                        idmap.freeIds.erase(*prev);
-                        idmap.freeIds.insert(newprev);
-                    } else if (ub != idmap.freeIds.end() &&
-                               erasedId + 1 == ub->start) {
-                        // extend ub range to include erased Id
-                        id_range newub(erasedId, ub->end);
-                        idmap.freeIds.erase(*ub);
-                        idmap.freeIds.insert(newub);
-                    } else {
-                        // add new range for just this value
-                        idmap.freeIds.insert(id_range(erasedId, erasedId));
-                    }
+                uint32_t erasedId = it->first;
+                IdMap::Id2StrMap::iterator irmt =
+                    idmap.reverseMap.find(erasedId);
+                if (irmt != idmap.reverseMap.end()) {
+                    const string& str = *irmt->second;
+
+                    // the free hook may hold the ID back until it is
+                    // released
+                    if (!idmap.freeHook ||
+                        idmap.freeHook.get()(str, erasedId))
+                        freeIdLocked(idmap, erasedId);
                     changed = true;
 
-                    IdMap::Id2StrMap::iterator irmt =
-                        idmap.reverseMap.find(iit->second);
-                    if (irmt != idmap.reverseMap.end()) {
-                        idmap.reverseMap.erase(irmt);
-                    }
-
-                    idmap.ids.erase(iit);
-
-                    LOG(DEBUG) << "Cleaned up ID " << it->first
+                    LOG(DEBUG) << "Cleaned up ID " << str
                                << " in namespace " << nmv.first;
+
+                    // the string is owned by the ids map, so erase
+                    // it last
+                    IdMap::Str2IdMap::iterator iit = idmap.ids.find(str);
+                    idmap.reverseMap.erase(irmt);
+                    if (iit != idmap.ids.end())
+                        idmap.ids.erase(iit);
                 }
                 it = idmap.erasedIds.erase(it);
                 continue;
@@ -253,6 +255,47 @@ void IdGenerator::cleanup() {
     }
 }
 
+void IdGenerator::freeIdLocked(IdMap& idmap, uint32_t erasedId) {
+    // return erasedId to free set
+    std::set<id_range>::iterator ub =
+        std::upper_bound(idmap.freeIds.begin(),
+                         idmap.freeIds.end(),
+                         id_range(erasedId, erasedId));
+    std::set<id_range>::iterator prev;
+    if (ub != idmap.freeIds.end()) {
+        prev = ub;
+        prev--;
+    } else {
+        prev = idmap.freeIds.begin();
+    }
+
+    if (prev != idmap.freeIds.end() &&
+        ub != idmap.freeIds.end() &&
+        prev->end + 1 == erasedId &&
+        erasedId + 1 == ub->start) {
+        // merge prev and upper bound
+        id_range newr(prev->start, ub->end);
+        idmap.freeIds.erase(*prev);
+        idmap.freeIds.erase(*ub);
+        idmap.freeIds.insert(newr);
+    } else if (prev != idmap.freeIds.end() &&
+               prev->end + 1 == erasedId) {
+        // extend prev bound range to include erased id
+        id_range newprev(prev->start, erasedId);
+        idmap.freeIds.erase(*prev);
+        idmap.freeIds.insert(newprev);
+    } else if (ub != idmap.freeIds.end() &&
+               erasedId + 1 == ub->start) {
+        // extend ub range to include erased Id
+        id_range newub(erasedId, ub->end);
+        idmap.freeIds.erase(*ub);
+        idmap.freeIds.insert(newub);
+    } else {
+        // add new range for just this value
+        idmap.freeIds.insert(id_range(erasedId, erasedId));
+    }
+}
+
 string IdGenerator::getNamespaceFile(const string& nmspc) {
     assert(!persistDir.empty());
     return persistDir + "/" + nmspc + ".id";
@@ -299,6 +342,8 @@ void IdGenerator::initNamespace(const std::string& nmspc,
                                 uint32_t minId, uint32_t maxId) {
     lock_guard<mutex> guard(id_mutex);
     IdMap& idmap = namespaces[nmspc];
+    idmap.reverseMap.clear();
+    idmap.erasedIds.clear();
     idmap.ids.clear();
     idmap.freeIds.insert(id_range(minId, maxId));
 
@@ -350,11 +395,14 @@ void IdGenerator::initNamespace(const std::string& nmspc,
             LOG(WARNING) << "ID file corrupt: " << id << " above maximum";
         } else if (id < minId) {
             LOG(WARNING) << "ID file corrupt: " << id << " below minimum";
+        } else if (idmap.ids.find(*str) != idmap.ids.end()) {
+            LOG(WARNING) << "ID file corrupt: " << *str
+                         << " seen more than once";
         } else {
-            idmap.ids[*str] = id;
-            idmap.reverseMap[id] = *str;
+            auto it = idmap.ids.emplace(*str, id).first;
+            idmap.reverseMap[id] = &it->first;
+            usedIds.insert(id);
         }
-        usedIds.insert(id);
         LOG(DEBUG) << "Loaded str: " << *str << ", "
                    << nmspc << ":" << id;
     }
@@ -390,9 +438,8 @@ void IdGenerator::collectGarbage(const std::string& ns,
         if (cb(ns, uit->first))
             continue;
 
-        IdMap::Str2EIdMap::const_iterator it = map.erasedIds.find(uit->first);
-        if (it == map.erasedIds.end()) {
-            map.erasedIds[uit->first] = std::chrono::steady_clock::now();
+        if (map.erasedIds.emplace(uit->second,
+                                  std::chrono::steady_clock::now()).second) {
             LOG(DEBUG) << "Found garbage " << uit->first << " in " << ns;
         }
     }
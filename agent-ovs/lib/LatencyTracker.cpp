@@ -0,0 +1,221 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of LatencyTracker class
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/LatencyTracker.h>
+#include <opflexagent/logging.h>
+
+namespace opflexagent {
+
+using std::lock_guard;
+using std::mutex;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+const size_t LatencyTracker::BUCKET_COUNT;
+const uint64_t LatencyTracker::BUCKET_BASE_US;
+const std::chrono::seconds LatencyTracker::DEFAULT_MAX_AGE(30);
+
+LatencyTracker::LatencyTracker(size_t maxTraces_, size_t maxSlowOps_)
+    : maxTraces(maxTraces_), maxSlowOps(maxSlowOps_), enabled(true),
+      renderers(0), slowThreshold(std::chrono::seconds(1)),
+      maxAge(DEFAULT_MAX_AGE), dropped(0) {
+
+}
+
+void LatencyTracker::clear() {
+    traces.clear();
+    order.clear();
+}
+
+void LatencyTracker::retire(trace_map_t::iterator it) {
+    order.erase(it->second.pos);
+    traces.erase(it);
+}
+
+void LatencyTracker::setEnabled(bool enabled_) {
+    lock_guard<mutex> guard(trace_mutex);
+    enabled = enabled_;
+    if (!enabled)
+        clear();
+}
+
+void LatencyTracker::setSlowThreshold(std::chrono::milliseconds threshold) {
+    lock_guard<mutex> guard(trace_mutex);
+    slowThreshold = threshold;
+}
+
+void LatencyTracker::setMaxAge(std::chrono::milliseconds maxAge_) {
+    lock_guard<mutex> guard(trace_mutex);
+    maxAge = maxAge_;
+}
+
+void LatencyTracker::registerRenderer() {
+    lock_guard<mutex> guard(trace_mutex);
+    renderers += 1;
+}
+
+void LatencyTracker::unregisterRenderer() {
+    lock_guard<mutex> guard(trace_mutex);
+    if (renderers > 0)
+        renderers -= 1;
+    if (renderers == 0)
+        clear();
+}
+
+void LatencyTracker::begin(const std::string& key, clock::time_point start) {
+    clock::time_point now = clock::now();
+    lock_guard<mutex> guard(trace_mutex);
+    if (!enabled || renderers == 0)
+        return;
+
+    // traces for updates that never reach a renderer are abandoned;
+    // drop them once they are too old
+    clock::time_point expiry = now - maxAge;
+    while (!order.empty()) {
+        auto it = traces.find(*order.front());
+        if (it->second.start >= expiry)
+            break;
+        retire(it);
+        dropped += 1;
+    }
+
+    auto it = traces.find(key);
+    if (it != traces.end()) {
+        Trace& t = it->second;
+        if (t.lastStage < 0) {
+            // the same update entering the next component
+            if (start < t.start) {
+                t.start = start;
+                t.last = start;
+            }
+            return;
+        }
+        order.erase(t.pos);
+    } else {
+        if (traces.size() >= maxTraces && !order.empty()) {
+            retire(traces.find(*order.front()));
+            dropped += 1;
+        }
+        it = traces.emplace(key, Trace()).first;
+    }
+    Trace& t = it->second;
+    t.start = start;
+    t.last = start;
+    t.lastStage = -1;
+    t.stageUs.fill(0);
+    t.pos = order.insert(order.end(), &it->first);
+}
+
+static void addSample(LatencyTracker::Histogram& h, uint64_t us) {
+    h.buckets[LatencyTracker::getBucket(us)] += 1;
+    h.count += 1;
+    h.sumUs += us;
+    if (us > h.maxUs) h.maxUs = us;
+}
+
+void LatencyTracker::record(Trace& trace, Stage stage,
+                            clock::time_point now) {
+    if (now < trace.last)
+        now = trace.last;
+    uint64_t us = duration_cast<microseconds>(now - trace.last).count();
+    trace.stageUs[stage] = us;
+    trace.last = now;
+    trace.lastStage = stage;
+    addSample(histograms[stage], us);
+}
+
+void LatencyTracker::mark(const std::string& key, Stage stage) {
+    clock::time_point now = clock::now();
+    lock_guard<mutex> guard(trace_mutex);
+    auto it = traces.find(key);
+    if (it == traces.end() || it->second.lastStage >= stage)
+        return;
+    record(it->second, stage, now);
+}
+
+void LatencyTracker::finish(const std::string& key, Stage stage) {
+    clock::time_point now = clock::now();
+    lock_guard<mutex> guard(trace_mutex);
+    auto it = traces.find(key);
+    if (it == traces.end())
+        return;
+    Trace& t = it->second;
+    if (t.lastStage < stage)
+        record(t, stage, now);
+    t.stageUs[TOTAL] = duration_cast<microseconds>(t.last - t.start).count();
+    addSample(histograms[TOTAL], t.stageUs[TOTAL]);
+
+    if (microseconds(t.stageUs[TOTAL]) >= slowThreshold) {
+        LOG(DEBUG) << "Slow update for " << key << ": "
+                   << t.stageUs[TOTAL] << "us";
+        if (slowOps.size() >= maxSlowOps)
+            slowOps.pop_front();
+        slowOps.push_back(SlowOp());
+        SlowOp& op = slowOps.back();
+        op.key = key;
+        op.completed = std::chrono::system_clock::now();
+        op.stageUs = t.stageUs;
+    }
+    retire(it);
+}
+
+void LatencyTracker::abandon(const std::string& key) {
+    lock_guard<mutex> guard(trace_mutex);
+    auto it = traces.find(key);
+    if (it != traces.end())
+        retire(it);
+}
+
+LatencyTracker::Histogram LatencyTracker::getHistogram(Stage stage) const {
+    lock_guard<mutex> guard(trace_mutex);
+    return histograms[stage];
+}
+
+std::vector<LatencyTracker::SlowOp> LatencyTracker::getSlowOps() const {
+    lock_guard<mutex> guard(trace_mutex);
+    return std::vector<SlowOp>(slowOps.begin(), slowOps.end());
+}
+
+size_t LatencyTracker::getInFlight() const {
+    lock_guard<mutex> guard(trace_mutex);
+    return traces.size();
+}
+
+uint64_t LatencyTracker::getDropped() const {
+    lock_guard<mutex> guard(trace_mutex);
+    return dropped;
+}
+
+const char* LatencyTracker::getStageName(Stage stage) {
+    switch (stage) {
+    case SOURCE:
+        return "source";
+    case NOTIFY:
+        return "notify";
+    case QUEUE:
+        return "queue";
+    case RENDER:
+        return "render";
+    case TOTAL:
+        return "total";
+    default:
+        return "unknown";
+    }
+}
+
+size_t LatencyTracker::getBucket(uint64_t us) {
+    size_t b = 0;
+    while (b < BUCKET_COUNT - 1 && us > (BUCKET_BASE_US << b))
+        b += 1;
+    return b;
+}
+
+} /* namespace opflexagent */
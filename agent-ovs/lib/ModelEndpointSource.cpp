@@ -37,7 +37,10 @@ ModelEndpointSource::
 ModelEndpointSource(EndpointManager* manager_,
                     opflex::ofcore::OFFramework& framework_,
                     const std::set<std::string>& inventories_)
-    : EndpointSource(manager_), framework(framework_) {
+    : EndpointSource(manager_), framework(framework_),
+      io_service(manager_->getAgent().getAgentIOService()),
+      batch(std::make_shared<Batch>()) {
+    batch->source = this;
     LOG(INFO) << "Watching opflex model inventory for endpoint data";
     modelgbp::inv::LocalInventoryEp::registerListener(framework, this);
 
@@ -55,6 +58,11 @@ ModelEndpointSource(EndpointManager* manager_,
 
 ModelEndpointSource::~ModelEndpointSource() {
     modelgbp::inv::LocalInventoryEp::unregisterListener(framework, this);
+
+    // wait for a batch being applied, and leave any batch that is
+    // still queued with nothing to apply it to
+    std::lock_guard<std::mutex> guard(batch->flush_mutex);
+    batch->source = nullptr;
 }
 
 static const std::string IP_TYPE_DEFAULT("default");
@@ -67,6 +75,46 @@ static const std::string IFACE_TYPE_ACCESS_UPLINK("access-uplink");
 
 void ModelEndpointSource::objectUpdated (opflex::modb::class_id_t class_id,
                                          const opflex::modb::URI& uri) {
+    // Updates that arrive before the agent thread gets to the batch
+    // are applied together
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> guard(batch->mutex);
+        if (batch->queued.insert(uri.toString()).second)
+            batch->uris.push_back(uri);
+        if (!batch->scheduled) {
+            batch->scheduled = true;
+            schedule = true;
+        }
+    }
+    if (schedule) {
+        std::shared_ptr<Batch> b(batch);
+        io_service.post([b]() { flushBatch(b); });
+    }
+}
+
+void ModelEndpointSource::flushBatch(const std::shared_ptr<Batch>& batch) {
+    std::lock_guard<std::mutex> flushGuard(batch->flush_mutex);
+    vector<opflex::modb::URI> uris;
+    {
+        std::lock_guard<std::mutex> guard(batch->mutex);
+        uris.swap(batch->uris);
+        batch->queued.clear();
+        batch->scheduled = false;
+    }
+    if (!batch->source) return;
+
+    vector<Endpoint> updates;
+    vector<std::string> removals;
+    for (const opflex::modb::URI& uri : uris)
+        batch->source->processUpdate(uri, updates, removals);
+    batch->source->removeEndpoints(removals);
+    batch->source->updateEndpoints(updates);
+}
+
+void ModelEndpointSource::processUpdate(const opflex::modb::URI& uri,
+                                        vector<Endpoint>& updates,
+                                        vector<std::string>& removals) {
     using namespace modelgbp::inv;
 
     auto optep(LocalInventoryEp::resolve(framework, uri));
@@ -75,7 +123,7 @@ void ModelEndpointSource::objectUpdated (opflex::modb::class_id_t class_id,
         if (it != knownEps.end()) {
             LOG(INFO) << "Removed endpoint "
                       << it->second << " at " << uri;
-            removeEndpoint(it->second);
+            removals.push_back(it->second);
             knownEps.erase(it);
         }
         return;
@@ -282,7 +330,7 @@ void ModelEndpointSource::objectUpdated (opflex::modb::class_id_t class_id,
         }
 
         knownEps[uri.toString()] = newep.getUUID();
-        updateEndpoint(newep);
+        updates.push_back(newep);
 
         LOG(INFO) << "Updated endpoint " << newep
                   << " from " << uri;
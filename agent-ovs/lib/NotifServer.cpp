@@ -41,7 +41,7 @@ using rapidjson::Writer;
 using rapidjson::Value;
 
 NotifServer::NotifServer(ba::io_service& io_service_)
-    : io_service(io_service_), running(false) {
+    : io_service(io_service_), running(false), latencyTracker(nullptr) {
 
 }
 
@@ -61,6 +61,10 @@ void NotifServer::setSocketGroup(const std::string& group) {
     notifSocketGroup = group;
 }
 
+void NotifServer::setLatencyTracker(LatencyTracker* tracker) {
+    latencyTracker = tracker;
+}
+
 void NotifServer::setSocketPerms(const std::string& perms) {
     notifSocketPerms = perms;
 }
@@ -68,9 +72,11 @@ void NotifServer::setSocketPerms(const std::string& perms) {
 class NotifServer::session
     : public std::enable_shared_from_this<session> {
 public:
-    session(ba::io_service& io_service_, std::set<session_ptr>& sessions_)
+    session(ba::io_service& io_service_, std::set<session_ptr>& sessions_,
+            LatencyTracker* latencyTracker_)
         : io_service(io_service_), socket(io_service),
-          sessions(sessions_), msg_len(0) { }
+          sessions(sessions_), latencyTracker(latencyTracker_),
+          msg_len(0) { }
 
     stream_protocol::socket& get_socket() {
         return socket;
@@ -164,7 +170,7 @@ public:
                 }
 
                 if (request.HasMember("id")) {
-                    shared_ptr<StringBuffer> sb(new StringBuffer());
+                    shared_ptr<StringBuffer> sb(newMessage());
                     Writer<StringBuffer> writer(*sb);
                     writer.StartObject();
                     writer.Key("result");
@@ -176,6 +182,27 @@ public:
 
                     write(sb);
                 }
+            } else if ("latency" == std::string(m.GetString())) {
+                shared_ptr<StringBuffer> sb(newMessage());
+                Writer<StringBuffer> writer(*sb);
+                writer.StartObject();
+                if (latencyTracker) {
+                    writer.Key("result");
+                    writeLatency(writer);
+                } else {
+                    writer.Key("error");
+                    writer.StartObject();
+                    writer.Key("message");
+                    writer.String("Latency tracing not available");
+                    writer.EndObject();
+                }
+                if (request.HasMember("id")) {
+                    writer.Key("id");
+                    request["id"].Accept(writer);
+                }
+                writer.EndObject();
+
+                write(sb);
             }
 
             read();
@@ -210,6 +237,7 @@ private:
     ba::io_service& io_service;
     stream_protocol::socket socket;
     std::set<session_ptr>& sessions;
+    LatencyTracker* latencyTracker;
 
     std::unordered_set<std::string> subscriptions;
     uint32_t msg_len;
@@ -239,6 +267,72 @@ private:
         session_ptr session;
     };
 
+    static StringBuffer* newMessage() {
+        StringBuffer* sb = new StringBuffer();
+        // leave room to fill in message size later
+        sb->Put('\0');
+        sb->Put('\0');
+        sb->Put('\0');
+        sb->Put('\0');
+        return sb;
+    }
+
+    void writeLatency(Writer<StringBuffer>& writer) {
+        typedef LatencyTracker LT;
+        writer.StartObject();
+        writer.Key("in-flight");
+        writer.Uint64(latencyTracker->getInFlight());
+        writer.Key("dropped");
+        writer.Uint64(latencyTracker->getDropped());
+        writer.Key("bucket-bounds-us");
+        writer.StartArray();
+        for (size_t i = 0; i < LT::BUCKET_COUNT - 1; i++)
+            writer.Uint64(LT::BUCKET_BASE_US << i);
+        writer.EndArray();
+
+        writer.Key("stages");
+        writer.StartObject();
+        for (int i = 0; i < LT::STAGE_COUNT; i++) {
+            LT::Stage stage = static_cast<LT::Stage>(i);
+            LT::Histogram h = latencyTracker->getHistogram(stage);
+            writer.Key(LT::getStageName(stage));
+            writer.StartObject();
+            writer.Key("count");
+            writer.Uint64(h.count);
+            writer.Key("sum-us");
+            writer.Uint64(h.sumUs);
+            writer.Key("max-us");
+            writer.Uint64(h.maxUs);
+            writer.Key("buckets");
+            writer.StartArray();
+            for (uint64_t b : h.buckets)
+                writer.Uint64(b);
+            writer.EndArray();
+            writer.EndObject();
+        }
+        writer.EndObject();
+
+        writer.Key("slow");
+        writer.StartArray();
+        for (const LT::SlowOp& op : latencyTracker->getSlowOps()) {
+            writer.StartObject();
+            writer.Key("key");
+            writer.String(op.key.c_str());
+            writer.Key("completed-ms");
+            writer.Uint64(std::chrono::duration_cast<std::chrono::milliseconds>
+                          (op.completed.time_since_epoch()).count());
+            for (int i = 0; i < LT::STAGE_COUNT; i++) {
+                LT::Stage stage = static_cast<LT::Stage>(i);
+                writer.Key((std::string(LT::getStageName(stage)) +
+                            "-us").c_str());
+                writer.Uint64(op.stageUs[i]);
+            }
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+
     void write(shared_ptr<StringBuffer> message) {
         // write message length to first 4 bytes of message
         *reinterpret_cast<uint32_t*>(const_cast<char*>(message->GetString())) =
@@ -250,7 +344,8 @@ private:
 };
 
 void NotifServer::accept() {
-    session_ptr new_session(new session(io_service, sessions));
+    session_ptr new_session(new session(io_service, sessions,
+                                        latencyTracker));
     acceptor->
         async_accept(new_session->get_socket(),
                      [this, new_session](const boost::system::error_code& ec) {
@@ -25,6 +25,8 @@
 #include <prometheus/exposer.h>
 #include <prometheus/registry.h>
 #include <prometheus/detail/utils.h>
+#include <prometheus/collectable.h>
+#include <prometheus/metric_family.h>
 
 namespace opflexagent {
 
@@ -176,6 +178,131 @@ static string remote_ep_family_help[] =
   "number of remote endpoints under the same uplink port"
 };
 
+static string fswatcher_family_names[] =
+{
+  "opflex_fs_watcher_update_events",
+  "opflex_fs_watcher_suppressed_events",
+  "opflex_fs_watcher_delete_events"
+};
+
+static string fswatcher_family_help[] =
+{
+  "number of file updates delivered to the filesystem sources",
+  "number of file updates suppressed because the contents did not change",
+  "number of file deletes delivered to the filesystem sources"
+};
+
+static string ep_advert_family_names[] =
+{
+  "opflex_endpoint_advert_queue_depth",
+  "opflex_endpoint_advert_sent",
+  "opflex_endpoint_advert_coalesced",
+  "opflex_endpoint_advert_send_rate"
+};
+
+static string ep_advert_family_help[] =
+{
+  "number of endpoints waiting for an advertisement to be sent",
+  "number of endpoint advertisements sent",
+  "number of endpoint advertisement requests merged into a pending one",
+  "endpoint advertisements sent per second"
+};
+
+static string ct_zone_family_names[] =
+{
+  "opflex_ct_zone_flush_queue_depth",
+  "opflex_ct_zone_flushed_zones",
+  "opflex_ct_zone_flushed_entries",
+  "opflex_ct_zone_last_flush_ms"
+};
+
+static string ct_zone_family_help[] =
+{
+  "number of released conntrack zones waiting to be flushed",
+  "number of conntrack zones flushed in the background",
+  "number of conntrack entries deleted by zone flushes",
+  "duration of the last conntrack zone flush in milliseconds"
+};
+
+static string epg_render_family_names[] =
+{
+  "opflex_epg_render_fanouts",
+  "opflex_epg_render_skipped"
+};
+
+static string epg_render_family_help[] =
+{
+  "number of endpoint group updates that re-rendered their endpoints",
+  "number of endpoint group updates that left their endpoints alone"
+};
+
+static string task_queue_family_names[] =
+{
+  "opflex_task_queue_depth",
+  "opflex_task_queue_dispatched",
+  "opflex_task_queue_coalesced",
+  "opflex_task_queue_held",
+  "opflex_task_queue_overdue",
+  "opflex_task_queue_run",
+  "opflex_task_queue_wait_usec",
+  "opflex_task_queue_max_wait_usec",
+  "opflex_task_queue_run_usec",
+  "opflex_task_queue_max_run_usec"
+};
+
+static string task_queue_family_help[] =
+{
+  "number of tasks currently queued",
+  "number of times a task was dispatched",
+  "number of dispatches merged into a task that was already queued",
+  "number of dispatches held back behind a queued or running parent",
+  "number of holds skipped because the task waited past the hold limit",
+  "number of tasks that were run",
+  "total time tasks spent queued in microseconds",
+  "longest time a task spent queued in microseconds",
+  "total time spent running tasks in microseconds",
+  "longest time spent running a task in microseconds"
+};
+
+static string flow_table_family_names[] =
+{
+  "opflex_flow_table_flows",
+  "opflex_flow_table_adds",
+  "opflex_flow_table_mods",
+  "opflex_flow_table_deletes",
+  "opflex_flow_table_diff_usec",
+  "opflex_flow_table_encoded_bytes"
+};
+
+static string flow_table_family_help[] =
+{
+  "number of flows in the flow table",
+  "number of flows added to the flow table",
+  "number of flows modified in the flow table",
+  "number of flows deleted from the flow table",
+  "time spent computing flow table differences in microseconds",
+  "bytes of flow mods encoded for the flow table"
+};
+
+static string flow_object_family_names[] =
+{
+  "opflex_flow_object_flows",
+  "opflex_flow_object_adds",
+  "opflex_flow_object_mods",
+  "opflex_flow_object_deletes",
+  "opflex_flow_object_diff_usec"
+};
+
+static string flow_object_family_help[] =
+{
+  "number of flows owned by objects of the type",
+  "number of flows added for objects of the type",
+  "number of flows modified for objects of the type",
+  "number of flows deleted for objects of the type",
+  "time spent computing flow differences for objects of the type "
+  "in microseconds"
+};
+
 static string rddrop_family_names[] =
 {
   "opflex_policy_drop_bytes",
@@ -358,7 +485,7 @@ void PrometheusManager::removeDynamicGauges ()
     // Remove EpCounter related gauges
     {
         const lock_guard<mutex> lock(ep_counter_mutex);
-        removeDynamicGaugeEp();
+        removeEpLabels();
     }
 
     // Remove SvcTargetCounter related gauges
@@ -391,6 +518,43 @@ void PrometheusManager::removeDynamicGauges ()
         removeDynamicGaugeRemoteEp();
     }
 
+    // Remove FSWatcher related gauges
+    {
+        const lock_guard<mutex> lock(fswatcher_mutex);
+        removeDynamicGaugeFSWatcher();
+    }
+
+    // Remove endpoint advertisement related gauges
+    {
+        const lock_guard<mutex> lock(ep_advert_mutex);
+        removeDynamicGaugeEpAdvert();
+    }
+
+    // Remove conntrack zone flush related gauges
+    {
+        const lock_guard<mutex> lock(ct_zone_mutex);
+        removeDynamicGaugeCtZone();
+    }
+
+    // Remove endpoint group render related gauges
+    {
+        const lock_guard<mutex> lock(epg_render_mutex);
+        removeDynamicGaugeEpgRender();
+    }
+
+    // Remove task queue related gauges
+    {
+        const lock_guard<mutex> lock(task_queue_mutex);
+        removeDynamicGaugeTaskQueue();
+    }
+
+    // Remove flow table programming related gauges
+    {
+        const lock_guard<mutex> lock(flow_table_mutex);
+        removeDynamicGaugeFlowTable();
+        removeDynamicGaugeFlowObject();
+    }
+
     // Remove RDDropCounter related gauges
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
@@ -530,6 +694,133 @@ void PrometheusManager::createStaticGaugeFamiliesRemoteEp (void)
     }
 }
 
+// create all FSWatcher specific gauge families during start
+void PrometheusManager::createStaticGaugeFamiliesFSWatcher (void)
+{
+    for (FSWATCHER_METRICS metric=FSWATCHER_METRICS_MIN;
+            metric <= FSWATCHER_METRICS_MAX;
+                metric = FSWATCHER_METRICS(metric+1)) {
+        auto& gauge_fswatcher_family = BuildGauge()
+                             .Name(fswatcher_family_names[metric])
+                             .Help(fswatcher_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_fswatcher_family_ptr[metric] = &gauge_fswatcher_family;
+
+        // metrics per family will be created later
+        fswatcher_gauge_map[metric] = nullptr;
+    }
+}
+
+// create all endpoint advertisement specific gauge families during start
+void PrometheusManager::createStaticGaugeFamiliesEpAdvert (void)
+{
+    for (EP_ADVERT_METRICS metric=EP_ADVERT_METRICS_MIN;
+            metric <= EP_ADVERT_METRICS_MAX;
+                metric = EP_ADVERT_METRICS(metric+1)) {
+        auto& gauge_ep_advert_family = BuildGauge()
+                             .Name(ep_advert_family_names[metric])
+                             .Help(ep_advert_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_ep_advert_family_ptr[metric] = &gauge_ep_advert_family;
+
+        // metrics per family will be created later
+        ep_advert_gauge_map[metric] = nullptr;
+    }
+}
+
+// create all conntrack zone flush gauge families during start
+void PrometheusManager::createStaticGaugeFamiliesCtZone (void)
+{
+    for (CT_ZONE_METRICS metric=CT_ZONE_METRICS_MIN;
+            metric <= CT_ZONE_METRICS_MAX;
+                metric = CT_ZONE_METRICS(metric+1)) {
+        auto& gauge_ct_zone_family = BuildGauge()
+                             .Name(ct_zone_family_names[metric])
+                             .Help(ct_zone_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_ct_zone_family_ptr[metric] = &gauge_ct_zone_family;
+
+        // metrics per family will be created later
+        ct_zone_gauge_map[metric] = nullptr;
+    }
+}
+
+// create all endpoint group render gauge families during start
+void PrometheusManager::createStaticGaugeFamiliesEpgRender (void)
+{
+    for (EPG_RENDER_METRICS metric=EPG_RENDER_METRICS_MIN;
+            metric <= EPG_RENDER_METRICS_MAX;
+                metric = EPG_RENDER_METRICS(metric+1)) {
+        auto& gauge_epg_render_family = BuildGauge()
+                             .Name(epg_render_family_names[metric])
+                             .Help(epg_render_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_epg_render_family_ptr[metric] = &gauge_epg_render_family;
+
+        // metrics per family will be created later
+        epg_render_gauge_map[metric] = nullptr;
+    }
+}
+
+// create all task queue gauge families during start
+void PrometheusManager::createStaticGaugeFamiliesTaskQueue (void)
+{
+    for (TASK_QUEUE_METRICS metric=TASK_QUEUE_METRICS_MIN;
+            metric <= TASK_QUEUE_METRICS_MAX;
+                metric = TASK_QUEUE_METRICS(metric+1)) {
+        auto& gauge_task_queue_family = BuildGauge()
+                             .Name(task_queue_family_names[metric])
+                             .Help(task_queue_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_task_queue_family_ptr[metric] = &gauge_task_queue_family;
+
+        // metrics per family will be created later
+        task_queue_gauge_map[metric].clear();
+    }
+}
+
+// create all flow table programming gauge families during start
+void PrometheusManager::createStaticGaugeFamiliesFlowTable (void)
+{
+    for (FLOW_TABLE_METRICS metric=FLOW_TABLE_METRICS_MIN;
+            metric <= FLOW_TABLE_METRICS_MAX;
+                metric = FLOW_TABLE_METRICS(metric+1)) {
+        auto& gauge_flow_table_family = BuildGauge()
+                             .Name(flow_table_family_names[metric])
+                             .Help(flow_table_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_flow_table_family_ptr[metric] = &gauge_flow_table_family;
+
+        // metrics per family will be created later
+        flow_table_gauge_map[metric].clear();
+    }
+}
+
+// create all flow programming per object type gauge families during
+// start
+void PrometheusManager::createStaticGaugeFamiliesFlowObject (void)
+{
+    for (FLOW_OBJECT_METRICS metric=FLOW_OBJECT_METRICS_MIN;
+            metric <= FLOW_OBJECT_METRICS_MAX;
+                metric = FLOW_OBJECT_METRICS(metric+1)) {
+        auto& gauge_flow_object_family = BuildGauge()
+                             .Name(flow_object_family_names[metric])
+                             .Help(flow_object_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_flow_object_family_ptr[metric] = &gauge_flow_object_family;
+
+        // metrics per family will be created later
+        flow_object_gauge_map[metric].clear();
+    }
+}
+
 // create all RDDrop specific gauge families during start
 void PrometheusManager::createStaticGaugeFamiliesRDDrop (void)
 {
@@ -565,16 +856,8 @@ void PrometheusManager::createStaticGaugeFamiliesEp (void)
                          .Register(*registry_ptr);
     gauge_ep_total_family_ptr = &gauge_ep_total_family;
 
-    for (EP_METRICS metric=EP_RX_BYTES;
-            metric < EP_METRICS_MAX;
-                metric = EP_METRICS(metric+1)) {
-        auto& gauge_ep_family = BuildGauge()
-                             .Name(ep_family_names[metric])
-                             .Help(ep_family_help[metric])
-                             .Labels({})
-                             .Register(*registry_ptr);
-        gauge_ep_family_ptr[metric] = &gauge_ep_family;
-    }
+    // Per-ep metric families are rendered by EpCounterCollectable
+    // during scrape and are not registered here.
 }
 
 // create all SvcTarget specific gauge families during start
@@ -716,6 +999,37 @@ void PrometheusManager::createStaticGaugeFamilies (void)
         createStaticGaugeFamiliesRemoteEp();
     }
 
+    {
+        const lock_guard<mutex> lock(fswatcher_mutex);
+        createStaticGaugeFamiliesFSWatcher();
+    }
+
+    {
+        const lock_guard<mutex> lock(ep_advert_mutex);
+        createStaticGaugeFamiliesEpAdvert();
+    }
+
+    {
+        const lock_guard<mutex> lock(ct_zone_mutex);
+        createStaticGaugeFamiliesCtZone();
+    }
+
+    {
+        const lock_guard<mutex> lock(epg_render_mutex);
+        createStaticGaugeFamiliesEpgRender();
+    }
+
+    {
+        const lock_guard<mutex> lock(task_queue_mutex);
+        createStaticGaugeFamiliesTaskQueue();
+    }
+
+    {
+        const lock_guard<mutex> lock(flow_table_mutex);
+        createStaticGaugeFamiliesFlowTable();
+        createStaticGaugeFamiliesFlowObject();
+    }
+
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
         createStaticGaugeFamiliesRDDrop();
@@ -866,6 +1180,10 @@ void PrometheusManager::start (bool exposeLocalHostOnly, bool exposeEpSvcNan_)
     // ask the exposer to scrape the registry on incoming scrapes
     exposer_ptr->RegisterCollectable(registry_ptr);
 
+    // EpCounter metrics are pulled lazily from the stats universe
+    ep_collectable_ptr = make_shared<EpCounterCollectable>(*this);
+    exposer_ptr->RegisterCollectable(ep_collectable_ptr);
+
     string allowed;
     for (const auto& allow : agent.getPrometheusEpAttributes())
         allowed += allow+",";
@@ -883,11 +1201,6 @@ void PrometheusManager::init ()
         counter_ep_create_family_ptr = nullptr;
         counter_ep_remove_family_ptr = nullptr;
         gauge_ep_total_family_ptr = nullptr;
-        for (EP_METRICS metric=EP_RX_BYTES;
-                metric < EP_METRICS_MAX;
-                    metric = EP_METRICS(metric+1)) {
-            gauge_ep_family_ptr[metric] = nullptr;
-        }
     }
 
     {
@@ -942,6 +1255,69 @@ void PrometheusManager::init ()
         }
     }
 
+    {
+        const lock_guard<mutex> lock(fswatcher_mutex);
+        for (FSWATCHER_METRICS metric=FSWATCHER_METRICS_MIN;
+                metric <= FSWATCHER_METRICS_MAX;
+                    metric = FSWATCHER_METRICS(metric+1)) {
+            gauge_fswatcher_family_ptr[metric] = nullptr;
+            fswatcher_gauge_map[metric] = nullptr;
+        }
+    }
+
+    {
+        const lock_guard<mutex> lock(ep_advert_mutex);
+        for (EP_ADVERT_METRICS metric=EP_ADVERT_METRICS_MIN;
+                metric <= EP_ADVERT_METRICS_MAX;
+                    metric = EP_ADVERT_METRICS(metric+1)) {
+            gauge_ep_advert_family_ptr[metric] = nullptr;
+            ep_advert_gauge_map[metric] = nullptr;
+        }
+    }
+
+    {
+        const lock_guard<mutex> lock(ct_zone_mutex);
+        for (CT_ZONE_METRICS metric=CT_ZONE_METRICS_MIN;
+                metric <= CT_ZONE_METRICS_MAX;
+                    metric = CT_ZONE_METRICS(metric+1)) {
+            gauge_ct_zone_family_ptr[metric] = nullptr;
+            ct_zone_gauge_map[metric] = nullptr;
+        }
+    }
+
+    {
+        const lock_guard<mutex> lock(epg_render_mutex);
+        for (EPG_RENDER_METRICS metric=EPG_RENDER_METRICS_MIN;
+                metric <= EPG_RENDER_METRICS_MAX;
+                    metric = EPG_RENDER_METRICS(metric+1)) {
+            gauge_epg_render_family_ptr[metric] = nullptr;
+            epg_render_gauge_map[metric] = nullptr;
+        }
+    }
+
+    {
+        const lock_guard<mutex> lock(task_queue_mutex);
+        for (TASK_QUEUE_METRICS metric=TASK_QUEUE_METRICS_MIN;
+                metric <= TASK_QUEUE_METRICS_MAX;
+                    metric = TASK_QUEUE_METRICS(metric+1)) {
+            gauge_task_queue_family_ptr[metric] = nullptr;
+        }
+    }
+
+    {
+        const lock_guard<mutex> lock(flow_table_mutex);
+        for (FLOW_TABLE_METRICS metric=FLOW_TABLE_METRICS_MIN;
+                metric <= FLOW_TABLE_METRICS_MAX;
+                    metric = FLOW_TABLE_METRICS(metric+1)) {
+            gauge_flow_table_family_ptr[metric] = nullptr;
+        }
+        for (FLOW_OBJECT_METRICS metric=FLOW_OBJECT_METRICS_MIN;
+                metric <= FLOW_OBJECT_METRICS_MAX;
+                    metric = FLOW_OBJECT_METRICS(metric+1)) {
+            gauge_flow_object_family_ptr[metric] = nullptr;
+        }
+    }
+
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
         for (RDDROP_METRICS metric=RDDROP_METRICS_MIN;
@@ -1006,6 +1382,9 @@ void PrometheusManager::stop ()
     exposer_ptr.reset();
     exposer_ptr = nullptr;
 
+    ep_collectable_ptr.reset();
+    ep_collectable_ptr = nullptr;
+
     registry_ptr.reset();
     registry_ptr = nullptr;
 }
@@ -1327,6 +1706,143 @@ void PrometheusManager::createDynamicGaugeRemoteEp (REMOTE_EP_METRICS metric)
     remote_ep_gauge_map[metric] = &gauge;
 }
 
+// Create FSWatcher gauge given metric type
+void PrometheusManager::createDynamicGaugeFSWatcher (FSWATCHER_METRICS metric)
+{
+    // Retrieve the Gauge if its already created
+    if (getDynamicGaugeFSWatcher(metric))
+        return;
+
+    LOG(DEBUG) << "creating fs watcher dyn gauge family"
+               << " metric: " << metric;
+
+    auto& gauge = gauge_fswatcher_family_ptr[metric]->Add({});
+    fswatcher_gauge_map[metric] = &gauge;
+}
+
+// Create endpoint advertisement gauge given metric type
+void PrometheusManager::createDynamicGaugeEpAdvert (EP_ADVERT_METRICS metric)
+{
+    // Retrieve the Gauge if its already created
+    if (getDynamicGaugeEpAdvert(metric))
+        return;
+
+    LOG(DEBUG) << "creating endpoint advert dyn gauge family"
+               << " metric: " << metric;
+
+    auto& gauge = gauge_ep_advert_family_ptr[metric]->Add({});
+    ep_advert_gauge_map[metric] = &gauge;
+}
+
+// Create conntrack zone flush gauge given metric type
+void PrometheusManager::createDynamicGaugeCtZone (CT_ZONE_METRICS metric)
+{
+    // Retrieve the Gauge if its already created
+    if (getDynamicGaugeCtZone(metric))
+        return;
+
+    LOG(DEBUG) << "creating conntrack zone dyn gauge family"
+               << " metric: " << metric;
+
+    auto& gauge = gauge_ct_zone_family_ptr[metric]->Add({});
+    ct_zone_gauge_map[metric] = &gauge;
+}
+
+// Create endpoint group render gauge given metric type
+void PrometheusManager::createDynamicGaugeEpgRender (EPG_RENDER_METRICS metric)
+{
+    // Retrieve the Gauge if its already created
+    if (getDynamicGaugeEpgRender(metric))
+        return;
+
+    LOG(DEBUG) << "creating endpoint group render dyn gauge family"
+               << " metric: " << metric;
+
+    auto& gauge = gauge_epg_render_family_ptr[metric]->Add({});
+    epg_render_gauge_map[metric] = &gauge;
+}
+
+// Create task queue gauge given metric type and task class
+void PrometheusManager::createDynamicGaugeTaskQueue (TASK_QUEUE_METRICS metric,
+                                                     const string& task_class)
+{
+    // Retrieve the Gauge if its already created
+    if (getDynamicGaugeTaskQueue(metric, task_class))
+        return;
+
+    LOG(DEBUG) << "creating task queue dyn gauge family"
+               << " metric: " << metric
+               << " class: " << task_class;
+
+    auto& gauge = gauge_task_queue_family_ptr[metric]->Add({{"class",
+                                                             task_class}});
+    if (gauge_check.is_dup(&gauge)) {
+        LOG(ERROR) << "duplicate task queue dyn gauge family"
+                   << " metric: " << metric
+                   << " class: " << task_class;
+        return;
+    }
+    gauge_check.add(&gauge);
+    task_queue_gauge_map[metric][task_class] = &gauge;
+}
+
+// Create flow table gauge given metric type, bridge and table
+void PrometheusManager::createDynamicGaugeFlowTable (FLOW_TABLE_METRICS metric,
+                                                     const string& bridge_name,
+                                                     const string& table_name)
+{
+    // Retrieve the Gauge if its already created
+    if (getDynamicGaugeFlowTable(metric, bridge_name, table_name))
+        return;
+
+    LOG(DEBUG) << "creating flow table dyn gauge family"
+               << " metric: " << metric
+               << " bridge: " << bridge_name
+               << " table: " << table_name;
+
+    auto& gauge = gauge_flow_table_family_ptr[metric]->Add(
+                                            {{"bridge", bridge_name},
+                                             {"table", table_name}});
+    if (gauge_check.is_dup(&gauge)) {
+        LOG(ERROR) << "duplicate flow table dyn gauge family"
+                   << " metric: " << metric
+                   << " bridge: " << bridge_name
+                   << " table: " << table_name;
+        return;
+    }
+    gauge_check.add(&gauge);
+    flow_table_gauge_map[metric][make_pair(bridge_name, table_name)] = &gauge;
+}
+
+// Create flow object gauge given metric type, bridge and object type
+void PrometheusManager::createDynamicGaugeFlowObject (FLOW_OBJECT_METRICS metric,
+                                                      const string& bridge_name,
+                                                      const string& object_type)
+{
+    // Retrieve the Gauge if its already created
+    if (getDynamicGaugeFlowObject(metric, bridge_name, object_type))
+        return;
+
+    LOG(DEBUG) << "creating flow object dyn gauge family"
+               << " metric: " << metric
+               << " bridge: " << bridge_name
+               << " type: " << object_type;
+
+    auto& gauge = gauge_flow_object_family_ptr[metric]->Add(
+                                            {{"bridge", bridge_name},
+                                             {"type", object_type}});
+    if (gauge_check.is_dup(&gauge)) {
+        LOG(ERROR) << "duplicate flow object dyn gauge family"
+                   << " metric: " << metric
+                   << " bridge: " << bridge_name
+                   << " type: " << object_type;
+        return;
+    }
+    gauge_check.add(&gauge);
+    flow_object_gauge_map[metric][make_pair(bridge_name, object_type)] =
+        &gauge;
+}
+
 // Create RDDropCounter gauge given metric type, rdURI
 void PrometheusManager::createDynamicGaugeRDDrop (RDDROP_METRICS metric,
                                                   const string& rdURI)
@@ -1538,72 +2054,62 @@ void PrometheusManager::createDynamicGaugePodSvc (PODSVC_METRICS metric,
     podsvc_gauge_map[metric][uuid] = make_pair(std::move(label_map), &gauge);
 }
 
-// Create EpCounter gauge given metric type and an uuid
-bool PrometheusManager::createDynamicGaugeEp (EP_METRICS metric,
-                                              const string& uuid,
-                                              const string& ep_name,
-                                              const size_t& attr_hash,
+// Create or refresh the cached label set of an ep
+bool PrometheusManager::updateEpLabels (const string& uuid,
+                                        const string& ep_name,
+                                        const size_t& attr_hash,
                     const unordered_map<string, string>&    attr_map)
 {
     /**
-     * We create a hash of all the key, value pairs in label attr_map
-     * and then maintain a map of uuid to another pair of all attr hash
-     * and gauge ptr
-     * {uuid: pair(old_all_attr_hash, gauge_ptr)}
+     * Labels are cached per ep uuid along with the hash of the ep
+     * attributes they were built from:
+     * {uuid: (attr_hash, label_hash, labels)}
+     * The label map is rebuilt only when the incoming attribute hash
+     * differs from the cached one. The counter values themselves are
+     * read during scrape by EpCounterCollectable.
      */
-    auto hgauge = getDynamicGaugeEp(metric, uuid);
-    if (hgauge) {
-        /**
-         * Detect attribute change by comparing hashes:
-         * Check incoming hash with the cached hash to detect attribute change
-         * Note:
-         * - we dont do a delete and create of metric for every attribute change.
-         * Rather the dttribute's delete and create will get processed in EP Mgr.
-         * Then during periodic update of epCounter, we will detect attr change in
-         * PrometheusManager and do a delete/create of metric for latest label
-         * annotations.
-         * - by not doing del/add of metric for every attribute change, we reduce
-         * # of metric+label creation in prometheus.
-         */
-        if (attr_hash == hgauge.get().first)
+    bool added = true;
+    auto itr = ep_label_map.find(uuid);
+    if (itr != ep_label_map.end()) {
+        if (attr_hash == itr->second.attr_hash)
             return false;
-        else {
-            LOG(DEBUG) << "addNupdate epcounter: " << ep_name
-                       << " incoming attr_hash: " << attr_hash << "\n"
-                       << "existing ep metric, but deleting: hash modified;"
-                       << " metric: " << ep_family_names[metric]
-                       << " hash: " << hgauge.get().first
-                       << " gaugeptr: " << hgauge.get().second;
-            removeDynamicGaugeEp(metric, uuid);
-        }
+        LOG(DEBUG) << "addNupdate epcounter: " << ep_name
+                   << " incoming attr_hash: " << attr_hash
+                   << " existing attr_hash: " << itr->second.attr_hash
+                   << "; rebuilding labels";
+        ep_label_hashes.erase(itr->second.label_hash);
+        ep_label_map.erase(itr);
+        added = false;
     }
 
     auto label_map = createLabelMapFromEpAttr(ep_name,
                                               attr_map,
                                               agent.getPrometheusEpAttributes());
     auto hash = hash_labels(label_map);
-    auto& gauge = gauge_ep_family_ptr[metric]->Add(label_map);
-    if (gauge_check.is_dup(&gauge)) {
-        LOG(ERROR) << "duplicate ep dyn gauge family: " << ep_name
-                   << " metric: " << metric
+    if (!ep_label_hashes.insert(hash).second) {
+        LOG(ERROR) << "duplicate ep labels: " << ep_name
                    << " uuid: " << uuid
-                   << " label hash: " << hash
-                   << " gaugeptr: " << &gauge;
-        // Note: return true so that: if metrics are created before and later
-        // result in duplication due to change in attributes, the pre-duplicated
-        // metrics can get freed.
-        return true;
+                   << " label hash: " << hash;
+        // An ep whose labels got modified into a duplicate is no
+        // longer exposed, so account for it as removed.
+        if (!added) {
+            incStaticCounterEpRemove();
+            updateStaticGaugeEpTotal(false);
+        }
+        return false;
     }
-    LOG(DEBUG) << "created ep dyn gauge family: " << ep_name
-               << " metric: " << metric
-               << " uuid: " << uuid
-               << " label hash: " << hash
-               << " gaugeptr: " << &gauge;
-    gauge_check.add(&gauge);
 
-    ep_gauge_map[metric][uuid] = make_pair(hash, &gauge);
+    EpLabelState& state = ep_label_map[uuid];
+    state.attr_hash = attr_hash;
+    state.label_hash = hash;
+    state.labels.reserve(label_map.size());
+    for (const auto& label : label_map)
+        state.labels.push_back({label.first, label.second});
 
-    return true;
+    LOG(DEBUG) << "created ep labels: " << ep_name
+               << " uuid: " << uuid
+               << " label hash: " << hash;
+    return added;
 }
 
 // Create a label map that can be used for annotation, given the ep attr map
@@ -1837,6 +2343,64 @@ Gauge * PrometheusManager::getDynamicGaugeRemoteEp (REMOTE_EP_METRICS metric)
     return remote_ep_gauge_map[metric];
 }
 
+// Get FSWatcher gauge given the metric
+Gauge * PrometheusManager::getDynamicGaugeFSWatcher (FSWATCHER_METRICS metric)
+{
+    return fswatcher_gauge_map[metric];
+}
+
+// Get endpoint advertisement gauge given the metric
+Gauge * PrometheusManager::getDynamicGaugeEpAdvert (EP_ADVERT_METRICS metric)
+{
+    return ep_advert_gauge_map[metric];
+}
+
+// Get conntrack zone flush gauge given the metric
+Gauge * PrometheusManager::getDynamicGaugeCtZone (CT_ZONE_METRICS metric)
+{
+    return ct_zone_gauge_map[metric];
+}
+
+// Get endpoint group render gauge given the metric
+Gauge * PrometheusManager::getDynamicGaugeEpgRender (EPG_RENDER_METRICS metric)
+{
+    return epg_render_gauge_map[metric];
+}
+
+// Get task queue gauge given the metric type and task class
+Gauge * PrometheusManager::getDynamicGaugeTaskQueue (TASK_QUEUE_METRICS metric,
+                                                     const string& task_class)
+{
+    auto itr = task_queue_gauge_map[metric].find(task_class);
+    if (itr == task_queue_gauge_map[metric].end())
+        return nullptr;
+    return itr->second;
+}
+
+// Get flow table gauge given the metric type, bridge and table
+Gauge * PrometheusManager::getDynamicGaugeFlowTable (FLOW_TABLE_METRICS metric,
+                                                     const string& bridge_name,
+                                                     const string& table_name)
+{
+    auto itr = flow_table_gauge_map[metric].find(make_pair(bridge_name,
+                                                           table_name));
+    if (itr == flow_table_gauge_map[metric].end())
+        return nullptr;
+    return itr->second;
+}
+
+// Get flow object gauge given the metric type, bridge and object type
+Gauge * PrometheusManager::getDynamicGaugeFlowObject (FLOW_OBJECT_METRICS metric,
+                                                      const string& bridge_name,
+                                                      const string& object_type)
+{
+    auto itr = flow_object_gauge_map[metric].find(make_pair(bridge_name,
+                                                            object_type));
+    if (itr == flow_object_gauge_map[metric].end())
+        return nullptr;
+    return itr->second;
+}
+
 // Get RDDropCounter gauge given the metric, rdURI
 Gauge * PrometheusManager::getDynamicGaugeRDDrop (RDDROP_METRICS metric,
                                                   const string& rdURI)
@@ -1905,21 +2469,6 @@ mgauge_pair_t PrometheusManager::getDynamicGaugePodSvc (PODSVC_METRICS metric,
     return mgauge;
 }
 
-// Get EpCounter gauge given the metric, uuid of EP
-hgauge_pair_t PrometheusManager::getDynamicGaugeEp (EP_METRICS metric,
-                                                   const string& uuid)
-{
-    hgauge_pair_t hgauge = boost::none;
-    auto itr = ep_gauge_map[metric].find(uuid);
-    if (itr == ep_gauge_map[metric].end()) {
-        LOG(DEBUG) << "Dyn Gauge EpCounter not found " << uuid;
-    } else {
-        hgauge = itr->second;
-    }
-
-    return hgauge;
-}
-
 // Remove dynamic ContractClassifierCounter gauge given a metic type and
 // name of srcEpg, dstEpg & classifier
 bool PrometheusManager::removeDynamicGaugeContractClassifier (CONTRACT_METRICS metric,
@@ -2043,6 +2592,144 @@ void PrometheusManager::removeDynamicGaugeRemoteEp ()
     }
 }
 
+// Remove dynamic FSWatcher gauge given a metic type
+bool PrometheusManager::removeDynamicGaugeFSWatcher (FSWATCHER_METRICS metric)
+{
+    Gauge *pgauge = getDynamicGaugeFSWatcher(metric);
+    if (pgauge) {
+        gauge_fswatcher_family_ptr[metric]->Remove(pgauge);
+        fswatcher_gauge_map[metric] = nullptr;
+    } else {
+        LOG(DEBUG) << "remove dynamic gauge FSWatcher not found";
+        return false;
+    }
+    return true;
+}
+
+// Remove dynamic FSWatcher gauges for all metrics
+void PrometheusManager::removeDynamicGaugeFSWatcher ()
+{
+    for (FSWATCHER_METRICS metric=FSWATCHER_METRICS_MIN;
+            metric <= FSWATCHER_METRICS_MAX;
+                metric = FSWATCHER_METRICS(metric+1)) {
+        removeDynamicGaugeFSWatcher(metric);
+    }
+}
+
+// Remove dynamic endpoint advertisement gauge given a metic type
+bool PrometheusManager::removeDynamicGaugeEpAdvert (EP_ADVERT_METRICS metric)
+{
+    Gauge *pgauge = getDynamicGaugeEpAdvert(metric);
+    if (pgauge) {
+        gauge_ep_advert_family_ptr[metric]->Remove(pgauge);
+        ep_advert_gauge_map[metric] = nullptr;
+    } else {
+        LOG(DEBUG) << "remove dynamic gauge EpAdvert not found";
+        return false;
+    }
+    return true;
+}
+
+// Remove dynamic endpoint advertisement gauges for all metrics
+void PrometheusManager::removeDynamicGaugeEpAdvert ()
+{
+    for (EP_ADVERT_METRICS metric=EP_ADVERT_METRICS_MIN;
+            metric <= EP_ADVERT_METRICS_MAX;
+                metric = EP_ADVERT_METRICS(metric+1)) {
+        removeDynamicGaugeEpAdvert(metric);
+    }
+}
+
+// Remove dynamic conntrack zone flush gauge given a metic type
+bool PrometheusManager::removeDynamicGaugeCtZone (CT_ZONE_METRICS metric)
+{
+    Gauge *pgauge = getDynamicGaugeCtZone(metric);
+    if (pgauge) {
+        gauge_ct_zone_family_ptr[metric]->Remove(pgauge);
+        ct_zone_gauge_map[metric] = nullptr;
+    } else {
+        LOG(DEBUG) << "remove dynamic gauge CtZone not found";
+        return false;
+    }
+    return true;
+}
+
+// Remove dynamic conntrack zone flush gauges for all metrics
+void PrometheusManager::removeDynamicGaugeCtZone ()
+{
+    for (CT_ZONE_METRICS metric=CT_ZONE_METRICS_MIN;
+            metric <= CT_ZONE_METRICS_MAX;
+                metric = CT_ZONE_METRICS(metric+1)) {
+        removeDynamicGaugeCtZone(metric);
+    }
+}
+
+// Remove dynamic endpoint group render gauge given a metic type
+bool PrometheusManager::removeDynamicGaugeEpgRender (EPG_RENDER_METRICS metric)
+{
+    Gauge *pgauge = getDynamicGaugeEpgRender(metric);
+    if (pgauge) {
+        gauge_epg_render_family_ptr[metric]->Remove(pgauge);
+        epg_render_gauge_map[metric] = nullptr;
+    } else {
+        LOG(DEBUG) << "remove dynamic gauge EpgRender not found";
+        return false;
+    }
+    return true;
+}
+
+// Remove dynamic endpoint group render gauges for all metrics
+void PrometheusManager::removeDynamicGaugeEpgRender ()
+{
+    for (EPG_RENDER_METRICS metric=EPG_RENDER_METRICS_MIN;
+            metric <= EPG_RENDER_METRICS_MAX;
+                metric = EPG_RENDER_METRICS(metric+1)) {
+        removeDynamicGaugeEpgRender(metric);
+    }
+}
+
+// Remove dynamic task queue gauges for all metrics and task classes
+void PrometheusManager::removeDynamicGaugeTaskQueue ()
+{
+    for (TASK_QUEUE_METRICS metric=TASK_QUEUE_METRICS_MIN;
+            metric <= TASK_QUEUE_METRICS_MAX;
+                metric = TASK_QUEUE_METRICS(metric+1)) {
+        for (auto& kv : task_queue_gauge_map[metric]) {
+            gauge_check.remove(kv.second);
+            gauge_task_queue_family_ptr[metric]->Remove(kv.second);
+        }
+        task_queue_gauge_map[metric].clear();
+    }
+}
+
+// Remove dynamic flow table gauges for all metrics and tables
+void PrometheusManager::removeDynamicGaugeFlowTable ()
+{
+    for (FLOW_TABLE_METRICS metric=FLOW_TABLE_METRICS_MIN;
+            metric <= FLOW_TABLE_METRICS_MAX;
+                metric = FLOW_TABLE_METRICS(metric+1)) {
+        for (auto& kv : flow_table_gauge_map[metric]) {
+            gauge_check.remove(kv.second);
+            gauge_flow_table_family_ptr[metric]->Remove(kv.second);
+        }
+        flow_table_gauge_map[metric].clear();
+    }
+}
+
+// Remove dynamic flow object gauges for all metrics and object types
+void PrometheusManager::removeDynamicGaugeFlowObject ()
+{
+    for (FLOW_OBJECT_METRICS metric=FLOW_OBJECT_METRICS_MIN;
+            metric <= FLOW_OBJECT_METRICS_MAX;
+                metric = FLOW_OBJECT_METRICS(metric+1)) {
+        for (auto& kv : flow_object_gauge_map[metric]) {
+            gauge_check.remove(kv.second);
+            gauge_flow_object_family_ptr[metric]->Remove(kv.second);
+        }
+        flow_object_gauge_map[metric].clear();
+    }
+}
+
 // Remove dynamic RDDropCounter gauge given a metic type and rdURI
 bool PrometheusManager::removeDynamicGaugeRDDrop (RDDROP_METRICS metric,
                                                   const string& rdURI)
@@ -2261,51 +2948,30 @@ void PrometheusManager::removeDynamicGaugePodSvc ()
     }
 }
 
-// Remove dynamic EpCounter gauge given a metic type and ep uuid
-bool PrometheusManager::removeDynamicGaugeEp (EP_METRICS metric,
-                                              const string& uuid)
+// Remove the cached label set of an ep given uuid
+bool PrometheusManager::removeEpLabels (const string& uuid)
 {
-    auto hgauge = getDynamicGaugeEp(metric, uuid);
-    if (hgauge) {
-        ep_gauge_map[metric].erase(uuid);
-        gauge_check.remove(hgauge.get().second);
-        gauge_ep_family_ptr[metric]->Remove(hgauge.get().second);
-    } else {
-        LOG(DEBUG) << "remove dynamic gauge ep not found uuid:" << uuid;
+    auto itr = ep_label_map.find(uuid);
+    if (itr == ep_label_map.end()) {
+        LOG(DEBUG) << "remove ep labels not found uuid:" << uuid;
         return false;
     }
+    ep_label_hashes.erase(itr->second.label_hash);
+    ep_label_map.erase(itr);
     return true;
 }
 
-// Remove dynamic EpCounter gauge given a metic type
-void PrometheusManager::removeDynamicGaugeEp (EP_METRICS metric)
-{
-    auto itr = ep_gauge_map[metric].begin();
-    while (itr != ep_gauge_map[metric].end()) {
-        LOG(DEBUG) << "Delete Ep uuid: " << itr->first
-                   << " hash: " << itr->second.get().first
-                   << " Gauge: " << itr->second.get().second;
-        gauge_check.remove(itr->second.get().second);
-        gauge_ep_family_ptr[metric]->Remove(itr->second.get().second);
-        itr++;
-
-        if (metric == (EP_METRICS_MAX-1)) {
-            incStaticCounterEpRemove();
-            updateStaticGaugeEpTotal(false);
-        }
-    }
-
-    ep_gauge_map[metric].clear();
-}
-
-// Remove dynamic EpCounter gauges for all metrics
-void PrometheusManager::removeDynamicGaugeEp ()
+// Remove the cached label sets of all eps
+void PrometheusManager::removeEpLabels ()
 {
-    for (EP_METRICS metric=EP_RX_BYTES;
-            metric < EP_METRICS_MAX;
-                metric = EP_METRICS(metric+1)) {
-        removeDynamicGaugeEp(metric);
+    for (const auto& p : ep_label_map) {
+        LOG(DEBUG) << "Delete Ep uuid: " << p.first
+                   << " label hash: " << p.second.label_hash;
+        incStaticCounterEpRemove();
+        updateStaticGaugeEpTotal(false);
     }
+    ep_label_map.clear();
+    ep_label_hashes.clear();
 }
 
 // Remove all dynamically allocated counter families
@@ -2392,6 +3058,76 @@ void PrometheusManager::removeStaticGaugeFamiliesRemoteEp ()
     }
 }
 
+// Remove all statically allocated FSWatcher gauge families
+void PrometheusManager::removeStaticGaugeFamiliesFSWatcher ()
+{
+    for (FSWATCHER_METRICS metric=FSWATCHER_METRICS_MIN;
+            metric <= FSWATCHER_METRICS_MAX;
+                metric = FSWATCHER_METRICS(metric+1)) {
+        gauge_fswatcher_family_ptr[metric] = nullptr;
+    }
+}
+
+// Remove all statically allocated endpoint advertisement gauge families
+void PrometheusManager::removeStaticGaugeFamiliesEpAdvert ()
+{
+    for (EP_ADVERT_METRICS metric=EP_ADVERT_METRICS_MIN;
+            metric <= EP_ADVERT_METRICS_MAX;
+                metric = EP_ADVERT_METRICS(metric+1)) {
+        gauge_ep_advert_family_ptr[metric] = nullptr;
+    }
+}
+
+// Remove all statically allocated conntrack zone gauge families
+void PrometheusManager::removeStaticGaugeFamiliesCtZone ()
+{
+    for (CT_ZONE_METRICS metric=CT_ZONE_METRICS_MIN;
+            metric <= CT_ZONE_METRICS_MAX;
+                metric = CT_ZONE_METRICS(metric+1)) {
+        gauge_ct_zone_family_ptr[metric] = nullptr;
+    }
+}
+
+// Remove all statically allocated endpoint group render gauge families
+void PrometheusManager::removeStaticGaugeFamiliesEpgRender ()
+{
+    for (EPG_RENDER_METRICS metric=EPG_RENDER_METRICS_MIN;
+            metric <= EPG_RENDER_METRICS_MAX;
+                metric = EPG_RENDER_METRICS(metric+1)) {
+        gauge_epg_render_family_ptr[metric] = nullptr;
+    }
+}
+
+// Remove all statically allocated task queue gauge families
+void PrometheusManager::removeStaticGaugeFamiliesTaskQueue ()
+{
+    for (TASK_QUEUE_METRICS metric=TASK_QUEUE_METRICS_MIN;
+            metric <= TASK_QUEUE_METRICS_MAX;
+                metric = TASK_QUEUE_METRICS(metric+1)) {
+        gauge_task_queue_family_ptr[metric] = nullptr;
+    }
+}
+
+// Remove all statically allocated flow table gauge families
+void PrometheusManager::removeStaticGaugeFamiliesFlowTable ()
+{
+    for (FLOW_TABLE_METRICS metric=FLOW_TABLE_METRICS_MIN;
+            metric <= FLOW_TABLE_METRICS_MAX;
+                metric = FLOW_TABLE_METRICS(metric+1)) {
+        gauge_flow_table_family_ptr[metric] = nullptr;
+    }
+}
+
+// Remove all statically allocated flow object gauge families
+void PrometheusManager::removeStaticGaugeFamiliesFlowObject ()
+{
+    for (FLOW_OBJECT_METRICS metric=FLOW_OBJECT_METRICS_MIN;
+            metric <= FLOW_OBJECT_METRICS_MAX;
+                metric = FLOW_OBJECT_METRICS(metric+1)) {
+        gauge_flow_object_family_ptr[metric] = nullptr;
+    }
+}
+
 // Remove all statically allocated RDDrop gauge families
 void PrometheusManager::removeStaticGaugeFamiliesRDDrop ()
 {
@@ -2416,11 +3152,6 @@ void PrometheusManager::removeStaticGaugeFamiliesPodSvc()
 void PrometheusManager::removeStaticGaugeFamiliesEp()
 {
     gauge_ep_total_family_ptr = nullptr;
-    for (EP_METRICS metric=EP_RX_BYTES;
-            metric < EP_METRICS_MAX;
-                metric = EP_METRICS(metric+1)) {
-        gauge_ep_family_ptr[metric] = nullptr;
-    }
 }
 
 // Remove all statically allocated svc target gauge families
@@ -2493,6 +3224,43 @@ void PrometheusManager::removeStaticGaugeFamilies()
         removeStaticGaugeFamiliesRemoteEp();
     }
 
+    // FSWatcher specific
+    {
+        const lock_guard<mutex> lock(fswatcher_mutex);
+        removeStaticGaugeFamiliesFSWatcher();
+    }
+
+    // Endpoint advertisement specific
+    {
+        const lock_guard<mutex> lock(ep_advert_mutex);
+        removeStaticGaugeFamiliesEpAdvert();
+    }
+
+    // Conntrack zone flush specific
+    {
+        const lock_guard<mutex> lock(ct_zone_mutex);
+        removeStaticGaugeFamiliesCtZone();
+    }
+
+    // Endpoint group render specific
+    {
+        const lock_guard<mutex> lock(epg_render_mutex);
+        removeStaticGaugeFamiliesEpgRender();
+    }
+
+    // Task queue specific
+    {
+        const lock_guard<mutex> lock(task_queue_mutex);
+        removeStaticGaugeFamiliesTaskQueue();
+    }
+
+    // Flow table programming specific
+    {
+        const lock_guard<mutex> lock(flow_table_mutex);
+        removeStaticGaugeFamiliesFlowTable();
+        removeStaticGaugeFamiliesFlowObject();
+    }
+
     // RDDropCounter specific
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
@@ -2875,6 +3643,307 @@ void PrometheusManager::addNUpdateRemoteEpCount (size_t count)
     }
 }
 
+/* Function called from PolicyStatsManager to update FSWatcher stats */
+void PrometheusManager::addNUpdateFSWatcherStats (void)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(fswatcher_mutex);
+
+    FSWatcher& fsWatcher = agent.getFSWatcher();
+    for (FSWATCHER_METRICS metric=FSWATCHER_METRICS_MIN;
+            metric <= FSWATCHER_METRICS_MAX;
+                metric = FSWATCHER_METRICS(metric+1)) {
+        // create the metric if its not present
+        createDynamicGaugeFSWatcher(metric);
+        Gauge *pgauge = getDynamicGaugeFSWatcher(metric);
+        if (!pgauge)
+            continue;
+        uint64_t value = 0;
+        switch (metric) {
+        case FSWATCHER_UPDATE_EVENTS:
+            value = fsWatcher.getUpdateEvents();
+            break;
+        case FSWATCHER_SUPPRESSED_EVENTS:
+            value = fsWatcher.getSuppressedEvents();
+            break;
+        case FSWATCHER_DELETE_EVENTS:
+            value = fsWatcher.getDeleteEvents();
+            break;
+        default:
+            LOG(ERROR) << "Unhandled fs watcher metric: " << metric;
+            break;
+        }
+        pgauge->Set(static_cast<double>(value));
+    }
+}
+
+/* Function called from AdvertManager to update endpoint advertisement
+ * stats */
+void PrometheusManager::addNUpdateEpAdvertStats (size_t queueDepth,
+                                                 uint64_t sent,
+                                                 uint64_t coalesced,
+                                                 double sendRate)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(ep_advert_mutex);
+
+    for (EP_ADVERT_METRICS metric=EP_ADVERT_METRICS_MIN;
+            metric <= EP_ADVERT_METRICS_MAX;
+                metric = EP_ADVERT_METRICS(metric+1)) {
+        // create the metric if its not present
+        createDynamicGaugeEpAdvert(metric);
+        Gauge *pgauge = getDynamicGaugeEpAdvert(metric);
+        if (!pgauge)
+            continue;
+        double value = 0;
+        switch (metric) {
+        case EP_ADVERT_QUEUE_DEPTH:
+            value = static_cast<double>(queueDepth);
+            break;
+        case EP_ADVERT_SENT:
+            value = static_cast<double>(sent);
+            break;
+        case EP_ADVERT_COALESCED:
+            value = static_cast<double>(coalesced);
+            break;
+        case EP_ADVERT_SEND_RATE:
+            value = sendRate;
+            break;
+        default:
+            LOG(ERROR) << "Unhandled endpoint advert metric: " << metric;
+            break;
+        }
+        pgauge->Set(value);
+    }
+}
+
+/* Function called from OVSRenderer to update conntrack zone flush
+ * stats */
+void PrometheusManager::addNUpdateCtZoneStats (size_t queueDepth,
+                                               uint64_t flushedZones,
+                                               uint64_t flushedEntries,
+                                               uint64_t lastFlushMs)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(ct_zone_mutex);
+
+    for (CT_ZONE_METRICS metric=CT_ZONE_METRICS_MIN;
+            metric <= CT_ZONE_METRICS_MAX;
+                metric = CT_ZONE_METRICS(metric+1)) {
+        // create the metric if its not present
+        createDynamicGaugeCtZone(metric);
+        Gauge *pgauge = getDynamicGaugeCtZone(metric);
+        if (!pgauge)
+            continue;
+        uint64_t value = 0;
+        switch (metric) {
+        case CT_ZONE_FLUSH_QUEUE_DEPTH:
+            value = queueDepth;
+            break;
+        case CT_ZONE_FLUSHED_ZONES:
+            value = flushedZones;
+            break;
+        case CT_ZONE_FLUSHED_ENTRIES:
+            value = flushedEntries;
+            break;
+        case CT_ZONE_LAST_FLUSH_MS:
+            value = lastFlushMs;
+            break;
+        default:
+            LOG(ERROR) << "Unhandled conntrack zone metric: " << metric;
+            break;
+        }
+        pgauge->Set(static_cast<double>(value));
+    }
+}
+
+/* Function called from OVSRenderer to update endpoint group render
+ * stats */
+void PrometheusManager::addNUpdateEpgRenderStats (uint64_t fanouts,
+                                                  uint64_t skipped)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(epg_render_mutex);
+
+    for (EPG_RENDER_METRICS metric=EPG_RENDER_METRICS_MIN;
+            metric <= EPG_RENDER_METRICS_MAX;
+                metric = EPG_RENDER_METRICS(metric+1)) {
+        // create the metric if its not present
+        createDynamicGaugeEpgRender(metric);
+        Gauge *pgauge = getDynamicGaugeEpgRender(metric);
+        if (!pgauge)
+            continue;
+        uint64_t value = 0;
+        switch (metric) {
+        case EPG_RENDER_FANOUTS:
+            value = fanouts;
+            break;
+        case EPG_RENDER_SKIPPED:
+            value = skipped;
+            break;
+        default:
+            LOG(ERROR) << "Unhandled endpoint group render metric: "
+                       << metric;
+            break;
+        }
+        pgauge->Set(static_cast<double>(value));
+    }
+}
+
+/* Function called from OVSRenderer to update task queue stats for
+ * each class of tasks */
+void PrometheusManager::addNUpdateTaskQueueStats (const string& task_class,
+                                                  const TaskQueue::TaskStats& stats)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(task_queue_mutex);
+
+    for (TASK_QUEUE_METRICS metric=TASK_QUEUE_METRICS_MIN;
+            metric <= TASK_QUEUE_METRICS_MAX;
+                metric = TASK_QUEUE_METRICS(metric+1)) {
+        // create the metric if its not present
+        createDynamicGaugeTaskQueue(metric, task_class);
+        Gauge *pgauge = getDynamicGaugeTaskQueue(metric, task_class);
+        if (!pgauge)
+            continue;
+        uint64_t value = 0;
+        switch (metric) {
+        case TASK_QUEUE_DEPTH:
+            value = stats.depth;
+            break;
+        case TASK_QUEUE_DISPATCHED:
+            value = stats.dispatched;
+            break;
+        case TASK_QUEUE_COALESCED:
+            value = stats.coalesced;
+            break;
+        case TASK_QUEUE_HELD:
+            value = stats.held;
+            break;
+        case TASK_QUEUE_OVERDUE:
+            value = stats.overdue;
+            break;
+        case TASK_QUEUE_RUN:
+            value = stats.run;
+            break;
+        case TASK_QUEUE_WAIT_USEC:
+            value = stats.waitUs;
+            break;
+        case TASK_QUEUE_MAX_WAIT_USEC:
+            value = stats.maxWaitUs;
+            break;
+        case TASK_QUEUE_RUN_USEC:
+            value = stats.runUs;
+            break;
+        case TASK_QUEUE_MAX_RUN_USEC:
+            value = stats.maxRunUs;
+            break;
+        default:
+            LOG(ERROR) << "Unhandled task queue metric: " << metric;
+            break;
+        }
+        pgauge->Set(static_cast<double>(value));
+    }
+}
+
+/* Function called from SwitchManager to update flow table
+ * programming counters */
+void PrometheusManager::addNUpdateFlowTableStats (const string& bridge_name,
+                                                  const string& table_name,
+                                                  uint64_t flows,
+                                                  uint64_t adds,
+                                                  uint64_t mods,
+                                                  uint64_t deletes,
+                                                  uint64_t diffUsec,
+                                                  uint64_t bytes)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(flow_table_mutex);
+
+    for (FLOW_TABLE_METRICS metric=FLOW_TABLE_METRICS_MIN;
+            metric <= FLOW_TABLE_METRICS_MAX;
+                metric = FLOW_TABLE_METRICS(metric+1)) {
+        // create the metric if its not present
+        createDynamicGaugeFlowTable(metric, bridge_name, table_name);
+        Gauge *pgauge = getDynamicGaugeFlowTable(metric, bridge_name,
+                                                 table_name);
+        if (!pgauge)
+            continue;
+        uint64_t value = 0;
+        switch (metric) {
+        case FLOW_TABLE_FLOWS:
+            value = flows;
+            break;
+        case FLOW_TABLE_ADDS:
+            value = adds;
+            break;
+        case FLOW_TABLE_MODS:
+            value = mods;
+            break;
+        case FLOW_TABLE_DELETES:
+            value = deletes;
+            break;
+        case FLOW_TABLE_DIFF_USEC:
+            value = diffUsec;
+            break;
+        case FLOW_TABLE_BYTES:
+            value = bytes;
+            break;
+        default:
+            LOG(ERROR) << "Unhandled flow table metric: " << metric;
+            break;
+        }
+        pgauge->Set(static_cast<double>(value));
+    }
+}
+
+/* Function called from SwitchManager to update flow programming
+ * counters for each type of object */
+void PrometheusManager::addNUpdateFlowObjectStats (const string& bridge_name,
+                                                   const string& object_type,
+                                                   uint64_t flows,
+                                                   uint64_t adds,
+                                                   uint64_t mods,
+                                                   uint64_t deletes,
+                                                   uint64_t diffUsec)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(flow_table_mutex);
+
+    for (FLOW_OBJECT_METRICS metric=FLOW_OBJECT_METRICS_MIN;
+            metric <= FLOW_OBJECT_METRICS_MAX;
+                metric = FLOW_OBJECT_METRICS(metric+1)) {
+        // create the metric if its not present
+        createDynamicGaugeFlowObject(metric, bridge_name, object_type);
+        Gauge *pgauge = getDynamicGaugeFlowObject(metric, bridge_name,
+                                                  object_type);
+        if (!pgauge)
+            continue;
+        uint64_t value = 0;
+        switch (metric) {
+        case FLOW_OBJECT_FLOWS:
+            value = flows;
+            break;
+        case FLOW_OBJECT_ADDS:
+            value = adds;
+            break;
+        case FLOW_OBJECT_MODS:
+            value = mods;
+            break;
+        case FLOW_OBJECT_DELETES:
+            value = deletes;
+            break;
+        case FLOW_OBJECT_DIFF_USEC:
+            value = diffUsec;
+            break;
+        default:
+            LOG(ERROR) << "Unhandled flow object metric: " << metric;
+            break;
+        }
+        pgauge->Set(static_cast<double>(value));
+    }
+}
+
 /* Function called from ContractStatsManager to update RDDropCounter
  * This will be called from IntFlowManager to create metrics. */
 void PrometheusManager::addNUpdateRDDropCounter (const string& rdURI,
@@ -3031,92 +4100,111 @@ void PrometheusManager::addNUpdateEpCounter (const string& uuid,
                   const unordered_map<string, string>&    attr_map)
 {
     RETURN_IF_DISABLED
-    using namespace opflex::modb;
+
+    /**
+     * Only the label set is maintained here. The counter values are
+     * pulled from EpStatUniverse when the exposer is scraped, so
+     * there is nothing to do for an ep whose attributes didnt change.
+     */
+    const lock_guard<mutex> lock(ep_counter_mutex);
+    if (updateEpLabels(uuid, ep_name, attr_hash, attr_map)) {
+        incStaticCounterEpCreate();
+        updateStaticGaugeEpTotal(true);
+    }
+}
+
+PrometheusManager::EpCounterCollectable::
+EpCounterCollectable (PrometheusManager& pmanager_) : pmanager(pmanager_) {}
+
+// Render EpCounter metric families on scrape
+std::vector<MetricFamily> PrometheusManager::EpCounterCollectable::Collect ()
+{
     using namespace modelgbp::gbpe;
     using namespace modelgbp::observer;
 
-    const lock_guard<mutex> lock(ep_counter_mutex);
-    Mutator mutator(framework, "policyelement");
+    std::vector<MetricFamily> families(EP_METRICS_MAX);
+    for (EP_METRICS metric=EP_RX_BYTES;
+            metric < EP_METRICS_MAX;
+                metric = EP_METRICS(metric+1)) {
+        families[metric].name = ep_family_names[metric];
+        families[metric].help = ep_family_help[metric];
+        families[metric].type = MetricType::Gauge;
+    }
+
+    if (pmanager.disabled)
+        return families;
+
     optional<shared_ptr<EpStatUniverse> > su =
-                            EpStatUniverse::resolve(framework);
-    if (su) {
+                            EpStatUniverse::resolve(pmanager.framework);
+    if (!su)
+        return families;
+
+    const lock_guard<mutex> lock(pmanager.ep_counter_mutex);
+    for (auto& family : families)
+        family.metric.reserve(pmanager.ep_label_map.size());
+
+    for (const auto& p : pmanager.ep_label_map) {
         optional<shared_ptr<EpCounter>> ep_counter =
-                            su.get()->resolveGbpeEpCounter(uuid);
-        if (ep_counter) {
-
-            // Create the gauge counters if they arent present already
-            for (EP_METRICS metric=EP_RX_BYTES;
-                    metric < EP_METRICS_MAX;
-                        metric = EP_METRICS(metric+1)) {
-                if (!createDynamicGaugeEp(metric,
-                                          uuid,
-                                          ep_name,
-                                          attr_hash,
-                                          attr_map)) {
-                    break;
-                }
+                            su.get()->resolveGbpeEpCounter(p.first);
+        if (!ep_counter)
+            continue;
 
-                if (metric == (EP_METRICS_MAX-1)) {
-                    incStaticCounterEpCreate();
-                    updateStaticGaugeEpTotal(true);
-                }
+        for (EP_METRICS metric=EP_RX_BYTES;
+                metric < EP_METRICS_MAX;
+                    metric = EP_METRICS(metric+1)) {
+            optional<uint64_t>   metric_opt;
+            switch (metric) {
+            case EP_RX_BYTES:
+                metric_opt = ep_counter.get()->getRxBytes();
+                break;
+            case EP_RX_PKTS:
+                metric_opt = ep_counter.get()->getRxPackets();
+                break;
+            case EP_RX_DROPS:
+                metric_opt = ep_counter.get()->getRxDrop();
+                break;
+            case EP_RX_UCAST:
+                metric_opt = ep_counter.get()->getRxUnicast();
+                break;
+            case EP_RX_MCAST:
+                metric_opt = ep_counter.get()->getRxMulticast();
+                break;
+            case EP_RX_BCAST:
+                metric_opt = ep_counter.get()->getRxBroadcast();
+                break;
+            case EP_TX_BYTES:
+                metric_opt = ep_counter.get()->getTxBytes();
+                break;
+            case EP_TX_PKTS:
+                metric_opt = ep_counter.get()->getTxPackets();
+                break;
+            case EP_TX_DROPS:
+                metric_opt = ep_counter.get()->getTxDrop();
+                break;
+            case EP_TX_UCAST:
+                metric_opt = ep_counter.get()->getTxUnicast();
+                break;
+            case EP_TX_MCAST:
+                metric_opt = ep_counter.get()->getTxMulticast();
+                break;
+            case EP_TX_BCAST:
+                metric_opt = ep_counter.get()->getTxBroadcast();
+                break;
+            default:
+                LOG(ERROR) << "Unhandled metric: " << metric;
             }
+            if (!metric_opt)
+                continue;
 
-            // Update the metrics
-            for (EP_METRICS metric=EP_RX_BYTES;
-                    metric < EP_METRICS_MAX;
-                        metric = EP_METRICS(metric+1)) {
-                hgauge_pair_t hgauge = getDynamicGaugeEp(metric, uuid);
-                optional<uint64_t>   metric_opt;
-                switch (metric) {
-                case EP_RX_BYTES:
-                    metric_opt = ep_counter.get()->getRxBytes();
-                    break;
-                case EP_RX_PKTS:
-                    metric_opt = ep_counter.get()->getRxPackets();
-                    break;
-                case EP_RX_DROPS:
-                    metric_opt = ep_counter.get()->getRxDrop();
-                    break;
-                case EP_RX_UCAST:
-                    metric_opt = ep_counter.get()->getRxUnicast();
-                    break;
-                case EP_RX_MCAST:
-                    metric_opt = ep_counter.get()->getRxMulticast();
-                    break;
-                case EP_RX_BCAST:
-                    metric_opt = ep_counter.get()->getRxBroadcast();
-                    break;
-                case EP_TX_BYTES:
-                    metric_opt = ep_counter.get()->getTxBytes();
-                    break;
-                case EP_TX_PKTS:
-                    metric_opt = ep_counter.get()->getTxPackets();
-                    break;
-                case EP_TX_DROPS:
-                    metric_opt = ep_counter.get()->getTxDrop();
-                    break;
-                case EP_TX_UCAST:
-                    metric_opt = ep_counter.get()->getTxUnicast();
-                    break;
-                case EP_TX_MCAST:
-                    metric_opt = ep_counter.get()->getTxMulticast();
-                    break;
-                case EP_TX_BCAST:
-                    metric_opt = ep_counter.get()->getTxBroadcast();
-                    break;
-                default:
-                    LOG(ERROR) << "Unhandled metric: " << metric;
-                }
-                if (metric_opt && hgauge)
-                    hgauge.get().second->Set(static_cast<double>(metric_opt.get()));
-                if (!hgauge) {
-                    LOG(ERROR) << "ep stats invalid update for uuid: " << uuid;
-                    break;
-                }
-            }
+            ClientMetric client_metric;
+            client_metric.label = p.second.labels;
+            client_metric.gauge.value =
+                static_cast<double>(metric_opt.get());
+            families[metric].metric.push_back(std::move(client_metric));
         }
     }
+
+    return families;
 }
 
 void PrometheusManager::dumpPodSvcState ()
@@ -3210,16 +4298,9 @@ void PrometheusManager::removeEpCounter (const string& uuid,
     const lock_guard<mutex> lock(ep_counter_mutex);
     LOG(DEBUG) << "remove ep counter " << ep_name;
 
-    for (EP_METRICS metric=EP_RX_BYTES;
-            metric < EP_METRICS_MAX;
-                metric = EP_METRICS(metric+1)) {
-        if (!removeDynamicGaugeEp(metric, uuid))
-            break;
-
-        if (metric == (EP_METRICS_MAX-1)) {
-            incStaticCounterEpRemove();
-            updateStaticGaugeEpTotal(false);
-        }
+    if (removeEpLabels(uuid)) {
+        incStaticCounterEpRemove();
+        updateStaticGaugeEpTotal(false);
     }
 }
 
@@ -9,38 +9,233 @@
 #include <opflexagent/TaskQueue.h>
 #include <opflexagent/logging.h>
 
+#include <boost/asio/deadline_timer.hpp>
+
 #include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace opflexagent {
 
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+static const std::string DEFAULT_CLASS("default");
+
+const std::chrono::milliseconds TaskQueue::DEFAULT_MAX_HOLD(1000);
+
 TaskQueue::TaskQueue(boost::asio::io_service& io_service_)
-    : io_service(io_service_) {
+    : io_service(io_service_), debounce(0), maxHold(DEFAULT_MAX_HOLD),
+      nextSeq(0) {
+
+}
+
+void TaskQueue::setDebounce(std::chrono::milliseconds delay) {
+    std::unique_lock<std::mutex> guard(queueMutex);
+    debounce = delay;
+}
+
+void TaskQueue::setMaxHold(std::chrono::milliseconds limit) {
+    std::unique_lock<std::mutex> guard(queueMutex);
+    maxHold = limit;
+}
 
+bool TaskQueue::isActive(const std::string& taskId) const {
+    return queuedItems.find(taskId) != queuedItems.end() ||
+        runningItems.find(taskId) != runningItems.end();
 }
 
-void TaskQueue::run_task(const std::string& taskId,
-                         const std::function<void ()>& task) {
+bool TaskQueue::canHold(const Entry& entry, clock::time_point now) const {
+    return now - entry.queued < maxHold;
+}
+
+static void addTime(uint64_t& total, uint64_t& max, uint64_t us) {
+    total += us;
+    if (us > max) max = us;
+}
+
+void TaskQueue::schedule(const std::string& taskId, uint64_t seq,
+                         bool delay) {
+    std::chrono::milliseconds window(0);
+    if (delay) {
+        std::unique_lock<std::mutex> guard(queueMutex);
+        window = debounce;
+    }
+    if (window.count() > 0) {
+        auto timer = std::make_shared<boost::asio::deadline_timer>
+            (io_service, boost::posix_time::milliseconds(window.count()));
+        timer->async_wait([this, timer, taskId, seq]
+                          (const boost::system::error_code& ec) {
+                              if (ec) return;
+                              TaskQueue::run_task(taskId, seq);
+                          });
+    } else {
+        io_service.post([=]() { TaskQueue::run_task(taskId, seq); });
+    }
+}
+
+void TaskQueue::releaseChildren(const std::string& parentId) {
+    std::vector<std::pair<std::string, uint64_t>> released;
     {
         std::unique_lock<std::mutex> guard(queueMutex);
-        queuedItems.erase(taskId);
+        auto cit = children.find(parentId);
+        if (cit == children.end()) return;
+        for (const std::string& childId : cit->second) {
+            auto it = queuedItems.find(childId);
+            if (it == queuedItems.end() || !it->second.held) continue;
+            it->second.held = false;
+            it->second.seq = nextSeq++;
+            released.emplace_back(childId, it->second.seq);
+        }
     }
+    // the children already waited behind their parent, so there is
+    // no need to debounce them again
+    for (const auto& r : released)
+        schedule(r.first, r.second, false);
+}
+
+void TaskQueue::run_task(const std::string& taskId, uint64_t seq) {
+    Entry entry;
+    {
+        std::unique_lock<std::mutex> guard(queueMutex);
+        auto it = queuedItems.find(taskId);
+        // a stale run for a task that was held back or has already
+        // run
+        if (it == queuedItems.end() || it->second.seq != seq ||
+            it->second.held)
+            return;
+        entry = std::move(it->second);
+        queuedItems.erase(it);
+        if (!entry.parentId.empty()) {
+            auto cit = children.find(entry.parentId);
+            if (cit != children.end()) {
+                cit->second.erase(taskId);
+                if (cit->second.empty())
+                    children.erase(cit);
+            }
+        }
+        runningItems.insert(taskId);
+
+        TaskStats& s = stats[entry.taskClass];
+        s.depth -= 1;
+        addTime(s.waitUs, s.maxWaitUs,
+                duration_cast<microseconds>(clock::now() - entry.queued)
+                .count());
+    }
+
+    clock::time_point start = clock::now();
     try {
-        task();
+        entry.task();
     } catch (const std::exception& e) {
         LOG(ERROR) << "Exception while executing task " << taskId
                    << ": " << e.what();
     } catch (...) {
         LOG(ERROR) << "Unknown error while executing task " << taskId;
     }
+
+    {
+        std::unique_lock<std::mutex> guard(queueMutex);
+        auto rit = runningItems.find(taskId);
+        if (rit != runningItems.end())
+            runningItems.erase(rit);
+        TaskStats& s = stats[entry.taskClass];
+        s.run += 1;
+        addTime(s.runUs, s.maxRunUs,
+                duration_cast<microseconds>(clock::now() - start).count());
+    }
+    releaseChildren(taskId);
 }
 
 void TaskQueue::dispatch(const std::string& taskId,
-                         const std::function<void ()>& task) {
+                         const std::function<void ()>& task,
+                         const std::string& taskClass,
+                         const std::string& parentId) {
+    uint64_t seq;
     {
         std::unique_lock<std::mutex> guard(queueMutex);
-        if (!queuedItems.insert(taskId).second) return;
+        const std::string& cls = taskClass.empty() ? DEFAULT_CLASS : taskClass;
+        TaskStats& s = stats[cls];
+        s.dispatched += 1;
+
+        bool hold = !parentId.empty() && parentId != taskId &&
+            isActive(parentId);
+        clock::time_point now = clock::now();
+
+        auto it = queuedItems.find(taskId);
+        if (it != queuedItems.end()) {
+            // merge into the queued task, keeping its original
+            // deadline so that it still runs within one window
+            Entry& e = it->second;
+            e.task = task;
+            s.coalesced += 1;
+            if (hold && !e.held && e.parentId == parentId) {
+                if (canHold(e, now)) {
+                    // invalidate the run that is already scheduled
+                    e.held = true;
+                    e.seq = nextSeq++;
+                    s.held += 1;
+                } else {
+                    s.overdue += 1;
+                }
+            }
+            return;
+        }
+
+        Entry& e = queuedItems[taskId];
+        e.task = task;
+        e.taskClass = cls;
+        e.parentId = parentId;
+        e.queued = now;
+        if (hold && !canHold(e, now)) {
+            hold = false;
+            s.overdue += 1;
+        }
+        e.seq = seq = nextSeq++;
+        e.held = hold;
+        s.depth += 1;
+        if (hold)
+            s.held += 1;
+        if (!parentId.empty())
+            children[parentId].insert(taskId);
+
+        // a newly queued parent subsumes children that are already
+        // queued, unless it is itself waiting on its own parent
+        if (!hold && runningItems.find(taskId) == runningItems.end()) {
+            auto cit = children.find(taskId);
+            if (cit != children.end()) {
+                for (const std::string& childId : cit->second) {
+                    auto chit = queuedItems.find(childId);
+                    if (chit == queuedItems.end() || chit->second.held)
+                        continue;
+                    TaskStats& cs = stats[chit->second.taskClass];
+                    if (!canHold(chit->second, now)) {
+                        // the child has waited long enough; let its
+                        // scheduled run go ahead
+                        cs.overdue += 1;
+                        continue;
+                    }
+                    chit->second.held = true;
+                    chit->second.seq = nextSeq++;
+                    cs.held += 1;
+                }
+            }
+        }
+
+        if (hold) return;
     }
-    io_service.post([=]() { TaskQueue::run_task(taskId, task); });
+    schedule(taskId, seq, true);
+}
+
+size_t TaskQueue::getDepth() const {
+    std::unique_lock<std::mutex> guard(queueMutex);
+    return queuedItems.size();
+}
+
+void TaskQueue::getStats(std::unordered_map<std::string,
+                                            TaskStats>& result) const {
+    std::unique_lock<std::mutex> guard(queueMutex);
+    result = stats;
 }
 
 } // namespace opflexagent
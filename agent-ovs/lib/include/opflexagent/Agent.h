@@ -22,6 +22,7 @@
 #include <opflexagent/ExtraConfigManager.h>
 #include <opflexagent/LearningBridgeManager.h>
 #include <opflexagent/NotifServer.h>
+#include <opflexagent/LatencyTracker.h>
 #include <opflexagent/FSWatcher.h>
 #include <opflexagent/SpanManager.h>
 #include <opflexagent/SnatManager.h>
@@ -160,6 +161,11 @@ public:
      */
     SnatManager& getSnatManager() { return snatManager; }
 
+    /**
+     * Get the filesystem watcher used by the filesystem sources
+     */
+    FSWatcher& getFSWatcher() { return fsWatcher; }
+
     /**
      * Get renderer forwarding mode for this agent
      */
@@ -209,6 +215,12 @@ public:
      */
     NotifServer& getNotifServer() { return notifServer; }
 
+    /**
+     * Get the latency tracker used to trace updates through the
+     * agent
+     */
+    LatencyTracker& getLatencyTracker() { return latencyTracker; }
+
     /**
      * Get the ASIO service for the agent for scheduling asynchronous
      * tasks in the io service thread.  You must schedule your async
@@ -327,6 +339,7 @@ public:
 private:
     boost::asio::io_service agent_io;
     std::unique_ptr<boost::asio::io_service::work> io_work;
+    LatencyTracker latencyTracker;
 
     opflex::ofcore::OFFramework& framework;
 #ifdef HAVE_PROMETHEUS_SUPPORT
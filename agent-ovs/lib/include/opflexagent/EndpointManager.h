@@ -20,6 +20,8 @@
 #include <opflexagent/Endpoint.h>
 #include <opflexagent/EndpointListener.h>
 #include <opflexagent/PolicyManager.h>
+#include <opflexagent/PartitionedSet.h>
+#include <opflexagent/ShardedMap.h>
 #ifdef HAVE_PROMETHEUS_SUPPORT
 #include <opflexagent/PrometheusManager.h>
 #endif
@@ -32,6 +34,7 @@
 #include <boost/random/mersenne_twister.hpp>
 
 #include <unordered_set>
+#include <vector>
 #include <memory>
 #include <mutex>
 
@@ -351,6 +354,28 @@ private:
      */
     void updateEndpoint(const Endpoint& endpoint);
 
+    /**
+     * Add or update a batch of endpoints.  The endpoints are applied
+     * under a single lock and MODB commit, and listeners are notified
+     * once per endpoint and security group set after the whole batch
+     * is applied.
+     *
+     * @param endpoints the endpoints to add/update
+     */
+    void updateEndpoints(const std::vector<Endpoint>& endpoints);
+
+    /**
+     * Apply the new information about an endpoint to the endpoint
+     * state.  Must be called with ep_mutex held.
+     *
+     * @param endpoint the endpoint to add/update
+     * @param notifySecGroupSets security group sets to notify
+     * @param notifyExtDomSets external domains to notify
+     */
+    void updateEndpointState(const Endpoint& endpoint,
+            std::unordered_set<EndpointListener::uri_set_t>& notifySecGroupSets,
+            EndpointListener::uri_set_t& notifyExtDomSets);
+
     /**
      * Update the local endpoint entries associated with an endpoint
      * @param uuid uuid of the endpoint
@@ -384,6 +409,27 @@ private:
      */
     void removeEndpoint(const std::string& uuid);
 
+    /**
+     * Remove a batch of endpoints under a single lock and MODB
+     * commit.  Listeners are notified after the whole batch is
+     * applied.
+     *
+     * @param uuids the UUIDs of the endpoints that no longer exist
+     */
+    void removeEndpoints(const std::vector<std::string>& uuids);
+
+    /**
+     * Remove an endpoint from the endpoint state.  Must be called
+     * with ep_mutex held and a mutator active.
+     *
+     * @param uuid the UUID of the endpoint that no longer exists
+     * @param notifySecGroupSets security group sets to notify
+     * @param notifyExtDomSets external domains to notify
+     */
+    void removeEndpointState(const std::string& uuid,
+            std::unordered_set<EndpointListener::uri_set_t>& notifySecGroupSets,
+            EndpointListener::uri_set_t& notifyExtDomSets);
+
     /**
      * Remove the external endpoint with the specified UUID from the endpoint
      * manager.
@@ -457,6 +503,67 @@ private:
 
     std::mutex ep_mutex;
 
+    /**
+     * An exclusive lock on ep_mutex for code that modifies the
+     * endpoint state.  Before the lock is released, the snapshots of
+     * any indices that changed while it was held are published.
+     */
+    class EpWriteLock {
+    public:
+        EpWriteLock(EndpointManager& epmanager);
+        ~EpWriteLock();
+
+        /**
+         * Publish changed snapshots and release the lock early
+         */
+        void unlock();
+    private:
+        EndpointManager& epmanager;
+        std::unique_lock<std::mutex> guard;
+    };
+
+    /**
+     * Copy-on-write snapshots of endpoint objects by UUID, covering
+     * both local and external endpoints.  Read without ep_mutex.
+     */
+    ShardedMap<std::string, Endpoint> ep_snapshot;
+
+    typedef PartitionedSet<std::string> str_pset_t;
+
+    /**
+     * Copy-on-write snapshots of group_ep_map.  Read without
+     * ep_mutex.  Groups can be large, so each snapshot is partitioned
+     * and a change copies only the partitions it touches.
+     */
+    ShardedMap<opflex::modb::URI, str_pset_t> group_ep_snapshot;
+
+    /**
+     * Copy-on-write snapshots of iface_ep_map.  Read without
+     * ep_mutex.
+     */
+    ShardedMap<std::string, str_uset_t> iface_ep_snapshot;
+
+    /**
+     * Keys whose snapshots are out of date, and for groups the
+     * endpoints that joined or left.  Protected by ep_mutex.
+     */
+    str_uset_t dirty_eps;
+    std::unordered_map<opflex::modb::URI, str_uset_t> dirty_groups;
+    str_uset_t dirty_ifaces;
+
+    /**
+     * Publish snapshots for all dirty keys.  Must be called with
+     * ep_mutex held.
+     */
+    void publishSnapshots();
+
+    /**
+     * True while a batch update is being applied.  Changes are then
+     * written to the mutator of the batch rather than committed for
+     * each endpoint.
+     */
+    bool batch_update;
+
     /**
      * Map endpoint UUID to endpoint state object
      */
@@ -11,6 +11,8 @@
 
 #include <opflexagent/Endpoint.h>
 
+#include <vector>
+
 #pragma once
 #ifndef OPFLEXAGENT_ENDPOINTSOURCE_H
 #define OPFLEXAGENT_ENDPOINTSOURCE_H
@@ -53,6 +55,21 @@ public:
      */
     virtual void removeEndpoint(const std::string& uuid);
 
+    /**
+     * Add or update a batch of endpoints in the endpoint manager.
+     *
+     * @param endpoints the endpoints to add/update
+     */
+    virtual void updateEndpoints(const std::vector<Endpoint>& endpoints);
+
+    /**
+     * Remove a batch of endpoints that no longer exist from the
+     * endpoint manager
+     *
+     * @param uuids the endpoints that no longer exist
+     */
+    virtual void removeEndpoints(const std::vector<std::string>& uuids);
+
     /**
      * Add or update the specified external endpoint in the endpoint manager.
      *
@@ -13,6 +13,7 @@
 #ifndef OPFLEXAGENT_FSENDPOINTSOURCE_H
 #define OPFLEXAGENT_FSENDPOINTSOURCE_H
 
+#include <opflexagent/Endpoint.h>
 #include <opflexagent/EndpointSource.h>
 #include <opflexagent/FSWatcher.h>
 
@@ -20,6 +21,7 @@
 
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 namespace opflexagent {
 
@@ -48,6 +50,16 @@ public:
     virtual void updated(const boost::filesystem::path& filePath);
     // See Watcher
     virtual void deleted(const boost::filesystem::path& filePath);
+    // See Watcher
+    virtual std::unique_ptr<Parsed>
+    parse(const boost::filesystem::path& filePath);
+    // See Watcher
+    virtual void apply(const boost::filesystem::path& filePath,
+                       std::unique_ptr<Parsed> parsed);
+    // See Watcher
+    virtual void beginBatch();
+    // See Watcher
+    virtual void endBatch();
 
 private:
     typedef std::unordered_map<std::string, std::string> ep_map_t;
@@ -56,6 +68,23 @@ private:
      * EPs that are known to the filesystem watcher
      */
     ep_map_t knownEps;
+
+    /**
+     * True while a batch of files is being applied
+     */
+    bool batching;
+
+    /**
+     * Endpoint updates queued in the current batch
+     */
+    std::vector<Endpoint> pendingEps;
+
+    /**
+     * Endpoint removals queued in the current batch
+     */
+    std::vector<std::string> pendingRemovals;
+
+    void flushBatch();
 };
 
 } /* namespace opflexagent */
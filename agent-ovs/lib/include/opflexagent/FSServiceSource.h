@@ -48,6 +48,12 @@ public:
     virtual void updated(const boost::filesystem::path& filePath);
     // See Watcher
     virtual void deleted(const boost::filesystem::path& filePath);
+    // See Watcher
+    virtual std::unique_ptr<Parsed>
+    parse(const boost::filesystem::path& filePath);
+    // See Watcher
+    virtual void apply(const boost::filesystem::path& filePath,
+                       std::unique_ptr<Parsed> parsed);
 
 private:
     typedef std::unordered_map<std::string, std::string> serv_map_t;
@@ -18,6 +18,10 @@
 #include <boost/filesystem.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <sys/types.h>
+
+#include <atomic>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <thread>
@@ -48,6 +52,53 @@ public:
          * Called when the specified path is deleted
          */
         virtual void deleted(const boost::filesystem::path& filePath) = 0;
+
+        /**
+         * The result of parsing a file during the initial scan
+         */
+        class Parsed {
+        public:
+            virtual ~Parsed() {}
+        };
+
+        /**
+         * Parse the specified path during the initial scan.  When
+         * the scan is run on multiple threads, this is called
+         * concurrently from worker threads and must not touch any
+         * watcher state.  The default implementation defers all the
+         * work to updated().
+         *
+         * @param filePath the path to parse
+         * @return the parsed file contents, or nullptr if the file
+         * should be ignored
+         */
+        virtual std::unique_ptr<Parsed>
+        parse(const boost::filesystem::path& filePath) {
+            return std::unique_ptr<Parsed>(new Parsed());
+        }
+
+        /**
+         * Apply a file parsed with parse().  Called from the watcher
+         * thread between beginBatch() and endBatch(), in directory
+         * order.
+         *
+         * @param filePath the path that was parsed
+         * @param parsed the result of parse()
+         */
+        virtual void apply(const boost::filesystem::path& filePath,
+                           std::unique_ptr<Parsed> parsed) {
+            updated(filePath);
+        }
+
+        /**
+         * Called before a batch of files is applied
+         */
+        virtual void beginBatch() {}
+
+        /**
+         * Called after a batch of files is applied
+         */
+        virtual void endBatch() {}
     };
 
     /**
@@ -63,6 +114,41 @@ public:
      */
     void setInitialScan(bool scan);
 
+    /**
+     * Set the number of worker threads used to parse files during
+     * the initial scan.
+     *
+     * @param threads the number of threads.  0 or 1 scans each
+     * directory serially on the watcher thread.  Default 0.
+     */
+    void setScanThreads(size_t threads);
+
+    /**
+     * Enable or disable suppression of update notifications for
+     * files whose contents have not changed since the last
+     * notification.
+     *
+     * @param suppress true to suppress unchanged updates.  Default
+     * true.
+     */
+    void setSuppressUnchanged(bool suppress);
+
+    /**
+     * Get the number of file update events delivered to watchers
+     */
+    uint64_t getUpdateEvents() const { return updateEvents; }
+
+    /**
+     * Get the number of file update events that were suppressed
+     * because the file contents did not change
+     */
+    uint64_t getSuppressedEvents() const { return suppressedEvents; }
+
+    /**
+     * Get the number of file delete events delivered to watchers
+     */
+    uint64_t getDeleteEvents() const { return deleteEvents; }
+
     /**
      * Start the listener on the currently registered set of watchers
      */
@@ -97,6 +183,22 @@ private:
     typedef std::unordered_map<boost::filesystem::path,
                                WatchState, PathHash> path_map_t;
 
+    /**
+     * Last known state of a file that was delivered to watchers
+     */
+    struct FileState {
+        dev_t dev;
+        ino_t ino;
+        uint64_t size;
+        int64_t mtime;
+        int64_t ctime;
+        uint64_t digest;
+        bool stable;
+    };
+
+    typedef std::unordered_map<boost::filesystem::path,
+                               FileState, PathHash> file_map_t;
+
     /**
      * paths to monitor.
      */
@@ -117,9 +219,33 @@ private:
      */
     int eventFd;
     bool initialScan;
+    size_t scanThreads;
+    bool suppressUnchanged;
+
+    /**
+     * State of the files delivered to watchers.  Only accessed from
+     * the polling thread.
+     */
+    file_map_t fileStates;
+
+    std::atomic<uint64_t> updateEvents;
+    std::atomic<uint64_t> suppressedEvents;
+    std::atomic<uint64_t> deleteEvents;
+
+    /**
+     * Check whether the file has changed since it was last delivered
+     * to the watchers and record its current state
+     *
+     * @param filePath the file to check
+     * @return true if the file changed or its state is unknown
+     */
+    bool checkChanged(const boost::filesystem::path& filePath);
 
-    static void scanPath(const WatchState* ws,
-                         const boost::filesystem::path& watchPath);
+    void scanPath(const WatchState* ws,
+                  const boost::filesystem::path& watchPath);
+    void parallelScanPath(const WatchState* ws,
+                          const boost::filesystem::path& watchPath,
+                          size_t threads);
 };
 
 } /* namespace opflexagent */
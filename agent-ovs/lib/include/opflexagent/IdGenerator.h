@@ -101,6 +101,17 @@ public:
      */
     uint32_t getFreeRangeCount(const std::string& nmspc);
 
+    /**
+     * Call the given function for each ID in a namespace that is
+     * free to be allocated.  The function is called with the lock
+     * held, so it must not call back into the IdGenerator.
+     *
+     * @param nmspc the namespace to check
+     * @param visitor the function to call for each free ID
+     */
+    void forEachFreeId(const std::string& nmspc,
+                       const std::function<void(uint32_t)>& visitor);
+
     /**
      * Purge erased entries that are sufficiently old
      */
@@ -122,6 +133,31 @@ public:
      */
     void setAllocHook(const std::string& nmspc, alloc_hook_t& allocHook);
 
+    /**
+     * Function that can be registered as a hook for the release of
+     * an erased ID during cleanup.  A false return value indicates
+     * that the ID must be held back from reuse until it is returned
+     * with release().
+     */
+    typedef std::function<bool(const std::string&, uint32_t)> free_hook_t;
+
+    /**
+     * Set a callback hook called when an erased ID is about to be
+     * returned to the free set
+     *
+     * @param nmspc the namespace to register the hook for
+     * @param freeHook the callback to register
+     */
+    void setFreeHook(const std::string& nmspc, free_hook_t& freeHook);
+
+    /**
+     * Return an ID held back by the free hook to the free set
+     *
+     * @param nmspc the namespace of the ID
+     * @param id the ID to return
+     */
+    void release(const std::string& nmspc, uint32_t id);
+
     /**
      * Gets the name of the file used for persisting IDs.
      *
@@ -203,7 +239,11 @@ private:
     friend bool operator!=(const id_range& lhs, const id_range& rhs);
 
     /**
-     * Keeps track of IDs assignments in a namespace.
+     * Keeps track of IDs assignments in a namespace.  Each string is
+     * stored once, as the key in the ids map; the other maps are
+     * keyed by ID and the reverse map points at the key in the ids
+     * map.  The strings are not shared with the MODB, which does not
+     * expose its URI storage.
      */
     struct IdMap : private boost::noncopyable {
         /**
@@ -212,17 +252,42 @@ private:
         typedef std::unordered_map<std::string, uint32_t> Str2IdMap;
         Str2IdMap ids;
 
+        /**
+         * Ranges of free IDs.  A set of ranges rather than a bitmap:
+         * the namespaces span up to 2^31 IDs but in practice hold a
+         * few ranges, and allocation takes the front of the first
+         * range.
+         */
         std::set<id_range> freeIds;
 
-        typedef std::unordered_map<std::string, time_point> Str2EIdMap;
-        Str2EIdMap erasedIds;
+        /**
+         * Map of erased IDs to the time they were erased.  Each ID
+         * is held for the cleanup interval from its own erase time
+         * rather than for a number of cleanup passes, so that the
+         * reuse delay does not depend on how often cleanup runs.
+         */
+        typedef std::unordered_map<uint32_t, time_point> Id2EIdMap;
+        Id2EIdMap erasedIds;
 
-        typedef std::unordered_map<uint32_t, std::string> Id2StrMap;
+        /**
+         * Map of IDs to their string.  The string is owned by the
+         * ids map, which does not move its elements.
+         */
+        typedef std::unordered_map<uint32_t, const std::string*> Id2StrMap;
         Id2StrMap  reverseMap;
 
         boost::optional<alloc_hook_t> allocHook;
+        boost::optional<free_hook_t> freeHook;
     };
 
+    /**
+     * Return an ID to the free set of a namespace
+     *
+     * @param idmap the assignments of the namespace
+     * @param id the ID to return
+     */
+    static void freeIdLocked(IdMap& idmap, uint32_t id);
+
     /**
      * Save ID assignment to file (which determined from the namespace).
      *
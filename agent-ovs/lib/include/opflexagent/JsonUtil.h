@@ -0,0 +1,230 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Utility functions for reading JSON source files
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_JSONUTIL_H
+#define OPFLEXAGENT_JSONUTIL_H
+
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+
+#include <boost/optional.hpp>
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace opflexagent {
+namespace json {
+
+/**
+ * Read and parse a JSON file into the given document.  The file
+ * must contain a JSON object.
+ *
+ * @param path the file to read
+ * @param doc the document to parse into
+ * @throws std::runtime_error if the file could not be read or parsed
+ */
+inline void readFile(const std::string& path, rapidjson::Document& doc) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in)
+        throw std::runtime_error(path + ": cannot open file");
+    std::string contents((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+    doc.Parse(contents.c_str());
+    if (doc.HasParseError()) {
+        throw std::runtime_error(
+            path + "(" + std::to_string(doc.GetErrorOffset()) + "): " +
+            rapidjson::GetParseError_En(doc.GetParseError()));
+    }
+    if (!doc.IsObject())
+        throw std::runtime_error(path + ": expected a JSON object");
+}
+
+/**
+ * Get the named member of a JSON object
+ *
+ * @param obj the object
+ * @param name the member name
+ * @return the member value, or nullptr if obj is not an object or
+ * the member is not present or null
+ */
+inline const rapidjson::Value* member(const rapidjson::Value& obj,
+                                      const char* name) {
+    if (!obj.IsObject()) return nullptr;
+    auto it = obj.FindMember(name);
+    if (it == obj.MemberEnd() || it->value.IsNull()) return nullptr;
+    return &it->value;
+}
+
+/**
+ * Convert a scalar JSON value to its string form.  Numbers and
+ * booleans are converted to their textual representation, matching
+ * the property tree JSON reader.
+ *
+ * @param v the value
+ * @return the string form, or boost::none if v is not a scalar
+ */
+inline boost::optional<std::string> toString(const rapidjson::Value& v) {
+    if (v.IsString())
+        return std::string(v.GetString(), v.GetStringLength());
+    if (v.IsBool())
+        return std::string(v.GetBool() ? "true" : "false");
+    if (v.IsUint64())
+        return std::to_string(v.GetUint64());
+    if (v.IsInt64())
+        return std::to_string(v.GetInt64());
+    if (v.IsDouble())
+        return std::to_string(v.GetDouble());
+    return boost::none;
+}
+
+/**
+ * Get a string member of a JSON object
+ *
+ * @param obj the object
+ * @param name the member name
+ * @return the value, or boost::none if not present or not a scalar
+ */
+inline boost::optional<std::string> getString(const rapidjson::Value& obj,
+                                              const char* name) {
+    const rapidjson::Value* v = member(obj, name);
+    if (!v) return boost::none;
+    return toString(*v);
+}
+
+/**
+ * Get an unsigned integer member of a JSON object.  Both numbers
+ * and numeric strings are accepted.
+ *
+ * @param obj the object
+ * @param name the member name
+ * @return the value, or boost::none if not present, not a valid
+ * number or out of range for T
+ */
+template <typename T>
+inline boost::optional<T> getUint(const rapidjson::Value& obj,
+                                  const char* name) {
+    const rapidjson::Value* v = member(obj, name);
+    if (!v) return boost::none;
+    uint64_t val;
+    if (v->IsUint64()) {
+        val = v->GetUint64();
+    } else if (v->IsString() && v->GetStringLength() > 0 &&
+               v->GetString()[0] != '-') {
+        char* end = nullptr;
+        errno = 0;
+        val = std::strtoull(v->GetString(), &end, 10);
+        if (errno != 0 || *end != '\0')
+            return boost::none;
+    } else {
+        return boost::none;
+    }
+    if (val > std::numeric_limits<T>::max())
+        return boost::none;
+    return static_cast<T>(val);
+}
+
+/**
+ * Get a boolean member of a JSON object.  Booleans, the strings
+ * "true" and "false", and the numbers 0 and 1 are accepted.
+ *
+ * @param obj the object
+ * @param name the member name
+ * @return the value, or boost::none if not present or not a boolean
+ */
+inline boost::optional<bool> getBool(const rapidjson::Value& obj,
+                                     const char* name) {
+    const rapidjson::Value* v = member(obj, name);
+    if (!v) return boost::none;
+    if (v->IsBool())
+        return v->GetBool();
+    if (v->IsString()) {
+        std::string s(v->GetString(), v->GetStringLength());
+        if (s == "true" || s == "1") return true;
+        if (s == "false" || s == "0") return false;
+    } else if (v->IsUint64() && v->GetUint64() <= 1) {
+        return v->GetUint64() == 1;
+    }
+    return boost::none;
+}
+
+/**
+ * Call a function for each scalar element of an array member of a
+ * JSON object, passing the element in string form
+ *
+ * @param obj the object
+ * @param name the member name
+ * @param f the function to call
+ */
+template <typename F>
+inline void forEachString(const rapidjson::Value& obj, const char* name,
+                          F f) {
+    const rapidjson::Value* v = member(obj, name);
+    if (!v || !v->IsArray()) return;
+    for (rapidjson::Value::ConstValueIterator it = v->Begin();
+         it != v->End(); ++it) {
+        boost::optional<std::string> s = toString(*it);
+        if (s) f(s.get());
+    }
+}
+
+/**
+ * Call a function for each element of an array member of a JSON
+ * object
+ *
+ * @param obj the object
+ * @param name the member name
+ * @param f the function to call
+ */
+template <typename F>
+inline void forEachElement(const rapidjson::Value& obj, const char* name,
+                           F f) {
+    const rapidjson::Value* v = member(obj, name);
+    if (!v || !v->IsArray()) return;
+    for (rapidjson::Value::ConstValueIterator it = v->Begin();
+         it != v->End(); ++it)
+        f(*it);
+}
+
+/**
+ * Call a function for each scalar member of an object member of a
+ * JSON object, passing the member name and value in string form
+ *
+ * @param obj the object
+ * @param name the member name
+ * @param f the function to call
+ * @return true if the member is present and is an object
+ */
+template <typename F>
+inline bool forEachMember(const rapidjson::Value& obj, const char* name,
+                          F f) {
+    const rapidjson::Value* v = member(obj, name);
+    if (!v || !v->IsObject()) return false;
+    for (rapidjson::Value::ConstMemberIterator it = v->MemberBegin();
+         it != v->MemberEnd(); ++it) {
+        boost::optional<std::string> s = toString(it->value);
+        if (s)
+            f(std::string(it->name.GetString(),
+                          it->name.GetStringLength()),
+              s.get());
+    }
+    return true;
+}
+
+} /* namespace json */
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_JSONUTIL_H */
@@ -0,0 +1,275 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for LatencyTracker
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_LATENCYTRACKER_H
+#define OPFLEXAGENT_LATENCYTRACKER_H
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Track how long a change to an endpoint or managed object takes to
+ * make its way from the point where the agent first learns about it
+ * to the point where the resulting flows are programmed.  Each trace
+ * is keyed by endpoint UUID or MO URI and is marked as it passes each
+ * stage.  The time spent in each stage feeds a per-stage histogram,
+ * and traces that take longer than the slow threshold end to end are
+ * kept in a small ring buffer for later inspection.
+ *
+ * If the same key is updated again after its trace has passed a
+ * stage, the trace restarts from the new update.  Traces are only
+ * started while a renderer that completes them is registered, and
+ * traces that never complete expire after a maximum age or are
+ * evicted, oldest first, to make room for new ones.
+ */
+class LatencyTracker : private boost::noncopyable {
+public:
+    /**
+     * The clock used for all latency measurements
+     */
+    typedef std::chrono::steady_clock clock;
+
+    /**
+     * The stages of the update pipeline.  Each stage measures the
+     * time since the previous stage completed.
+     */
+    enum Stage {
+        /** Source loaded the change and the manager applied it */
+        SOURCE,
+        /** The renderer was notified of the change */
+        NOTIFY,
+        /** The renderer task was dequeued from its task queue */
+        QUEUE,
+        /** The renderer wrote the resulting flows to the switch */
+        RENDER,
+        /** End to end time for the whole trace */
+        TOTAL,
+        STAGE_COUNT
+    };
+
+    /**
+     * The number of histogram buckets.  Bucket i counts samples of
+     * at most (BUCKET_BASE_US << i) microseconds, and the last
+     * bucket counts everything larger.
+     */
+    static const size_t BUCKET_COUNT = 18;
+
+    /**
+     * The upper bound of the first histogram bucket in microseconds
+     */
+    static const uint64_t BUCKET_BASE_US = 64;
+
+    /**
+     * A latency histogram for a single stage
+     */
+    struct Histogram {
+        /** Sample counts per bucket */
+        std::array<uint64_t, BUCKET_COUNT> buckets{};
+        /** Total number of samples */
+        uint64_t count = 0;
+        /** Sum of all samples in microseconds */
+        uint64_t sumUs = 0;
+        /** Largest sample in microseconds */
+        uint64_t maxUs = 0;
+    };
+
+    /**
+     * A completed trace that exceeded the slow threshold
+     */
+    struct SlowOp {
+        /** The endpoint UUID or MO URI for the trace */
+        std::string key;
+        /** Wall-clock time at which the trace completed */
+        std::chrono::system_clock::time_point completed;
+        /** Time spent in each stage in microseconds */
+        std::array<uint64_t, STAGE_COUNT> stageUs{};
+    };
+
+    /**
+     * Construct a new latency tracker
+     *
+     * @param maxTraces the maximum number of traces in flight at
+     * once; the oldest trace is dropped to make room beyond this
+     * @param maxSlowOps the number of slow operations to retain
+     */
+    LatencyTracker(size_t maxTraces = 4096, size_t maxSlowOps = 64);
+
+    /**
+     * The default maximum age of a trace in flight
+     */
+    static const std::chrono::seconds DEFAULT_MAX_AGE;
+
+    /**
+     * Enable or disable tracing.  Disabling tracing discards any
+     * traces that are in flight.
+     *
+     * @param enabled true to enable tracing
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * Set the end-to-end time above which a completed trace is
+     * recorded as a slow operation
+     *
+     * @param threshold the slow operation threshold
+     */
+    void setSlowThreshold(std::chrono::milliseconds threshold);
+
+    /**
+     * Set the age after which a trace that is still in flight is
+     * dropped
+     *
+     * @param maxAge the maximum age of a trace
+     */
+    void setMaxAge(std::chrono::milliseconds maxAge);
+
+    /**
+     * Register a renderer that completes traces.  Traces are only
+     * started while at least one renderer is registered.
+     */
+    void registerRenderer();
+
+    /**
+     * Unregister a renderer registered with registerRenderer().
+     * Traces in flight are discarded when the last renderer is
+     * unregistered.
+     */
+    void unregisterRenderer();
+
+    /**
+     * Start a trace for the given key.  If a trace for the key is
+     * already in flight and has passed a stage, it is restarted;
+     * if it has not passed any stage yet, it keeps the earlier of
+     * the two start times.
+     *
+     * @param key the endpoint UUID or MO URI
+     * @param start the time at which the change was first seen
+     */
+    void begin(const std::string& key,
+               clock::time_point start = clock::now());
+
+    /**
+     * Record that the trace for the given key completed a stage.
+     * Does nothing if there is no trace in flight for the key or if
+     * the trace is already past the stage.
+     *
+     * @param key the endpoint UUID or MO URI
+     * @param stage the stage that was completed
+     */
+    void mark(const std::string& key, Stage stage);
+
+    /**
+     * Record that the trace for the given key completed its final
+     * stage and retire it
+     *
+     * @param key the endpoint UUID or MO URI
+     * @param stage the stage that was completed
+     */
+    void finish(const std::string& key, Stage stage);
+
+    /**
+     * Discard the trace for the given key without recording it, for
+     * an update that will not be rendered
+     *
+     * @param key the endpoint UUID or MO URI
+     */
+    void abandon(const std::string& key);
+
+    /**
+     * Get the latency histogram for a stage
+     *
+     * @param stage the stage
+     * @return a copy of the histogram
+     */
+    Histogram getHistogram(Stage stage) const;
+
+    /**
+     * Get the recent slow operations, oldest first
+     *
+     * @return a copy of the slow operation ring buffer
+     */
+    std::vector<SlowOp> getSlowOps() const;
+
+    /**
+     * Get the number of traces currently in flight
+     */
+    size_t getInFlight() const;
+
+    /**
+     * Get the number of traces dropped because they expired or
+     * because too many were in flight
+     */
+    uint64_t getDropped() const;
+
+    /**
+     * Get the name of a stage
+     *
+     * @param stage the stage
+     * @return a short name for the stage
+     */
+    static const char* getStageName(Stage stage);
+
+    /**
+     * Get the index of the histogram bucket for a sample
+     *
+     * @param us the sample in microseconds
+     * @return the bucket index
+     */
+    static size_t getBucket(uint64_t us);
+
+private:
+    typedef std::list<const std::string*> trace_order_t;
+
+    struct Trace {
+        clock::time_point start;
+        clock::time_point last;
+        int lastStage;
+        std::array<uint64_t, STAGE_COUNT> stageUs;
+        /** Position of the trace in the order list */
+        trace_order_t::iterator pos;
+    };
+    typedef std::unordered_map<std::string, Trace> trace_map_t;
+
+    const size_t maxTraces;
+    const size_t maxSlowOps;
+
+    mutable std::mutex trace_mutex;
+    bool enabled;
+    size_t renderers;
+    std::chrono::microseconds slowThreshold;
+    std::chrono::microseconds maxAge;
+    trace_map_t traces;
+    /** Keys of the traces in flight in the order they were started */
+    trace_order_t order;
+    std::array<Histogram, STAGE_COUNT> histograms;
+    std::deque<SlowOp> slowOps;
+    uint64_t dropped;
+
+    void record(Trace& trace, Stage stage, clock::time_point now);
+    void retire(trace_map_t::iterator it);
+    void clear();
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_LATENCYTRACKER_H */
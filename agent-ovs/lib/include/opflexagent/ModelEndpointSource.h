@@ -18,8 +18,15 @@
 #include <opflex/ofcore/OFFramework.h>
 #include <opflex/modb/ObjectListener.h>
 
+#include <boost/asio/io_service.hpp>
+
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace opflexagent {
 
@@ -55,12 +62,46 @@ public:
 private:
     typedef std::unordered_map<std::string, std::string> ep_map_t;
 
+    /**
+     * Inventory updates waiting to be applied together.  Shared with
+     * the queued flush so that a flush that runs after the source is
+     * destroyed does nothing.
+     */
+    struct Batch {
+        /** Protects the queued updates */
+        std::mutex mutex;
+        /** Held while applying a batch and to clear the source */
+        std::mutex flush_mutex;
+        ModelEndpointSource* source = nullptr;
+        std::vector<opflex::modb::URI> uris;
+        std::unordered_set<std::string> queued;
+        bool scheduled = false;
+    };
+
     opflex::ofcore::OFFramework& framework;
+    boost::asio::io_service& io_service;
+    std::shared_ptr<Batch> batch;
 
     /**
      * EPs that are known in the model
      */
     ep_map_t knownEps;
+
+    /**
+     * Apply the queued updates of a batch to the endpoint manager
+     */
+    static void flushBatch(const std::shared_ptr<Batch>& batch);
+
+    /**
+     * Read the endpoint at the given inventory URI
+     *
+     * @param uri the URI of the inventory endpoint
+     * @param updates endpoints to update are appended here
+     * @param removals UUIDs of endpoints to remove are appended here
+     */
+    void processUpdate(const opflex::modb::URI& uri,
+                       std::vector<Endpoint>& updates,
+                       std::vector<std::string>& removals);
 };
 
 } /* namespace opflexagent */
@@ -24,6 +24,7 @@
 #include <opflex/modb/MAC.h>
 
 #include <opflexagent/KeyedRateLimiter.h>
+#include <opflexagent/LatencyTracker.h>
 
 namespace opflexagent {
 
@@ -73,6 +74,15 @@ public:
      */
     void setSocketPerms(const std::string& perms);
 
+    /**
+     * Set the latency tracker to report on when clients send a
+     * "latency" request
+     *
+     * @param tracker the latency tracker, or nullptr to disable
+     * latency requests
+     */
+    void setLatencyTracker(LatencyTracker* tracker);
+
     /**
      * Start the server
      */
@@ -113,6 +123,7 @@ private:
     std::string notifSocketGroup;
     std::string notifSocketPerms;
     std::atomic<bool> running;
+    LatencyTracker* latencyTracker;
 
     std::set<session_ptr> sessions;
 
@@ -0,0 +1,123 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for PartitionedSet
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_PARTITIONEDSET_H
+#define OPFLEXAGENT_PARTITIONEDSET_H
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <unordered_set>
+
+namespace opflexagent {
+
+/**
+ * An immutable set that is split into partitions by element hash.
+ * Partitions are shared between versions of the set, so a new
+ * version that differs in a few elements copies only the partitions
+ * holding those elements rather than the whole set.
+ *
+ * @param T the element type; must be hashable
+ * @param NPARTS the number of partitions
+ */
+template <typename T, size_t NPARTS = 32>
+class PartitionedSet {
+public:
+    /**
+     * The set type of a single partition
+     */
+    typedef std::unordered_set<T> part_t;
+
+    /**
+     * Create an empty set
+     */
+    PartitionedSet() : count(0) {}
+
+    /**
+     * Get the number of elements in the set
+     */
+    size_t size() const { return count; }
+
+    /**
+     * Add all elements of the set to the given set
+     *
+     * @param out the set to add to
+     */
+    void insertInto(std::unordered_set<T>& out) const {
+        for (const auto& p : parts) {
+            if (p) out.insert(p->begin(), p->end());
+        }
+    }
+
+    /**
+     * Create the next version of a set.  The given elements are
+     * present in the new version if and only if they are present in
+     * the current contents.  Elements that are not in the changed
+     * set must be the same in the current contents as in the old
+     * version.
+     *
+     * @param old the previous version of the set, or an empty
+     * pointer for an empty set
+     * @param current the current contents of the set
+     * @param changed the elements that may have changed since the
+     * previous version
+     * @return the new version of the set
+     */
+    static std::shared_ptr<const PartitionedSet>
+    update(const std::shared_ptr<const PartitionedSet>& old,
+           const std::unordered_set<T>& current,
+           const std::unordered_set<T>& changed) {
+        std::shared_ptr<PartitionedSet> next =
+            old ? std::make_shared<PartitionedSet>(*old)
+                : std::make_shared<PartitionedSet>();
+        std::array<std::shared_ptr<part_t>, NPARTS> copied;
+        for (const T& e : changed) {
+            size_t i = partition(e);
+            if (!copied[i]) {
+                copied[i] = next->parts[i]
+                    ? std::make_shared<part_t>(*next->parts[i])
+                    : std::make_shared<part_t>();
+            }
+            if (current.find(e) != current.end())
+                copied[i]->insert(e);
+            else
+                copied[i]->erase(e);
+        }
+        next->count = 0;
+        for (size_t i = 0; i < NPARTS; ++i) {
+            if (copied[i])
+                next->parts[i] = copied[i]->empty()
+                    ? std::shared_ptr<const part_t>()
+                    : std::shared_ptr<const part_t>(std::move(copied[i]));
+            if (next->parts[i])
+                next->count += next->parts[i]->size();
+        }
+        if (next->count != current.size()) {
+            // the old version did not match; rebuild from scratch
+            next = std::make_shared<PartitionedSet>();
+            return update(next, current, current);
+        }
+        return next;
+    }
+
+private:
+    std::array<std::shared_ptr<const part_t>, NPARTS> parts;
+    size_t count;
+
+    static size_t partition(const T& e) {
+        return std::hash<T>()(e) % NPARTS;
+    }
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_PARTITIONEDSET_H */
@@ -14,6 +14,7 @@
 #define __OPFLEXAGENT_PROMETHEUS_MANAGER_H__
 
 #include <opflex/ofcore/OFFramework.h>
+#include <opflexagent/TaskQueue.h>
 #include <unordered_map>
 #include <memory>
 #include <string>
@@ -23,6 +24,8 @@
 #include <prometheus/counter.h>
 #include <prometheus/exposer.h>
 #include <prometheus/registry.h>
+#include <prometheus/collectable.h>
+#include <prometheus/metric_family.h>
 
 namespace opflexagent {
 
@@ -39,8 +42,6 @@ using namespace prometheus;
 
 class Agent;
 
-// Optional pair of label attr hash and Gauge ptr
-typedef optional<pair<size_t, Gauge *> >  hgauge_pair_t;
 // Optional pair of label attr map and Gauge ptr
 typedef optional<pair<map<string, string>, Gauge *> >  mgauge_pair_t;
 
@@ -89,8 +90,9 @@ public:
             const unordered_map<string, string>&    attr_map,
             const unordered_set<string>&        allowed_set);
     /**
-     * Create EpCounter metric family if its not present.
-     * Update EpCounter metric family if its already present
+     * Start exposing EpCounter metrics for the ep if its not present.
+     * Refresh the cached labels if the ep attributes changed. The
+     * counter values are read from EpStatUniverse during scrape.
      *
      * @param uuid        uuid of ep
      * @param ep_name     the name of the ep
@@ -226,6 +228,104 @@ public:
      */
     void addNUpdateRemoteEpCount(size_t count);
 
+    /* FSWatcher related APIs */
+    /**
+     * Create FSWatcher metric family if its not present.
+     * Update FSWatcher metric family if its already present
+     */
+    void addNUpdateFSWatcherStats(void);
+
+    /* Endpoint advertisement related APIs */
+    /**
+     * Create endpoint advertisement metric family if its not present.
+     * Update endpoint advertisement metric family if its already present
+     *
+     * @param queueDepth number of endpoints waiting to be advertised
+     * @param sent       number of advertisements sent
+     * @param coalesced  number of requests merged into a pending one
+     * @param sendRate   advertisements sent per second
+     */
+    void addNUpdateEpAdvertStats(size_t queueDepth, uint64_t sent,
+                                 uint64_t coalesced, double sendRate);
+
+    /* Connection tracking zone flush related APIs */
+    /**
+     * Create connection tracking zone flush metric family if its not
+     * present.  Update it if its already present
+     *
+     * @param queueDepth     number of released zones waiting to be
+     *                       flushed
+     * @param flushedZones   number of zones flushed in the background
+     * @param flushedEntries number of conntrack entries deleted by
+     *                       zone flushes
+     * @param lastFlushMs    duration of the last zone flush in
+     *                       milliseconds
+     */
+    void addNUpdateCtZoneStats(size_t queueDepth, uint64_t flushedZones,
+                               uint64_t flushedEntries,
+                               uint64_t lastFlushMs);
+
+    /* Endpoint group render related APIs */
+    /**
+     * Create endpoint group render metric family if its not present.
+     * Update it if its already present
+     *
+     * @param fanouts number of endpoint group updates that re-rendered
+     *                their member endpoints
+     * @param skipped number of endpoint group updates that left their
+     *                member endpoints alone
+     */
+    void addNUpdateEpgRenderStats(uint64_t fanouts, uint64_t skipped);
+
+    /* Task queue related APIs */
+    /**
+     * Create task queue metrics for a class of tasks if they are not
+     * present, and update them
+     *
+     * @param task_class the class of the tasks
+     * @param stats      the statistics for the class
+     */
+    void addNUpdateTaskQueueStats(const string& task_class,
+                                  const TaskQueue::TaskStats& stats);
+
+    /* Flow table programming related APIs */
+    /**
+     * Create flow table programming metrics for a table if they are
+     * not present, and update them
+     *
+     * @param bridge_name the name of the bridge
+     * @param table_name  the name of the flow table
+     * @param flows       number of flows in the table
+     * @param adds        number of flows added
+     * @param mods        number of flows modified
+     * @param deletes     number of flows deleted
+     * @param diffUsec    time spent computing flow differences
+     * @param bytes       bytes of flow mods encoded
+     */
+    void addNUpdateFlowTableStats(const string& bridge_name,
+                                  const string& table_name,
+                                  uint64_t flows, uint64_t adds,
+                                  uint64_t mods, uint64_t deletes,
+                                  uint64_t diffUsec, uint64_t bytes);
+
+    /**
+     * Create flow programming metrics for a type of object if they
+     * are not present, and update them
+     *
+     * @param bridge_name the name of the bridge
+     * @param object_type the type of the objects that own the flows
+     * @param flows       number of flows owned by objects of the type
+     * @param adds        number of flows added
+     * @param mods        number of flows modified
+     * @param deletes     number of flows deleted
+     * @param diffUsec    time spent computing flow differences
+     */
+    void addNUpdateFlowObjectStats(const string& bridge_name,
+                                   const string& object_type,
+                                   uint64_t flows, uint64_t adds,
+                                   uint64_t mods, uint64_t deletes,
+                                   uint64_t diffUsec);
+
 
     /* RDDropCounter related APIs */
     /**
@@ -427,8 +527,6 @@ private:
     };
 
     // Static Metric families and metrics
-    // metric families to track all EpCounter metrics
-    Family<Gauge>      *gauge_ep_family_ptr[EP_METRICS_MAX];
     // Counter family to track all EpCounter creates
     Family<Counter>    *counter_ep_create_family_ptr;
     // Counter family to track all EpCounter removes
@@ -466,29 +564,64 @@ private:
     // remove any ep counter metric during stop
     void removeStaticCountersEp(void);
 
-    // Dynamic Metric families and metrics
-    // CRUD for every EP Counter metric
-    // func to create gauge for EpCounter given metric type, uuid & attr map
-    bool createDynamicGaugeEp(EP_METRICS metric,
-                              const string& uuid,
-                              const string& ep_name,
-                              const size_t& attr_hash,
-        const unordered_map<string, string>&    attr_map);
-    // func to get gauge for EpCounter given metric type, uuid
-    hgauge_pair_t getDynamicGaugeEp(EP_METRICS metric, const string& uuid);
-    // func to remove gauge for EpCounter given metric type, uuid
-    bool removeDynamicGaugeEp(EP_METRICS metric, const string& uuid);
-    // func to remove all gauge of every EpCounter for a metric type
-    void removeDynamicGaugeEp(EP_METRICS metric);
-    // func to remove all gauges of every EpCounter
-    void removeDynamicGaugeEp(void);
+    /**
+     * Collectable that renders the EpCounter metric families only
+     * when the exposer is scraped. Counter values are read from the
+     * EpStatUniverse that the stats managers keep up to date, so no
+     * per-endpoint work is done between scrapes.
+     */
+    class EpCounterCollectable : public Collectable {
+    public:
+        /**
+         * Instantiate a new EpCounter collectable
+         *
+         * @param pmanager_   the owning prometheus manager
+         */
+        EpCounterCollectable(PrometheusManager& pmanager_);
+
+        /**
+         * Build the EpCounter metric families from the current
+         * counter snapshots
+         *
+         * @return the metric families to expose
+         */
+        std::vector<MetricFamily> Collect() override;
+
+    private:
+        PrometheusManager& pmanager;
+    };
+
+    // collectable registered with the exposer for EpCounter metrics
+    shared_ptr<EpCounterCollectable> ep_collectable_ptr;
 
     /**
-     * cache the pair of (label map hash, gauge ptr) for every ep uuid
-     * The hash is created utilizing prometheus lib, which is basically
-     * a rolling hash  of all the key,value pairs of the ep attributes.
+     * Label set cached for every ep uuid. The labels are rebuilt only
+     * when the hash of the ep attributes changes.
      */
-    unordered_map<string, hgauge_pair_t> ep_gauge_map[EP_METRICS_MAX];
+    struct EpLabelState {
+        // hash of the ep attributes the labels were built from
+        size_t attr_hash;
+        // hash of the label set, used to detect duplicates
+        size_t label_hash;
+        // prometheus labels for this ep
+        std::vector<ClientMetric::Label> labels;
+    };
+
+    // func to create or refresh the label set of an ep.
+    // return true if a new ep got added
+    bool updateEpLabels(const string& uuid,
+                        const string& ep_name,
+                        const size_t& attr_hash,
+        const unordered_map<string, string>&    attr_map);
+    // func to remove the label set of an ep given uuid
+    bool removeEpLabels(const string& uuid);
+    // func to remove the label set of every ep
+    void removeEpLabels(void);
+
+    // cache of label set for every ep uuid
+    unordered_map<string, EpLabelState> ep_label_map;
+    // label hashes in use, to avoid exposing duplicate series
+    unordered_set<size_t> ep_label_hashes;
 
     //Utility apis
     // Create a label map that can be used for annotation, given the ep attr map
@@ -805,6 +938,280 @@ private:
     Gauge* remote_ep_gauge_map[REMOTE_EP_METRICS_MAX+1];
     /* End of RemoteEp related apis and state */
 
+    /* Start of FSWatcher related apis and state */
+    // Lock to safe guard FSWatcher related state
+    mutex fswatcher_mutex;
+
+    enum FSWATCHER_METRICS {
+        FSWATCHER_METRICS_MIN,
+        FSWATCHER_UPDATE_EVENTS = FSWATCHER_METRICS_MIN,
+        FSWATCHER_SUPPRESSED_EVENTS,
+        FSWATCHER_DELETE_EVENTS,
+        FSWATCHER_METRICS_MAX = FSWATCHER_DELETE_EVENTS
+    };
+
+    // Static Metric families and metrics
+    // metric families to track all FSWatcher metrics
+    Family<Gauge>      *gauge_fswatcher_family_ptr[FSWATCHER_METRICS_MAX+1];
+
+    // create any fs watcher gauge metric families during start
+    void createStaticGaugeFamiliesFSWatcher(void);
+    // remove any fs watcher gauge metric families during stop
+    void removeStaticGaugeFamiliesFSWatcher(void);
+
+    // Dynamic Metric families and metrics
+    // func to create gauge for fs watcher given metric type
+    void createDynamicGaugeFSWatcher(FSWATCHER_METRICS metric);
+    // func to get Gauge for FSWatcher given metric type
+    Gauge * getDynamicGaugeFSWatcher(FSWATCHER_METRICS metric);
+    // func to remove gauge for FSWatcher given metric type
+    bool removeDynamicGaugeFSWatcher(FSWATCHER_METRICS metric);
+    // func to remove all gauges of every FSWatcher metric
+    void removeDynamicGaugeFSWatcher(void);
+
+    /**
+     * cache Gauge ptr for every FSWatcher metric
+     */
+    Gauge* fswatcher_gauge_map[FSWATCHER_METRICS_MAX+1];
+    /* End of FSWatcher related apis and state */
+
+    /* Start of endpoint advertisement related apis and state */
+    // Lock to safe guard endpoint advertisement related state
+    mutex ep_advert_mutex;
+
+    enum EP_ADVERT_METRICS {
+        EP_ADVERT_METRICS_MIN,
+        EP_ADVERT_QUEUE_DEPTH = EP_ADVERT_METRICS_MIN,
+        EP_ADVERT_SENT,
+        EP_ADVERT_COALESCED,
+        EP_ADVERT_SEND_RATE,
+        EP_ADVERT_METRICS_MAX = EP_ADVERT_SEND_RATE
+    };
+
+    // Static Metric families and metrics
+    // metric families to track all endpoint advertisement metrics
+    Family<Gauge>      *gauge_ep_advert_family_ptr[EP_ADVERT_METRICS_MAX+1];
+
+    // create any endpoint advert gauge metric families during start
+    void createStaticGaugeFamiliesEpAdvert(void);
+    // remove any endpoint advert gauge metric families during stop
+    void removeStaticGaugeFamiliesEpAdvert(void);
+
+    // Dynamic Metric families and metrics
+    // func to create gauge for endpoint advert given metric type
+    void createDynamicGaugeEpAdvert(EP_ADVERT_METRICS metric);
+    // func to get Gauge for endpoint advert given metric type
+    Gauge * getDynamicGaugeEpAdvert(EP_ADVERT_METRICS metric);
+    // func to remove gauge for endpoint advert given metric type
+    bool removeDynamicGaugeEpAdvert(EP_ADVERT_METRICS metric);
+    // func to remove all gauges of every endpoint advert metric
+    void removeDynamicGaugeEpAdvert(void);
+
+    /**
+     * cache Gauge ptr for every endpoint advertisement metric
+     */
+    Gauge* ep_advert_gauge_map[EP_ADVERT_METRICS_MAX+1];
+    /* End of endpoint advertisement related apis and state */
+
+    /* Start of conntrack zone flush related apis and state */
+    // Lock to safe guard conntrack zone flush related state
+    mutex ct_zone_mutex;
+
+    enum CT_ZONE_METRICS {
+        CT_ZONE_METRICS_MIN,
+        CT_ZONE_FLUSH_QUEUE_DEPTH = CT_ZONE_METRICS_MIN,
+        CT_ZONE_FLUSHED_ZONES,
+        CT_ZONE_FLUSHED_ENTRIES,
+        CT_ZONE_LAST_FLUSH_MS,
+        CT_ZONE_METRICS_MAX = CT_ZONE_LAST_FLUSH_MS
+    };
+
+    // Static Metric families and metrics
+    // metric families to track all conntrack zone flush metrics
+    Family<Gauge>      *gauge_ct_zone_family_ptr[CT_ZONE_METRICS_MAX+1];
+
+    // create any conntrack zone gauge metric families during start
+    void createStaticGaugeFamiliesCtZone(void);
+    // remove any conntrack zone gauge metric families during stop
+    void removeStaticGaugeFamiliesCtZone(void);
+
+    // Dynamic Metric families and metrics
+    // func to create gauge for conntrack zone given metric type
+    void createDynamicGaugeCtZone(CT_ZONE_METRICS metric);
+    // func to get Gauge for conntrack zone given metric type
+    Gauge * getDynamicGaugeCtZone(CT_ZONE_METRICS metric);
+    // func to remove gauge for conntrack zone given metric type
+    bool removeDynamicGaugeCtZone(CT_ZONE_METRICS metric);
+    // func to remove all gauges of every conntrack zone metric
+    void removeDynamicGaugeCtZone(void);
+
+    /**
+     * cache Gauge ptr for every conntrack zone flush metric
+     */
+    Gauge* ct_zone_gauge_map[CT_ZONE_METRICS_MAX+1];
+    /* End of conntrack zone flush related apis and state */
+
+    /* Start of endpoint group render related apis and state */
+    // Lock to safe guard endpoint group render related state
+    mutex epg_render_mutex;
+
+    enum EPG_RENDER_METRICS {
+        EPG_RENDER_METRICS_MIN,
+        EPG_RENDER_FANOUTS = EPG_RENDER_METRICS_MIN,
+        EPG_RENDER_SKIPPED,
+        EPG_RENDER_METRICS_MAX = EPG_RENDER_SKIPPED
+    };
+
+    // Static Metric families and metrics
+    // metric families to track all endpoint group render metrics
+    Family<Gauge>      *gauge_epg_render_family_ptr[EPG_RENDER_METRICS_MAX+1];
+
+    // create any endpoint group render gauge metric families during start
+    void createStaticGaugeFamiliesEpgRender(void);
+    // remove any endpoint group render gauge metric families during stop
+    void removeStaticGaugeFamiliesEpgRender(void);
+
+    // Dynamic Metric families and metrics
+    // func to create gauge for endpoint group render given metric type
+    void createDynamicGaugeEpgRender(EPG_RENDER_METRICS metric);
+    // func to get Gauge for endpoint group render given metric type
+    Gauge * getDynamicGaugeEpgRender(EPG_RENDER_METRICS metric);
+    // func to remove gauge for endpoint group render given metric type
+    bool removeDynamicGaugeEpgRender(EPG_RENDER_METRICS metric);
+    // func to remove all gauges of every endpoint group render metric
+    void removeDynamicGaugeEpgRender(void);
+
+    /**
+     * cache Gauge ptr for every endpoint group render metric
+     */
+    Gauge* epg_render_gauge_map[EPG_RENDER_METRICS_MAX+1];
+    /* End of endpoint group render related apis and state */
+
+    /* Start of task queue related apis and state */
+    // Lock to safe guard task queue related state
+    mutex task_queue_mutex;
+
+    enum TASK_QUEUE_METRICS {
+        TASK_QUEUE_METRICS_MIN,
+        TASK_QUEUE_DEPTH = TASK_QUEUE_METRICS_MIN,
+        TASK_QUEUE_DISPATCHED,
+        TASK_QUEUE_COALESCED,
+        TASK_QUEUE_HELD,
+        TASK_QUEUE_OVERDUE,
+        TASK_QUEUE_RUN,
+        TASK_QUEUE_WAIT_USEC,
+        TASK_QUEUE_MAX_WAIT_USEC,
+        TASK_QUEUE_RUN_USEC,
+        TASK_QUEUE_MAX_RUN_USEC,
+        TASK_QUEUE_METRICS_MAX = TASK_QUEUE_MAX_RUN_USEC
+    };
+
+    // Static Metric families and metrics
+    // metric families to track all task queue metrics
+    Family<Gauge>      *gauge_task_queue_family_ptr[TASK_QUEUE_METRICS_MAX+1];
+
+    // create any task queue gauge metric families during start
+    void createStaticGaugeFamiliesTaskQueue(void);
+    // remove any task queue gauge metric families during stop
+    void removeStaticGaugeFamiliesTaskQueue(void);
+
+    // Dynamic Metric families and metrics
+    // func to create gauge for task queue given metric type and class
+    void createDynamicGaugeTaskQueue(TASK_QUEUE_METRICS metric,
+                                     const string& task_class);
+    // func to get Gauge for task queue given metric type and class
+    Gauge * getDynamicGaugeTaskQueue(TASK_QUEUE_METRICS metric,
+                                     const string& task_class);
+    // func to remove all gauges of every task queue metric
+    void removeDynamicGaugeTaskQueue(void);
+
+    /**
+     * cache Gauge ptr for every task queue metric, keyed by task
+     * class
+     */
+    unordered_map<string, Gauge*> task_queue_gauge_map[TASK_QUEUE_METRICS_MAX+1];
+    /* End of task queue related apis and state */
+
+    /* Start of flow table programming related apis and state */
+    // Lock to safe guard flow table programming related state
+    mutex flow_table_mutex;
+
+    enum FLOW_TABLE_METRICS {
+        FLOW_TABLE_METRICS_MIN,
+        FLOW_TABLE_FLOWS = FLOW_TABLE_METRICS_MIN,
+        FLOW_TABLE_ADDS,
+        FLOW_TABLE_MODS,
+        FLOW_TABLE_DELETES,
+        FLOW_TABLE_DIFF_USEC,
+        FLOW_TABLE_BYTES,
+        FLOW_TABLE_METRICS_MAX = FLOW_TABLE_BYTES
+    };
+
+    // Static Metric families and metrics
+    // metric families to track all flow table programming metrics
+    Family<Gauge>      *gauge_flow_table_family_ptr[FLOW_TABLE_METRICS_MAX+1];
+
+    // create any flow table gauge metric families during start
+    void createStaticGaugeFamiliesFlowTable(void);
+    // remove any flow table gauge metric families during stop
+    void removeStaticGaugeFamiliesFlowTable(void);
+
+    // Dynamic Metric families and metrics
+    // func to create gauge for flow table given metric type and table
+    void createDynamicGaugeFlowTable(FLOW_TABLE_METRICS metric,
+                                     const string& bridge_name,
+                                     const string& table_name);
+    // func to get Gauge for flow table given metric type and table
+    Gauge * getDynamicGaugeFlowTable(FLOW_TABLE_METRICS metric,
+                                     const string& bridge_name,
+                                     const string& table_name);
+    // func to remove all gauges of every flow table metric
+    void removeDynamicGaugeFlowTable(void);
+
+    /**
+     * cache Gauge ptr for every flow table metric, keyed by bridge
+     * and table
+     */
+    map<pair<string, string>, Gauge*>
+        flow_table_gauge_map[FLOW_TABLE_METRICS_MAX+1];
+
+    enum FLOW_OBJECT_METRICS {
+        FLOW_OBJECT_METRICS_MIN,
+        FLOW_OBJECT_FLOWS = FLOW_OBJECT_METRICS_MIN,
+        FLOW_OBJECT_ADDS,
+        FLOW_OBJECT_MODS,
+        FLOW_OBJECT_DELETES,
+        FLOW_OBJECT_DIFF_USEC,
+        FLOW_OBJECT_METRICS_MAX = FLOW_OBJECT_DIFF_USEC
+    };
+
+    // metric families to track flow programming per object type
+    Family<Gauge>      *gauge_flow_object_family_ptr[FLOW_OBJECT_METRICS_MAX+1];
+
+    // create any flow object gauge metric families during start
+    void createStaticGaugeFamiliesFlowObject(void);
+    // remove any flow object gauge metric families during stop
+    void removeStaticGaugeFamiliesFlowObject(void);
+
+    // func to create gauge for flow object given metric type and type
+    void createDynamicGaugeFlowObject(FLOW_OBJECT_METRICS metric,
+                                      const string& bridge_name,
+                                      const string& object_type);
+    // func to get Gauge for flow object given metric type and type
+    Gauge * getDynamicGaugeFlowObject(FLOW_OBJECT_METRICS metric,
+                                      const string& bridge_name,
+                                      const string& object_type);
+    // func to remove all gauges of every flow object metric
+    void removeDynamicGaugeFlowObject(void);
+
+    /**
+     * cache Gauge ptr for every flow object metric, keyed by bridge
+     * and object type
+     */
+    map<pair<string, string>, Gauge*>
+        flow_object_gauge_map[FLOW_OBJECT_METRICS_MAX+1];
+    /* End of flow table programming related apis and state */
+
 
     /* Start of RDDropCounter related apis and state */
     // Lock to safe guard RDDropCounter related state
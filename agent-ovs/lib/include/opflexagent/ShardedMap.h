@@ -0,0 +1,129 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for ShardedMap
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_SHARDEDMAP_H
+#define OPFLEXAGENT_SHARDEDMAP_H
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * A map from keys to immutable values that is partitioned into
+ * lock-striped shards by key hash.  Values are published as shared
+ * pointers to const objects, so a reader holds the shard lock only
+ * long enough to copy a pointer and can then use the value without
+ * blocking writers.  Writers replace values wholesale rather than
+ * modifying them in place.
+ *
+ * @param K the key type; must be hashable
+ * @param V the value type
+ * @param NSHARDS the number of shards
+ */
+template <typename K, typename V, size_t NSHARDS = 16>
+class ShardedMap : private boost::noncopyable {
+public:
+    /**
+     * A pointer to an immutable value in the map
+     */
+    typedef std::shared_ptr<const V> value_ptr;
+
+    /**
+     * Get the value for the given key
+     *
+     * @param key the key to look up
+     * @return the value, or an empty pointer if the key is not
+     * present
+     */
+    value_ptr get(const K& key) const {
+        const Shard& s = shard(key);
+        std::lock_guard<std::mutex> guard(s.mutex);
+        auto it = s.map.find(key);
+        if (it == s.map.end())
+            return value_ptr();
+        return it->second;
+    }
+
+    /**
+     * Publish a new value for the given key
+     *
+     * @param key the key to update
+     * @param value the new value
+     */
+    void put(const K& key, value_ptr value) {
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> guard(s.mutex);
+        s.map[key] = std::move(value);
+    }
+
+    /**
+     * Remove the given key
+     *
+     * @param key the key to remove
+     */
+    void erase(const K& key) {
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> guard(s.mutex);
+        s.map.erase(key);
+    }
+
+    /**
+     * Remove all keys
+     */
+    void clear() {
+        for (Shard& s : shards) {
+            std::lock_guard<std::mutex> guard(s.mutex);
+            s.map.clear();
+        }
+    }
+
+    /**
+     * Call the given function for every key and value in the map.
+     * Each shard is visited under its own lock, so the result is not
+     * an atomic snapshot of the whole map.
+     *
+     * @param f a function taking the key and the value pointer
+     */
+    template <typename F>
+    void forEach(F f) const {
+        for (const Shard& s : shards) {
+            std::lock_guard<std::mutex> guard(s.mutex);
+            for (const auto& kv : s.map)
+                f(kv.first, kv.second);
+        }
+    }
+
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<K, value_ptr> map;
+    };
+    std::array<Shard, NSHARDS> shards;
+
+    Shard& shard(const K& key) {
+        return shards[std::hash<K>()(key) % NSHARDS];
+    }
+
+    const Shard& shard(const K& key) const {
+        return shards[std::hash<K>()(key) % NSHARDS];
+    }
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_SHARDEDMAP_H */
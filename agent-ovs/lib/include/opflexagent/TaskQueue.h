@@ -13,6 +13,9 @@
 
 #include <boost/asio/io_service.hpp>
 
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
 #include <unordered_set>
 #include <string>
 #include <mutex>
@@ -22,36 +25,138 @@ namespace opflexagent {
 
 /**
  * Queue tasks using a boost::asio::io_service so that the same task
- * is not queued multiple times
+ * is not queued multiple times.
+ *
+ * Tasks may optionally be delayed by a debounce window so that a
+ * burst of updates to the same task ID results in a single run.  The
+ * window starts when the task is first queued and is not extended by
+ * later dispatches, so a task waits at most one window.
+ *
+ * A task may also name a parent task.  While the parent is queued or
+ * running, the child is held back and is only released once the
+ * parent completes.  A parent task that re-dispatches its children,
+ * such as an endpoint group update that re-renders its endpoints,
+ * therefore results in one run for each child rather than two.  A
+ * child that has already waited longer than the hold limit is not
+ * held again, so a parent that is dispatched continuously cannot
+ * starve its children.
  */
 class TaskQueue {
 public:
+    /**
+     * Counters for a class of tasks
+     */
+    struct TaskStats {
+        /** Number of times a task was dispatched */
+        uint64_t dispatched = 0;
+        /** Dispatches merged into a task that was already queued */
+        uint64_t coalesced = 0;
+        /** Dispatches held back behind a queued or running parent */
+        uint64_t held = 0;
+        /** Holds skipped because the task waited past the hold limit */
+        uint64_t overdue = 0;
+        /** Number of tasks that were run */
+        uint64_t run = 0;
+        /** Number of tasks currently queued */
+        uint64_t depth = 0;
+        /** Total time tasks spent queued in microseconds */
+        uint64_t waitUs = 0;
+        /** Longest time a task spent queued in microseconds */
+        uint64_t maxWaitUs = 0;
+        /** Total time spent running tasks in microseconds */
+        uint64_t runUs = 0;
+        /** Longest time spent running a task in microseconds */
+        uint64_t maxRunUs = 0;
+    };
+
     /**
      * Initialize a task queue using the specified io_service
      * @param io_service the io service to use
      */
     TaskQueue(boost::asio::io_service& io_service);
 
+    /**
+     * Set how long a newly queued task waits before it runs so that
+     * further updates to the same task ID can be merged into it.
+     *
+     * @param delay the debounce window.  Zero runs tasks as soon as
+     * possible.
+     */
+    void setDebounce(std::chrono::milliseconds delay);
+
+    /**
+     * Set how long a queued task may wait before it is no longer held
+     * back behind its parent.
+     *
+     * @param limit the hold limit.  Zero never holds tasks back.
+     */
+    void setMaxHold(std::chrono::milliseconds limit);
+
+    /**
+     * The default hold limit
+     */
+    static const std::chrono::milliseconds DEFAULT_MAX_HOLD;
+
     /**
      * Dispatch the given task with the specified task ID.  If a task
      * with the given task ID has already been queued and not been
-     * executed, the task will not be queued again.  The task can be
-     * queued again once it has begun executing.
+     * executed, the task will not be queued again and the new task
+     * function replaces the queued one.  The task can be queued again
+     * once it has begun executing.
      *
      * @param taskId a unique ID for the task
      * @param task a function to execute for the task.  This will be
      * copied onto the task queue
+     * @param taskClass the class of the task used for statistics
+     * @param parentId the ID of a parent task that subsumes this
+     * task, or an empty string
      */
     void dispatch(const std::string& taskId,
-                  const std::function<void ()>& task);
+                  const std::function<void ()>& task,
+                  const std::string& taskClass = "",
+                  const std::string& parentId = "");
+
+    /**
+     * Get the number of tasks that are currently queued
+     */
+    size_t getDepth() const;
+
+    /**
+     * Get the statistics for each task class.  Tasks dispatched
+     * without a class are counted under "default".
+     *
+     * @param stats a map from task class to statistics to fill in
+     */
+    void getStats(std::unordered_map<std::string, TaskStats>& stats) const;
 
 private:
-    void run_task(const std::string& taskId,
-                  const std::function<void ()>& task);
+    typedef std::chrono::steady_clock clock;
+
+    struct Entry {
+        std::function<void ()> task;
+        std::string taskClass;
+        std::string parentId;
+        clock::time_point queued;
+        uint64_t seq;
+        bool held;
+    };
+
+    void schedule(const std::string& taskId, uint64_t seq, bool delay);
+    void run_task(const std::string& taskId, uint64_t seq);
+    bool isActive(const std::string& taskId) const;
+    bool canHold(const Entry& entry, clock::time_point now) const;
+    void releaseChildren(const std::string& parentId);
 
     boost::asio::io_service& io_service;
-    std::mutex queueMutex;
-    std::unordered_set<std::string> queuedItems;
+    mutable std::mutex queueMutex;
+    std::chrono::milliseconds debounce;
+    std::chrono::milliseconds maxHold;
+    uint64_t nextSeq;
+    std::unordered_map<std::string, Entry> queuedItems;
+    std::unordered_multiset<std::string> runningItems;
+    std::unordered_map<std::string,
+                       std::unordered_set<std::string>> children;
+    std::unordered_map<std::string, TaskStats> stats;
 };
 
 } // namespace opflexagent
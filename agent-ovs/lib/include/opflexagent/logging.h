@@ -13,6 +13,9 @@
 #ifndef AGENT_LOGGING_H
 #define AGENT_LOGGING_H
 
+#include <opflex/logging/OFLogBuffer.h>
+
+#include <cstdint>
 #include <string>
 #include <iostream>
 #include <sstream>
@@ -60,6 +63,33 @@ void initLogging(const std::string& level, bool toSyslog,
                  const std::string& log_file,
                  const std::string& syslog_name = "opflex-agent");
 
+/**
+ * Switch the current log destination to asynchronous mode.  Log
+ * messages are queued on a per-thread lock-free ring buffer and
+ * written by a single background thread, so logging threads never
+ * wait on the log destination.  If a ring buffer is full, debug and
+ * trace messages are dropped and counted while more severe messages
+ * wait for space.  Call initLogging() first to select the
+ * destination.
+ *
+ * @param queueSize the number of messages each thread can queue;
+ * rounded up to a power of two
+ */
+void enableAsyncLogging(size_t queueSize = 4096);
+
+/**
+ * Write out any queued log messages, stop the background log writer
+ * and return to synchronous logging.  Safe to call when asynchronous
+ * logging is not enabled.
+ */
+void stopAsyncLogging();
+
+/**
+ * Get the number of log messages dropped because a ring buffer was
+ * full
+ */
+uint64_t getDroppedLogMessages();
+
 /**
  * Change the logging level of the agent.
  *
@@ -95,26 +125,32 @@ public:
      * @param fn Name of function enclosing the message
      */
     Logger(LogLevel l, const char *f, int no, const char *fn) :
+        buffer_(opflex::logging::OFLogBuffer::acquire()),
         level(l), filename(f), lineNumber(no), functionName(fn) {}
 
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
     /**
      * Destroy the logger and log the output
      */
     ~Logger() {
         getLogSink()->write(level, filename, lineNumber, functionName,
-                            buffer_.str());
+                            buffer_->str());
+        opflex::logging::OFLogBuffer::release(buffer_);
     }
 
     /**
      * Get the ostream to write to
      */
-    std::ostream& stream() { return buffer_; }
+    std::ostream& stream() { return buffer_->stream(); }
 
 private:
     /**
-     * The internal buffer for the logger
+     * The internal buffer for the logger, reused across messages
+     * logged from the same thread
      */
-    std::ostringstream buffer_;
+    opflex::logging::OFLogBuffer* buffer_;
     /**
      * The log level of the message
      */
@@ -18,11 +18,21 @@
 
 #include <opflex/logging/OFLogHandler.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
+#include <pthread.h>
 #include <syslog.h>
 
 using opflex::logging::OFLogHandler;
@@ -33,11 +43,49 @@ AgentLogHandler logHandler(OFLogHandler::NO_LOGGING);
 
 LogLevel logLevel = DEBUG;
 
+/**
+ * Log sink that formats each message itself and can write a batch of
+ * messages before flushing the underlying destination.
+ */
+class FormattingLogSink : public LogSink {
+public:
+    virtual ~FormattingLogSink() {}
+
+    virtual
+    void write(LogLevel level, const char *filename, int lineno,
+               const char *functionName, const std::string& message) {
+        writeRecord(boost::posix_time::microsec_clock::local_time(),
+                    level, filename, lineno, functionName, message);
+        flush();
+    }
+
+    /**
+     * Write a log message without flushing the destination
+     *
+     * @param timestamp the local time at which the message was logged
+     * @param level The log level of the message
+     * @param filename Name of source file that generated the message
+     * @param lineno Line number in source file that generated the message
+     * @param functionName Name of function that generated the message
+     * @param message The log message to write
+     */
+    virtual
+    void writeRecord(const boost::posix_time::ptime& timestamp,
+                     LogLevel level, const char *filename, int lineno,
+                     const char *functionName,
+                     const std::string& message) = 0;
+
+    /**
+     * Flush messages written with writeRecord to the destination
+     */
+    virtual void flush() {}
+};
+
 /**
  * Log sink to write log messages to a standard output stream, such as
  * standard output or file stream.
  */
-class OStreamLogSink : public LogSink {
+class OStreamLogSink : public FormattingLogSink {
 public:
     /**
      * Constructor that accepts the output stream to write logs to.
@@ -64,8 +112,9 @@ public:
     }
 
     virtual
-    void write(LogLevel level, const char *filename, int lineno,
-               const char *functionName, const std::string& message) {
+    void writeRecord(const boost::posix_time::ptime& timestamp,
+                     LogLevel level, const char *filename, int lineno,
+                     const char *functionName, const std::string& message) {
         const char *levelStr = LEVEL_STR_DEBUG;
         switch (level) {
         case TRACE:   levelStr = LEVEL_STR_TRACE; break;
@@ -76,9 +125,14 @@ public:
         case FATAL:   levelStr = LEVEL_STR_FATAL; break;
         }
         std::lock_guard<std::mutex> lock(logMtx);
-        (*out) << "[" << boost::posix_time::microsec_clock::local_time()
+        (*out) << "[" << timestamp
             << "] [" << levelStr << "] [" << filename << ":" << lineno << ":"
-            << functionName << "] " << message << std::endl;
+            << functionName << "] " << message << '\n';
+    }
+
+    virtual void flush() {
+        std::lock_guard<std::mutex> lock(logMtx);
+        out->flush();
     }
 
 private:
@@ -103,7 +157,7 @@ const char * OStreamLogSink::LEVEL_STR_FATAL = "fatal";
 /**
  * Log sink to write log messages to syslog.
  */
-class SyslogLogSink : public LogSink {
+class SyslogLogSink : public FormattingLogSink {
 public:
     SyslogLogSink(const std::string& name) : syslog_name(name) {
         openlog(syslog_name.c_str(), LOG_CONS | LOG_PID, LOG_DAEMON);
@@ -112,8 +166,10 @@ public:
         closelog();
     }
 
-    void write(LogLevel level, const char *filename, int lineno,
-               const char *functionName, const std::string& message) {
+    virtual
+    void writeRecord(const boost::posix_time::ptime&,
+                     LogLevel level, const char *filename, int lineno,
+                     const char *functionName, const std::string& message) {
         int priority = LOG_DEBUG;
         switch (level) {
         // No level lower than LOG_DEBUG in syslog
@@ -133,27 +189,396 @@ private:
     std::string syslog_name;
 };
 
+/**
+ * A log message queued for the asynchronous log writer.  Slots are
+ * reused, so the strings keep their capacity across messages.
+ */
+struct LogRecord {
+    LogLevel level;
+    int lineno;
+    std::chrono::system_clock::time_point timestamp;
+    std::string filename;
+    std::string functionName;
+    std::string message;
+};
+
+/**
+ * Single-producer single-consumer ring buffer of log records owned
+ * by one logging thread and drained by the log writer thread.
+ */
+class LogRing {
+public:
+    LogRing(size_t size) : slots(size), mask(size - 1) {}
+
+    /**
+     * Queue a message.  Called only from the owning thread.
+     *
+     * @return the sequence number of the message, or -1 if the ring
+     * is full
+     */
+    int64_t push(LogLevel level, const char *filename, int lineno,
+                 const char *functionName, const std::string& message) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= slots.size())
+            return -1;
+        LogRecord& r = slots[t & mask];
+        r.level = level;
+        r.lineno = lineno;
+        r.timestamp = std::chrono::system_clock::now();
+        r.filename.assign(filename);
+        r.functionName.assign(functionName);
+        r.message.assign(message);
+        tail.store(t + 1, std::memory_order_seq_cst);
+        return static_cast<int64_t>(t);
+    }
+
+    /**
+     * Check whether the message with the given sequence number has
+     * been written
+     */
+    bool written(uint64_t seq) const {
+        return head.load(std::memory_order_acquire) > seq;
+    }
+
+    /**
+     * Check whether there are messages to write
+     */
+    bool pending() const {
+        return tail.load(std::memory_order_seq_cst) !=
+            head.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Write up to max queued messages to the given sink.  Called only
+     * from the log writer thread.
+     *
+     * @return the number of messages written
+     */
+    size_t drain(FormattingLogSink& sink, size_t max) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        size_t count = 0;
+        while (h != t && count < max) {
+            LogRecord& r = slots[h & mask];
+            sink.writeRecord(toLocal(r.timestamp), r.level,
+                             r.filename.c_str(), r.lineno,
+                             r.functionName.c_str(), r.message);
+            if (r.message.capacity() > MAX_RETAINED_MESSAGE)
+                std::string().swap(r.message);
+            head.store(++h, std::memory_order_release);
+            count += 1;
+        }
+        return count;
+    }
+
+    /**
+     * Set when the owning thread exits
+     */
+    std::atomic<bool> closed{false};
+
+private:
+    static const size_t MAX_RETAINED_MESSAGE = 16 * 1024;
+
+    static boost::posix_time::ptime
+    toLocal(const std::chrono::system_clock::time_point& tp) {
+        using namespace boost::posix_time;
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>
+            (tp.time_since_epoch()).count();
+        ptime utc = from_time_t(us / 1000000) + microseconds(us % 1000000);
+        return boost::date_time::c_local_adjustor<ptime>::utc_to_local(utc);
+    }
+
+    std::vector<LogRecord> slots;
+    const uint64_t mask;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+};
+
+/**
+ * Per-thread handle on the ring buffer of the current generation of
+ * the asynchronous log sink
+ */
+struct LogRingHolder {
+    ~LogRingHolder() {
+        if (ring) ring->closed = true;
+    }
+
+    std::shared_ptr<LogRing> ring;
+    uint64_t generation = 0;
+};
+
+static thread_local LogRingHolder localRing;
+
+/**
+ * Held by the log writer thread while it writes a batch, and across
+ * fork() so that a forked child never inherits a log destination
+ * locked by the writer thread
+ */
+static std::mutex writerMutex;
+
+/**
+ * Log sink that queues messages on per-thread ring buffers and
+ * writes them to a formatting log sink from a background thread.
+ */
+class AsyncLogSink : public LogSink {
+public:
+    AsyncLogSink(FormattingLogSink& target_, size_t queueSize)
+        : target(&target_), ringSize(1),
+          reportedDropped(dropped.load(std::memory_order_relaxed)) {
+        while (ringSize < queueSize) ringSize <<= 1;
+        generation = nextGeneration++;
+        writer = std::thread([this]() { run(); });
+    }
+
+    /**
+     * Get the destination that messages are written to
+     */
+    FormattingLogSink* getTarget() { return target; }
+
+    virtual
+    void write(LogLevel level, const char *filename, int lineno,
+               const char *functionName, const std::string& message) {
+        if (stopping) {
+            target->write(level, filename, lineno, functionName, message);
+            return;
+        }
+        LogRing& ring = getRing();
+        int64_t seq;
+        while ((seq = ring.push(level, filename, lineno,
+                                functionName, message)) < 0) {
+            if (level >= DEBUG) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            wake();
+            if (stopping) {
+                target->write(level, filename, lineno, functionName,
+                              message);
+                return;
+            }
+            std::this_thread::yield();
+        }
+        wake();
+        if (level == FATAL) {
+            // the process is likely about to exit
+            while (!ring.written(seq) && !stopping)
+                std::this_thread::yield();
+        }
+    }
+
+    /**
+     * Write out all queued messages and stop the writer thread
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        cond.notify_one();
+        if (writer.joinable())
+            writer.join();
+    }
+
+    /**
+     * Number of messages dropped because a ring buffer was full
+     */
+    static std::atomic<uint64_t> dropped;
+
+private:
+    static const size_t BATCH_SIZE = 256;
+    static std::atomic<uint64_t> nextGeneration;
+
+    LogRing& getRing() {
+        if (localRing.generation != generation || !localRing.ring) {
+            if (localRing.ring) localRing.ring->closed = true;
+            localRing.ring = std::make_shared<LogRing>(ringSize);
+            localRing.generation = generation;
+            std::lock_guard<std::mutex> guard(mutex);
+            newRings.push_back(localRing.ring);
+        }
+        return *localRing.ring;
+    }
+
+    void wake() {
+        if (sleeping.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> guard(mutex);
+            cond.notify_one();
+        }
+    }
+
+    size_t drainAll() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            rings.insert(rings.end(), newRings.begin(), newRings.end());
+            newRings.clear();
+        }
+        size_t count = 0;
+        auto it = rings.begin();
+        while (it != rings.end()) {
+            // check closed before draining so that no message queued
+            // before the thread exited is lost
+            bool closed = (*it)->closed;
+            count += (*it)->drain(*target, BATCH_SIZE);
+            if (closed && !(*it)->pending())
+                it = rings.erase(it);
+            else
+                ++it;
+        }
+        return count;
+    }
+
+    bool anyPending() {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!newRings.empty()) return true;
+        for (auto& r : rings)
+            if (r->pending()) return true;
+        return false;
+    }
+
+    void reportDropped() {
+        uint64_t d = dropped.load(std::memory_order_relaxed);
+        if (d == reportedDropped) return;
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastDropReport < std::chrono::seconds(1) && !stopping)
+            return;
+        std::ostringstream msg;
+        msg << "Dropped " << (d - reportedDropped)
+            << " log messages because the log queue was full";
+        target->writeRecord(boost::posix_time::microsec_clock::local_time(),
+                            WARNING, __FILE__, __LINE__, __FUNCTION__,
+                            msg.str());
+        reportedDropped = d;
+        lastDropReport = now;
+    }
+
+    void run() {
+        while (true) {
+            size_t count;
+            {
+                std::lock_guard<std::mutex> guard(writerMutex);
+                count = drainAll();
+                reportDropped();
+                if (count > 0)
+                    target->flush();
+            }
+            if (count > 0) continue;
+            if (stopping) break;
+
+            sleeping = true;
+            if (!anyPending()) {
+                std::unique_lock<std::mutex> guard(mutex);
+                if (!stopping)
+                    cond.wait_for(guard, std::chrono::milliseconds(100));
+            }
+            sleeping = false;
+        }
+        // drain anything queued while stopping
+        std::lock_guard<std::mutex> guard(writerMutex);
+        while (drainAll() > 0) {}
+        reportDropped();
+        target->flush();
+    }
+
+    FormattingLogSink* target;
+    size_t ringSize;
+    uint64_t generation;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> sleeping{false};
+    std::vector<std::shared_ptr<LogRing>> newRings;
+
+    // accessed only from the writer thread
+    std::vector<std::shared_ptr<LogRing>> rings;
+    uint64_t reportedDropped;
+    std::chrono::steady_clock::time_point lastDropReport;
+
+    std::thread writer;
+};
+
+std::atomic<uint64_t> AsyncLogSink::dropped{0};
+std::atomic<uint64_t> AsyncLogSink::nextGeneration{1};
+
 static OStreamLogSink consoleLogSink(std::cout);
-static LogSink * currentLogSink = &consoleLogSink;
+static FormattingLogSink * syncLogSink = &consoleLogSink;
+static std::atomic<LogSink*> currentLogSink{&consoleLogSink};
+static AsyncLogSink * asyncLogSink = NULL;
+static std::mutex asyncMutex;
 
 LogSink * getLogSink() {
-    return currentLogSink;
+    return currentLogSink.load(std::memory_order_acquire);
+}
+
+static void lockWriterForFork() {
+    writerMutex.lock();
+}
+
+static void unlockWriterForFork() {
+    writerMutex.unlock();
+}
+
+/**
+ * The log writer thread does not exist in a forked child, so the
+ * child must go back to logging synchronously
+ */
+static void resetAsyncLoggingInChild() {
+    writerMutex.unlock();
+    if (asyncLogSink) {
+        currentLogSink = syncLogSink;
+        // leaked on purpose: its writer thread belongs to the parent
+        asyncLogSink = NULL;
+    }
 }
 
 void initLogging(const std::string& levelstr,
                  bool toSyslog,
                  const std::string& log_file,
                  const std::string& syslog_name) {
+    stopAsyncLogging();
     if (toSyslog) {
-        currentLogSink = new SyslogLogSink(syslog_name);
+        syncLogSink = new SyslogLogSink(syslog_name);
     } else if (!log_file.empty()) {
-        currentLogSink = new OStreamLogSink(log_file);
+        syncLogSink = new OStreamLogSink(log_file);
+    } else {
+        syncLogSink = &consoleLogSink;
     }
+    currentLogSink = syncLogSink;
     OFLogHandler::registerHandler(logHandler);
 
     setLoggingLevel(levelstr);
 }
 
+void enableAsyncLogging(size_t queueSize) {
+    static std::once_flag registered;
+    std::call_once(registered, []() {
+            pthread_atfork(lockWriterForFork, unlockWriterForFork,
+                           resetAsyncLoggingInChild);
+            std::atexit(stopAsyncLogging);
+        });
+
+    std::lock_guard<std::mutex> guard(asyncMutex);
+    if (asyncLogSink) return;
+    asyncLogSink = new AsyncLogSink(*syncLogSink,
+                                    std::max<size_t>(queueSize, 2));
+    currentLogSink = asyncLogSink;
+}
+
+void stopAsyncLogging() {
+    std::lock_guard<std::mutex> guard(asyncMutex);
+    if (!asyncLogSink) return;
+    currentLogSink = asyncLogSink->getTarget();
+    asyncLogSink->stop();
+    // Threads that loaded the sink before the switch may still call
+    // into it; once stopped it writes through to the target, so it
+    // is never deleted.
+    asyncLogSink = NULL;
+}
+
+uint64_t getDroppedLogMessages() {
+    return AsyncLogSink::dropped.load(std::memory_order_relaxed);
+}
+
 void setLoggingLevel(const std::string& newLevelstr) {
     OFLogHandler::Level level = OFLogHandler::INFO;
 
@@ -15,12 +15,23 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/filesystem/fstream.hpp>
 
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
 #include <opflexagent/FSEndpointSource.h>
 #include <opflexagent/FSExternalEndpointSource.h>
 #include <opflexagent/logging.h>
 
 #include <opflexagent/test/BaseFixture.h>
 #include <opflexagent/test/MockEndpointSource.h>
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
 
 namespace opflexagent {
 
@@ -444,6 +455,215 @@ BOOST_FIXTURE_TEST_CASE( basic, EndpointFixture ) {
     WAIT_FOR(!hasEPREntry<L3Ep>(framework, l3epr2_ipm), 500);
 }
 
+class BatchEndpointListener : public EndpointListener {
+public:
+    virtual void endpointUpdated(const std::string& uuid) {
+        std::unique_lock<std::mutex> guard(mutex);
+        epUpdates[uuid] += 1;
+    }
+    virtual void secGroupSetUpdated(const uri_set_t& secGroups) {
+        std::unique_lock<std::mutex> guard(mutex);
+        secGroupUpdates[secGroups] += 1;
+    }
+
+    std::mutex mutex;
+    std::unordered_map<std::string, int> epUpdates;
+    std::unordered_map<uri_set_t, int> secGroupUpdates;
+};
+
+BOOST_FIXTURE_TEST_CASE( batch, EndpointFixture ) {
+    URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+    URI sgu = URI("/PolicyUniverse/PolicySpace/test/GbpSecGroup/sg/");
+    std::vector<Endpoint> eps;
+    std::vector<std::string> uuids;
+    for (int i = 0; i < 10; i++) {
+        Endpoint ep("batch-ep-" + std::to_string(i));
+        ep.setMAC(MAC("00:00:00:00:01:0" + std::to_string(i)));
+        ep.setInterfaceName("veth-batch" + std::to_string(i));
+        ep.setEgURI(epgu);
+        ep.addSecurityGroup(sgu);
+        eps.push_back(ep);
+        uuids.push_back(ep.getUUID());
+    }
+    // duplicates in a batch are applied in order
+    eps.push_back(eps[0]);
+    uuids.push_back(uuids[0]);
+
+    BatchEndpointListener listener;
+    agent.getEndpointManager().registerListener(&listener);
+    EndpointListener::uri_set_t secGroups;
+    secGroups.insert(sgu);
+
+    epSource.updateEndpoints(eps);
+    std::unordered_set<std::string> epUuids;
+    agent.getEndpointManager().getEndpointsForGroup(epgu, epUuids);
+    BOOST_CHECK_EQUAL(10, epUuids.size());
+    epUuids.clear();
+    agent.getEndpointManager().getEndpointsByIface("veth-batch3", epUuids);
+    BOOST_CHECK_EQUAL(1, epUuids.size());
+    {
+        std::unique_lock<std::mutex> guard(listener.mutex);
+        // one notification per endpoint even though the batch
+        // contains a duplicate
+        BOOST_CHECK_EQUAL(10, listener.epUpdates.size());
+        for (int i = 0; i < 10; i++)
+            BOOST_CHECK_EQUAL(1, listener.epUpdates[uuids[i]]);
+        // one notification for the whole batch
+        BOOST_CHECK_EQUAL(1, listener.secGroupUpdates[secGroups]);
+        listener.epUpdates.clear();
+        listener.secGroupUpdates.clear();
+    }
+
+    epSource.removeEndpoints(uuids);
+    epUuids.clear();
+    agent.getEndpointManager().getEndpointsForGroup(epgu, epUuids);
+    BOOST_CHECK(epUuids.empty());
+    {
+        std::unique_lock<std::mutex> guard(listener.mutex);
+        BOOST_CHECK_EQUAL(10, listener.epUpdates.size());
+        for (int i = 0; i < 10; i++)
+            BOOST_CHECK_EQUAL(1, listener.epUpdates[uuids[i]]);
+        BOOST_CHECK_EQUAL(1, listener.secGroupUpdates[secGroups]);
+    }
+
+    agent.getEndpointManager().unregisterListener(&listener);
+}
+
+class SnapshotEndpointListener : public EndpointListener {
+public:
+    SnapshotEndpointListener(EndpointManager& epManager_, const URI& epgu_)
+        : epManager(epManager_), epgu(epgu_) {}
+
+    virtual void endpointUpdated(const std::string& uuid) {
+        // listeners must see the state that triggered the
+        // notification
+        std::unordered_set<std::string> eps;
+        epManager.getEndpointsForGroup(epgu, eps);
+        std::unique_lock<std::mutex> guard(mutex);
+        groupSizes[uuid] = eps.size();
+        present[uuid] = (bool)epManager.getEndpoint(uuid);
+    }
+
+    EndpointManager& epManager;
+    URI epgu;
+    std::mutex mutex;
+    std::unordered_map<std::string, size_t> groupSizes;
+    std::unordered_map<std::string, bool> present;
+};
+
+BOOST_FIXTURE_TEST_CASE( snapshots, EndpointFixture ) {
+    URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+    EndpointManager& epManager = agent.getEndpointManager();
+    SnapshotEndpointListener listener(epManager, epgu);
+    epManager.registerListener(&listener);
+
+    Endpoint ep1("snap-ep-1");
+    ep1.setMAC(MAC("00:00:00:00:02:01"));
+    ep1.setInterfaceName("veth-snap1");
+    ep1.setEgURI(epgu);
+    epSource.updateEndpoint(ep1);
+    {
+        std::unique_lock<std::mutex> guard(listener.mutex);
+        BOOST_CHECK_EQUAL(1, listener.groupSizes[ep1.getUUID()]);
+        BOOST_CHECK(listener.present[ep1.getUUID()]);
+    }
+
+    // moving the endpoint to another interface updates both
+    // interface snapshots
+    ep1.setInterfaceName("veth-snap2");
+    epSource.updateEndpoint(ep1);
+    std::unordered_set<std::string> epUuids;
+    epManager.getEndpointsByIface("veth-snap1", epUuids);
+    BOOST_CHECK(epUuids.empty());
+    epManager.getEndpointsByIface("veth-snap2", epUuids);
+    BOOST_CHECK_EQUAL(1, epUuids.size());
+    BOOST_CHECK_EQUAL("veth-snap2",
+                      epManager.getEndpoint(ep1.getUUID())
+                      ->getInterfaceName().get());
+    epUuids.clear();
+    epManager.getEndpointUUIDs(epUuids);
+    BOOST_CHECK(epUuids.find(ep1.getUUID()) != epUuids.end());
+
+    epSource.removeEndpoint(ep1.getUUID());
+    {
+        std::unique_lock<std::mutex> guard(listener.mutex);
+        BOOST_CHECK_EQUAL(0, listener.groupSizes[ep1.getUUID()]);
+        BOOST_CHECK(!listener.present[ep1.getUUID()]);
+    }
+    epUuids.clear();
+    epManager.getEndpointsByIface("veth-snap2", epUuids);
+    BOOST_CHECK(epUuids.empty());
+
+    epManager.unregisterListener(&listener);
+}
+
+BOOST_FIXTURE_TEST_CASE( group_snapshot_churn, EndpointFixture ) {
+    URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+    EndpointManager& epManager = agent.getEndpointManager();
+
+    // endpoints join and leave one at a time, each change
+    // republishing the group snapshot
+    std::unordered_set<std::string> expected;
+    for (int i = 0; i < 100; i++) {
+        std::stringstream uuid;
+        uuid << "churn-ep-" << i;
+        Endpoint ep(uuid.str());
+        ep.setEgURI(epgu);
+        epSource.updateEndpoint(ep);
+        expected.insert(uuid.str());
+    }
+    for (int i = 0; i < 100; i += 3) {
+        std::stringstream uuid;
+        uuid << "churn-ep-" << i;
+        epSource.removeEndpoint(uuid.str());
+        expected.erase(uuid.str());
+    }
+
+    std::unordered_set<std::string> eps;
+    epManager.getEndpointsForGroup(epgu, eps);
+    BOOST_CHECK(expected == eps);
+}
+
+#ifdef HAVE_PROMETHEUS_SUPPORT
+BOOST_FIXTURE_TEST_CASE( epcounter_prom, EndpointFixture ) {
+    const string cmd = "curl --proxy \"\" --compressed --silent "
+        "http://127.0.0.1:9612/metrics 2>&1;";
+    const string series = "opflex_endpoint_rx_bytes{name=\"veth1-acc\"}";
+    URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+    Endpoint ep1("e82e883b-851d-4cc6-bedb-fb5e27530043");
+    ep1.setMAC(MAC("00:00:00:00:00:01"));
+    ep1.addIP("10.1.1.2");
+    ep1.setInterfaceName("veth1");
+    ep1.setAccessInterface("veth1-acc");
+    ep1.setEgURI(epgu);
+    epSource.updateEndpoint(ep1);
+
+    // nothing is exposed for the endpoint until its first stats update
+    string output = BaseFixture::getOutputFromCommand(cmd);
+    BOOST_CHECK(output.find("opflex_endpoint_active_total") !=
+                string::npos);
+    BOOST_CHECK_EQUAL(string::npos, output.find(series));
+
+    EndpointManager::EpCounters counters{};
+    counters.rxBytes = 1234;
+    agent.getEndpointManager().updateEndpointCounters(ep1.getUUID(),
+                                                      counters);
+    output = BaseFixture::getOutputFromCommand(cmd);
+    BOOST_CHECK(output.find(series + " 1234") != string::npos);
+
+    // the value is read on scrape, so later updates need no refresh
+    counters.rxBytes = 5678;
+    agent.getEndpointManager().updateEndpointCounters(ep1.getUUID(),
+                                                      counters);
+    output = BaseFixture::getOutputFromCommand(cmd);
+    BOOST_CHECK(output.find(series + " 5678") != string::npos);
+
+    epSource.removeEndpoint(ep1.getUUID());
+    WAIT_FOR(BaseFixture::getOutputFromCommand(cmd).find(series) ==
+             string::npos, 500);
+}
+#endif
+
 BOOST_FIXTURE_TEST_CASE( epgmapping, EndpointFixture ) {
     URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
     URI epg2u = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg2/");
@@ -791,6 +1011,132 @@ BOOST_FIXTURE_TEST_CASE( fssource, FSEndpointFixture ) {
     watcher.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE( fssource_parallel_scan, FSEndpointFixture ) {
+    URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+    const int count = 300;
+    for (int i = 0; i < count; ++i) {
+        std::string uuid = "ep-" + std::to_string(i);
+        fs::ofstream os(temp / (uuid + ".ep"));
+        os << "{"
+           << "\"uuid\":\"" << uuid << "\","
+           << "\"mac\":\"10:ff:00:a3:"
+           << std::hex << std::setw(2) << std::setfill('0') << (i >> 8)
+           << ":" << std::setw(2) << (i & 0xff) << std::dec << "\","
+           << "\"ip\":[\"10.1." << (i >> 8) << "." << (i & 0xff) << "\"],"
+           << "\"interface-name\":\"veth" << i << "\","
+           << "\"access-interface-vlan\":\"" << (i + 1) << "\","
+           << "\"promiscuous-mode\":true,"
+           << "\"endpoint-group\":\"/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/\","
+           << "\"attributes\":{\"attr1\":\"value1\"}"
+           << "}" << std::endl;
+    }
+    // an unparseable file is skipped
+    fs::ofstream bad(temp / "bad.ep");
+    bad << "{\"uuid\":" << std::endl;
+    bad.close();
+
+    FSWatcher watcher;
+    watcher.setScanThreads(4);
+    FSEndpointSource source(&agent.getEndpointManager(), watcher,
+                            temp.string());
+    watcher.start();
+
+    WAIT_FOR(count == getEGSize(agent.getEndpointManager(), epgu), 1000);
+    auto ep = agent.getEndpointManager().getEndpoint("ep-257");
+    BOOST_REQUIRE(ep);
+    BOOST_CHECK_EQUAL("veth257", ep->getInterfaceName().get());
+    BOOST_CHECK_EQUAL(MAC("10:ff:00:a3:01:01"), ep->getMAC().get());
+    BOOST_CHECK_EQUAL(258, ep->getAccessIfaceVlan().get());
+    BOOST_CHECK(ep->isPromiscuousMode());
+    BOOST_CHECK(ep->getIPs().count("10.1.1.1") == 1);
+
+    watcher.stop();
+}
+
+BOOST_FIXTURE_TEST_CASE( fssource_unchanged, FSEndpointFixture ) {
+    URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+    fs::path path1(temp / "83f18f0b-80f7-46e2-b06c-4d9487b0c754.ep");
+    auto writeEp = [&](const std::string& iface) {
+        // write outside the watch directory and move into place
+        fs::path tmp(temp.parent_path() / fs::unique_path());
+        fs::ofstream os(tmp);
+        os << "{"
+           << "\"uuid\":\"83f18f0b-80f7-46e2-b06c-4d9487b0c754\","
+           << "\"mac\":\"10:ff:00:a3:01:00\","
+           << "\"interface-name\":\"" << iface << "\","
+           << "\"endpoint-group\":\"/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/\""
+           << "}" << std::endl;
+        os.close();
+        fs::rename(tmp, path1);
+    };
+    writeEp("veth0");
+
+    FSWatcher watcher;
+    FSEndpointSource source(&agent.getEndpointManager(), watcher,
+                            temp.string());
+    watcher.start();
+
+    WAIT_FOR(1 == getEGSize(agent.getEndpointManager(), epgu), 500);
+    BOOST_CHECK_EQUAL(1, watcher.getUpdateEvents());
+
+    // rewriting identical content is suppressed
+    writeEp("veth0");
+    WAIT_FOR(1 == watcher.getSuppressedEvents(), 500);
+    BOOST_CHECK_EQUAL(1, watcher.getUpdateEvents());
+
+    writeEp("veth1");
+    WAIT_FOR(2 == watcher.getUpdateEvents(), 500);
+    WAIT_FOR("veth1" == agent.getEndpointManager()
+             .getEndpoint("83f18f0b-80f7-46e2-b06c-4d9487b0c754")
+             ->getInterfaceName().get(), 500);
+
+    fs::remove(path1);
+    WAIT_FOR(1 == watcher.getDeleteEvents(), 500);
+    WAIT_FOR(0 == getEGSize(agent.getEndpointManager(), epgu), 500);
+
+    watcher.stop();
+}
+
+BOOST_FIXTURE_TEST_CASE( fssource_rename_same_mtime, FSEndpointFixture ) {
+    URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+    fs::path path1(temp / "83f18f0b-80f7-46e2-b06c-4d9487b0c754.ep");
+    std::time_t mtime = std::time(NULL) - 3600;
+    auto writeEp = [&](const std::string& iface) {
+        // same size and modification time each time, as a copy that
+        // preserves timestamps would leave them
+        fs::path tmp(temp.parent_path() / fs::unique_path());
+        fs::ofstream os(tmp);
+        os << "{"
+           << "\"uuid\":\"83f18f0b-80f7-46e2-b06c-4d9487b0c754\","
+           << "\"mac\":\"10:ff:00:a3:01:00\","
+           << "\"interface-name\":\"" << iface << "\","
+           << "\"endpoint-group\":\"/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/\""
+           << "}" << std::endl;
+        os.close();
+        fs::last_write_time(tmp, mtime);
+        fs::rename(tmp, path1);
+    };
+    writeEp("veth0");
+    // let the change time age so the scanned state is trusted
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+
+    FSWatcher watcher;
+    FSEndpointSource source(&agent.getEndpointManager(), watcher,
+                            temp.string());
+    watcher.start();
+    WAIT_FOR(1 == getEGSize(agent.getEndpointManager(), epgu), 500);
+
+    // a different file renamed into place is not taken as unchanged
+    writeEp("veth1");
+    WAIT_FOR(2 == watcher.getUpdateEvents(), 500);
+    WAIT_FOR("veth1" == agent.getEndpointManager()
+             .getEndpoint("83f18f0b-80f7-46e2-b06c-4d9487b0c754")
+             ->getInterfaceName().get(), 500);
+    BOOST_CHECK_EQUAL(0, watcher.getSuppressedEvents());
+
+    watcher.stop();
+}
+
 class MockEndpointListener : public EndpointListener {
 public:
     virtual void endpointUpdated(const std::string& uuid) {};
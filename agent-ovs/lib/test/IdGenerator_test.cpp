@@ -13,9 +13,11 @@
 #include <boost/test/unit_test.hpp>
 
 #include <cstdio>
+#include <fstream>
 #include <sstream>
 #include <thread>
 #include <chrono>
+#include <vector>
 
 using namespace std;
 using namespace boost;
@@ -301,4 +303,100 @@ BOOST_AUTO_TEST_CASE(persist_range) {
 
 }
 
+static void writeIdRecord(std::ofstream& file, uint32_t id,
+                          const string& str) {
+    uint16_t len = str.size();
+    file.write((const char*)&id, sizeof(id));
+    file.write((const char*)&len, sizeof(len));
+    file.write(str.data(), len);
+}
+
+BOOST_AUTO_TEST_CASE(persist_corrupt) {
+    string dir(".");
+    string nmspc("idtest");
+    IdGenerator idgen(std::chrono::milliseconds(15));
+    idgen.setPersistLocation(dir);
+
+    {
+        std::ofstream file(idgen.getNamespaceFile(nmspc).c_str(),
+                           std::ios_base::binary | std::ios_base::trunc);
+        uint32_t version = 1;
+        file.write("opflexid", 8);
+        file.write((const char*)&version, sizeof(version));
+        writeIdRecord(file, 1, "/uri/one");
+        writeIdRecord(file, 2, "/uri/one");
+        writeIdRecord(file, 25, "/uri/two");
+    }
+
+    // rejected entries do not take up IDs
+    idgen.initNamespace(nmspc, 1, 20);
+    BOOST_CHECK_EQUAL(1, idgen.getIdNoAlloc(nmspc, "/uri/one"));
+    BOOST_CHECK_EQUAL(-1, idgen.getIdNoAlloc(nmspc, "/uri/two"));
+    BOOST_CHECK_EQUAL(19, idgen.getRemainingIds(nmspc));
+    BOOST_CHECK_EQUAL(2, idgen.getId(nmspc, "/uri/two"));
+
+    remove(idgen.getNamespaceFile(nmspc).c_str());
+}
+
+BOOST_AUTO_TEST_CASE(free_hook) {
+    string nmspc("idtest");
+    IdGenerator idgen(std::chrono::milliseconds(15));
+    idgen.initNamespace(nmspc, 1, 2);
+
+    std::vector<uint32_t> held;
+    IdGenerator::free_hook_t hook =
+        [&held](const std::string&, uint32_t id) {
+        held.push_back(id);
+        return false;
+    };
+    idgen.setFreeHook(nmspc, hook);
+
+    uint32_t id1 = idgen.getId(nmspc, "/uri/one");
+    idgen.getId(nmspc, "/uri/two");
+    BOOST_CHECK_EQUAL(0, idgen.getRemainingIds(nmspc));
+
+    // held back by the hook until released
+    idgen.erase(nmspc, "/uri/one");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    idgen.cleanup();
+    BOOST_REQUIRE_EQUAL(1, held.size());
+    BOOST_CHECK_EQUAL(id1, held[0]);
+    BOOST_CHECK(!idgen.getStringForId(nmspc, id1));
+    BOOST_CHECK_EQUAL(0, idgen.getRemainingIds(nmspc));
+
+    idgen.release(nmspc, id1);
+    BOOST_CHECK_EQUAL(1, idgen.getRemainingIds(nmspc));
+    BOOST_CHECK_EQUAL(id1, idgen.getId(nmspc, "/uri/three"));
+}
+
+BOOST_AUTO_TEST_CASE(erased_lookup) {
+    string nmspc("idtest");
+    IdGenerator idgen(std::chrono::milliseconds(15));
+    idgen.initNamespace(nmspc, 1, 10);
+
+    uint32_t id1 = idgen.getId(nmspc, "/uri/one");
+    uint32_t id2 = idgen.getId(nmspc, "/uri/two");
+
+    // erased IDs are hidden from lookups but keep their string
+    // until cleaned up
+    idgen.erase(nmspc, "/uri/one");
+    idgen.erase(nmspc, "/uri/unknown");
+    BOOST_CHECK_EQUAL(-1, idgen.getIdNoAlloc(nmspc, "/uri/one"));
+    BOOST_CHECK_EQUAL(id2, idgen.getIdNoAlloc(nmspc, "/uri/two"));
+    BOOST_CHECK_EQUAL("/uri/one", idgen.getStringForId(nmspc, id1).get());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    idgen.cleanup();
+    BOOST_CHECK(!idgen.getStringForId(nmspc, id1));
+    BOOST_CHECK_EQUAL("/uri/two", idgen.getStringForId(nmspc, id2).get());
+    BOOST_CHECK_EQUAL(9, idgen.getRemainingIds(nmspc));
+
+    // reinitializing the namespace drops all assignments
+    idgen.erase(nmspc, "/uri/two");
+    idgen.initNamespace(nmspc, 1, 10);
+    BOOST_CHECK(!idgen.getStringForId(nmspc, id2));
+    BOOST_CHECK_EQUAL(-1, idgen.getIdNoAlloc(nmspc, "/uri/two"));
+    idgen.cleanup();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
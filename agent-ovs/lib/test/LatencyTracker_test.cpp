@@ -0,0 +1,145 @@
+/*
+ * Test suite for class LatencyTracker
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/LatencyTracker.h>
+#include <opflexagent/logging.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(LatencyTracker_test)
+
+typedef LatencyTracker LT;
+
+BOOST_AUTO_TEST_CASE(buckets) {
+    BOOST_CHECK_EQUAL(0, LT::getBucket(0));
+    BOOST_CHECK_EQUAL(0, LT::getBucket(64));
+    BOOST_CHECK_EQUAL(1, LT::getBucket(65));
+    BOOST_CHECK_EQUAL(1, LT::getBucket(128));
+    BOOST_CHECK_EQUAL(4, LT::getBucket(1000));
+    BOOST_CHECK_EQUAL(LT::BUCKET_COUNT - 1, LT::getBucket(UINT64_MAX));
+}
+
+BOOST_AUTO_TEST_CASE(stages) {
+    LT t;
+    t.registerRenderer();
+    t.setSlowThreshold(std::chrono::milliseconds(1));
+
+    LT::clock::time_point start =
+        LT::clock::now() - std::chrono::milliseconds(5);
+    t.begin("ep1", start);
+    // the same update seen by the next component keeps its start
+    t.begin("ep1");
+    BOOST_CHECK_EQUAL(1, t.getInFlight());
+
+    t.mark("ep1", LT::SOURCE);
+    t.mark("ep1", LT::NOTIFY);
+    // stages already passed are ignored
+    t.mark("ep1", LT::SOURCE);
+    t.finish("ep1", LT::RENDER);
+    BOOST_CHECK_EQUAL(0, t.getInFlight());
+
+    LT::Histogram source = t.getHistogram(LT::SOURCE);
+    BOOST_CHECK_EQUAL(1, source.count);
+    BOOST_CHECK(source.sumUs >= 5000);
+    BOOST_CHECK_EQUAL(1, t.getHistogram(LT::NOTIFY).count);
+    BOOST_CHECK_EQUAL(0, t.getHistogram(LT::QUEUE).count);
+    BOOST_CHECK_EQUAL(1, t.getHistogram(LT::RENDER).count);
+    LT::Histogram total = t.getHistogram(LT::TOTAL);
+    BOOST_CHECK_EQUAL(1, total.count);
+    BOOST_CHECK(total.sumUs >= 5000);
+
+    std::vector<LT::SlowOp> slow = t.getSlowOps();
+    BOOST_REQUIRE_EQUAL(1, slow.size());
+    BOOST_CHECK_EQUAL("ep1", slow[0].key);
+    BOOST_CHECK_EQUAL(slow[0].stageUs[LT::TOTAL], total.sumUs);
+
+    // marks without a trace in flight are ignored
+    t.mark("ep2", LT::SOURCE);
+    t.finish("ep2", LT::RENDER);
+    BOOST_CHECK_EQUAL(1, t.getHistogram(LT::TOTAL).count);
+}
+
+BOOST_AUTO_TEST_CASE(restart) {
+    LT t;
+    t.registerRenderer();
+
+    // a new update restarts a trace that is past its first stage
+    t.begin("ep1", LT::clock::now() - std::chrono::seconds(20));
+    t.mark("ep1", LT::SOURCE);
+    t.begin("ep1");
+    t.mark("ep1", LT::SOURCE);
+    t.finish("ep1", LT::RENDER);
+    BOOST_CHECK_EQUAL(2, t.getHistogram(LT::SOURCE).count);
+    LT::Histogram total = t.getHistogram(LT::TOTAL);
+    BOOST_CHECK_EQUAL(1, total.count);
+    BOOST_CHECK(total.sumUs < 10000000);
+
+    // abandoned traces are not recorded
+    t.begin("ep2");
+    t.abandon("ep2");
+    BOOST_CHECK_EQUAL(0, t.getInFlight());
+    t.finish("ep2", LT::RENDER);
+    BOOST_CHECK_EQUAL(1, t.getHistogram(LT::TOTAL).count);
+    BOOST_CHECK_EQUAL(0, t.getDropped());
+}
+
+BOOST_AUTO_TEST_CASE(limits) {
+    LT t(2, 2);
+    t.setSlowThreshold(std::chrono::milliseconds(0));
+
+    // nothing is traced without a renderer to complete the traces
+    t.begin("ep1");
+    BOOST_CHECK_EQUAL(0, t.getInFlight());
+    t.registerRenderer();
+
+    // the oldest trace makes room for a new one
+    t.begin("ep1");
+    t.begin("ep2");
+    t.begin("ep3");
+    BOOST_CHECK_EQUAL(2, t.getInFlight());
+    BOOST_CHECK_EQUAL(1, t.getDropped());
+    t.finish("ep1", LT::RENDER);
+    BOOST_CHECK_EQUAL(0, t.getHistogram(LT::TOTAL).count);
+
+    // traces that never complete expire
+    t.finish("ep2", LT::RENDER);
+    t.finish("ep3", LT::RENDER);
+    t.setMaxAge(std::chrono::seconds(60));
+    t.begin("ep4", LT::clock::now() - std::chrono::minutes(10));
+    t.begin("ep5");
+    t.begin("ep6");
+    BOOST_CHECK_EQUAL(2, t.getInFlight());
+    BOOST_CHECK_EQUAL(2, t.getDropped());
+
+    t.finish("ep5", LT::RENDER);
+    t.finish("ep6", LT::RENDER);
+    std::vector<LT::SlowOp> slow = t.getSlowOps();
+    BOOST_REQUIRE_EQUAL(2, slow.size());
+    BOOST_CHECK_EQUAL("ep5", slow[0].key);
+    BOOST_CHECK_EQUAL("ep6", slow[1].key);
+
+    // traces in flight are discarded with the last renderer
+    t.begin("ep7");
+    t.unregisterRenderer();
+    BOOST_CHECK_EQUAL(0, t.getInFlight());
+
+    t.registerRenderer();
+    t.setEnabled(false);
+    t.begin("ep8");
+    BOOST_CHECK_EQUAL(0, t.getInFlight());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
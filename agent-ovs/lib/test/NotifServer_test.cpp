@@ -41,6 +41,7 @@ public:
     NotifFixture() : notif(io) {
         std::remove(SOCK_NAME.c_str());
         notif.setSocketName(SOCK_NAME);
+        notif.setLatencyTracker(&tracker);
         notif.start();
         io_service_thread.reset(new std::thread([this]() { io.run(); }));
     }
@@ -56,6 +57,7 @@ public:
     }
 
     ba::io_service io;
+    LatencyTracker tracker;
     NotifServer notif;
     std::unique_ptr<std::thread> io_service_thread;
 };
@@ -150,6 +152,58 @@ BOOST_FIXTURE_TEST_CASE(subscribe, NotifFixture) {
     BOOST_CHECK(us.find("1cc9483a-8d7a-48d5-9c23-862401691e01") != us.end());
 }
 
+BOOST_FIXTURE_TEST_CASE(latency, NotifFixture) {
+    tracker.setSlowThreshold(std::chrono::milliseconds(0));
+    tracker.registerRenderer();
+    tracker.begin("4412dcd2-0cd0-4741-99d1-d8b3946e1fa9");
+    tracker.mark("4412dcd2-0cd0-4741-99d1-d8b3946e1fa9",
+                 LatencyTracker::SOURCE);
+    tracker.finish("4412dcd2-0cd0-4741-99d1-d8b3946e1fa9",
+                   LatencyTracker::RENDER);
+
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    stream_protocol::socket s(io);
+    s.connect(stream_protocol::endpoint(SOCK_NAME));
+
+    StringBuffer r;
+    Writer<StringBuffer> writer(r);
+    writer.StartObject();
+    writer.Key("method");
+    writer.String("latency");
+    writer.Key("params");
+    writer.StartObject();
+    writer.EndObject();
+    writer.Key("id");
+    writer.String("2");
+    writer.EndObject();
+    uint32_t size = htonl(r.GetSize());
+    ba::write(s, ba::buffer(&size, 4));
+    ba::write(s, ba::buffer(r.GetString(), r.GetSize()));
+
+    Document rdoc;
+    readMessage(s, rdoc);
+
+    BOOST_REQUIRE(rdoc.HasMember("id"));
+    BOOST_CHECK_EQUAL("2", std::string(rdoc["id"].GetString()));
+    BOOST_REQUIRE(rdoc.HasMember("result"));
+    const rapidjson::Value& res = rdoc["result"];
+    BOOST_REQUIRE(res.HasMember("stages"));
+    const rapidjson::Value& stages = res["stages"];
+    BOOST_REQUIRE(stages.HasMember("total"));
+    BOOST_CHECK_EQUAL(1, stages["total"]["count"].GetUint64());
+    BOOST_CHECK_EQUAL(LatencyTracker::BUCKET_COUNT,
+                      stages["total"]["buckets"].Size());
+    BOOST_CHECK_EQUAL(0, stages["queue"]["count"].GetUint64());
+
+    BOOST_REQUIRE(res.HasMember("slow"));
+    BOOST_REQUIRE(res["slow"].IsArray());
+    BOOST_REQUIRE_EQUAL(1, res["slow"].Size());
+    BOOST_CHECK_EQUAL("4412dcd2-0cd0-4741-99d1-d8b3946e1fa9",
+                      std::string(res["slow"][0]["key"].GetString()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
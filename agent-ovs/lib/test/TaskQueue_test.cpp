@@ -0,0 +1,146 @@
+/*
+ * Test suite for class TaskQueue
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/TaskQueue.h>
+#include <opflexagent/logging.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(TaskQueue_test)
+
+BOOST_AUTO_TEST_CASE(coalesce) {
+    boost::asio::io_service io;
+    TaskQueue q(io);
+    std::vector<std::string> ran;
+
+    q.dispatch("a", [&]() { ran.push_back("a1"); });
+    q.dispatch("a", [&]() { ran.push_back("a2"); });
+    q.dispatch("b", [&]() { ran.push_back("b"); });
+    BOOST_CHECK_EQUAL(2, q.getDepth());
+    io.run();
+
+    // the latest task for a queued ID replaces the earlier one
+    BOOST_REQUIRE_EQUAL(2, ran.size());
+    BOOST_CHECK_EQUAL("a2", ran[0]);
+    BOOST_CHECK_EQUAL("b", ran[1]);
+    BOOST_CHECK_EQUAL(0, q.getDepth());
+
+    std::unordered_map<std::string, TaskQueue::TaskStats> stats;
+    q.getStats(stats);
+    BOOST_CHECK_EQUAL(3, stats["default"].dispatched);
+    BOOST_CHECK_EQUAL(1, stats["default"].coalesced);
+    BOOST_CHECK_EQUAL(2, stats["default"].run);
+    BOOST_CHECK_EQUAL(0, stats["default"].depth);
+}
+
+BOOST_AUTO_TEST_CASE(parent) {
+    boost::asio::io_service io;
+    TaskQueue q(io);
+    std::vector<std::string> ran;
+
+    auto child = [&](const std::string& id) {
+        q.dispatch(id, [&ran, id]() { ran.push_back(id); }, "ep", "epg");
+    };
+
+    // queued children are subsumed by a parent that re-dispatches
+    // them, and children dispatched while the parent is queued wait
+    // for it
+    child("ep1");
+    q.dispatch("epg", [&]() {
+            ran.push_back("epg");
+            child("ep1");
+            child("ep2");
+        }, "epg");
+    child("ep2");
+    child("ep3");
+    io.run();
+
+    BOOST_REQUIRE_EQUAL(4, ran.size());
+    BOOST_CHECK_EQUAL("epg", ran[0]);
+    BOOST_CHECK_EQUAL(3, std::count(ran.begin() + 1, ran.end(), "ep1") +
+                      std::count(ran.begin() + 1, ran.end(), "ep2") +
+                      std::count(ran.begin() + 1, ran.end(), "ep3"));
+
+    std::unordered_map<std::string, TaskQueue::TaskStats> stats;
+    q.getStats(stats);
+    BOOST_CHECK_EQUAL(5, stats["ep"].dispatched);
+    BOOST_CHECK_EQUAL(3, stats["ep"].held);
+    BOOST_CHECK_EQUAL(3, stats["ep"].run);
+    BOOST_CHECK_EQUAL(1, stats["epg"].run);
+
+    // with the parent idle, children run on their own
+    ran.clear();
+    io.reset();
+    child("ep1");
+    io.run();
+    BOOST_REQUIRE_EQUAL(1, ran.size());
+    BOOST_CHECK_EQUAL("ep1", ran[0]);
+}
+
+BOOST_AUTO_TEST_CASE(maxHold) {
+    boost::asio::io_service io;
+    TaskQueue q(io);
+    q.setMaxHold(std::chrono::milliseconds(10));
+    bool childRan = false;
+    int pumps = 0;
+
+    // another task keeps queueing the parent again after every run,
+    // which would hold the child back each time
+    std::function<void ()> pump = [&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        q.dispatch("epg", []() {}, "epg");
+        if (!childRan && ++pumps < 200)
+            q.dispatch("pump", pump);
+    };
+    q.dispatch("epg", []() {}, "epg");
+    q.dispatch("ep1", [&]() { childRan = true; }, "ep", "epg");
+    q.dispatch("pump", pump);
+    io.run();
+
+    BOOST_CHECK(childRan);
+    BOOST_CHECK(pumps < 200);
+
+    std::unordered_map<std::string, TaskQueue::TaskStats> stats;
+    q.getStats(stats);
+    BOOST_CHECK(stats["ep"].held > 1);
+    BOOST_CHECK(stats["ep"].overdue > 0);
+    BOOST_CHECK_EQUAL(1, stats["ep"].run);
+}
+
+BOOST_AUTO_TEST_CASE(debounce) {
+    boost::asio::io_service io;
+    TaskQueue q(io);
+    q.setDebounce(std::chrono::milliseconds(20));
+    int count = 0;
+
+    q.dispatch("a", [&]() { count += 1; });
+    io.poll();
+    q.dispatch("a", [&]() { count += 1; });
+    BOOST_CHECK_EQUAL(0, count);
+    io.run();
+    BOOST_CHECK_EQUAL(1, count);
+
+    std::unordered_map<std::string, TaskQueue::TaskStats> stats;
+    q.getStats(stats);
+    BOOST_CHECK(stats["default"].maxWaitUs >= 20000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,67 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for asynchronous logging
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/logging.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+namespace fs = boost::filesystem;
+
+BOOST_AUTO_TEST_SUITE(logging_test)
+
+BOOST_AUTO_TEST_CASE(async) {
+    fs::path logFile =
+        fs::temp_directory_path() / fs::unique_path("opflex-log-%%%%-%%%%");
+    initLogging("debug", false, logFile.string());
+    enableAsyncLogging(16);
+
+    const int nthreads = 4;
+    const int nmsgs = 1000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nthreads; i++) {
+        threads.emplace_back([i]() {
+                for (int j = 0; j < nmsgs; j++) {
+                    LOG(INFO) << "info " << i << " " << j;
+                    LOG(DEBUG) << "debug " << i << " " << j;
+                }
+            });
+    }
+    for (auto& t : threads)
+        t.join();
+    stopAsyncLogging();
+    initLogging("debug", false, "");
+
+    // info messages are never dropped; debug messages may be, but
+    // only when counted
+    size_t info = 0, debug = 0;
+    std::ifstream in(logFile.string());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find("[info]") != std::string::npos) info += 1;
+        if (line.find("[debug]") != std::string::npos) debug += 1;
+    }
+    BOOST_CHECK_EQUAL(nthreads * nmsgs, info);
+    BOOST_CHECK_EQUAL(nthreads * nmsgs,
+                      debug + getDroppedLogMessages());
+
+    fs::remove(logFile);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
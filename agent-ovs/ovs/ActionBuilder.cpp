@@ -7,6 +7,7 @@
  */
 
 #include <algorithm>
+#include <cstring>
 
 #include "ActionBuilder.h"
 #include "FlowBuilder.h"
@@ -23,12 +24,12 @@ namespace opflexagent {
 
 ActionBuilder::ActionBuilder(FlowBuilder& fb_)
     : buf(new ofpbuf), flowHasVlan(false), fb(fb_) {
-    ofpbuf_init(buf, 64);
+    ofpbuf_use_stub(buf, stub, sizeof(stub));
 }
 
 ActionBuilder::ActionBuilder()
     : buf(new ofpbuf), flowHasVlan(false) {
-    ofpbuf_init(buf, 64);
+    ofpbuf_use_stub(buf, stub, sizeof(stub));
 }
 
 ActionBuilder::~ActionBuilder() {
@@ -47,6 +48,20 @@ void ActionBuilder::build(ofputil_flow_stats *dstEntry) {
     dstEntry->ofpacts = getActionsFromBuffer(buf, dstEntry->ofpacts_len);
 }
 
+void ActionBuilder::build(FlowEntry& dstEntry) {
+    if (!dstEntry.isArenaBacked()) {
+        build(dstEntry.entry);
+        return;
+    }
+    // copy the actions into the arena; the buffer itself is released
+    // with this builder
+    ofpact* acts = dstEntry.allocActions(buf->size);
+    if (buf->size)
+        memcpy(acts, buf->data, buf->size);
+    dstEntry.entry->ofpacts = acts;
+    dstEntry.entry->ofpacts_len = buf->size;
+}
+
 void ActionBuilder::build(ofputil_flow_mod *dstMod) {
     dstMod->ofpacts = getActionsFromBuffer(buf, dstMod->ofpacts_len);
 }
@@ -254,6 +269,12 @@ ActionBuilder& ActionBuilder::multipath(enum nx_hash_fields fields,
     return *this;
 }
 
+ActionBuilder& ActionBuilder::conjunction(uint32_t id, uint8_t clause,
+                                          uint8_t nClauses) {
+    act_conjunction(buf, id, clause, nClauses);
+    return *this;
+}
+
 ActionBuilder& ActionBuilder::macVlanLearn(uint16_t prio,
                                            uint64_t cookie,
                                            uint8_t table) {
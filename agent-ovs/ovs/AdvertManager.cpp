@@ -19,12 +19,17 @@
 #include "ActionBuilder.h"
 #include "IntFlowManager.h"
 #include <opflexagent/logging.h>
+#ifdef HAVE_PROMETHEUS_SUPPORT
+#include <opflexagent/PrometheusManager.h>
+#endif
 #include "arp.h"
 
 #include <boost/system/error_code.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/placeholders.hpp>
 
+#include <cmath>
+
 #include <modelgbp/gbp/RoutingModeEnumT.hpp>
 
 #include "ovs-ofputil.h"
@@ -34,6 +39,7 @@
 #include <openvswitch/match.h>
 
 using std::string;
+using std::vector;
 using std::shared_ptr;
 using std::unordered_set;
 using std::unique_lock;
@@ -49,6 +55,7 @@ using boost::posix_time::milliseconds;
 using boost::posix_time::seconds;
 using boost::optional;
 using opflex::modb::URI;
+using std::chrono::steady_clock;
 
 namespace opflexagent {
 
@@ -59,7 +66,12 @@ AdvertManager::AdvertManager(Agent& agent_,
     : urng(rng()), all_ep_dis(300,600), repeat_dis(3000,5000),
       sendRouterAdv(false), initialRouterAdvs(0),
       sendEndpointAdv(EPADV_DISABLED), tunnelEndpointAdv(EPADV_DISABLED),
-      tunnelEpAdvInterval(300),
+      tunnelEpAdvInterval(300), epAdvTimerPending(false),
+      allEpAdvSlot(EP_ADV_SLOTS), allEpAdvSlotInterval(0),
+      advDrainPending(false), advRate(1000), advBurst(64),
+      advTokens(advBurst), advLastRefill(steady_clock::now()),
+      advSent(0), advCoalesced(0), advRateStart(advLastRefill),
+      advRateSent(0), advSendRate(0),
       agent(agent_), intFlowManager(intFlowManager_),
       portMapper(NULL), switchConnection(NULL),
       ioService(&agent.getAgentIOService()),
@@ -82,6 +94,7 @@ void AdvertManager::start() {
     if (sendEndpointAdv != EPADV_DISABLED) {
         allEndpointAdvTimer.reset(new deadline_timer(*ioService));
         endpointAdvTimer.reset(new deadline_timer(*ioService));
+        advSendTimer.reset(new deadline_timer(*ioService));
         scheduleInitialEndpointAdv();
     }
 
@@ -97,6 +110,8 @@ void AdvertManager::stop() {
         endpointAdvTimer->cancel();
     if (allEndpointAdvTimer)
         allEndpointAdvTimer->cancel();
+    if (advSendTimer)
+        advSendTimer->cancel();
     if(tunnelEpAdvTimer)
         tunnelEpAdvTimer->cancel();
 }
@@ -111,9 +126,40 @@ void AdvertManager::scheduleInitialRouterAdv() {
     }
 }
 
+void AdvertManager::setEndpointAdvRate(uint32_t rate, uint32_t burst) {
+    lock_guard<mutex> guard(adv_mutex);
+    advRate = rate;
+    advBurst = std::max(burst, 1u);
+    advTokens = advBurst;
+    advLastRefill = steady_clock::now();
+}
+
+size_t AdvertManager::getEndpointAdvQueueDepth() {
+    lock_guard<mutex> guard(adv_mutex);
+    return advQueue.size();
+}
+
+double AdvertManager::getEndpointAdvSendRate() {
+    lock_guard<mutex> guard(adv_mutex);
+    updateAdvSendRate(steady_clock::now());
+    return advSendRate;
+}
+
+void AdvertManager::updateAdvSendRate(steady_clock::time_point now) {
+    double window =
+        std::chrono::duration<double>(now - advRateStart).count();
+    if (window >= 1) {
+        advSendRate = advRateSent / window;
+        advRateSent = 0;
+        advRateStart = now;
+    }
+}
+
 void AdvertManager::scheduleInitialEndpointAdv(uint64_t delay) {
     lock_guard<recursive_mutex> guard(timer_mutex);
     if (allEndpointAdvTimer) {
+        // the next sweep advertises every endpoint at once
+        allEpAdvSlot = EP_ADV_SLOTS;
         allEndpointAdvTimer->expires_from_now(milliseconds(delay));
         allEndpointAdvTimer->
             async_wait(bind(&AdvertManager::onAllEndpointAdvTimer,
@@ -123,6 +169,12 @@ void AdvertManager::scheduleInitialEndpointAdv(uint64_t delay) {
 
 void AdvertManager::doScheduleEpAdv(uint64_t time) {
     lock_guard<recursive_mutex> guard(timer_mutex);
+    // Leave a pending timer alone unless this request is due sooner,
+    // so that a stream of updates cannot keep pushing it back
+    if (epAdvTimerPending &&
+        endpointAdvTimer->expires_from_now() <= milliseconds(time))
+        return;
+    epAdvTimerPending = true;
     endpointAdvTimer->expires_from_now(milliseconds(time));
     endpointAdvTimer->
         async_wait(bind(&AdvertManager::onEndpointAdvTimer,
@@ -133,7 +185,11 @@ void AdvertManager::scheduleEndpointAdv(const std::string& uuid) {
     lock_guard<recursive_mutex> timerGuard(timer_mutex);
     if (endpointAdvTimer) {
         unique_lock<mutex> guard(ep_mutex);
-        pendingEps[uuid] = 5;
+        auto r = pendingEps.emplace(uuid, 5);
+        if (!r.second) {
+            r.first->second = 5;
+            advCoalesced += 1;
+        }
 
         doScheduleEpAdv();
     }
@@ -150,7 +206,8 @@ void AdvertManager::scheduleServiceAdv(const std::string& uuid) {
 }
 
 static int send_packet_out(SwitchConnection* conn,
-                           OfpBuf& b,
+                           const void* packet,
+                           size_t packetLen,
                            unordered_set<uint32_t>& out_ports,
                            IntFlowManager::EncapType encapType =
                            IntFlowManager::ENCAP_NONE,
@@ -158,8 +215,8 @@ static int send_packet_out(SwitchConnection* conn,
                            const address& tunDst = address()) {
     struct ofputil_packet_out po{};
     po.buffer_id = UINT32_MAX;
-    po.packet = b.data();
-    po.packet_len = b.size();
+    po.packet = packet;
+    po.packet_len = packetLen;
     match_set_in_port(&po.flow_metadata, OFPP_CONTROLLER);
 
     ActionBuilder ab;
@@ -181,6 +238,17 @@ static int send_packet_out(SwitchConnection* conn,
     return error;
 }
 
+static int send_packet_out(SwitchConnection* conn,
+                           OfpBuf& b,
+                           unordered_set<uint32_t>& out_ports,
+                           IntFlowManager::EncapType encapType =
+                           IntFlowManager::ENCAP_NONE,
+                           uint32_t vnid = 0,
+                           const address& tunDst = address()) {
+    return send_packet_out(conn, b.data(), b.size(), out_ports,
+                           encapType, vnid, tunDst);
+}
+
 void AdvertManager::sendRouterAdvs() {
     LOG(DEBUG) << "Sending all router advertisements";
 
@@ -260,15 +328,30 @@ void AdvertManager::onRouterAdvTimer(const boost::system::error_code& ec) {
     }
 }
 
-static void doSendEpAdv(PolicyManager& policyManager,
-                        SwitchConnection* switchConnection,
-                        const string& ip, const uint8_t* epMac,
-                        const uint8_t* routerMac,
-                        const URI& egURI, uint32_t epgVnid,
-                        unordered_set<uint32_t>& out_ports,
-                        AdvertManager::EndpointAdvMode mode,
-                        IntFlowManager::EncapType encapType,
-                        const address& tunDst) {
+/**
+ * Where to send an endpoint advertisement composed into a batch
+ */
+struct EpAdvDest {
+    EpAdvDest(uint32_t vnid_, const address& tunDst_)
+        : vnid(vnid_), tunDst(tunDst_) {}
+
+    uint32_t vnid;
+    address tunDst;
+};
+
+/**
+ * Size of the largest endpoint advertisement, used to size batches
+ */
+static const size_t EP_ADV_SIZE_HINT = 86;
+
+static void doComposeEpAdv(PolicyManager& policyManager,
+                           packets::PacketBatch& batch,
+                           std::vector<EpAdvDest>& dests,
+                           const string& ip, const uint8_t* epMac,
+                           const uint8_t* routerMac,
+                           const URI& egURI, uint32_t epgVnid,
+                           AdvertManager::EndpointAdvMode mode,
+                           const address& tunDst) {
     boost::system::error_code ec;
     address addr = address::from_string(ip, ec);
     if (ec) {
@@ -277,8 +360,6 @@ static void doSendEpAdv(PolicyManager& policyManager,
         return;
     }
 
-    OfpBuf b((struct ofpbuf*)NULL);
-
     boost::optional<address> routerIp;
     if (mode == AdvertManager::EPADV_ROUTER_REQUEST) {
         boost::optional<std::shared_ptr<modelgbp::gbp::Subnet> > ipSubnet =
@@ -298,20 +379,20 @@ static void doSendEpAdv(PolicyManager& policyManager,
             // unicast spoofed ARP request for subnet gateway router
             uint32_t routerIpv = routerIp.get().to_v4().to_ulong();
 
-            b = packets::compose_arp(arp::op::REQUEST,
-                                     epMac, routerMac,
-                                     epMac, packets::MAC_ADDR_ZERO,
-                                     addrv, routerIpv);
+            packets::compose_arp(batch, arp::op::REQUEST,
+                                 epMac, routerMac,
+                                 epMac, packets::MAC_ADDR_ZERO,
+                                 addrv, routerIpv);
         } else {
             // unicast or broadcast gratuitous arp
             const uint8_t* dstMac =
                 (mode == AdvertManager::EPADV_GRATUITOUS_BROADCAST)
                 ? packets::MAC_ADDR_BROADCAST : routerMac;
 
-            b = packets::compose_arp(arp::op::REQUEST,
-                                     epMac, dstMac,
-                                     epMac, packets::MAC_ADDR_BROADCAST,
-                                     addrv, addrv);
+            packets::compose_arp(batch, arp::op::REQUEST,
+                                 epMac, dstMac,
+                                 epMac, packets::MAC_ADDR_BROADCAST,
+                                 addrv, addrv);
         }
     } else {
         address_v6::bytes_type abytes = addr.to_v6().to_bytes();
@@ -328,38 +409,27 @@ static void doSendEpAdv(PolicyManager& policyManager,
                 routerIp.get().to_v6().to_bytes();
             struct in6_addr* targetv = (struct in6_addr*)targetbytes.data();
 
-            b = packets::compose_icmp6_neigh_solit(epMac, routerMac,
-                                                   addrv, dstv, targetv);
+            packets::compose_icmp6_neigh_solit(batch, epMac, routerMac,
+                                               addrv, dstv, targetv);
         } else {
             // unicast or broadcast gratuitous neighbor advertisement
             const uint8_t* dstMac =
                 (mode == AdvertManager::EPADV_GRATUITOUS_BROADCAST)
                 ? packets::MAC_ADDR_IPV6MULTICAST : routerMac;
-            address_v6::bytes_type rbytes =
-                address_v6::from_string("ff02::1").to_bytes();
+            address_v6::bytes_type rbytes = ALL_NODES_IP.to_bytes();
             struct in6_addr* allnodes = (struct in6_addr*)rbytes.data();
 
-            b = packets::compose_icmp6_neigh_ad(0,
-                                                epMac, dstMac,
-                                                addrv, allnodes);
+            packets::compose_icmp6_neigh_ad(batch, 0,
+                                            epMac, dstMac,
+                                            addrv, allnodes);
         }
     }
-    if (!b.get()) return;
-
-    int error = send_packet_out(switchConnection, b, out_ports,
-                                encapType, epgVnid, tunDst);
-    if (error) {
-        LOG(ERROR) << "Could not write packet-out: "
-                   << ovs_strerror(error);
-    }
+    dests.emplace_back(epgVnid, tunDst);
 }
 
-void AdvertManager::sendEndpointAdvs(const string& uuid) {
-    uint32_t tunPort = intFlowManager.getTunnelPort();
-    if (tunPort == OFPP_NONE) return;
-    unordered_set<uint32_t> out_ports;
-    out_ports.insert(tunPort);
-
+void AdvertManager::composeEndpointAdvs(const string& uuid,
+                                        packets::PacketBatch& batch,
+                                        std::vector<EpAdvDest>& dests) {
     EndpointManager& epMgr = agent.getEndpointManager();
     PolicyManager& polMgr = agent.getPolicyManager();
 
@@ -381,11 +451,10 @@ void AdvertManager::sendEndpointAdvs(const string& uuid) {
         LOG(DEBUG) << "Sending endpoint advertisement for "
                    << ep->getMAC().get() << " " << ip;
 
-        doSendEpAdv(polMgr, switchConnection,
-                    ip, epMac, routerMac, epgURI.get(), epgVnid.get(),
-                    out_ports, sendEndpointAdv,
-                    intFlowManager.getEncapType(),
-                    intFlowManager.getEPGTunnelDst(epgURI.get()));
+        doComposeEpAdv(polMgr, batch, dests,
+                       ip, epMac, routerMac, epgURI.get(), epgVnid.get(),
+                       sendEndpointAdv,
+                       intFlowManager.getEPGTunnelDst(epgURI.get()));
 
     }
 
@@ -403,30 +472,157 @@ void AdvertManager::sendEndpointAdvs(const string& uuid) {
         LOG(DEBUG) << "Sending endpoint advertisement for "
                    << ep->getMAC().get() << " " << ipm.getFloatingIP().get();
 
-        doSendEpAdv(polMgr, switchConnection,
-                    ipm.getFloatingIP().get(), epMac,
-                    routerMac, ipm.getEgURI().get(),
-                    ipmVnid.get(), out_ports, sendEndpointAdv,
-                    intFlowManager.getEncapType(),
-                    intFlowManager.getEPGTunnelDst(ipm.getEgURI().get()));
+        doComposeEpAdv(polMgr, batch, dests,
+                       ipm.getFloatingIP().get(), epMac,
+                       routerMac, ipm.getEgURI().get(),
+                       ipmVnid.get(), sendEndpointAdv,
+                       intFlowManager.getEPGTunnelDst(ipm.getEgURI().get()));
+    }
+}
+
+void AdvertManager::sendEndpointAdvBatch(const packets::PacketBatch& batch,
+                                         const std::vector<EpAdvDest>& dests) {
+    uint32_t tunPort = intFlowManager.getTunnelPort();
+    if (tunPort == OFPP_NONE) return;
+    unordered_set<uint32_t> out_ports;
+    out_ports.insert(tunPort);
+    IntFlowManager::EncapType encapType = intFlowManager.getEncapType();
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        int error = send_packet_out(switchConnection,
+                                    batch.data(i), batch.length(i),
+                                    out_ports, encapType,
+                                    dests[i].vnid, dests[i].tunDst);
+        if (error) {
+            LOG(ERROR) << "Could not write packet-out: "
+                       << ovs_strerror(error);
+        }
+    }
+}
+
+void AdvertManager::queueEndpointAdvs(const vector<string>& uuids) {
+    bool post = false;
+    {
+        lock_guard<mutex> guard(adv_mutex);
+        for (const string& uuid : uuids) {
+            if (advQueued.insert(uuid).second)
+                advQueue.push_back(uuid);
+            else
+                advCoalesced += 1;
+        }
+        if (!advQueue.empty() && !advDrainPending) {
+            advDrainPending = true;
+            post = true;
+        }
     }
+    if (post)
+        agent.getAgentIOService()
+            .post(bind(&AdvertManager::drainEndpointAdvs, this));
 }
 
-void AdvertManager::sendAllEndpointAdvs() {
-    LOG(DEBUG) << "Sending all endpoint advertisements";
+void AdvertManager::queueAllEndpointAdvs(size_t slot) {
+    LOG(DEBUG) << "Queueing endpoint advertisements for slot " << slot;
 
     EndpointManager& epMgr = agent.getEndpointManager();
     PolicyManager& polMgr = agent.getPolicyManager();
 
     PolicyManager::uri_set_t epgURIs;
     polMgr.getGroups(epgURIs);
+    std::hash<string> hasher;
+    vector<string> uuids;
     for (const URI& epg : epgURIs) {
         unordered_set<string> eps;
         epMgr.getEndpointsForGroup(epg, eps);
         for (const string& uuid : eps) {
-            sendEndpointAdvs(uuid);
+            if (slot == EP_ADV_SLOTS || hasher(uuid) % EP_ADV_SLOTS == slot)
+                uuids.push_back(uuid);
         }
     }
+    queueEndpointAdvs(uuids);
+}
+
+void AdvertManager::drainEndpointAdvs() {
+    if (stopping) return;
+
+    vector<string> uuids;
+    {
+        lock_guard<mutex> guard(adv_mutex);
+        if (advRate != 0) {
+            steady_clock::time_point now = steady_clock::now();
+            double elapsed =
+                std::chrono::duration<double>(now - advLastRefill).count();
+            advLastRefill = now;
+            advTokens = std::min<double>(advBurst,
+                                         advTokens + elapsed * advRate);
+        }
+        // Each endpoint needs at least one token; endpoints with
+        // several addresses can drive the bucket negative, which
+        // delays the next round accordingly
+        while (!advQueue.empty() &&
+               (advRate == 0 || uuids.size() < advTokens)) {
+            uuids.push_back(std::move(advQueue.front()));
+            advQueue.pop_front();
+            advQueued.erase(uuids.back());
+        }
+    }
+
+    packets::PacketBatch batch(uuids.size() * EP_ADV_SIZE_HINT,
+                               uuids.size());
+    vector<EpAdvDest> dests;
+    if (!uuids.empty() && intFlowManager.getTunnelPort() != OFPP_NONE) {
+        dests.reserve(uuids.size());
+        for (const string& uuid : uuids) {
+            composeEndpointAdvs(uuid, batch, dests);
+        }
+        sendEndpointAdvBatch(batch, dests);
+    }
+
+    uint64_t delay = 0;
+    size_t depth;
+    double rate;
+    {
+        lock_guard<mutex> guard(adv_mutex);
+        advSent += batch.size();
+        advRateSent += batch.size();
+        updateAdvSendRate(steady_clock::now());
+        if (advRate != 0)
+            advTokens -= batch.size();
+
+        if (advQueue.empty()) {
+            advDrainPending = false;
+        } else if (advRate == 0 || advTokens >= 1) {
+            delay = 1;
+        } else {
+            delay = static_cast<uint64_t>
+                (std::ceil((1 - advTokens) * 1000 / advRate));
+            delay = std::max<uint64_t>(delay, 1);
+        }
+        depth = advQueue.size();
+        rate = advSendRate;
+    }
+
+    if (delay) {
+        lock_guard<recursive_mutex> guard(timer_mutex);
+        if (advSendTimer && !stopping) {
+            advSendTimer->expires_from_now(milliseconds(delay));
+            advSendTimer->async_wait(bind(&AdvertManager::onAdvSendTimer,
+                                          this, error));
+        }
+    }
+
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    agent.getPrometheusManager().
+        addNUpdateEpAdvertStats(depth, advSent, advCoalesced, rate);
+#else
+    (void)depth;
+    (void)rate;
+#endif
+}
+
+void AdvertManager::onAdvSendTimer(const boost::system::error_code& ec) {
+    if (ec)
+        return;
+    drainEndpointAdvs();
 }
 
 struct ServiceAdvHash {
@@ -500,16 +696,32 @@ void AdvertManager::onAllEndpointAdvTimer(const boost::system::error_code& ec) {
     if (!portMapper)
         return;
 
+    size_t slot;
+    {
+        lock_guard<recursive_mutex> guard(timer_mutex);
+        slot = allEpAdvSlot;
+    }
+
+    // Slot EP_ADV_SLOTS is a full sweep.  Otherwise only the
+    // endpoints hashed to the current slot are queued, and services
+    // are advertised once per sweep on slot 0.
     if (switchConnection->IsConnected()) {
         agent.getAgentIOService()
-            .dispatch(bind(&AdvertManager::sendAllEndpointAdvs, this));
-        agent.getAgentIOService()
-            .dispatch(bind(&AdvertManager::sendAllServiceAdvs, this));
+            .dispatch(bind(&AdvertManager::queueAllEndpointAdvs,
+                           this, slot));
+        if (slot == 0 || slot == EP_ADV_SLOTS)
+            agent.getAgentIOService()
+                .dispatch(bind(&AdvertManager::sendAllServiceAdvs, this));
     }
 
     if (!stopping) {
         lock_guard<recursive_mutex> guard(timer_mutex);
-        allEndpointAdvTimer->expires_from_now(seconds(all_ep_dis(urng)));
+        if (slot == 0 || slot == EP_ADV_SLOTS)
+            allEpAdvSlotInterval =
+                all_ep_dis(urng) * 1000 / EP_ADV_SLOTS;
+        allEpAdvSlot = (slot + 1) % EP_ADV_SLOTS;
+        allEndpointAdvTimer->
+            expires_from_now(milliseconds(allEpAdvSlotInterval));
         allEndpointAdvTimer->
             async_wait(bind(&AdvertManager::onAllEndpointAdvTimer,
                             this, error));
@@ -547,14 +759,30 @@ void AdvertManager::sendServiceAdvs(const string& uuid) {
                << svc->getInterfaceName().get()
                << " (vlan " << unsigned(vnid) << ")";
 
-    doSendEpAdv(polMgr, switchConnection, svc->getIfaceIP().get(),
-                svcMac, routerMac, URI::ROOT, vnid,
-                out_ports, sendEndpointAdv, encapType, address());
+    packets::PacketBatch batch(EP_ADV_SIZE_HINT, 1);
+    std::vector<EpAdvDest> dests;
+    doComposeEpAdv(polMgr, batch, dests, svc->getIfaceIP().get(),
+                   svcMac, routerMac, URI::ROOT, vnid,
+                   sendEndpointAdv, address());
+    for (size_t i = 0; i < batch.size(); i++) {
+        int error = send_packet_out(switchConnection,
+                                    batch.data(i), batch.length(i),
+                                    out_ports, encapType,
+                                    dests[i].vnid, dests[i].tunDst);
+        if (error) {
+            LOG(ERROR) << "Could not write packet-out: "
+                       << ovs_strerror(error);
+        }
+    }
 }
 
 void AdvertManager::onEndpointAdvTimer(const boost::system::error_code& ec) {
     if (ec)
         return;
+    {
+        lock_guard<recursive_mutex> guard(timer_mutex);
+        epAdvTimerPending = false;
+    }
     if (sendEndpointAdv == EPADV_DISABLED)
         return;
     if (!switchConnection)
@@ -562,13 +790,12 @@ void AdvertManager::onEndpointAdvTimer(const boost::system::error_code& ec) {
     if (!portMapper)
         return;
 
+    vector<string> uuids;
     unique_lock<mutex> guard(ep_mutex);
     {
         auto it = pendingEps.begin();
         while (it != pendingEps.end()) {
-            agent.getAgentIOService()
-                .post(bind(&AdvertManager::sendEndpointAdvs,
-                           this, it->first));
+            uuids.push_back(it->first);
             if (it->second <= 1) {
                 it = pendingEps.erase(it);
             } else {
@@ -606,10 +833,12 @@ void AdvertManager::onEndpointAdvTimer(const boost::system::error_code& ec) {
         }
     }
 
-    if (!pendingEps.empty() || !pendingServices.empty()) {
-        guard.unlock();
+    bool repeat = !pendingEps.empty() || !pendingServices.empty();
+    guard.unlock();
+
+    queueEndpointAdvs(uuids);
+    if (repeat)
         doScheduleEpAdv(repeat_dis(urng));
-    }
 }
 
 void AdvertManager::sendTunnelEpRarp(const string& uuid) {
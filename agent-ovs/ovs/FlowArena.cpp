@@ -0,0 +1,116 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of FlowArena class
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include "FlowArena.h"
+#include <opflexagent/logging.h>
+
+namespace opflexagent {
+
+static thread_local FlowArena* currentArena = nullptr;
+
+static FlowArena& threadArena() {
+    static thread_local FlowArena arena;
+    return arena;
+}
+
+const size_t FlowArena::DEFAULT_BLOCK_SIZE;
+const size_t FlowArena::DEFAULT_MAX_BYTES;
+
+FlowArena::FlowArena(size_t blockSize_, size_t maxBytes_)
+    : blockSize(blockSize_), maxBytes(maxBytes_), curBlock(0), offset(0),
+      bytesUsed(0), liveEntries(0) {}
+
+FlowArena::~FlowArena() {
+    if (liveEntries > 0) {
+        LOG(ERROR) << "Destroying flow arena with " << liveEntries
+                   << " live flow entries";
+    }
+}
+
+void* FlowArena::allocate(size_t size, size_t align) {
+    for (;;) {
+        if (curBlock < blocks.size()) {
+            Block& b = blocks[curBlock];
+            size_t start = (offset + align - 1) & ~(align - 1);
+            if (start + size <= b.size) {
+                offset = start + size;
+                bytesUsed += size;
+                void* p = b.data.get() + start;
+                std::memset(p, 0, size);
+                return p;
+            }
+            if (curBlock + 1 < blocks.size() &&
+                blocks[curBlock + 1].size >= size + align) {
+                curBlock += 1;
+                offset = 0;
+                continue;
+            }
+        }
+
+        // allocations that don't fit in a standard block get a
+        // dedicated block
+        size_t bsize = std::max(blockSize, size + align);
+        Block nb;
+        nb.data.reset(new uint8_t[bsize]);
+        nb.size = bsize;
+        if (curBlock < blocks.size())
+            curBlock += 1;
+        blocks.insert(blocks.begin() + curBlock, std::move(nb));
+        offset = 0;
+    }
+}
+
+void FlowArena::reset() {
+    if (liveEntries > 0) {
+        LOG(WARNING) << "Not resetting flow arena with " << liveEntries
+                     << " live flow entries";
+        return;
+    }
+
+    // Keep a single standard block around for the next pass and drop
+    // any oversized ones
+    blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+                                [this](const Block& b) {
+                                    return b.size != blockSize;
+                                }),
+                 blocks.end());
+    if (blocks.size() > 1)
+        blocks.resize(1);
+    curBlock = 0;
+    offset = 0;
+    bytesUsed = 0;
+}
+
+FlowArena* FlowArena::current() {
+    return currentArena;
+}
+
+FlowArena::Scope::Scope() : owner(currentArena == nullptr) {
+    if (owner)
+        currentArena = &threadArena();
+}
+
+FlowArena::Scope::~Scope() {
+    if (owner) {
+        if (currentArena->isFull()) {
+            LOG(WARNING) << "Flow arena reached its limit of "
+                         << currentArena->maxBytes << " bytes"
+                         << " with " << currentArena->liveEntries
+                         << " live flow entries";
+        }
+        currentArena->reset();
+        currentArena = nullptr;
+    }
+}
+
+} // namespace opflexagent
@@ -9,6 +9,7 @@
 #include <opflexagent/Network.h>
 
 #include "FlowBuilder.h"
+#include "FlowArena.h"
 #include "eth.h"
 
 #include "ovs-shim.h"
@@ -16,8 +17,16 @@
 
 namespace opflexagent {
 
-FlowBuilder::FlowBuilder() : entry_(new FlowEntry()),
-    tlvEntry_(new TlvEntry()), ethType_(0) {
+static FlowEntryPtr newFlowEntry() {
+    FlowArena* arena = FlowArena::current();
+    // fall back to the heap rather than let a full arena keep growing
+    if (arena && !arena->isFull())
+        return std::allocate_shared<FlowEntry>
+            (FlowArena::Allocator<FlowEntry>(*arena), *arena);
+    return std::make_shared<FlowEntry>();
+}
+
+FlowBuilder::FlowBuilder() : entry_(newFlowEntry()), ethType_(0) {
 
 }
 
@@ -33,7 +42,7 @@ ActionBuilder& FlowBuilder::action() {
 
 FlowEntryPtr FlowBuilder::build() {
     if (action_)
-        action_->build(entry_->entry);
+        action_->build(*entry_);
     return entry_;
 }
 
@@ -305,6 +314,11 @@ FlowBuilder& FlowBuilder::tunId(uint64_t tunId) {
     return *this;
 }
 
+FlowBuilder& FlowBuilder::conjId(uint32_t id) {
+    match_set_conj_id(match(), id);
+    return *this;
+}
+
 FlowBuilder& FlowBuilder::reg(uint8_t reg, uint32_t value, uint32_t mask) {
     match_set_reg_masked(match(), reg, value, mask);
     return *this;
@@ -349,6 +363,8 @@ FlowBuilder& FlowBuilder::outerIpDst(const boost::asio::ip::address& ip,
 
 FlowBuilder& FlowBuilder::tlv(uint16_t opt_class, uint8_t opt_type,
         uint8_t opt_len, uint16_t idx) {
+    if (!tlvEntry_)
+        tlvEntry_.reset(new TlvEntry());
     tlvEntry_->entry->option_class = opt_class;
     tlvEntry_->entry->option_type = opt_type;
     tlvEntry_->entry->option_len = opt_len;
@@ -357,11 +373,14 @@ FlowBuilder& FlowBuilder::tlv(uint16_t opt_class, uint8_t opt_type,
 }
 
 TlvEntryPtr FlowBuilder::buildTlv() {
+    // tlv entries are only allocated for builders that use them
+    if (!tlvEntry_)
+        tlvEntry_.reset(new TlvEntry());
     return tlvEntry_;
 }
 
 void FlowBuilder::buildTlv(TlvEntryList& tlvList) {
-    tlvList.push_back(tlvEntry_);
+    tlvList.push_back(buildTlv());
 }
 
 } // namespace opflexagent
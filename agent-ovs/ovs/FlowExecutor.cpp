@@ -27,6 +27,14 @@ typedef std::unique_lock<std::mutex> mutex_guard;
 namespace opflexagent {
 
 FlowExecutor::FlowExecutor() : swConn(NULL) {
+    for (auto& b : encodedBytes)
+        b.store(0, std::memory_order_relaxed);
+}
+
+void
+FlowExecutor::countEncoded(const FlowEdit::Entry& edit, size_t size) {
+    encodedBytes[edit.second->entry->table_id]
+        .fetch_add(size, std::memory_order_relaxed);
 }
 
 FlowExecutor::~FlowExecutor() {
@@ -201,6 +209,7 @@ FlowExecutor::DoExecuteNoBlock(const T& fe,
 
     for (const typename T::Entry& e : fe.edits) {
         OfpBuf msg(EncodeMod<typename T::Entry>(e, ofVersion));
+        countEncoded(e, msg.size());
         ovs_be32 xid = ((ofp_header *)msg->data)->xid;
         if (barrXid) {
             mutex_guard lock(reqMtx);
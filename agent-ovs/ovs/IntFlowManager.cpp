@@ -7,6 +7,8 @@
  */
 
 #include <string>
+#include <map>
+#include <set>
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
@@ -49,7 +51,9 @@
 #include "FlowUtils.h"
 #include "FlowConstants.h"
 #include "FlowBuilder.h"
+#include "FlowArena.h"
 #include "RangeMask.h"
+#include "MaglevTable.h"
 
 #include "arp.h"
 #include "eth.h"
@@ -149,10 +153,12 @@ IntFlowManager::IntFlowManager(Agent& agent_,
     prometheusManager(agent.getPrometheusManager()),
 #endif
     taskQueue(agent.getAgentIOService()), encapType(ENCAP_NONE),
-    floodScope(FLOOD_DOMAIN), tunnelPortStr("4789"),
+    floodScope(FLOOD_DOMAIN), svcLbMode(SVC_LB_HASH), tunnelPortStr("4789"),
     virtualRouterEnabled(false), routerAdv(false),
     virtualDHCPEnabled(false), conntrackEnabled(false), dropLogRemotePort(0),
-    serviceStatsFlowDisabled(false),
+    serviceStatsFlowDisabled(false), podSvcStatsMode(POD_SVC_STATS_PAIR),
+    podSvcStatsSamplePercent(100),
+    renderGeneration(0), epgRenderFanouts(0), epgRenderSkipped(0),
     advertManager(agent, *this), isSyncing(false), stopping(false) {
     // set up flow tables
     switchManager.setMaxFlowTables(NUM_FLOW_TABLES);
@@ -197,6 +203,7 @@ void IntFlowManager::registerModbListeners() {
     agent.getPolicyManager().registerListener(this);
     agent.getSnatManager().registerListener(this);
     tunnelEpManager.registerListener(this);
+    agent.getLatencyTracker().registerRenderer();
 }
 
 void IntFlowManager::stop() {
@@ -210,6 +217,7 @@ void IntFlowManager::stop() {
     agent.getPolicyManager().unregisterListener(this);
     agent.getSnatManager().unregisterListener(this);
     tunnelEpManager.unregisterListener(this);
+    agent.getLatencyTracker().unregisterRenderer();
 
     advertManager.stop();
     switchManager.getPortMapper().unregisterPortStatusListener(this);
@@ -243,6 +251,99 @@ void IntFlowManager::setFloodScope(FloodScope fscope) {
     floodScope = fscope;
 }
 
+void IntFlowManager::setServiceLbMode(ServiceLbMode mode) {
+    svcLbMode = mode;
+}
+
+void IntFlowManager::setPodSvcStatsMode(PodSvcStatsMode mode,
+                                        uint32_t samplePercent) {
+    podSvcStatsMode = mode;
+    // aggregated counters always count every pair
+    podSvcStatsSamplePercent =
+        mode == POD_SVC_STATS_PAIR ? std::min(samplePercent, 100u) : 100;
+}
+
+void IntFlowManager::setTaskDebounce(std::chrono::milliseconds delay) {
+    taskQueue.setDebounce(delay);
+}
+
+void IntFlowManager::
+getTaskStats(std::unordered_map<std::string,
+                                TaskQueue::TaskStats>& stats) const {
+    taskQueue.getStats(stats);
+}
+
+string IntFlowManager::getPodSvcStatsKey(const string& uuid) const {
+    size_t pos = uuid.find(":");
+    if (pos == string::npos)
+        return uuid;
+    switch (podSvcStatsMode) {
+    case POD_SVC_STATS_SERVICE:
+        return "*" + uuid.substr(pos);
+    case POD_SVC_STATS_POD:
+        return uuid.substr(0, pos + 1) + "*";
+    default:
+        return uuid;
+    }
+}
+
+uint32_t IntFlowManager::getPodSvcSampleBucket(const string& uuid) {
+    // FNV-1a, so that the same pairs stay in the sample across
+    // restarts and builds
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : uuid) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return static_cast<uint32_t>(h % 100);
+}
+
+bool IntFlowManager::isPodSvcPairTracked(const string& uuid) const {
+    if (podSvcStatsSamplePercent >= 100)
+        return true;
+    return getPodSvcSampleBucket(uuid) < podSvcStatsSamplePercent;
+}
+
+static string getServiceLbKey(const Service::ServiceMapping& sm) {
+    ostringstream key;
+    key << sm.getServiceIP().get() << "/"
+        << (sm.getServiceProto() ? sm.getServiceProto().get() : "") << "/"
+        << (sm.getServicePort() ? sm.getServicePort().get() : 0);
+    return key.str();
+}
+
+size_t IntFlowManager::getServiceLbTableSize(const string& uuid,
+                                             const Service::ServiceMapping& sm,
+                                             size_t nextHops) {
+    unique_lock<mutex> guard(svcLbMutex);
+    size_t& size = svcLbTableSize[uuid][getServiceLbKey(sm)];
+    size = MaglevTable::getTableSize(nextHops, size);
+    return size;
+}
+
+void IntFlowManager::pruneServiceLbTables(const string& uuid,
+                                          const Service& as) {
+    unordered_set<string> keys;
+    for (auto const& sm : as.getServiceMappings()) {
+        if (sm.getServiceIP())
+            keys.insert(getServiceLbKey(sm));
+    }
+
+    unique_lock<mutex> guard(svcLbMutex);
+    auto it = svcLbTableSize.find(uuid);
+    if (it == svcLbTableSize.end())
+        return;
+    auto& sizes = it->second;
+    for (auto sit = sizes.begin(); sit != sizes.end(); ) {
+        if (keys.find(sit->first) == keys.end())
+            sit = sizes.erase(sit);
+        else
+            ++sit;
+    }
+    if (sizes.empty())
+        svcLbTableSize.erase(it);
+}
+
 uint32_t IntFlowManager::getTunnelPort() {
     return switchManager.getPortMapper().FindPort(encapIface);
 }
@@ -309,9 +410,10 @@ void IntFlowManager::setVirtualDHCP(bool dhcpEnabled,
 
 void IntFlowManager::setEndpointAdv(AdvertManager::EndpointAdvMode mode,
         AdvertManager::EndpointAdvMode tunnelMode,
-        uint64_t tunnelAdvIntvl) {
+        uint64_t tunnelAdvIntvl, uint32_t advRate, uint32_t advBurst) {
     if (mode != AdvertManager::EPADV_DISABLED)
         advertManager.enableEndpointAdv(mode);
+    advertManager.setEndpointAdvRate(advRate, advBurst);
     advertManager.enableTunnelEndpointAdv(tunnelMode, tunnelAdvIntvl);
 }
 
@@ -344,14 +446,33 @@ address IntFlowManager::getEPGTunnelDst(const URI& epgURI) {
 }
 
 void IntFlowManager::endpointUpdated(const std::string& uuid) {
-    if (stopping) return;
+    LatencyTracker& tracker = agent.getLatencyTracker();
+    if (stopping) {
+        tracker.abandon(uuid);
+        return;
+    }
 
     if(tunnelEpManager.isTunnelEp(uuid)){
+        tracker.abandon(uuid);
         advertManager.scheduleTunnelEpAdv(uuid);
         return;
     }
     advertManager.scheduleEndpointAdv(uuid);
-    taskQueue.dispatch(uuid, [=]() { handleEndpointUpdate(uuid); });
+    tracker.mark(uuid, LatencyTracker::NOTIFY);
+
+    // a queued update to the endpoint group re-renders its endpoints,
+    // so hold the endpoint update until the group update completes
+    string egKey;
+    std::shared_ptr<const Endpoint> ep =
+        agent.getEndpointManager().getEndpoint(uuid);
+    if (ep && ep->getEgURI())
+        egKey = ep->getEgURI().get().toString();
+
+    taskQueue.dispatch(uuid, [=, &tracker]() {
+            tracker.mark(uuid, LatencyTracker::QUEUE);
+            handleEndpointUpdate(uuid);
+            tracker.finish(uuid, LatencyTracker::RENDER);
+        }, "endpoint", egKey);
 }
 
 void IntFlowManager::localExternalDomainUpdated(const opflex::modb::URI& egURI) {
@@ -362,14 +483,16 @@ void IntFlowManager::localExternalDomainUpdated(const opflex::modb::URI& egURI)
 void IntFlowManager::remoteEndpointUpdated(const string& uuid) {
     if (stopping) return;
     taskQueue.dispatch(uuid,
-                       [=](){ handleRemoteEndpointUpdate(uuid); });
+                       [=](){ handleRemoteEndpointUpdate(uuid); },
+                       "remote-endpoint");
 }
 
 void IntFlowManager::serviceUpdated(const std::string& uuid) {
     if (stopping) return;
 
     advertManager.scheduleServiceAdv(uuid);
-    taskQueue.dispatch(uuid, [=]() { handleServiceUpdate(uuid); });
+    taskQueue.dispatch(uuid, [=]() { handleServiceUpdate(uuid); },
+                       "service");
 }
 
 void IntFlowManager::rdConfigUpdated(const opflex::modb::URI& rdURI) {
@@ -485,21 +608,29 @@ void IntFlowManager::lbVlanUpdated(LearningBridgeIface::vlan_range_t vlan) {
 void IntFlowManager::egDomainUpdated(const opflex::modb::URI& egURI) {
     if (stopping) return;
 
-    taskQueue.dispatch(egURI.toString(),
-                       [=]() { handleEndpointGroupDomainUpdate(egURI); });
+    string key = egURI.toString();
+    LatencyTracker& tracker = agent.getLatencyTracker();
+    tracker.begin(key);
+    taskQueue.dispatch(key, [=, &tracker]() {
+            tracker.mark(key, LatencyTracker::QUEUE);
+            handleEndpointGroupDomainUpdate(egURI);
+            tracker.finish(key, LatencyTracker::RENDER);
+        }, "epg");
 }
 
 void IntFlowManager::domainUpdated(class_id_t cid, const URI& domURI) {
     if (stopping) return;
 
     taskQueue.dispatch(domURI.toString(),
-                       [=]() { handleDomainUpdate(cid, domURI); });
+                       [=]() { handleDomainUpdate(cid, domURI); },
+                       "domain");
 }
 
 void IntFlowManager::contractUpdated(const opflex::modb::URI& contractURI) {
     if (stopping) return;
     taskQueue.dispatch(contractURI.toString(),
-                       [=]() { handleContractUpdate(contractURI); });
+                       [=]() { handleContractUpdate(contractURI); },
+                       "contract");
 }
 
 void IntFlowManager::configUpdated(const opflex::modb::URI& configURI) {
@@ -1417,6 +1548,7 @@ bool getHostAccess(EndpointManager& epMgr,
 
 void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
     LOG(DEBUG) << "Updating remote endpoint " << uuid;
+    FlowArena::Scope arenaScope;
 
     optional<shared_ptr<modelgbp::inv::RemoteInventoryEp>> ep =
         modelgbp::inv::RemoteInventoryEp::resolve(agent.getFramework(), uuid);
@@ -1722,6 +1854,8 @@ static void flowsEndpointSNAT(SnatManager& snatMgr,
 
 void IntFlowManager::handleEndpointUpdate(const string& uuid) {
     LOG(DEBUG) << "Updating endpoint " << uuid;
+    // build flows for this render pass in the thread's flow arena
+    FlowArena::Scope arenaScope;
 
     EndpointManager& epMgr = agent.getEndpointManager();
     shared_ptr<const Endpoint> epWrapper = epMgr.getEndpoint(uuid);
@@ -2239,6 +2373,8 @@ updateSvcStatsCounters (const uint64_t &cookie,
     // The idgen strings for epToSvc and svcToEp will have below format
     // eptosvc:ep-uuid:svc-uuid
     // svctoep:ep-uuid:svc-uuid
+    // with ep-uuid or svc-uuid replaced by "*" when the counters are
+    // aggregated per service or per pod
 
     // The idgen strings for anyToSvc and svcToAny will have below format
     // antosvc:svc-tgt:svc-uuid:nh-ip
@@ -2521,23 +2657,35 @@ updatePodSvcStatsCounters (const uint64_t &cookie,
     const string& epUuid = idStr.substr(pos1+1, pos2-pos1-1);
     const string& svcUuid = idStr.substr(pos2+1);
 
+    // Aggregated counters use "*" in place of the uuid they are
+    // shared across, and name that side "*" so that the counters
+    // still carry both an endpoint and a service name
+    static const attr_map anyEpAttr = {{"vm-name", "*"}};
+    static const attr_map anySvcAttr = {{"name", "*"}};
+
     ServiceManager& svcMgr = agent.getServiceManager();
-    shared_ptr<const Service> asWrapper = svcMgr.getService(svcUuid);
-    if (!asWrapper) {
-        LOG(DEBUG) << "service not found for uuid: " << svcUuid;
-        return;
+    shared_ptr<const Service> asWrapper;
+    if (svcUuid != "*") {
+        asWrapper = svcMgr.getService(svcUuid);
+        if (!asWrapper) {
+            LOG(DEBUG) << "service not found for uuid: " << svcUuid;
+            return;
+        }
     }
-    const Service& as = *asWrapper;
-    const attr_map &svcAttr = as.getAttributes();
+    const attr_map &svcAttr =
+        asWrapper ? asWrapper->getAttributes() : anySvcAttr;
 
     EndpointManager& epMgr = agent.getEndpointManager();
-    shared_ptr<const Endpoint> epWrapper = epMgr.getEndpoint(epUuid);
-    if (!epWrapper) {
-        LOG(DEBUG) << "endpoint not found for uuid: " << epUuid;
-        return;
+    shared_ptr<const Endpoint> epWrapper;
+    if (epUuid != "*") {
+        epWrapper = epMgr.getEndpoint(epUuid);
+        if (!epWrapper) {
+            LOG(DEBUG) << "endpoint not found for uuid: " << epUuid;
+            return;
+        }
     }
-    const Endpoint& endPoint = *epWrapper.get();
-    const attr_map &epAttr = endPoint.getAttributes();
+    const attr_map &epAttr =
+        epWrapper ? epWrapper->getAttributes() : anyEpAttr;
 
     Mutator mutator(agent.getFramework(), "policyelement");
     optional<shared_ptr<SvcStatUniverse> > su =
@@ -3572,6 +3720,124 @@ void IntFlowManager::updateSvcTgtStatsFlows (const string &uuid,
         switchManager.writeFlow(p.first, STATS_TABLE_ID, p.second);
 }
 
+void IntFlowManager::writePodSvcAggEpFlows(const string& epUuid) {
+    const string flowId = "podsvc:ep:" + epUuid;
+    auto eitr = podSvcAggEps.find(epUuid);
+    if (eitr == podSvcAggEps.end()) {
+        switchManager.clearFlows(flowId, STATS_TABLE_ID);
+        return;
+    }
+
+    // Each endpoint IP is one clause of the conjunction of every
+    // aggregated counter it is counted towards
+    std::map<string, std::set<uint32_t>> ingConj;
+    std::map<string, std::set<uint32_t>> egrConj;
+    for (const auto& sp : eitr->second) {
+        auto citr =
+            podSvcUuidCkMap.find(getPodSvcStatsKey(epUuid + ":" + sp.first));
+        if (citr == podSvcUuidCkMap.end())
+            continue;
+        for (const string& ip : sp.second) {
+            ingConj[ip].insert(static_cast<uint32_t>(citr->second.first));
+            egrConj[ip].insert(static_cast<uint32_t>(citr->second.second));
+        }
+    }
+
+    FlowEntryList flows;
+    for (const auto& ic : ingConj) {
+        boost::system::error_code ec;
+        address epAddr = address::from_string(ic.first, ec);
+        if (ec)
+            continue;
+        uint16_t ethType =
+            epAddr.is_v4() ? eth::type::IP : eth::type::IPV6;
+
+        FlowBuilder epToSvc;
+        epToSvc.priority(100).ethType(ethType).ipSrc(epAddr);
+        for (uint32_t id : ic.second)
+            epToSvc.action().conjunction(id, 1, 2);
+        epToSvc.build(flows);
+
+        FlowBuilder svcToEp;
+        svcToEp.priority(100).ethType(ethType).ipDst(epAddr);
+        for (uint32_t id : egrConj[ic.first])
+            svcToEp.action().conjunction(id, 2, 2);
+        svcToEp.build(flows);
+    }
+    switchManager.writeFlow(flowId, STATS_TABLE_ID, flows);
+}
+
+void IntFlowManager::writePodSvcAggSvcFlows(const string& svcUuid) {
+    const string flowId = "podsvc:svc:" + svcUuid;
+    auto sitr = podSvcAggSvcs.find(svcUuid);
+    shared_ptr<const Service> asWrapper =
+        agent.getServiceManager().getService(svcUuid);
+    if (sitr == podSvcAggSvcs.end() || !asWrapper) {
+        switchManager.clearFlows(flowId, STATS_TABLE_ID);
+        return;
+    }
+
+    // Each service mapping is the other clause of the conjunction of
+    // every aggregated counter of the service's pairs
+    std::set<uint32_t> ingConj;
+    std::set<uint32_t> egrConj;
+    for (const string& epUuid : sitr->second) {
+        auto citr =
+            podSvcUuidCkMap.find(getPodSvcStatsKey(epUuid + ":" + svcUuid));
+        if (citr == podSvcUuidCkMap.end())
+            continue;
+        ingConj.insert(static_cast<uint32_t>(citr->second.first));
+        egrConj.insert(static_cast<uint32_t>(citr->second.second));
+    }
+
+    FlowEntryList flows;
+    for (auto const& sm : asWrapper->getServiceMappings()) {
+        if (ingConj.empty() || !sm.getServiceIP())
+            continue;
+        boost::system::error_code ec;
+        address svcAddr = address::from_string(sm.getServiceIP().get(), ec);
+        if (ec)
+            continue;
+
+        uint8_t proto = 0;
+        if (sm.getServiceProto()) {
+            const string& protoStr = sm.getServiceProto().get();
+            if ("udp" == protoStr)
+                proto = 17;
+            else if ("tcp" == protoStr)
+                proto = 6;
+            else
+                continue;
+        }
+
+        FlowBuilder epToSvc;
+        FlowBuilder svcToEp;
+        matchServiceProto(epToSvc, proto, sm, true);
+        matchServiceProto(svcToEp, proto, sm, false);
+        if (svcAddr.is_v4()) {
+            epToSvc.priority(100).ethType(eth::type::IP)
+                .reg(8, svcAddr.to_v4().to_ulong());
+            svcToEp.priority(100).ethType(eth::type::IP)
+                .ipSrc(svcAddr);
+        } else {
+            uint32_t pAddr[4];
+            in6AddrToLong(svcAddr, &pAddr[0]);
+            epToSvc.priority(100).ethType(eth::type::IPV6)
+                .reg(8, pAddr[0]).reg(9, pAddr[1])
+                .reg(10, pAddr[2]).reg(11, pAddr[3]);
+            svcToEp.priority(100).ethType(eth::type::IPV6)
+                .ipSrc(svcAddr);
+        }
+        for (uint32_t id : ingConj)
+            epToSvc.action().conjunction(id, 2, 2);
+        for (uint32_t id : egrConj)
+            svcToEp.action().conjunction(id, 1, 2);
+        epToSvc.build(flows);
+        svcToEp.build(flows);
+    }
+    switchManager.writeFlow(flowId, STATS_TABLE_ID, flows);
+}
+
 void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
                                              const bool &is_svc,
                                              const bool &is_add)
@@ -3588,22 +3854,65 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
      * their respective "pod<-->svc" uuids */
     unordered_map<string, FlowEntryList> uuid_felist_map;
 
+    /* In the service and pod modes, pairs don't get flows of their
+     * own.  Instead each endpoint IP and each service mapping gets
+     * one clause flow, and each aggregated counter one conjunction
+     * flow, so the number of stats flows grows with the number of
+     * endpoints plus services rather than their product.  These are
+     * the endpoints and services whose clause flows need rewriting. */
+    unordered_set<string> aggEps;
+    unordered_set<string> aggSvcs;
+    auto writeAggFlows = [this, &aggEps, &aggSvcs]() -> void {
+        for (const string& epUuid : aggEps)
+            writePodSvcAggEpFlows(epUuid);
+        for (const string& svcUuid : aggSvcs)
+            writePodSvcAggSvcFlows(svcUuid);
+    };
+
     // Expr to del stats flow between "ep to svc" and "svc to ep"
     auto podSvcFlowRemExpr =
-        [this] (const string &uuid) -> void {
+        [this, &aggEps, &aggSvcs] (const string &uuid) -> void {
         switchManager.clearFlows(uuid, STATS_TABLE_ID);
+        const string& key = getPodSvcStatsKey(uuid);
+        if (key != uuid) {
+            size_t pos = uuid.find(":");
+            const string epUuid = uuid.substr(0, pos);
+            const string svcUuid = uuid.substr(pos + 1);
+            auto eitr = podSvcAggEps.find(epUuid);
+            if (eitr != podSvcAggEps.end() && eitr->second.erase(svcUuid)) {
+                if (eitr->second.empty())
+                    podSvcAggEps.erase(eitr);
+                aggEps.insert(epUuid);
+            }
+            auto sitr = podSvcAggSvcs.find(svcUuid);
+            if (sitr != podSvcAggSvcs.end() && sitr->second.erase(epUuid)) {
+                if (sitr->second.empty())
+                    podSvcAggSvcs.erase(sitr);
+                aggSvcs.insert(svcUuid);
+            }
+
+            // Aggregated counters stay until their last pair goes
+            auto aitr = podSvcAggMap.find(key);
+            if (aitr == podSvcAggMap.end())
+                return;
+            aitr->second.erase(uuid);
+            if (!aitr->second.empty())
+                return;
+            podSvcAggMap.erase(aitr);
+            switchManager.clearFlows("podsvc:" + key, STATS_TABLE_ID);
+        }
         // Qualifying the names given to idGen with eptosvc/svctoep
         // so that stat's infra's genIdList_ is unique per direction
-        clearPodSvcStatsCounters("eptosvc:"+uuid);
-        clearPodSvcStatsCounters("svctoep:"+uuid);
-        idGen.erase(ID_NMSPC_SVCSTATS, "eptosvc:"+uuid);
-        idGen.erase(ID_NMSPC_SVCSTATS, "svctoep:"+uuid);
-        podSvcUuidCkMap.erase(uuid);
+        clearPodSvcStatsCounters("eptosvc:"+key);
+        clearPodSvcStatsCounters("svctoep:"+key);
+        idGen.erase(ID_NMSPC_SVCSTATS, "eptosvc:"+key);
+        idGen.erase(ID_NMSPC_SVCSTATS, "svctoep:"+key);
+        podSvcUuidCkMap.erase(key);
     };
 
     // Expr to add stats flow between "ep to svc" and "svc to ep"
     auto podSvcFlowAddExpr =
-        [this, &uuid_felist_map](const string &uuid,
+        [this, &uuid_felist_map, &aggEps, &aggSvcs](const string &uuid,
                                  const string &epipStr,
                                  const Service::ServiceMapping &sm) -> void {
 
@@ -3649,9 +3958,18 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
             }
         }
 
-        const string& ingStr = "eptosvc:"+uuid;
-        const string& egrStr = "svctoep:"+uuid;
-        auto itr = podSvcUuidCkMap.find(uuid);
+        // Pairs left out of the sample get no flows, so that the
+        // number of stats flows scales with the sample
+        if (!isPodSvcPairTracked(uuid))
+            return;
+
+        const string& key = getPodSvcStatsKey(uuid);
+        if (key != uuid)
+            podSvcAggMap[key].insert(uuid);
+
+        const string& ingStr = "eptosvc:"+key;
+        const string& egrStr = "svctoep:"+key;
+        auto itr = podSvcUuidCkMap.find(key);
         if (itr == podSvcUuidCkMap.end()) {
             // Qualifying the names given to idGen with eptosvc/svctoep
             // so that stat's infra's genIdList_ is unique per direction
@@ -3663,16 +3981,53 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
 
             // Create the objects and cookies once for every POD,SVC combination
             LOG(DEBUG) << "Creating pod<-->svc counters for"
-                       << " uuid: " << uuid
+                       << " uuid: " << key
                        << " cookieIg: " << cookieIdIg
                        << " cookieEg: " << cookieIdEg;
-            podSvcUuidCkMap[uuid] = make_pair(cookieIdIg, cookieIdEg);
+            itr = podSvcUuidCkMap.emplace(key,
+                                          make_pair(cookieIdIg,
+                                                    cookieIdEg)).first;
+
+            if (key != uuid) {
+                // The conjunction flows that count the aggregate; the
+                // conjunction IDs are the cookies
+                FlowEntryList conjFlows;
+                FlowBuilder().priority(100)
+                    .conjId(static_cast<uint32_t>(cookieIdIg))
+                    .flags(OFPUTIL_FF_SEND_FLOW_REM)
+                    .cookie(ovs_htonll(cookieIdIg))
+                    .action().go(OUT_TABLE_ID)
+                    .parent().build(conjFlows);
+                FlowBuilder().priority(100)
+                    .conjId(static_cast<uint32_t>(cookieIdEg))
+                    .flags(OFPUTIL_FF_SEND_FLOW_REM)
+                    .cookie(ovs_htonll(cookieIdEg))
+                    .action().go(OUT_TABLE_ID)
+                    .parent().build(conjFlows);
+                switchManager.writeFlow("podsvc:" + key, STATS_TABLE_ID,
+                                        conjFlows);
+            }
         }
+        const uint64_t cookieIg = itr->second.first;
+        const uint64_t cookieEg = itr->second.second;
 
         // Note: the objects are created once. But we still call below counter
         // updates to take care of ep/svc attr changes
-        updatePodSvcStatsCounters(podSvcUuidCkMap[uuid].first, true, ingStr, 0, 0);
-        updatePodSvcStatsCounters(podSvcUuidCkMap[uuid].second, false, egrStr, 0, 0);
+        updatePodSvcStatsCounters(cookieIg, true, ingStr, 0, 0);
+        updatePodSvcStatsCounters(cookieEg, false, egrStr, 0, 0);
+
+        if (key != uuid) {
+            size_t pos = uuid.find(":");
+            const string epUuid = uuid.substr(0, pos);
+            const string svcUuid = uuid.substr(pos + 1);
+            podSvcAggEps[epUuid][svcUuid].insert(epAddr.to_string());
+            podSvcAggSvcs[svcUuid].insert(epUuid);
+            aggEps.insert(epUuid);
+            aggSvcs.insert(svcUuid);
+            // no flows of its own, but the pair is counted
+            uuid_felist_map[uuid];
+            return;
+        }
 
         FlowBuilder epToSvc; // to service stats
         FlowBuilder svcToEp; // from service stats
@@ -3685,12 +4040,12 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
                    .ipSrc(epAddr)
                    .reg(8, svcAddr.to_v4().to_ulong())
                    .flags(OFPUTIL_FF_SEND_FLOW_REM)
-                   .cookie(ovs_htonll(podSvcUuidCkMap[uuid].first))
+                   .cookie(ovs_htonll(cookieIg))
                    .action().go(OUT_TABLE_ID);
             svcToEp.priority(100).ethType(eth::type::IP)
                    .ipSrc(svcAddr).ipDst(epAddr)
                    .flags(OFPUTIL_FF_SEND_FLOW_REM)
-                   .cookie(ovs_htonll(podSvcUuidCkMap[uuid].second))
+                   .cookie(ovs_htonll(cookieEg))
                    .action().go(OUT_TABLE_ID);
         } else {
             uint32_t pAddr[4];
@@ -3702,12 +4057,12 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
                    .reg(8, pAddr[0]).reg(9, pAddr[1])
                    .reg(10, pAddr[2]).reg(11, pAddr[3])
                    .flags(OFPUTIL_FF_SEND_FLOW_REM)
-                   .cookie(ovs_htonll(podSvcUuidCkMap[uuid].first))
+                   .cookie(ovs_htonll(cookieIg))
                    .action().go(OUT_TABLE_ID);
             svcToEp.priority(100).ethType(eth::type::IPV6)
                    .ipSrc(svcAddr).ipDst(epAddr)
                    .flags(OFPUTIL_FF_SEND_FLOW_REM)
-                   .cookie(ovs_htonll(podSvcUuidCkMap[uuid].second))
+                   .cookie(ovs_htonll(cookieEg))
                    .action().go(OUT_TABLE_ID);
         }
         epToSvc.build(uuid_felist_map[uuid]);
@@ -3722,6 +4077,7 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
         if (!is_add) {
             for (const string& epUuid : epUuids)
                 podSvcFlowRemExpr(epUuid+":"+uuid);
+            writeAggFlows();
             return;
         }
 
@@ -3737,6 +4093,17 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
         LOG(TRACE) << "####### pod<-->svc Service ########";
         LOG(TRACE) << *asWrapper;
 
+        // the endpoint IPs counted towards the service are collected
+        // again below
+        auto sitr = podSvcAggSvcs.find(uuid);
+        if (sitr != podSvcAggSvcs.end()) {
+            for (const string& epUuid : sitr->second) {
+                podSvcAggEps[epUuid][uuid].clear();
+                aggEps.insert(epUuid);
+            }
+            aggSvcs.insert(uuid);
+        }
+
         // build this set to detect if a pod<-->svc flow got created or not.
         // For e.g. if a svc-next hop becomes same as an IP in EP, then flow wont be created.
         // pre-existing flows should be deleted though and the mos should be removed.
@@ -3808,6 +4175,7 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
         if (!is_add) {
             for (const string& svcUuid : svcUuids)
                 podSvcFlowRemExpr(uuid+":"+svcUuid);
+            writeAggFlows();
             return;
         }
 
@@ -3829,6 +4197,14 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
             return;
         }
 
+        // the IPs of the endpoint are collected again below
+        auto eitr = podSvcAggEps.find(uuid);
+        if (eitr != podSvcAggEps.end()) {
+            for (auto& sp : eitr->second)
+                sp.second.clear();
+            aggEps.insert(uuid);
+        }
+
         // build this set to detect if a pod<-->svc flow got created or not.
         // For e.g. if an EP becomes next hop of a service, then flow wont be created.
         // pre-existing flows should be deleted though and the mos should be removed.
@@ -3884,6 +4260,7 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
 
     for (auto &p : uuid_felist_map)
         switchManager.writeFlow(p.first, STATS_TABLE_ID, p.second);
+    writeAggFlows();
 }
 
 void IntFlowManager::programServiceSnatDnatFlows (const string& uuid)
@@ -3967,23 +4344,52 @@ void IntFlowManager::programServiceSnatDnatFlows (const string& uuid)
                     proto = 6;
             }
 
+            // In Maglev mode each next hop owns the buckets of the
+            // lookup table that map to it, and a change to the next
+            // hops only changes the flows of the buckets that move
+            bool maglev =
+                svcLbMode == SVC_LB_MAGLEV && nextHopAddrs.size() > 1;
+            vector<vector<uint32_t>> maglevLinks(nextHopAddrs.size());
+            if (maglev) {
+                vector<string> names;
+                for (const address& nextHopAddr : nextHopAddrs)
+                    names.push_back(nextHopAddr.to_string());
+                vector<size_t> table;
+                MaglevTable::populate(names,
+                                      getServiceLbTableSize(uuid, sm,
+                                                            names.size()),
+                                      table);
+                for (size_t bucket = 0; bucket < table.size(); ++bucket)
+                    maglevLinks[table[bucket]].push_back(bucket);
+            }
 
             uint16_t link = 0;
             for (const address& nextHopAddr : nextHopAddrs) {
-                {
+                // use the first address as a "default" so that
+                // there is no transient case where there is no
+                // match while flows are updated.
+                vector<optional<uint32_t>> mapLinks;
+                if (link == 0)
+                    mapLinks.push_back(boost::none);
+                if (maglev) {
+                    mapLinks.insert(mapLinks.end(),
+                                    maglevLinks[link].begin(),
+                                    maglevLinks[link].end());
+                } else if (link != 0) {
+                    mapLinks.push_back(link);
+                }
+
+                for (const optional<uint32_t>& mapLink : mapLinks) {
                     FlowBuilder ipMap;
                     matchDestDom(ipMap, 0, rdId);
                     matchActionServiceProto(ipMap, proto, sm, true, true);
                     ipMap.ipDst(serviceAddr);
 
-                    // use the first address as a "default" so that
-                    // there is no transient case where there is no
-                    // match while flows are updated.
-                    if (link == 0) {
+                    if (!mapLink) {
                         ipMap.priority(99);
                     } else {
                         ipMap.priority(100)
-                            .reg(7, link);
+                            .reg(7, mapLink.get());
                     }
                     ipMap.action().ipDst(nextHopAddr).decTtl();
 
@@ -4138,6 +4544,7 @@ void IntFlowManager::programServiceSnatDnatFlows (const string& uuid)
 
 void IntFlowManager::handleServiceUpdate(const string& uuid) {
     LOG(DEBUG) << "Updating service " << uuid;
+    FlowArena::Scope arenaScope;
 
     ServiceManager& srvMgr = agent.getServiceManager();
     shared_ptr<const Service> asWrapper = srvMgr.getService(uuid);
@@ -4150,6 +4557,10 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
         switchManager.clearFlows(uuid, SERVICE_NEXTHOP_TABLE_ID);
         updateSvcStatsFlows(uuid, true, false);
         idGen.erase(ID_NMSPC_SERVICE, uuid);
+        {
+            unique_lock<mutex> guard(svcLbMutex);
+            svcLbTableSize.erase(uuid);
+        }
         return;
     }
 
@@ -4255,11 +4666,20 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
                     } else {
                         serviceDest.action().ethDst(getRouterMacAddr());
                     }
+                    // In Maglev mode the hash selects a bucket of
+                    // the service's lookup table; the next hop table
+                    // maps buckets to next hops
+                    size_t links = nextHopAddrs.size();
+                    ActionBuilder::MultipathAlgo alg =
+                        ActionBuilder::NX_MP_ALG_ITER_HASH;
+                    if (svcLbMode == SVC_LB_MAGLEV && links > 1) {
+                        links = getServiceLbTableSize(uuid, sm, links);
+                        alg = ActionBuilder::NX_MP_ALG_MODULO_N;
+                    }
                     serviceDest.action()
                         .multipath(NX_HASH_FIELDS_SYMMETRIC_L3L4_UDP,
-                                   1024,
-                                   ActionBuilder::NX_MP_ALG_ITER_HASH,
-                                   static_cast<uint16_t>(nextHopAddrs.size()-1),
+                                   1024, alg,
+                                   static_cast<uint16_t>(links-1),
                                    32, MFF_REG7)
                         .go(SERVICE_NEXTHOP_TABLE_ID);
                 } else if (as.getServiceMode() == Service::LOCAL_ANYCAST &&
@@ -4425,6 +4845,7 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
         }
     }
 
+    pruneServiceLbTables(uuid, as);
     programServiceSnatDnatFlows(uuid);
     switchManager.writeFlow(uuid, SEC_TABLE_ID, secFlows);
     switchManager.writeFlow(uuid, BRIDGE_TABLE_ID, bridgeFlows);
@@ -4911,8 +5332,19 @@ void IntFlowManager::createStaticFlows() {
 
 }
 
+bool IntFlowManager::EpgRenderState::
+operator==(const EpgRenderState& o) const {
+    return vnid == o.vnid && rdId == o.rdId && bdId == o.bdId &&
+        fgrpId == o.fgrpId && routingMode == o.routingMode &&
+        arpMode == o.arpMode && ndMode == o.ndMode &&
+        unkFloodMode == o.unkFloodMode &&
+        bcastFloodMode == o.bcastFloodMode &&
+        tunDst == o.tunDst && generation == o.generation;
+}
+
 void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
     LOG(DEBUG) << "Updating endpoint-group " << epgURI;
+    FlowArena::Scope arenaScope;
 
     const string& epgId = epgURI.toString();
 
@@ -4926,6 +5358,7 @@ void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
         switchManager.clearFlows(epgId, OUT_TABLE_ID);
         switchManager.clearFlows(epgId, BRIDGE_TABLE_ID);
         updateMulticastList(boost::none, epgURI);
+        epgRenderStates.erase(epgURI);
         return;
     }
 
@@ -4933,9 +5366,45 @@ void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
     optional<URI> fgrpURI, bdURI, rdURI;
     if (!getGroupForwardingInfo(epgURI, epgVnid, rdURI, rdId,
                                 bdURI, bdId, fgrpURI, fgrpId)) {
+        epgRenderStates.erase(epgURI);
         return;
     }
 
+    // Work out whether anything the member endpoint flows depend on
+    // has changed since the group was last rendered
+    EpgRenderState renderState;
+    renderState.vnid = epgVnid;
+    renderState.rdId = rdId;
+    renderState.bdId = bdId;
+    renderState.fgrpId = fgrpId;
+    renderState.routingMode = polMgr.getEffectiveRoutingMode(epgURI);
+    renderState.arpMode = AddressResModeEnumT::CONST_UNICAST;
+    renderState.ndMode = AddressResModeEnumT::CONST_UNICAST;
+    renderState.unkFloodMode = UnknownFloodModeEnumT::CONST_DROP;
+    renderState.bcastFloodMode = BcastFloodModeEnumT::CONST_NORMAL;
+    optional<shared_ptr<FloodDomain> > epgFd = polMgr.getFDForGroup(epgURI);
+    if (epgFd) {
+        renderState.arpMode = epgFd.get()
+            ->getArpMode(AddressResModeEnumT::CONST_UNICAST);
+        renderState.ndMode = epgFd.get()
+            ->getNeighborDiscMode(AddressResModeEnumT::CONST_UNICAST);
+        renderState.unkFloodMode = epgFd.get()
+            ->getUnknownFloodMode(UnknownFloodModeEnumT::CONST_DROP);
+        renderState.bcastFloodMode = epgFd.get()
+            ->getBcastFloodMode(BcastFloodModeEnumT::CONST_NORMAL);
+    }
+    renderState.tunDst = epgTunDst;
+    renderState.generation = renderGeneration;
+    bool epsChanged = true;
+    auto rsIt = epgRenderStates.find(epgURI);
+    if (rsIt == epgRenderStates.end()) {
+        epgRenderStates.emplace(epgURI, renderState);
+    } else if (rsIt->second == renderState) {
+        epsChanged = false;
+    } else {
+        rsIt->second = renderState;
+    }
+
     FlowEntryList uplinkMatch;
     if (tunPort != OFPP_NONE && encapType != ENCAP_NONE) {
         // Assign the source registers based on the VNID from the
@@ -5066,32 +5535,39 @@ void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
     }
     switchManager.writeFlow(epgId, OUT_TABLE_ID, egOutFlows);
 
-    unordered_set<string> epUuids;
-    EndpointManager& epMgr = agent.getEndpointManager();
-    epMgr.getEndpointsForIPMGroup(epgURI, epUuids);
-    std::unordered_set<URI> ipmRds;
-    for (const string& uuid : epUuids) {
-        std::shared_ptr<const Endpoint> ep = epMgr.getEndpoint(uuid);
-        if (!ep) continue;
-        const boost::optional<opflex::modb::URI>& egURI = ep->getEgURI();
-        if (!egURI) continue;
-        boost::optional<std::shared_ptr<modelgbp::gbp::RoutingDomain> > rd =
-            polMgr.getRDForGroup(egURI.get());
-        if (rd)
-            ipmRds.insert(rd.get()->getURI());
-    }
-    for (const URI& rdURI : ipmRds) {
-        // update routing domains that have references to the
-        // IP-mapping EPG to ensure external subnets are correctly
-        // mapped.
-        rdConfigUpdated(rdURI);
-    }
-
-    // note this combines with the IPM group endpoints from above:
-    epMgr.getEndpointsForGroup(epgURI, epUuids);
-    for (const string& uuid : epUuids) {
-        advertManager.scheduleEndpointAdv(uuid);
-        endpointUpdated(uuid);
+    if (epsChanged) {
+        epgRenderFanouts += 1;
+        unordered_set<string> epUuids;
+        EndpointManager& epMgr = agent.getEndpointManager();
+        epMgr.getEndpointsForIPMGroup(epgURI, epUuids);
+        std::unordered_set<URI> ipmRds;
+        for (const string& uuid : epUuids) {
+            std::shared_ptr<const Endpoint> ep = epMgr.getEndpoint(uuid);
+            if (!ep) continue;
+            const boost::optional<opflex::modb::URI>& egURI = ep->getEgURI();
+            if (!egURI) continue;
+            boost::optional<std::shared_ptr<modelgbp::gbp::RoutingDomain> > rd =
+                polMgr.getRDForGroup(egURI.get());
+            if (rd)
+                ipmRds.insert(rd.get()->getURI());
+        }
+        for (const URI& rdURI : ipmRds) {
+            // update routing domains that have references to the
+            // IP-mapping EPG to ensure external subnets are correctly
+            // mapped.
+            rdConfigUpdated(rdURI);
+        }
+
+        // note this combines with the IPM group endpoints from above:
+        epMgr.getEndpointsForGroup(epgURI, epUuids);
+        for (const string& uuid : epUuids) {
+            advertManager.scheduleEndpointAdv(uuid);
+            endpointUpdated(uuid);
+        }
+    } else {
+        LOG(DEBUG) << "Endpoint inputs unchanged for " << epgURI
+                   << "; not re-rendering endpoints";
+        epgRenderSkipped += 1;
     }
 
     PolicyManager::uri_set_t contractURIs;
@@ -5607,19 +6083,22 @@ updateEndpointFloodGroup(const opflex::modb::URI& fgrpURI,
         GroupEdit::Entry e =
             createGroupMod(OFPGC11_ADD, fgrpId, floodGroupMap[fgrpURI]);
         switchManager.writeGroupMod(e);
-    }
 
-    FlowEntryList fdOutput;
-    {
-        // Output table action to output to the flood group appropriate
-        // for the source EPG.
-        FlowBuilder().priority(10).reg(5, fgrpId)
-            .metadata(flow::meta::out::FLOOD, flow::meta::out::MASK)
-            .action()
-            .group(fgrpId)
-            .parent().build(fdOutput);
+        // The output flow only depends on the group ID, so it is
+        // written when the group is created rather than on every
+        // membership change
+        FlowEntryList fdOutput;
+        {
+            // Output table action to output to the flood group
+            // appropriate for the source EPG.
+            FlowBuilder().priority(10).reg(5, fgrpId)
+                .metadata(flow::meta::out::FLOOD, flow::meta::out::MASK)
+                .action()
+                .group(fgrpId)
+                .parent().build(fdOutput);
+        }
+        switchManager.writeFlow(fgrpStrId, OUT_TABLE_ID, fdOutput);
     }
-    switchManager.writeFlow(fgrpStrId, OUT_TABLE_ID, fdOutput);
 }
 
 void IntFlowManager::removeEndpointFromFloodGroup(const std::string& epUUID) {
@@ -5695,6 +6174,7 @@ void IntFlowManager::addContractRules(FlowEntryList& entryList,
 void
 IntFlowManager::handleContractUpdate(const opflex::modb::URI& contractURI) {
     LOG(DEBUG) << "Updating contract " << contractURI;
+    FlowArena::Scope arenaScope;
 
     const string& contractId = contractURI.toString();
     PolicyManager& polMgr = agent.getPolicyManager();
@@ -5788,6 +6268,7 @@ void IntFlowManager::initPlatformConfig() {
 void IntFlowManager::handleConfigUpdate(const opflex::modb::URI& configURI) {
     LOG(DEBUG) << "Updating platform config " << configURI;
     initPlatformConfig();
+    renderGeneration += 1;
 
     // Directly update the group-table
     updateGroupTable();
@@ -5838,6 +6319,7 @@ void IntFlowManager::handlePortStatusUpdate(const string& portName,
     LOG(DEBUG) << "Port-status update for " << portName;
     if (portName == encapIface) {
         initPlatformConfig();
+        renderGeneration += 1;
         createStaticFlows();
 
         PolicyManager::uri_set_t epgURIs;
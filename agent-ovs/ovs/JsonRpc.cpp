@@ -63,6 +63,12 @@ bool JsonRpc::createNetFlow(const string& brUuid, const string& target, const in
     tdSet = TupleDataSet(tuples);
     msg2.rowData.emplace("netflow", tdSet);
 
+    // replacing the reference drops any previous exporter in the
+    // same transaction
+    tuples.clear();
+    tdSet = TupleDataSet(tuples, "set");
+    msg2.rowData.emplace("ipfix", tdSet);
+
     const list<JsonRpcTransactMessage> requests = {msg1, msg2};
     if (!sendRequestAndAwaitResponse(requests)) {
         LOG(DEBUG) << "Error sending message";
@@ -102,6 +108,12 @@ bool JsonRpc::createIpfix(const string& brUuid, const string& target, const int&
     tdSet = TupleDataSet(tuples);
     msg2.rowData.emplace("ipfix", tdSet);
 
+    // replacing the reference drops any previous exporter in the
+    // same transaction
+    tuples.clear();
+    tdSet = TupleDataSet(tuples, "set");
+    msg2.rowData.emplace("netflow", tdSet);
+
     const list<JsonRpcTransactMessage> requests = {msg1, msg2};
     if (!sendRequestAndAwaitResponse(requests)) {
         LOG(DEBUG) << "Error sending message";
@@ -331,11 +343,26 @@ void JsonRpc::getPortUuid(const string& name, string& uuid) {
 }
 
 void JsonRpc::getPortUuids(map<string, string>& ports) {
-    for (auto& port : ports) {
-        string uuid;
-        getPortUuid(port.first, uuid);
-        if (!uuid.empty()) {
-            port.second = uuid;
+    // read all the port names in one select rather than making a
+    // round trip for each port
+    JsonRpcTransactMessage msg1(OvsdbOperation::SELECT, OvsdbTable::PORT);
+    msg1.columns.emplace("name");
+    msg1.columns.emplace("_uuid");
+
+    const list<JsonRpcTransactMessage> requests{msg1};
+    if (!sendRequestAndAwaitResponse(requests)) {
+        LOG(WARNING) << "Error sending message";
+        return;
+    }
+    unordered_map<string, string> portMap;
+    if (!getPortList(pResp->payload, portMap)) {
+        LOG(DEBUG) << "Unable to get port list";
+        return;
+    }
+    for (const auto& p : portMap) {
+        auto itr = ports.find(p.second);
+        if (itr != ports.end()) {
+            itr->second = p.first;
         }
     }
 }
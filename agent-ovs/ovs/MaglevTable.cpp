@@ -0,0 +1,98 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of MaglevTable class
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <algorithm>
+#include <cstdint>
+
+#include "MaglevTable.h"
+
+namespace opflexagent {
+
+/*
+ * Table sizes, roughly doubling.  The largest is the largest prime
+ * that fits in the 16-bit link count of a multipath action.
+ */
+static const size_t TABLE_SIZES[] = {
+    31, 61, 127, 251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521
+};
+
+/**
+ * Hash a backend name.  This must not change between releases, or
+ * restarting the agent would remap existing connections.
+ */
+static uint64_t hashName(const std::string& name, uint64_t seed) {
+    // FNV-1a followed by the splitmix64 finalizer
+    uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+    for (unsigned char c : name) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+size_t MaglevTable::getTableSize(size_t backends, size_t minSize) {
+    size_t want = std::max(backends * BUCKETS_PER_BACKEND, minSize);
+    for (size_t s : TABLE_SIZES) {
+        if (s >= want) return s;
+    }
+    return TABLE_SIZES[sizeof(TABLE_SIZES)/sizeof(TABLE_SIZES[0]) - 1];
+}
+
+void MaglevTable::populate(const std::vector<std::string>& backends,
+                           size_t size, std::vector<size_t>& table) {
+    table.clear();
+    if (backends.empty() || size == 0) return;
+
+    size_t n = backends.size();
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&backends](size_t a, size_t b) {
+                         return backends[a] < backends[b];
+                     });
+
+    if (size == 1) {
+        table.push_back(order[0]);
+        return;
+    }
+
+    // Each backend walks its own permutation of the buckets, given by
+    // offset and skip, and claims the next free bucket in turn
+    std::vector<uint64_t> offset(n), skip(n), next(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        offset[i] = hashName(backends[i], 0) % size;
+        skip[i] = hashName(backends[i], 1) % (size - 1) + 1;
+    }
+
+    const size_t EMPTY = static_cast<size_t>(-1);
+    table.assign(size, EMPTY);
+    size_t filled = 0;
+    while (true) {
+        for (size_t i : order) {
+            uint64_t c = (offset[i] + next[i] * skip[i]) % size;
+            while (table[c] != EMPTY) {
+                next[i] += 1;
+                c = (offset[i] + next[i] * skip[i]) % size;
+            }
+            table[c] = i;
+            next[i] += 1;
+            if (++filled == size)
+                return;
+        }
+    }
+}
+
+}   // namespace opflexagent
@@ -119,9 +119,8 @@ namespace opflexagent {
     }
 
     bool NetFlowRenderer::createNetFlow(const string &targets, int timeout) {
-        // ensure any previous netflow/ipfix destinations are removed first
-        jRpc->deleteNetFlow(switchName);
-        jRpc->deleteIpfix(switchName);
+        // any previous netflow/ipfix destinations are replaced by the
+        // same transaction
         string brUuid;
         jRpc->getBridgeUuid(switchName, brUuid);
         LOG(DEBUG) << "bridge uuid " << brUuid;
@@ -130,9 +129,8 @@ namespace opflexagent {
     }
 
     bool NetFlowRenderer::createIpfix(const string &targets, int sampling) {
-        // ensure any previous netflow/ipfix destinations are removed first
-        jRpc->deleteNetFlow(switchName);
-        jRpc->deleteIpfix(switchName);
+        // any previous netflow/ipfix destinations are replaced by the
+        // same transaction
         string brUuid;
         jRpc->getBridgeUuid(switchName, brUuid);
         LOG(DEBUG) << "bridge uuid " << brUuid << "sampling rate is " << sampling;
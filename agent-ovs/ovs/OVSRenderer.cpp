@@ -11,6 +11,9 @@
 
 #include "OVSRenderer.h"
 #include <opflexagent/logging.h>
+#ifdef HAVE_PROMETHEUS_SUPPORT
+#include <opflexagent/PrometheusManager.h>
+#endif
 
 #include <boost/asio/placeholders.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -32,6 +35,9 @@ using boost::asio::placeholders::error;
 
 static const std::string ID_NMSPC_CONNTRACK("conntrack");
 static const boost::posix_time::milliseconds CLEANUP_INTERVAL(3*60*1000);
+#ifdef HAVE_PROMETHEUS_SUPPORT
+static const boost::posix_time::milliseconds STATS_INTERVAL(10*1000);
+#endif
 
 #define PACKET_LOGGER_PIDDIR LOCALSTATEDIR"/lib/opflex-agent-ovs/pids"
 #define LOOPBACK "127.0.0.1"
@@ -74,10 +80,16 @@ OVSRenderer::OVSRenderer(Agent& agent_)
       endpointAdvMode(AdvertManager::EPADV_GRATUITOUS_BROADCAST),
       tunnelEndpointAdvMode(AdvertManager::EPADV_RARP_BROADCAST),
       tunnelEndpointAdvIntvl(300),
+      endpointAdvRate(1000), endpointAdvBurst(64), updateDebounce(0),
       virtualDHCP(true), connTrack(true), ctZoneRangeStart(0),
-      ctZoneRangeEnd(0), ovsdbUseLocalTcpPort(false), ifaceStatsEnabled(true), ifaceStatsInterval(0),
+      ctZoneRangeEnd(0), serviceLbMode(IntFlowManager::SVC_LB_HASH),
+      ovsdbUseLocalTcpPort(false), ifaceStatsEnabled(true),
+      ifaceStatsInterval(0),
       contractStatsEnabled(true), contractStatsInterval(0),
-      serviceStatsFlowDisabled(false), serviceStatsEnabled(true), serviceStatsInterval(0),
+      serviceStatsFlowDisabled(false),
+      podSvcStatsMode(IntFlowManager::POD_SVC_STATS_PAIR),
+      podSvcStatsSamplePercent(100),
+      serviceStatsEnabled(true), serviceStatsInterval(0),
       secGroupStatsEnabled(true), secGroupStatsInterval(0),
       tableDropStatsEnabled(true), tableDropStatsInterval(0),
       spanRenderer(agent_), netflowRenderer(agent_), started(false),
@@ -135,6 +147,10 @@ void OVSRenderer::start() {
     intFlowManager.setEncapIface(encapIface);
     intFlowManager.setUplinkIface(uplinkNativeIface);
     intFlowManager.setFloodScope(IntFlowManager::ENDPOINT_GROUP);
+    intFlowManager.setServiceLbMode(serviceLbMode);
+    intFlowManager.setPodSvcStatsMode(podSvcStatsMode,
+                                      podSvcStatsSamplePercent);
+    intFlowManager.setTaskDebounce(std::chrono::milliseconds(updateDebounce));
     if (encapType == IntFlowManager::ENCAP_VXLAN ||
         encapType == IntFlowManager::ENCAP_IVXLAN) {
         assert(tunnelRemotePort != 0);
@@ -144,7 +160,7 @@ void OVSRenderer::start() {
     intFlowManager.setVirtualDHCP(virtualDHCP, virtualDHCPMac);
     intFlowManager.setMulticastGroupFile(mcastGroupFile);
     intFlowManager.setEndpointAdv(endpointAdvMode, tunnelEndpointAdvMode,
-            tunnelEndpointAdvIntvl);
+            tunnelEndpointAdvIntvl, endpointAdvRate, endpointAdvBurst);
     if(!dropLogIntIface.empty()) {
         intFlowManager.setDropLog(dropLogIntIface, dropLogRemoteIp,
                 dropLogRemotePort);
@@ -235,6 +251,12 @@ void OVSRenderer::start() {
     cleanupTimer->expires_from_now(CLEANUP_INTERVAL);
     cleanupTimer->async_wait(bind(&OVSRenderer::onCleanupTimer,
                                   this, error));
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    statsTimer.reset(new deadline_timer(getAgent().getAgentIOService()));
+    statsTimer->expires_from_now(STATS_INTERVAL);
+    statsTimer->async_wait(bind(&OVSRenderer::onStatsTimer,
+                                this, error));
+#endif
 
     ovsdbConnection.reset(new OvsdbConnection(ovsdbUseLocalTcpPort));
     ovsdbConnection->start();
@@ -253,6 +275,11 @@ void OVSRenderer::stop() {
     if (cleanupTimer) {
         cleanupTimer->cancel();
     }
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    if (statsTimer) {
+        statsTimer->cancel();
+    }
+#endif
 
     if (ifaceStatsEnabled)
         interfaceStatsManager.stop();
@@ -269,6 +296,7 @@ void OVSRenderer::stop() {
 
     intFlowManager.stop();
     accessFlowManager.stop();
+    ctZoneManager.stop();
 
     intSwitchManager.stop();
     accessSwitchManager.stop();
@@ -340,6 +368,11 @@ void OVSRenderer::setProperties(const ptree& properties) {
                                "endpoint-advertisements.tunnel-endpoint-mode");
     static const std::string ENDPOINT_TNL_ADV_INTVL("forwarding."
                                    "endpoint-advertisements.tunnel-endpoint-interval");
+    static const std::string ENDPOINT_ADV_RATE("forwarding."
+                                               "endpoint-advertisements.rate");
+    static const std::string ENDPOINT_ADV_BURST("forwarding."
+                                                "endpoint-advertisements.burst");
+    static const std::string UPDATE_DEBOUNCE("forwarding.update-debounce");
 
     static const std::string FLOWID_CACHE_DIR("flowid-cache-dir");
     static const std::string MCAST_GROUP_FILE("mcast-group-file");
@@ -352,6 +385,8 @@ void OVSRenderer::setProperties(const ptree& properties) {
     static const std::string CONN_TRACK_RANGE_END("forwarding."
                                                   "connection-tracking."
                                                   "zone-range.end");
+    static const std::string SERVICE_LB_MODE("forwarding."
+                                             "service-load-balancing.mode");
 
     static const std::string STATS_INTERFACE_ENABLED("statistics"
                                                      ".interface.enabled");
@@ -363,6 +398,12 @@ void OVSRenderer::setProperties(const ptree& properties) {
                                                     ".contract.interval");
     static const std::string STATS_SERVICE_FLOWDISABLED("statistics"
                                                         ".service.flow-disabled");
+    static const std::string STATS_SERVICE_PODSVC_MODE("statistics"
+                                                       ".service.pod-svc"
+                                                       ".mode");
+    static const std::string STATS_SERVICE_PODSVC_SAMPLE("statistics"
+                                                         ".service.pod-svc"
+                                                         ".sample-percent");
     static const std::string STATS_SERVICE_ENABLED("statistics"
                                                   ".service.enabled");
     static const std::string STATS_SERVICE_INTERVAL("statistics"
@@ -473,11 +514,26 @@ void OVSRenderer::setProperties(const ptree& properties) {
     tunnelEndpointAdvIntvl =
         properties.get<uint64_t>(ENDPOINT_TNL_ADV_INTVL,
                                     300);
+    endpointAdvRate = properties.get<uint32_t>(ENDPOINT_ADV_RATE, 1000);
+    endpointAdvBurst = properties.get<uint32_t>(ENDPOINT_ADV_BURST, 64);
+    updateDebounce = properties.get<uint32_t>(UPDATE_DEBOUNCE, 0);
 
     connTrack = properties.get<bool>(CONN_TRACK, true);
     ctZoneRangeStart = properties.get<uint16_t>(CONN_TRACK_RANGE_START, 1);
     ctZoneRangeEnd = properties.get<uint16_t>(CONN_TRACK_RANGE_END, 65534);
 
+    std::string svcLbStr =
+        properties.get<std::string>(SERVICE_LB_MODE, "hash");
+    if (svcLbStr == "maglev") {
+        serviceLbMode = IntFlowManager::SVC_LB_MAGLEV;
+    } else {
+        if (svcLbStr != "hash") {
+            LOG(ERROR) << "Invalid service load balancing mode "
+                       << svcLbStr << ", using hash";
+        }
+        serviceLbMode = IntFlowManager::SVC_LB_HASH;
+    }
+
     flowIdCache = properties.get<std::string>(FLOWID_CACHE_DIR,
                                               DEF_FLOWID_CACHEDIR);
 
@@ -489,6 +545,25 @@ void OVSRenderer::setProperties(const ptree& properties) {
     ifaceStatsEnabled = properties.get<bool>(STATS_INTERFACE_ENABLED, true);
     contractStatsEnabled = properties.get<bool>(STATS_CONTRACT_ENABLED, true);
     serviceStatsFlowDisabled = properties.get<bool>(STATS_SERVICE_FLOWDISABLED, false);
+    std::string podSvcStatsStr =
+        properties.get<std::string>(STATS_SERVICE_PODSVC_MODE, "pair");
+    if (podSvcStatsStr == "service") {
+        podSvcStatsMode = IntFlowManager::POD_SVC_STATS_SERVICE;
+    } else if (podSvcStatsStr == "pod") {
+        podSvcStatsMode = IntFlowManager::POD_SVC_STATS_POD;
+    } else {
+        podSvcStatsMode = IntFlowManager::POD_SVC_STATS_PAIR;
+    }
+    podSvcStatsSamplePercent =
+        properties.get<uint32_t>(STATS_SERVICE_PODSVC_SAMPLE, 100);
+    if (podSvcStatsSamplePercent < 100 &&
+        podSvcStatsMode != IntFlowManager::POD_SVC_STATS_PAIR) {
+        // an aggregate over a sample of its pairs would undercount
+        LOG(ERROR) << "Pod to service stats sampling is only supported "
+                   << "in pair mode, counting all pairs in "
+                   << podSvcStatsStr << " mode";
+        podSvcStatsSamplePercent = 100;
+    }
     serviceStatsEnabled = properties.get<bool>(STATS_SERVICE_ENABLED, true);
     secGroupStatsEnabled = properties.get<bool>(STATS_SECGROUP_ENABLED, true);
     ifaceStatsInterval = properties.get<long>(STATS_INTERFACE_INTERVAL, 30000);
@@ -551,6 +626,33 @@ void OVSRenderer::onCleanupTimer(const boost::system::error_code& ec) {
     }
 }
 
+#ifdef HAVE_PROMETHEUS_SUPPORT
+void OVSRenderer::onStatsTimer(const boost::system::error_code& ec) {
+    if (ec) return;
+
+    PrometheusManager& prometheusManager = getAgent().getPrometheusManager();
+    prometheusManager.
+        addNUpdateCtZoneStats(ctZoneManager.getFlushQueueDepth(),
+                              ctZoneManager.getFlushedZones(),
+                              ctZoneManager.getFlushedEntries(),
+                              ctZoneManager.getLastFlushDuration());
+    prometheusManager.
+        addNUpdateEpgRenderStats(intFlowManager.getEpgRenderFanouts(),
+                                 intFlowManager.getEpgRenderSkipped());
+
+    std::unordered_map<std::string, TaskQueue::TaskStats> taskStats;
+    intFlowManager.getTaskStats(taskStats);
+    for (const auto& kv : taskStats)
+        prometheusManager.addNUpdateTaskQueueStats(kv.first, kv.second);
+
+    if (started) {
+        statsTimer->expires_from_now(STATS_INTERVAL);
+        statsTimer->async_wait(bind(&OVSRenderer::onStatsTimer,
+                                    this, error));
+    }
+}
+#endif
+
 void OVSRenderer::startPacketLogger() {
     if(dropLogIntIface.empty() && dropLogAccessIface.empty()) {
         LOG(DEBUG) << "DropLog interfaces not configured";
@@ -10,8 +10,9 @@
  */
 #include "PacketDecoderLayers.h"
 #include <boost/asio/ip/address.hpp>
-#include <opflex/modb/MAC.h>
 #include <opflexagent/logging.h>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 namespace opflexagent {
@@ -71,82 +72,238 @@ bool PacketTuple::serialize(Writer<StringBuffer> &writer) {
     return true;
 }
 
+void PacketTuple::addField(const std::string &name,
+                           const std::string &value) {
+    unsigned index = fields.size();
+    fields.insert(std::make_pair(index, std::make_pair(name, value)));
+}
+
+std::string PacketTuple::formatTimeStamp(time_t ts) {
+    struct tm tmBuf;
+    char currTime[256];
+    std::strftime(currTime, sizeof(currTime), "%a %b %d %H:%M:%S %Z %Y",
+                  localtime_r(&ts, &tmBuf));
+    return currTime;
+}
+
 bool operator== (const PacketTuple &lhs, const PacketTuple &rhs) {
     if (lhs.fields.size() != rhs.fields.size())
         return false;
     return  (lhs.fields == rhs.fields);
 }
 
-void PacketDecoderLayerField::transformLog(uint32_t value, stringstream &ostr, ParseInfo &p) {
-    if(!shouldLog()){
-        return;
+void PacketLayerFormat::parse(const std::string &fmt) {
+    segments.clear();
+    std::string literal;
+    std::size_t i = 0;
+    while (i < fmt.size()) {
+        if (fmt[i] != '%') {
+            literal += fmt[i++];
+            continue;
+        }
+        if (i + 1 < fmt.size() && fmt[i+1] == '%') {
+            literal += '%';
+            i += 2;
+            continue;
+        }
+        std::size_t end = fmt.find('%', i + 1);
+        if (end == std::string::npos) {
+            literal += fmt.substr(i);
+            break;
+        }
+        int arg = atoi(fmt.substr(i + 1, end - i - 1).c_str());
+        segments.push_back(make_pair(literal, arg - 1));
+        literal.clear();
+        i = end + 1;
     }
-    //Convert key types to layer names
-    if(getIsNextKey()) {
-        string layerName;
-        if(p.pktDecoder &&
-           p.pktDecoder->getLayerNameByTypeKey(
-               p.nextLayerTypeId, p.nextKey, layerName)) {
-            ostr << layerName;
-        } else {
-            ostr << value << "(unrecognized)";
+    if (!literal.empty()) {
+        segments.push_back(make_pair(literal, -1));
+    }
+}
+
+void PacketLayerFormat::render(const std::string *args, unsigned numArgs,
+                               std::string &out) const {
+    for (auto &seg : segments) {
+        out += seg.first;
+        if (seg.second >= 0 && (unsigned)seg.second < numArgs) {
+            out += args[seg.second];
         }
+    }
+}
+
+void ParseInfo::endLayer(const PacketDecoderLayer *layer,
+                         const PacketDecoderLayerVariant *variant) {
+    if (numValues == layerStart && layer->getNumOutArgs() == 0) {
         return;
     }
-    //Print fieldnames for bits
-    if(bitLength == 1) {
-        if(value ==1) {
-            ostr << fieldName << " ";
+    if (numLayers >= MAX_LAYERS) {
+        abortLayer();
+        return;
+    }
+    DecodedLayer &l = layers[numLayers++];
+    l.layer = layer;
+    l.variant = variant;
+    l.firstValue = layerStart;
+    l.numValues = numValues - layerStart;
+}
+
+std::string ParseInfo::getParsedString() const {
+    std::string out;
+    std::string args[MAX_ARGS];
+    for (unsigned i = 0; i < numLayers; i++) {
+        const DecodedLayer &l = layers[i];
+        unsigned numArgs = std::min<unsigned>(l.layer->getNumOutArgs(),
+                                              MAX_ARGS);
+        for (unsigned j = 0; j < numArgs; j++) {
+            args[j].clear();
+        }
+        for (unsigned j = l.firstValue; j < l.firstValue + l.numValues; j++) {
+            const PacketFieldValue &v = values[j];
+            unsigned arg = v.field->getOutSeq() - 1;
+            if (arg < numArgs) {
+                v.field->render(v, pktDecoder, args[arg]);
+            }
         }
+        const PacketLayerFormat &fmt =
+            l.variant ? l.variant->getFormat() : l.layer->getFormat();
+        fmt.render(args, numArgs, out);
+    }
+    return out;
+}
+
+void ParseInfo::getPacketTuple(PacketTuple &packetTuple) const {
+    packetTuple.TimeStamp = PacketTuple::formatTimeStamp(timeStamp);
+    for (int i = 0; i < TUPLE_FIELDS; i++) {
+        if (!tuple[i].field) {
+            continue;
+        }
+        std::string value;
+        tuple[i].field->render(tuple[i], pktDecoder, value);
+        packetTuple.setField((unsigned)i, value);
+    }
+}
+
+void PacketDecoderLayerField::computeExtraction() {
+    byteOffset = bitOffset/8;
+    if (bitLength == 0) {
+        byteCount = shift = mask = 0;
         return;
     }
-    //Check for a string representation
-    auto it = kvOutMap.find(value);
-    if(it != kvOutMap.end()) {
-        ostr << it->second;
-    } else {
-        ostr << value;
+    uint32_t lastByte = (bitOffset + bitLength - 1)/8;
+    byteCount = lastByte - byteOffset + 1;
+    shift = (lastByte + 1)*8 - (bitOffset + bitLength);
+    mask = (bitLength >= 32) ? 0xffffffff : ((1u << bitLength) - 1);
+}
+
+uint32_t PacketDecoderLayerField::extract(const unsigned char *buf) const {
+    uint64_t value = 0;
+    const unsigned char *data_ptr = buf + byteOffset;
+    for (uint32_t i = 0; i < byteCount; i++) {
+        value = (value << 8) | data_ptr[i];
     }
+    return (uint32_t)(value >> shift) & mask;
 }
 
-int PacketDecoderLayerField::decode(const unsigned char *buf, std::size_t length, ParseInfo &p) {
-    stringstream ostr;
-    int err = 0;
-    unsigned char *data_ptr = const_cast<unsigned char *>(buf) + (bitOffset/8);
+void PacketDecoderLayerField::render(const PacketFieldValue &v,
+                                     PacketDecoder *decoder,
+                                     std::string &out) const {
+    char buf[64];
     switch(fieldType) {
         case FLDTYPE_BITFIELD:
+        case FLDTYPE_BYTES:
+        case FLDTYPE_OPTBYTES:
         {
-            uint32_t value = 0;
-            unsigned char *ptr = (unsigned char *)&value;
-            uint32_t valBytes = 0;
-            uint32_t remBits = 0;
-            if(bitLength > 8-(bitOffset%8)) {
-                remBits = (bitLength-8+(bitOffset%8));
-                valBytes += (remBits)/8;
-                if(remBits%8) {
-                    valBytes++;
+            if(v.length != 0) {
+                for (uint32_t i=0; i < v.length; i++) {
+                    snprintf(buf, sizeof(buf), "%x", v.bytes[i]);
+                    out += buf;
                 }
-            } else {
-                remBits = 8-bitLength-(bitOffset%8);
+                break;
+            }
+            //Convert key types to layer names
+            if(isNextKey) {
+                string layerName;
+                if(decoder &&
+                   decoder->getLayerNameByTypeKey(
+                       v.nextLayerTypeId, v.value, layerName)) {
+                    out += layerName;
+                } else {
+                    out += std::to_string(v.value);
+                    out += "(unrecognized)";
+                }
+                break;
             }
-            unsigned char maskLow = ((1<<(8-(bitOffset%8)))-1);
-            ptr[3-valBytes] = *data_ptr & maskLow;
-            for( uint32_t i=1; i < valBytes; i++) {
-                data_ptr++;
-                ptr[3-valBytes+i] = *data_ptr;
+            //Print fieldnames for bits
+            if(bitLength == 1) {
+                if(v.value == 1) {
+                    out += fieldName;
+                    out += " ";
+                }
+                break;
             }
-            ptr[3] &= ~((1<<(remBits%8)) -1);
-            value = ntohl(value);
-            if(remBits) {
-                value = value >> remBits;
+            //Check for a string representation
+            auto it = kvOutMap.find(v.value);
+            if(it != kvOutMap.end()) {
+                out += it->second;
+            } else {
+                out += std::to_string(v.value);
             }
-            transformLog(value, ostr, p);
+            break;
+        }
+        case FLDTYPE_IPv4ADDR:
+        {
+            snprintf(buf, sizeof(buf), "%u.%u.%u.%u",
+                     v.bytes[0], v.bytes[1], v.bytes[2], v.bytes[3]);
+            out += buf;
+            break;
+        }
+        case FLDTYPE_IPv6ADDR:
+        {
+            boost::asio::ip::address_v6::bytes_type bytes;
+            memcpy(bytes.data(), v.bytes, bytes.size());
+            out += boost::asio::ip::address_v6(bytes).to_string();
+            break;
+        }
+        case FLDTYPE_MAC:
+        {
+            snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x",
+                     v.bytes[0], v.bytes[1], v.bytes[2],
+                     v.bytes[3], v.bytes[4], v.bytes[5]);
+            out += buf;
+            break;
+        }
+        case FLDTYPE_VARBYTES:
+        {
+            for (uint32_t i=0; i < v.length; i++) {
+                snprintf(buf, sizeof(buf), "%x ", v.bytes[i]);
+                out += buf;
+            }
+            break;
+        }
+        default:
+        case FLDTYPE_NONE:
+        {
+            break;
+        }
+    }
+}
+
+int PacketDecoderLayerField::decode(const unsigned char *buf, std::size_t length, ParseInfo &p) {
+    int err = 0;
+    const unsigned char *data_ptr = buf + byteOffset;
+    PacketFieldValue v;
+    memset(&v, 0, sizeof(v));
+    v.field = this;
+    switch(fieldType) {
+        case FLDTYPE_BITFIELD:
+        {
+            v.value = extract(buf);
             if(getIsLength()) {
-                p.inferredLength = value;
+                p.inferredLength = v.value;
             }
             int scratchOffset;
             if(shouldSave(scratchOffset)) {
-                p.scratchpad[scratchOffset] = value;
+                p.scratchpad[scratchOffset] = v.value;
             }
             break;
         }
@@ -159,104 +316,62 @@ int PacketDecoderLayerField::decode(const unsigned char *buf, std::size_t length
                     if(getIsLength()) {
                         p.inferredLength = 0;
                     }
-                    break;
+                    return err;
                 }
             }
             if (byteLen <= 4) {
-                uint32_t value = 0;
-                unsigned char *ptr = (unsigned char *)&value;
-                for(uint8_t i=0; i<byteLen; i++) {
-                    ptr[4-byteLen+i] = *data_ptr;
-                    data_ptr++;
-                }
-                value = ntohl(value);
+                v.value = extract(buf);
                 if(getIsLength()) {
-                    p.inferredLength = value;
+                    p.inferredLength = v.value;
                 }
                 if(getIsNextKey()) {
-                    p.nextKey = value;
+                    p.nextKey = v.value;
+                    v.nextLayerTypeId = p.nextLayerTypeId;
                 }
-                transformLog(value, ostr, p);
                 if(shouldSave(scratchOffset)) {
-                    p.scratchpad[scratchOffset] = value;
+                    p.scratchpad[scratchOffset] = v.value;
                 }
                 if(isMetaField()) {
-                    p.meta[metaSeq-1] = value;
+                    p.meta[metaSeq-1] = v.value;
                 }
             } else if(byteLen <= 8) {
-                uint64_t value = 0;
-                unsigned char *ptr = (unsigned char *)&value;
-                memcpy(ptr, data_ptr, byteLen);
-                if(shouldLog()) {
-                    for (uint8_t i=0; i<byteLen; i++) {
-                        ostr << hex << *ptr;
-                        ptr++;
-                    }
-                }
+                memcpy(v.bytes, data_ptr, byteLen);
+                v.length = byteLen;
             }
             break;
         }
         case FLDTYPE_IPv4ADDR:
         {
-            uint32_t value = 0;
-            unsigned char *ptr = (unsigned char *)&value;
-            for(int i=0; i<=3; i++) {
-                ptr[i] = *data_ptr;
-                data_ptr++;
-            }
-            value = htonl(value);
-            boost::asio::ip::address_v4 addr(value);
-            if(shouldLog()) {
-                ostr << addr;
-            }
+            memcpy(v.bytes, data_ptr, 4);
             break;
         }
         case FLDTYPE_IPv6ADDR:
         {
-            boost::asio::ip::address_v6::bytes_type bytes;
-            for(int i=0; i<16 ; i++) {
-                bytes[i] = *data_ptr;
-                data_ptr++;
-            }
-            boost::asio::ip::address_v6 addr(bytes);
-            if(shouldLog()) {
-                ostr << addr;
-            }
+            memcpy(v.bytes, data_ptr, 16);
             break;
         }
         case FLDTYPE_MAC:
-        {   uint8_t mac_bytes[6];
-            memcpy(mac_bytes,data_ptr,6);
-            opflex::modb::MAC mac(mac_bytes);
-            if(shouldLog()) {
-                ostr << mac;
-            }
+        {
+            memcpy(v.bytes, data_ptr, 6);
             break;
         }
         case FLDTYPE_VARBYTES:
         {
             //Atleast with Geneve header which is TLV based,
             //option length cannot exceed 128 bytes
-            unsigned char bytes[124];
             uint32_t var_length=0;
             var_length = p.inferredDataLength;
             if(var_length > (length - bitOffset/8)) {
                 err = -1;
                 return err;
             }
-            memcpy(bytes,data_ptr,var_length);
-            if(shouldLog()) {
-                for(uint32_t i=0; i < var_length; i++) {
-                    ostr << hex << bytes[i] << " ";
-                }
-            }
+            v.length = std::min<uint32_t>(var_length, sizeof(v.bytes));
+            memcpy(v.bytes, data_ptr, v.length);
             if(shouldSave(scratchOffset) && (var_length <= 4)) {
                 uint32_t value = 0;
-                unsigned char *ptr = (unsigned char *)&value;
-                for(uint8_t i=0; i<var_length; i++) {
-                    ptr[4-var_length+i] = bytes[i];
+                for(uint32_t i=0; i<var_length; i++) {
+                    value = (value << 8) | data_ptr[i];
                 }
-                value = ntohl(value);
                 p.scratchpad[scratchOffset] = value;
             }
             p.inferredDataLength = 0;
@@ -265,15 +380,11 @@ int PacketDecoderLayerField::decode(const unsigned char *buf, std::size_t length
         default:
         case FLDTYPE_NONE:
         {
-            break;
+            return err;
         }
     }
-    if(shouldLog()) {
-        p.formattedFields[outSeq-1] += ostr.str();
-    }
-    if(isTupleField()) {
-        std::string tupleStr = ostr.str();
-        p.packetTuple.setField((unsigned)(tupleSeq-1), tupleStr);
+    if(shouldLog() || isTupleField()) {
+        p.recordValue(v, shouldLog(), tupleSeq);
     }
     return err;
 }
@@ -284,8 +395,7 @@ int PacketDecoderLayer::decode(const unsigned char *buf, std::size_t length, Par
         LOG(ERROR) << "Remaining length is less than header length";
         return -1;
     }
-    p.formattedFields.clear();
-    p.formattedFields.resize(numOutArgs);
+    p.beginLayer();
     if(!isOptionLayer()) {
         p.nextLayerTypeId = getNextTypeId();
     }
@@ -297,6 +407,7 @@ int PacketDecoderLayer::decode(const unsigned char *buf, std::size_t length, Par
         }
         err = fld.decode(buf, length, p);
         if(err) {
+            p.abortLayer();
             return err;
         }
         //We have read the length field of the option header.
@@ -308,6 +419,7 @@ int PacketDecoderLayer::decode(const unsigned char *buf, std::size_t length, Par
         }
         if((byteLength==0) && (p.inferredLength > length)) {
             LOG(ERROR) << "Incorrect option header length";
+            p.abortLayer();
             return -1;
         }
     }
@@ -329,22 +441,11 @@ int PacketDecoderLayer::decode(const unsigned char *buf, std::size_t length, Par
         }
     }
 
-    boost::format fmtStr;
     auto sptr = getVariant(p);
     if(sptr) {
         sptr->reParse(p);
-        sptr->getFormatString(fmtStr);
-    } else {
-        getFormatString(fmtStr);
-    }
-    for(unsigned i=1; i<=numOutArgs; i++) {
-        fmtStr%p.formattedFields[i-1];
-    }
-    try {
-        p.parsedString += fmtStr.str();
-    } catch(boost::io::too_few_args& exc) {
-        LOG(ERROR)<< exc.what();
     }
+    p.endLayer(this, sptr.get());
 
     return err;
 }
@@ -353,6 +454,7 @@ void PacketDecoder::registerLayer(shared_ptr<PacketDecoderLayerVariant>& decoder
     if(!decoderLayer) {
         return;
     }
+    decoderLayer->initFormat();
     variantLayerIdMap.insert(make_pair(decoderLayer->getId(),decoderLayer));
     auto baseLayer = getLayerById(decoderLayer->getTypeId());
     if(baseLayer) {
@@ -366,6 +468,7 @@ void PacketDecoder::registerLayer(shared_ptr<PacketDecoderLayer>& decoderLayer)
     if(!decoderLayer) {
         return;
     }
+    decoderLayer->initFormat();
     layerTypeMap.insert(make_pair(decoderLayer->getTypeName(),decoderLayer->getTypeId()));
     layerNameMap.insert(make_pair(decoderLayer->getName(),decoderLayer->getId()));
     if(decoderLayer->getNextTypeId() != 0) {
@@ -21,9 +21,9 @@ int EthernetLayer::configure() {
     return 0;
 }
 
-void EthernetLayer::getFormatString(boost::format &fmtStr) {
+const char *EthernetLayer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format(" MAC=%1%:%2%:%3%");
+    return " MAC=%1%:%2%:%3%";
 }
 
 int QtagLayer::configure() {
@@ -34,9 +34,9 @@ int QtagLayer::configure() {
     return 0;
 }
 
-void QtagLayer::getFormatString(boost::format &fmtStr) {
+const char *QtagLayer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format(" QTAG=%1%");
+    return " QTAG=%1%";
 }
 
 int IPv4Layer::configure() {
@@ -60,9 +60,9 @@ void IPv4Layer::getOptionLength(ParseInfo &p) {
     p.pendingOptionLength = ((p.scratchpad[0]*4) - byteLength);
 }
 
-void IPv4Layer::getFormatString(boost::format &fmtStr) {
+const char *IPv4Layer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format(" SRC=%1% DST=%2% LEN=%3% DSCP=%4% TTL=%5% ID=%6% FLAGS=%7% FRAG=%8% PROTO=%9%");
+    return " SRC=%1% DST=%2% LEN=%3% DSCP=%4% TTL=%5% ID=%6% FLAGS=%7% FRAG=%8% PROTO=%9%";
 }
 
 int GeneveLayer::configure() {
@@ -81,9 +81,9 @@ void GeneveLayer::getOptionLength(ParseInfo &p) {
     p.pendingOptionLength = p.scratchpad[0]*4;
 }
 
-void GeneveLayer::getFormatString(boost::format &fmtStr) {
+const char *GeneveLayer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format("");
+    return "";
 }
 
 int GeneveOptLayer::configure() {
@@ -107,9 +107,9 @@ uint32_t GeneveOptLayer::getVariableHeaderLength(uint32_t fldVal) {
     return (fldVal*4 + 4);
 }
 
-void GeneveOptLayer::getFormatString(boost::format &fmtStr) {
+const char *GeneveOptLayer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format("");
+    return "";
 }
 
 std::shared_ptr<PacketDecoderLayerVariant>
@@ -130,9 +130,9 @@ int GeneveOptTableIdLayerVariant::configure() {
     return 0;
 }
 
-void GeneveOptTableIdLayerVariant::getFormatString(boost::format &fmtStr) {
+const char *GeneveOptTableIdLayerVariant::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format("");
+    return "";
 }
 
 void GeneveOptTableIdLayerVariant::reParse(ParseInfo &p) {
@@ -152,9 +152,9 @@ int ARPLayer::configure() {
     return 0;
 }
 
-void ARPLayer::getFormatString(boost::format &fmtStr) {
+const char *ARPLayer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format(" ARP_SPA=%1% ARP_TPA=%2% ARP_OP=%3%");
+    return " ARP_SPA=%1% ARP_TPA=%2% ARP_OP=%3%";
 }
 
 int ICMPLayer::configure() {
@@ -166,9 +166,9 @@ int ICMPLayer::configure() {
     return 0;
 }
 
-void ICMPLayer::getFormatString(boost::format &fmtStr) {
+const char *ICMPLayer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format(" TYPE=%1% CODE=%2% ID=%3% SEQ=%4%");
+    return " TYPE=%1% CODE=%2% ID=%3% SEQ=%4%";
 }
 
 int TCPLayer::configure() {
@@ -197,9 +197,9 @@ void TCPLayer::getOptionLength(ParseInfo &p) {
     p.pendingOptionLength = p.scratchpad[0]*4 - byteLength;
 }
 
-void TCPLayer::getFormatString(boost::format &fmtStr) {
+const char *TCPLayer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format(" SPT=%1% DPT=%2% SEQ=%3% ACK=%4% LEN=%5% WINDOWS=%7% %6% URGP=%8%");
+    return " SPT=%1% DPT=%2% SEQ=%3% ACK=%4% LEN=%5% WINDOWS=%7% %6% URGP=%8%";
 }
 
 int TCPOptLayer::configure() {
@@ -221,9 +221,9 @@ bool TCPOptLayer::hasOptBytes(ParseInfo &p) {
     return ((p.scratchpad[1] != 0) && (p.scratchpad[1] != 1));
 }
 
-void TCPOptLayer::getFormatString(boost::format &fmtStr) {
+const char *TCPOptLayer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format("");
+    return "";
 }
 
 int UDPLayer::configure() {
@@ -234,9 +234,9 @@ int UDPLayer::configure() {
     return 0;
 }
 
-void UDPLayer::getFormatString(boost::format &fmtStr) {
+const char *UDPLayer::getFormatString() {
     //Format string to print the layer goes here
-    fmtStr = boost::format(" SPT=%1% DPT=%2% LEN=%3%");
+    return " SPT=%1% DPT=%2% LEN=%3%";
 }
 
 int IPv6Layer::configure() {
@@ -251,9 +251,9 @@ int IPv6Layer::configure() {
     return 0;
 }
 
-void IPv6Layer::getFormatString(boost::format &fmtStr) {
-//Format string to print the layer goes here
-    fmtStr = boost::format(" SRC=%1% DST=%2% LEN=%3% TC=%4% HL=%5% FL=%6% PROTO=%7%");
+const char *IPv6Layer::getFormatString() {
+    //Format string to print the layer goes here
+    return " SRC=%1% DST=%2% LEN=%3% TC=%4% HL=%5% FL=%6% PROTO=%7%";
 }
 
 }
@@ -70,6 +70,7 @@ void PacketInHandler::setPortMapper(PortMapper* intMapper,
 }
 
 void PacketInHandler::start() {
+    agent.getEndpointManager().registerListener(this);
     if (intSwConnection)
         intSwConnection->RegisterMessageHandler(OFPTYPE_PACKET_IN, this);
 }
@@ -77,6 +78,65 @@ void PacketInHandler::start() {
 void PacketInHandler::stop() {
     if (intSwConnection)
         intSwConnection->UnregisterMessageHandler(OFPTYPE_PACKET_IN, this);
+    agent.getEndpointManager().unregisterListener(this);
+    dhcpReplyCache.clear();
+}
+
+void PacketInHandler::endpointUpdated(const std::string& uuid) {
+    dhcpReplyCache.invalidate(uuid);
+}
+
+OfpBuf DhcpReplyCache::get(const shared_ptr<const Endpoint>& ep,
+                           const string& key,
+                           const compose_t& compose) {
+    uint64_t gen;
+    {
+        std::lock_guard<std::mutex> guard(cacheMutex);
+        auto it = cache.find(ep->getUUID());
+        if (it != cache.end() && it->second.ep == ep) {
+            auto rit = it->second.replies.find(key);
+            if (rit != it->second.replies.end())
+                return OfpBuf(ofpbuf_clone(rit->second.get()));
+        }
+        gen = generation;
+    }
+
+    OfpBuf reply(compose());
+    if (!reply.get()) return reply;
+
+    std::lock_guard<std::mutex> guard(cacheMutex);
+    // the endpoint may have been updated or removed while composing
+    if (gen != generation) return reply;
+
+    CacheEntry& entry = cache[ep->getUUID()];
+    if (entry.ep != ep) {
+        entry.ep = ep;
+        entry.replies.clear();
+    } else if (entry.replies.size() >= MAX_REPLIES_PER_EP) {
+        entry.replies.clear();
+    }
+    entry.replies.emplace(key, OfpBuf(ofpbuf_clone(reply.get())));
+    return reply;
+}
+
+void DhcpReplyCache::invalidate(const std::string& uuid) {
+    std::lock_guard<std::mutex> guard(cacheMutex);
+    generation += 1;
+    cache.erase(uuid);
+}
+
+void DhcpReplyCache::clear() {
+    std::lock_guard<std::mutex> guard(cacheMutex);
+    generation += 1;
+    cache.clear();
+}
+
+size_t DhcpReplyCache::size() {
+    std::lock_guard<std::mutex> guard(cacheMutex);
+    size_t count = 0;
+    for (auto& entry : cache)
+        count += entry.second.replies.size();
+    return count;
 }
 
 typedef std::function<void (ActionBuilder&)> output_act_t;
@@ -304,6 +364,7 @@ static void handleNDPktIn(Agent& agent,
 
 static void handleDHCPv4PktIn(Agent& agent,
                               IntFlowManager& intFlowManager,
+                              DhcpReplyCache& replyCache,
                               PortMapper* intPortMapper,
                               PortMapper* accPortMapper,
                               SwitchConnection* intConn,
@@ -410,19 +471,26 @@ static void handleDHCPv4PktIn(Agent& agent,
         memcpy(serverMac, intFlowManager.getDHCPMacAddr(), sizeof(serverMac));
     }
 
-    OfpBuf b(packets::compose_dhcpv4_reply(reply_type,
-                                           dhcp_pkt->xid,
-                                           serverMac,
-                                           flow.dl_src.ea,
-                                           dhcpIp.to_ulong(),
-                                           prefixLen,
-                                           v4c.get().getServerIp(),
-                                           v4c.get().getRouters(),
-                                           v4c.get().getDnsServers(),
-                                           v4c.get().getDomain(),
-                                           v4c.get().getStaticRoutes(),
-                                           v4c.get().getInterfaceMtu(),
-                                           v4c.get().getLeaseTime()));
+    string key(1, (char)reply_type);
+    key.append((const char*)serverMac, sizeof(serverMac));
+
+    OfpBuf b(replyCache.get(ep, key, [&]() {
+                return packets::compose_dhcpv4_reply(reply_type,
+                                                     dhcp_pkt->xid,
+                                                     serverMac,
+                                                     flow.dl_src.ea,
+                                                     dhcpIp.to_ulong(),
+                                                     prefixLen,
+                                                     v4c.get().getServerIp(),
+                                                     v4c.get().getRouters(),
+                                                     v4c.get().getDnsServers(),
+                                                     v4c.get().getDomain(),
+                                                     v4c.get().getStaticRoutes(),
+                                                     v4c.get().getInterfaceMtu(),
+                                                     v4c.get().getLeaseTime());
+            }));
+    if (!b.get()) return;
+    packets::patch_dhcpv4_reply(b, dhcp_pkt->xid, flow.dl_src.ea);
 
     send_packet_out(agent, intConn, accConn, intFlowManager,
                     intPortMapper, accPortMapper, URI::ROOT, b,
@@ -432,6 +500,7 @@ static void handleDHCPv4PktIn(Agent& agent,
 
 static void handleDHCPv6PktIn(Agent& agent,
                               IntFlowManager& intFlowManager,
+                              DhcpReplyCache& replyCache,
                               PortMapper* intPortMapper,
                               PortMapper* accPortMapper,
                               SwitchConnection* intConn,
@@ -539,23 +608,41 @@ static void handleDHCPv6PktIn(Agent& agent,
         return;
     }
 
-    OfpBuf b(packets::compose_dhcpv6_reply(reply_type,
-                                           dhcp_pkt->transaction_id,
-                                           intFlowManager.getDHCPMacAddr(),
-                                           flow.dl_src.ea,
-                                           &flow.ipv6_src,
-                                           client_id,
-                                           client_id_len,
-                                           iaid,
-                                           v6addresses,
-                                           v6c.get().getDnsServers(),
-                                           v6c.get().getSearchList(),
-                                           temporary,
-                                           rapid_commit,
-                                           v6c.get().getT1(),
-                                           v6c.get().getT2(),
-                                           v6c.get().getPreferredLifetime(),
-                                           v6c.get().getValidLifetime()));
+    // everything in the reply other than the transaction ID and
+    // client MAC
+    string key;
+    key.push_back((char)reply_type);
+    key.push_back((char)temporary);
+    key.push_back((char)rapid_commit);
+    key.append((const char*)intFlowManager.getDHCPMacAddr(), 6);
+    key.append((const char*)&flow.ipv6_src, sizeof(flow.ipv6_src));
+    if (iaid)
+        key.append((const char*)iaid, 4);
+    if (client_id)
+        key.append((const char*)client_id, client_id_len);
+
+    OfpBuf b(replyCache.get(ep, key, [&]() {
+                return packets::compose_dhcpv6_reply
+                    (reply_type,
+                     dhcp_pkt->transaction_id,
+                     intFlowManager.getDHCPMacAddr(),
+                     flow.dl_src.ea,
+                     &flow.ipv6_src,
+                     client_id,
+                     client_id_len,
+                     iaid,
+                     v6addresses,
+                     v6c.get().getDnsServers(),
+                     v6c.get().getSearchList(),
+                     temporary,
+                     rapid_commit,
+                     v6c.get().getT1(),
+                     v6c.get().getT2(),
+                     v6c.get().getPreferredLifetime(),
+                     v6c.get().getValidLifetime());
+            }));
+    if (!b.get()) return;
+    packets::patch_dhcpv6_reply(b, dhcp_pkt->transaction_id, flow.dl_src.ea);
 
     send_packet_out(agent, intConn, accConn, intFlowManager,
                     intPortMapper, accPortMapper, URI::ROOT, b, proto,
@@ -592,6 +679,7 @@ static unordered_set<ep_ptr> findEpsForIface(EndpointManager& epMgr,
  * @param v4 true if this is a DHCPv4 message, or false for DHCPv6
  * @param agent the agent object
  * @param intFlowManager the flow manager
+ * @param replyCache cache of composed DHCP replies
  * @param intConn the openflow switch connection
  * @param accConn the openflow switch connection
  * @param pi the packet-in
@@ -603,6 +691,7 @@ static unordered_set<ep_ptr> findEpsForIface(EndpointManager& epMgr,
 static void handleDHCPPktIn(bool v4,
                             Agent& agent,
                             IntFlowManager& intFlowManager,
+                            DhcpReplyCache& replyCache,
                             PortMapper* intPortMapper,
                             PortMapper* accPortMapper,
                             SwitchConnection* intConn,
@@ -653,11 +742,11 @@ static void handleDHCPPktIn(bool v4,
     const shared_ptr<const Endpoint> ep = *eps.begin();
 
     if (v4)
-        handleDHCPv4PktIn(agent, intFlowManager,
+        handleDHCPv4PktIn(agent, intFlowManager, replyCache,
                           intPortMapper, accPortMapper, intConn, accConn,
                           ep, iface, pi, proto, pkt, flow);
     else
-        handleDHCPv6PktIn(agent, intFlowManager,
+        handleDHCPv6PktIn(agent, intFlowManager, replyCache,
                           intPortMapper, accPortMapper, intConn, accConn,
                           ep, pi, proto, pkt, flow);
 
@@ -931,11 +1020,12 @@ void PacketInHandler::Handle(SwitchConnection* conn,
                       intPortMapper, accessPortMapper,
                       pi, proto, pkt.get(), flow);
     else if (pi.cookie == flow::cookie::DHCP_V4)
-        handleDHCPPktIn(true, agent, intFlowManager, intPortMapper,
+        handleDHCPPktIn(true, agent, intFlowManager, dhcpReplyCache,
+                        intPortMapper,
                         accessPortMapper, conn, accSwConnection,
                         pi, proto, pkt.get(), flow);
     else if (pi.cookie == flow::cookie::DHCP_V6)
-        handleDHCPPktIn(false, agent, intFlowManager,
+        handleDHCPPktIn(false, agent, intFlowManager, dhcpReplyCache,
                         intPortMapper, accessPortMapper,
                         conn, accSwConnection, pi, proto, pkt.get(), flow);
     else if (pi.cookie == flow::cookie::VIRTUAL_IP_V4)
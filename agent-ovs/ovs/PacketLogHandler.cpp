@@ -19,6 +19,7 @@
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <cstring>
 
 namespace opflexagent {
 
@@ -52,18 +53,27 @@ void LocalClient::run() {
         {
             std::unique_lock<std::mutex> lk(pktLogger.qMutex);
             pktLogger.cond.wait_for(lk, std::chrono::seconds(1),
-                    [this](){return !this->pktLogger.packetTupleQ.empty();});
-            if(!pktLogger.packetTupleQ.empty()) {
+                    [this](){return !this->pktLogger.packetTupleQ.empty() ||
+                            !this->pktLogger.dropFlowSummaryQ.empty();});
+            if(!pktLogger.packetTupleQ.empty() ||
+               !pktLogger.dropFlowSummaryQ.empty()) {
                 StringBuffer buffer;
                 Writer<StringBuffer> writer(buffer);
                 unsigned event_count = 0;
                 writer.StartArray();
-                while((event_count < maxEventsPerBuffer) &&
-                        !pktLogger.packetTupleQ.empty()) {
-                    PacketTuple p = pktLogger.packetTupleQ.front();
-                    p.serialize(writer);
-                    pktLogger.packetTupleQ.pop();
-                    event_count++;
+                /* Summaries account for every dropped packet, so they
+                 * go ahead of the individual events */
+                std::queue<PacketTuple> *queues[] =
+                    {&pktLogger.dropFlowSummaryQ, &pktLogger.packetTupleQ};
+                for(auto q : queues) {
+                    while((event_count < maxEventsPerBuffer) &&
+                            (buffer.GetSize() + maxEventSize <
+                             send_buffer.size()) &&
+                            !q->empty()) {
+                        q->front().serialize(writer);
+                        q->pop();
+                        event_count++;
+                    }
                 }
                 writer.EndArray();
                 pendingDataLen = (buffer.GetSize()>4096? 4096: buffer.GetSize());
@@ -105,6 +115,8 @@ bool PacketLogHandler::startListener()
         return false;
     }
     socketListener->startReceive();
+    summaryTimer.reset(new boost::asio::deadline_timer(server_io));
+    startSummaryTimer();
     LOG(INFO) << "PacketLogHandler started!";
     return true;
 }
@@ -126,9 +138,14 @@ bool PacketLogHandler::startExporter()
 void PacketLogHandler::stopListener()
 {
     LOG(INFO) << "PacketLogHandler stopped";
+    stopped = true;
     if(socketListener) {
         socketListener->stop();
     }
+    if(summaryTimer) {
+        boost::system::error_code ec;
+        summaryTimer->cancel(ec);
+    }
     server_io.stop();
 }
 
@@ -185,16 +202,21 @@ void PacketLogHandler::parseLog(unsigned char *buf , std::size_t length) {
          * a generic criterion
          * */
         /* Skip logging/events for LLDP packets*/
-        #define LLDP_MAC "01:80:c2:00:00:0e"
-        std::string dstMac;
-        p.packetTuple.getField(2, dstMac);
-        if(dstMac == LLDP_MAC) {
+        static const uint8_t LLDP_MAC[6] = {0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e};
+        const PacketFieldValue &dstMac = p.getTupleValue(2);
+        if(dstMac.field && !memcmp(dstMac.bytes, LLDP_MAC, sizeof(LLDP_MAC))) {
             return;
         }
         std::string dropReason;
         getDropReason(p, dropReason);
-        p.packetTuple.setField(0, dropReason);
-        LOG(INFO)<< dropReason << " " << p.parsedString;
+        DropFlow *flow = updateDropFlow(p, dropReason, length);
+        if(!flow) {
+            /* Repeated drops are reported in the next flow summary */
+            LOG(DEBUG) << dropReason << " " << p.getParsedString();
+            return;
+        }
+        /* The decoded fields are only rendered as text when needed */
+        LOG(INFO)<< dropReason << " " << p.getParsedString();
         if(!packetEventNotifSock.empty())
         {
             {
@@ -204,7 +226,8 @@ void PacketLogHandler::parseLog(unsigned char *buf , std::size_t length) {
                         LOG(ERROR) << "Queueing packet events";
                         throttleActive = false;
                     }
-                    packetTupleQ.push(p.packetTuple);
+                    packetTupleQ.push(flow->tuple);
+                    flow->exportedPackets = 1;
                     if(packetTupleQ.size()  == maxOutstandingEvents) {
                         LOG(ERROR) << "Max Event queue size ("
                                    << maxOutstandingEvents
@@ -218,4 +241,122 @@ void PacketLogHandler::parseLog(unsigned char *buf , std::size_t length) {
     }
 }
 
+PacketLogHandler::DropFlow *
+PacketLogHandler::updateDropFlow(const ParseInfo &p,
+                                 const std::string &dropReason,
+                                 std::size_t length) {
+    DropFlowKey key;
+    memset(&key, 0, sizeof(key));
+    key.meta[0] = p.meta[0];
+    key.meta[1] = p.meta[1];
+    key.ethType = p.getTupleValue(3).value;
+    memcpy(key.srcIp, p.getTupleValue(4).bytes, sizeof(key.srcIp));
+    memcpy(key.dstIp, p.getTupleValue(5).bytes, sizeof(key.dstIp));
+    key.ipProto = p.getTupleValue(6).value;
+    key.srcPort = p.getTupleValue(7).value;
+    key.dstPort = p.getTupleValue(8).value;
+
+    auto it = dropFlowMap.find(key);
+    if(it != dropFlowMap.end()) {
+        DropFlow &flow = *it->second;
+        dropFlowLru.splice(dropFlowLru.begin(), dropFlowLru, it->second);
+        if(flow.packets == 0) {
+            flow.firstSeen = p.timeStamp;
+        }
+        flow.packets++;
+        flow.bytes += length;
+        flow.lastSeen = p.timeStamp;
+        return nullptr;
+    }
+
+    if(dropFlowLru.size() >= maxDropFlows) {
+        DropFlow &oldest = dropFlowLru.back();
+        if(oldest.packets > 0) {
+            emitDropFlowSummary(oldest);
+        }
+        dropFlowMap.erase(oldest.key);
+        dropFlowLru.pop_back();
+    }
+    dropFlowLru.emplace_front();
+    DropFlow &flow = dropFlowLru.front();
+    flow.key = key;
+    p.getPacketTuple(flow.tuple);
+    flow.tuple.setField(0, dropReason);
+    flow.packets = 1;
+    flow.bytes = length;
+    flow.loggedPackets = 1;
+    flow.exportedPackets = 0;
+    flow.firstSeen = flow.lastSeen = p.timeStamp;
+    dropFlowMap.insert(std::make_pair(key, dropFlowLru.begin()));
+    return &flow;
+}
+
+void PacketLogHandler::emitDropFlowSummary(const DropFlow &flow) {
+    const auto &fields = flow.tuple.fields;
+    if(flow.packets > flow.loggedPackets) {
+        LOG(INFO) << fields.at(0).second << " dropped " << flow.packets
+                  << " packets (" << flow.bytes << " bytes)"
+                  << " SRC=" << fields.at(4).second
+                  << " DST=" << fields.at(5).second
+                  << " PROTO=" << fields.at(6).second
+                  << " SPT=" << fields.at(7).second
+                  << " DPT=" << fields.at(8).second;
+    }
+    /* A flow whose only packet went out as an event has nothing
+     * new to report */
+    if(packetEventNotifSock.empty() ||
+       flow.packets <= flow.exportedPackets) {
+        return;
+    }
+    PacketTuple summary(flow.tuple);
+    summary.TimeStamp = PacketTuple::formatTimeStamp(flow.lastSeen);
+    summary.addField("PacketCount", std::to_string(flow.packets));
+    summary.addField("ByteCount", std::to_string(flow.bytes));
+    summary.addField("FirstSeen", PacketTuple::formatTimeStamp(flow.firstSeen));
+    summary.addField("LastSeen", PacketTuple::formatTimeStamp(flow.lastSeen));
+    std::lock_guard<std::mutex> lk(qMutex);
+    if(dropFlowSummaryQ.size() < maxDropFlows) {
+        dropFlowSummaryQ.push(std::move(summary));
+    } else {
+        lostDropFlowSummaries++;
+    }
+}
+
+void PacketLogHandler::flushDropFlows() {
+    for(auto it = dropFlowLru.begin(); it != dropFlowLru.end();) {
+        if(it->packets == 0) {
+            dropFlowMap.erase(it->key);
+            it = dropFlowLru.erase(it);
+            continue;
+        }
+        emitDropFlowSummary(*it);
+        it->packets = it->bytes = 0;
+        it->loggedPackets = it->exportedPackets = 0;
+        ++it;
+    }
+    uint64_t lost;
+    {
+        std::lock_guard<std::mutex> lk(qMutex);
+        lost = lostDropFlowSummaries;
+        lostDropFlowSummaries = 0;
+    }
+    if(lost) {
+        LOG(ERROR) << "Packet event queue full, " << lost
+                   << " drop flow summaries were not exported";
+    }
+    cond.notify_one();
+}
+
+void PacketLogHandler::startSummaryTimer() {
+    summaryTimer->expires_from_now(
+            boost::posix_time::seconds(dropFlowSummaryInterval));
+    summaryTimer->async_wait([this](const boost::system::error_code& ec) {
+            if(ec || stopped) {
+                return;
+            }
+            flushDropFlows();
+            startSummaryTimer();
+        });
+}
+
 }
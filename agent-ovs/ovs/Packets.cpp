@@ -26,6 +26,9 @@
 #include <netinet/ip.h>
 #include <netinet/ip6.h>
 #include <netinet/icmp6.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace opflexagent {
 namespace packets {
@@ -56,13 +59,57 @@ using boost::algorithm::split;
 using boost::algorithm::token_compress_on;
 using boost::algorithm::is_any_of;
 
+/*
+ * The one's complement sum is independent of byte order and of the
+ * width of the words being added as long as carries are folded back
+ * in, so sum wide words and fold the result down to 16 bits.
+ */
 void chksum_accum(uint32_t& chksum, uint16_t* addr, size_t len) {
-    while (len > 1)  {
-        chksum += *addr++;
+    const uint8_t* data = (const uint8_t*)addr;
+    uint64_t sum = 0;
+
+#ifdef __SSE2__
+    if (len >= 64) {
+        // widen 16-bit words into 32-bit lanes; a lane cannot
+        // overflow for less than 256KB of data per call
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = zero;
+        while (len >= 64 && len < (1 << 18)) {
+            for (int i = 0; i < 4; i++) {
+                __m128i v =
+                    _mm_loadu_si128((const __m128i*)(data + 16 * i));
+                acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+                acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+            }
+            data += 64;
+            len -= 64;
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, data, sizeof(v));
+        sum += (v & 0xffffffff) + (v >> 32);
+        data += 8;
+        len -= 8;
+    }
+    while (len > 1) {
+        uint16_t v;
+        memcpy(&v, data, sizeof(v));
+        sum += v;
+        data += 2;
         len -= 2;
     }
     if (len > 0)
-        chksum += *(uint8_t*)addr;
+        sum += *data;
+
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    chksum += sum;
 }
 
 uint16_t chksum_finalize(uint32_t chksum) {
@@ -238,11 +285,18 @@ OfpBuf compose_icmp6_router_ad(const uint8_t* srcMac,
     return b;
 }
 
-OfpBuf compose_icmp6_neigh_ad(uint32_t naFlags,
-                               const uint8_t* srcMac,
-                               const uint8_t* dstMac,
-                               const struct in6_addr* srcIp,
-                               const struct in6_addr* dstIp) {
+static const size_t NEIGH_AD_LEN =
+    sizeof(eth::eth_header) +
+    sizeof(struct ip6_hdr) +
+    sizeof(struct nd_neighbor_advert) +
+    sizeof(struct nd_opt_hdr) + 6;
+
+static void write_icmp6_neigh_ad(char* buf,
+                                 uint32_t naFlags,
+                                 const uint8_t* srcMac,
+                                 const uint8_t* dstMac,
+                                 const struct in6_addr* srcIp,
+                                 const struct in6_addr* dstIp) {
     eth::eth_header* eth = NULL;
     struct ip6_hdr* ip6 = NULL;
     uint16_t* payload;
@@ -251,16 +305,6 @@ OfpBuf compose_icmp6_neigh_ad(uint32_t naFlags,
     struct nd_neighbor_advert* neigh_ad = NULL;
     struct nd_opt_hdr* target_ll = NULL;
 
-    size_t len = sizeof(eth::eth_header) +
-        sizeof(struct ip6_hdr) +
-        sizeof(struct nd_neighbor_advert) +
-        sizeof(struct nd_opt_hdr) + 6;
-
-    OfpBuf b(len);
-    b.clear();
-    b.reserve(len);
-
-    char* buf = (char*)b.push_zeros(len);
     eth = (eth::eth_header*)buf;
     buf += sizeof(eth::eth_header);
     ip6 = (struct ip6_hdr*)buf;
@@ -315,15 +359,44 @@ OfpBuf compose_icmp6_neigh_ad(uint32_t naFlags,
     chksum_accum(chksum, payload, payloadLen);
     uint16_t fchksum = chksum_finalize(chksum);
     memcpy(&neigh_ad->nd_na_hdr.icmp6_cksum, &fchksum, sizeof(fchksum));
+}
+
+OfpBuf compose_icmp6_neigh_ad(uint32_t naFlags,
+                               const uint8_t* srcMac,
+                               const uint8_t* dstMac,
+                               const struct in6_addr* srcIp,
+                               const struct in6_addr* dstIp) {
+    OfpBuf b(NEIGH_AD_LEN);
+    b.clear();
+    b.reserve(NEIGH_AD_LEN);
 
+    write_icmp6_neigh_ad((char*)b.push_zeros(NEIGH_AD_LEN),
+                         naFlags, srcMac, dstMac, srcIp, dstIp);
     return b;
 }
 
-OfpBuf compose_icmp6_neigh_solit(const uint8_t* srcMac,
-                                  const uint8_t* dstMac,
-                                  const struct in6_addr* srcIp,
-                                  const struct in6_addr* dstIp,
-                                  const struct in6_addr* targetIp) {
+void compose_icmp6_neigh_ad(PacketBatch& batch,
+                            uint32_t naFlags,
+                            const uint8_t* srcMac,
+                            const uint8_t* dstMac,
+                            const struct in6_addr* srcIp,
+                            const struct in6_addr* dstIp) {
+    write_icmp6_neigh_ad((char*)batch.append(NEIGH_AD_LEN),
+                         naFlags, srcMac, dstMac, srcIp, dstIp);
+}
+
+static const size_t NEIGH_SOLIT_LEN =
+    sizeof(eth::eth_header) +
+    sizeof(struct ip6_hdr) +
+    sizeof(struct nd_neighbor_solicit) +
+    sizeof(struct nd_opt_hdr) + 6;
+
+static void write_icmp6_neigh_solit(char* buf,
+                                    const uint8_t* srcMac,
+                                    const uint8_t* dstMac,
+                                    const struct in6_addr* srcIp,
+                                    const struct in6_addr* dstIp,
+                                    const struct in6_addr* targetIp) {
     eth::eth_header* eth = NULL;
     struct ip6_hdr* ip6 = NULL;
     uint16_t* payload;
@@ -332,16 +405,6 @@ OfpBuf compose_icmp6_neigh_solit(const uint8_t* srcMac,
     struct nd_neighbor_solicit* neigh_sol = NULL;
     struct nd_opt_hdr* source_ll = NULL;
 
-    size_t len = sizeof(eth::eth_header) +
-        sizeof(struct ip6_hdr) +
-        sizeof(struct nd_neighbor_solicit) +
-        sizeof(struct nd_opt_hdr) + 6;
-
-    OfpBuf b(len);
-    b.clear();
-    b.reserve(len);
-
-    char* buf = (char*)b.push_zeros(len);
     eth = (eth::eth_header*)buf;
     buf += sizeof(eth::eth_header);
     ip6 = (struct ip6_hdr*)buf;
@@ -396,10 +459,32 @@ OfpBuf compose_icmp6_neigh_solit(const uint8_t* srcMac,
     chksum_accum(chksum, payload, payloadLen);
     uint16_t fchksum = chksum_finalize(chksum);
     memcpy(&neigh_sol->nd_ns_hdr.icmp6_cksum, &fchksum, sizeof(fchksum));
+}
+
+OfpBuf compose_icmp6_neigh_solit(const uint8_t* srcMac,
+                                  const uint8_t* dstMac,
+                                  const struct in6_addr* srcIp,
+                                  const struct in6_addr* dstIp,
+                                  const struct in6_addr* targetIp) {
+    OfpBuf b(NEIGH_SOLIT_LEN);
+    b.clear();
+    b.reserve(NEIGH_SOLIT_LEN);
 
+    write_icmp6_neigh_solit((char*)b.push_zeros(NEIGH_SOLIT_LEN),
+                            srcMac, dstMac, srcIp, dstIp, targetIp);
     return b;
 }
 
+void compose_icmp6_neigh_solit(PacketBatch& batch,
+                               const uint8_t* srcMac,
+                               const uint8_t* dstMac,
+                               const struct in6_addr* srcIp,
+                               const struct in6_addr* dstIp,
+                               const struct in6_addr* targetIp) {
+    write_icmp6_neigh_solit((char*)batch.append(NEIGH_SOLIT_LEN),
+                            srcMac, dstMac, srcIp, dstIp, targetIp);
+}
+
 static const size_t MAX_IP = 32;
 static const size_t MAX_ROUTE = 16;
 
@@ -966,14 +1051,81 @@ OfpBuf compose_dhcpv6_reply(uint8_t message_type,
     return b;
 }
 
-OfpBuf compose_arp(uint16_t op,
-                    const uint8_t* srcMac,
-                    const uint8_t* dstMac,
-                    const uint8_t* sha,
-                    const uint8_t* tha,
-                    uint32_t spa,
-                    uint32_t tpa,
-                    bool rarp) {
+/**
+ * Replace an even-length field at an even offset from the start of
+ * the checksummed data, adjusting the checksum as in RFC 1624
+ */
+static void chksum_replace(uint16_t& chksum, void* field,
+                           const void* value, size_t len) {
+    uint32_t sum = (uint16_t)~chksum;
+    for (size_t i = 0; i < len; i += 2) {
+        uint16_t oldVal, newVal;
+        memcpy(&oldVal, (char*)field + i, 2);
+        memcpy(&newVal, (const char*)value + i, 2);
+        sum += (uint16_t)~oldVal;
+        sum += newVal;
+    }
+    memcpy(field, value, len);
+    chksum = chksum_finalize(sum);
+    // a zero UDP checksum means no checksum
+    if (chksum == 0)
+        chksum = 0xffff;
+}
+
+void patch_dhcpv4_reply(OfpBuf& reply,
+                        uint32_t xid,
+                        const uint8_t* clientMac) {
+    using namespace dhcp;
+    using namespace udp;
+
+    size_t offset = sizeof(eth::eth_header) + sizeof(struct iphdr);
+    struct udp_hdr* udp =
+        (struct udp_hdr*)reply.at_assert(offset, sizeof(struct udp_hdr));
+    struct dhcp_hdr* dhcp =
+        (struct dhcp_hdr*)reply.at_assert(offset + sizeof(struct udp_hdr),
+                                          sizeof(struct dhcp_hdr));
+
+    uint8_t chaddr[eth::ADDR_LEN];
+    memcpy(chaddr, clientMac, eth::ADDR_LEN);
+    chksum_replace(udp->chksum, &dhcp->xid, &xid, sizeof(xid));
+    chksum_replace(udp->chksum, dhcp->chaddr, chaddr, sizeof(chaddr));
+}
+
+void patch_dhcpv6_reply(OfpBuf& reply,
+                        const uint8_t* xid,
+                        const uint8_t* clientMac) {
+    using namespace dhcp6;
+    using namespace udp;
+
+    eth::eth_header* eth =
+        (eth::eth_header*)reply.at_assert(0, sizeof(eth::eth_header));
+    size_t offset = sizeof(eth::eth_header) + sizeof(struct ip6_hdr);
+    struct udp_hdr* udp =
+        (struct udp_hdr*)reply.at_assert(offset, sizeof(struct udp_hdr));
+    struct dhcp6_hdr* dhcp =
+        (struct dhcp6_hdr*)reply.at_assert(offset + sizeof(struct udp_hdr),
+                                           sizeof(struct dhcp6_hdr));
+
+    memcpy(eth->eth_dst, clientMac, eth::ADDR_LEN);
+    struct dhcp6_hdr newHdr;
+    newHdr.msg_type = dhcp->msg_type;
+    memcpy(newHdr.transaction_id, xid, sizeof(newHdr.transaction_id));
+    chksum_replace(udp->chksum, dhcp, &newHdr, sizeof(newHdr));
+}
+
+static const size_t ARP_LEN =
+    sizeof(eth::eth_header) + sizeof(arp::arp_hdr) +
+    2 * eth::ADDR_LEN + 2 * 4;
+
+static void write_arp(char* buf,
+                      uint16_t op,
+                      const uint8_t* srcMac,
+                      const uint8_t* dstMac,
+                      const uint8_t* sha,
+                      const uint8_t* tha,
+                      uint32_t spa,
+                      uint32_t tpa,
+                      bool rarp) {
     using namespace arp;
 
     eth::eth_header* eth = NULL;
@@ -983,15 +1135,6 @@ OfpBuf compose_arp(uint16_t op,
     uint32_t* spaptr = NULL;
     uint32_t* tpaptr = NULL;
 
-    size_t len =
-        sizeof(eth::eth_header) + sizeof(arp_hdr) +
-        2 * eth::ADDR_LEN + 2 * 4;
-
-    OfpBuf b(len);
-    b.clear();
-    b.reserve(len);
-
-    char* buf = (char*)b.push_zeros(len);
     eth = (eth::eth_header*)buf;
     buf += sizeof(eth::eth_header);
     arp = (struct arp_hdr*)buf;
@@ -1027,9 +1170,37 @@ OfpBuf compose_arp(uint16_t op,
     tpa = htonl(tpa);
     memcpy(spaptr, &spa, sizeof(spa));
     memcpy(tpaptr, &tpa, sizeof(tpa));
+}
 
+OfpBuf compose_arp(uint16_t op,
+                    const uint8_t* srcMac,
+                    const uint8_t* dstMac,
+                    const uint8_t* sha,
+                    const uint8_t* tha,
+                    uint32_t spa,
+                    uint32_t tpa,
+                    bool rarp) {
+    OfpBuf b(ARP_LEN);
+    b.clear();
+    b.reserve(ARP_LEN);
+
+    write_arp((char*)b.push_zeros(ARP_LEN),
+              op, srcMac, dstMac, sha, tha, spa, tpa, rarp);
     return b;
 }
 
+void compose_arp(PacketBatch& batch,
+                 uint16_t op,
+                 const uint8_t* srcMac,
+                 const uint8_t* dstMac,
+                 const uint8_t* sha,
+                 const uint8_t* tha,
+                 uint32_t spa,
+                 uint32_t tpa,
+                 bool rarp) {
+    write_arp((char*)batch.append(ARP_LEN),
+              op, srcMac, dstMac, sha, tha, spa, tpa, rarp);
+}
+
 } /* namespace packets */
 } /* namespace opflexagent */
@@ -306,11 +306,18 @@ on_timer_base(const error_code& ec,
                     .setStateReportResps(peerStat.second->getStateReportResps())
                     .setStateReportErrs(peerStat.second->getStateReportErrs());
         }
+
+        FSWatcher& fsWatcher = agent->getFSWatcher();
+        ssu.get()->addObserverFsWatcherCounter()
+            ->setUpdateEvents(fsWatcher.getUpdateEvents())
+            .setSuppressedEvents(fsWatcher.getSuppressedEvents())
+            .setDeleteEvents(fsWatcher.getDeleteEvents());
     }
 
     mutator.commit();
 #ifdef HAVE_PROMETHEUS_SUPPORT
     prometheusManager.addNUpdateOFPeerStats();
+    prometheusManager.addNUpdateFSWatcherStats();
 #endif
 }
 
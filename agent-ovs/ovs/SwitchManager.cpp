@@ -9,10 +9,17 @@
 #include "SwitchManager.h"
 #include "FlowBuilder.h"
 #include <opflexagent/logging.h>
+#ifdef HAVE_PROMETHEUS_SUPPORT
+#include <opflexagent/PrometheusManager.h>
+#endif
 
 #include <boost/asio/placeholders.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+
 #include "ovs-ofputil.h"
 
 namespace opflexagent {
@@ -25,6 +32,11 @@ using boost::posix_time::milliseconds;
 using boost::asio::placeholders::error;
 
 const long DEFAULT_SYNC_DELAY_ON_CONNECT_MSEC = 5000;
+#ifdef HAVE_PROMETHEUS_SUPPORT
+static const milliseconds FLOW_COUNTERS_INTERVAL(10*1000);
+#endif
+// Object IDs beyond this many distinct types are counted as "other"
+static const size_t MAX_OBJECT_TYPES = 64;
 
 SwitchManager::SwitchManager(Agent& agent_,
                              FlowExecutor& flowExecutor_,
@@ -50,6 +62,13 @@ void SwitchManager::start(const std::string& swName) {
     // Start out in syncing mode to avoid writing to the flow tables;
     // we'll update cached state only.
     syncing = true;
+
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    countersTimer.reset(new deadline_timer(agent.getAgentIOService(),
+                                           FLOW_COUNTERS_INTERVAL));
+    countersTimer->async_wait(bind(&SwitchManager::onCountersTimer,
+                                   this, error));
+#endif
 }
 
 void SwitchManager::connect() {
@@ -70,12 +89,19 @@ void SwitchManager::stop() {
     if (connectTimer) {
         connectTimer->cancel();
     }
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    if (countersTimer) {
+        countersTimer->cancel();
+    }
+#endif
 }
 
 void SwitchManager::setMaxFlowTables(int max) {
     flowTables.resize(max);
     recvFlows.resize(max);
     tableDone.resize(max);
+    std::lock_guard<std::mutex> guard(countersMutex);
+    tableCounters.resize(max);
 }
 
 void SwitchManager::setForwardingTableList(
@@ -172,7 +198,11 @@ bool SwitchManager::writeFlow(const std::string& objId, int tableId,
     TableState& tab = flowTables[tableId];
 
     FlowEdit diffs;
+    auto start = std::chrono::steady_clock::now();
     tab.apply(objId, el, diffs);
+    countFlowEdits(objId, tableId, diffs,
+                   std::chrono::duration_cast<std::chrono::microseconds>
+                   (std::chrono::steady_clock::now() - start).count());
     if (!syncing) {
         // If a sync is in progress, don't write to the flow tables
         // while we are reading and reconciling with the current
@@ -188,6 +218,133 @@ bool SwitchManager::writeFlow(const std::string& objId, int tableId,
     return success;
 }
 
+void SwitchManager::countFlowEdits(const std::string& objId, int tableId,
+                                   const FlowEdit& diffs,
+                                   uint64_t diffTimeUs) {
+    uint64_t adds = 0, mods = 0, dels = 0;
+    for (const FlowEdit::Entry& e : diffs.edits) {
+        switch (e.first) {
+        case FlowEdit::ADD: adds += 1; break;
+        case FlowEdit::MOD: mods += 1; break;
+        case FlowEdit::DEL: dels += 1; break;
+        }
+    }
+
+    auto count = [&](FlowCounters& c) {
+        c.flows = c.flows + adds - dels;
+        c.writes += 1;
+        c.adds += adds;
+        c.mods += mods;
+        c.deletes += dels;
+        c.diffTimeUs += diffTimeUs;
+    };
+
+    std::string type(getObjectType(objId));
+    std::lock_guard<std::mutex> guard(countersMutex);
+    count(tableCounters[tableId]);
+    auto it = objTypeCounters.find(type);
+    if (it == objTypeCounters.end()) {
+        if (objTypeCounters.size() >= MAX_OBJECT_TYPES)
+            type = "other";
+        it = objTypeCounters.emplace(type, FlowCounters()).first;
+    }
+    count(it->second);
+}
+
+// check for the canonical 8-4-4-4-12 hex form of a UUID
+static bool isUuid(const std::string& str) {
+    if (str.size() != 36)
+        return false;
+    for (size_t i = 0; i < str.size(); i++) {
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            if (str[i] != '-')
+                return false;
+        } else if (!std::isxdigit(static_cast<unsigned char>(str[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string SwitchManager::getObjectType(const std::string& objId) {
+    if (!objId.empty() && objId[0] == '/') {
+        // URIs alternate class names and IDs, ending with a '/'
+        size_t end = objId.size();
+        if (objId[end - 1] == '/') end -= 1;
+        size_t idStart = objId.rfind('/', end - 1);
+        if (idStart != std::string::npos && idStart > 0) {
+            size_t clsStart = objId.rfind('/', idStart - 1);
+            if (clsStart != std::string::npos)
+                return objId.substr(clsStart + 1, idStart - clsStart - 1);
+        }
+        return "uri";
+    }
+
+    size_t len = objId.find(':');
+    if (isUuid(objId.substr(0, len)))
+        return "uuid";
+    if (len != std::string::npos && len > 0)
+        return objId.substr(0, len);
+    // IDs without a type prefix, such as interface names, would
+    // otherwise each take up one of the object types
+    return "other";
+}
+
+void SwitchManager::getTableCounters(int tableId, FlowCounters& counters) {
+    {
+        std::lock_guard<std::mutex> guard(countersMutex);
+        if (tableId < 0 ||
+            static_cast<size_t>(tableId) >= tableCounters.size()) {
+            counters = FlowCounters();
+            return;
+        }
+        counters = tableCounters[tableId];
+    }
+    counters.encodedBytes =
+        flowExecutor.getEncodedBytes(static_cast<uint8_t>(tableId));
+}
+
+void SwitchManager::
+getObjectTypeCounters(std::unordered_map<std::string,
+                                         FlowCounters>& counters) {
+    std::lock_guard<std::mutex> guard(countersMutex);
+    counters = objTypeCounters;
+}
+
+#ifdef HAVE_PROMETHEUS_SUPPORT
+void SwitchManager::onCountersTimer(const boost::system::error_code& ec) {
+    if (ec || stopping || !connection) return;
+
+    PrometheusManager& prometheusManager = agent.getPrometheusManager();
+    for (size_t i = 0; i < flowTables.size(); i++) {
+        FlowCounters c;
+        getTableCounters(i, c);
+        if (!c.writes)
+            continue;
+        auto it = tableDescriptionMap.find(i);
+        std::string tableName = it != tableDescriptionMap.end()
+            ? it->second.first : "TABLE_" + std::to_string(i);
+        prometheusManager.addNUpdateFlowTableStats(
+            connection->getSwitchName(), tableName,
+            c.flows, c.adds, c.mods, c.deletes, c.diffTimeUs,
+            c.encodedBytes);
+    }
+
+    std::unordered_map<std::string, FlowCounters> types;
+    getObjectTypeCounters(types);
+    for (const auto& t : types) {
+        const FlowCounters& c = t.second;
+        prometheusManager.addNUpdateFlowObjectStats(
+            connection->getSwitchName(), t.first,
+            c.flows, c.adds, c.mods, c.deletes, c.diffTimeUs);
+    }
+
+    countersTimer->expires_from_now(FLOW_COUNTERS_INTERVAL);
+    countersTimer->async_wait(bind(&SwitchManager::onCountersTimer,
+                                   this, error));
+}
+#endif
+
 bool SwitchManager::writeFlow(const std::string& objId,
                               int tableId, FlowEntryPtr el) {
     FlowEntryList tmpEl;
@@ -206,6 +363,18 @@ bool SwitchManager::clearFlows(const std::string& objId, int tableId) {
     return writeFlow(objId, tableId, empty);
 }
 
+void SwitchManager::clearTableState() {
+    size_t max = flowTables.size();
+    flowTables.clear();
+    flowTables.resize(max);
+
+    std::lock_guard<std::mutex> guard(countersMutex);
+    for (FlowCounters& c : tableCounters)
+        c.flows = 0;
+    for (auto& c : objTypeCounters)
+        c.second.flows = 0;
+}
+
 bool SwitchManager::writeGroupMod(const GroupEdit::Entry& e) {
     // If a sync is in progress, don't write to the group table while
     // we are reading and reconciling with the current groups.
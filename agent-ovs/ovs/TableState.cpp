@@ -6,6 +6,7 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <cstring>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -13,6 +14,7 @@
 #include <boost/optional.hpp>
 
 #include "TableState.h"
+#include "FlowArena.h"
 #include <opflexagent/logging.h>
 #include "ovs-shim.h"
 #include "ovs-ofputil.h"
@@ -73,17 +75,48 @@ using boost::optional;
 
 /** FlowEntry **/
 
-FlowEntry::FlowEntry() {
+FlowEntry::FlowEntry() : arena(NULL) {
     entry = (ofputil_flow_stats*)calloc(1, sizeof(ofputil_flow_stats));
 }
 
+FlowEntry::FlowEntry(FlowArena& arena_) : arena(&arena_) {
+    entry = (ofputil_flow_stats*)
+        arena->allocate(sizeof(ofputil_flow_stats),
+                        alignof(ofputil_flow_stats));
+    arena->liveEntries += 1;
+}
+
 FlowEntry::~FlowEntry() {
+    if (arena) {
+        // storage is released with the arena
+        arena->liveEntries -= 1;
+        return;
+    }
     if (entry->ofpacts) {
         free((void *)entry->ofpacts);
     }
     free(entry);
 }
 
+FlowEntryPtr FlowEntry::clone() const {
+    FlowEntryPtr copy = std::make_shared<FlowEntry>();
+    *copy->entry = *entry;
+    copy->entry->ofpacts = NULL;
+    if (entry->ofpacts) {
+        ofpact* acts = copy->allocActions(entry->ofpacts_len);
+        std::memcpy(acts, entry->ofpacts, entry->ofpacts_len);
+        copy->entry->ofpacts = acts;
+    }
+    return copy;
+}
+
+ofpact* FlowEntry::allocActions(size_t len) {
+    // ofpacts are aligned on 8 byte boundaries
+    if (arena)
+        return (ofpact*)arena->allocate(len, alignof(uint64_t));
+    return (ofpact*)malloc(len);
+}
+
 bool
 FlowEntry::matchEq(const FlowEntry *rhs) {
     const ofputil_flow_stats *feRhs = rhs->entry;
@@ -350,11 +383,48 @@ static void updateCookieMap(cookie_map_t& cookie_map,
     }
 }
 
+// Flow entries built in a flow arena are only valid for the current
+// render pass.  Replace each of them with the entry already cached for
+// the object if it is unchanged, or with a heap copy otherwise.
+static void persistArenaEntries(const match_map_t* oldEntries,
+                                FlowEntryList& newEntries) {
+    for (FlowEntryPtr& fe : newEntries) {
+        if (!fe->isArenaBacked())
+            continue;
+
+        if (oldEntries) {
+            match_key_t key;
+            key.prio = fe->entry->priority;
+            key.match = fe->entry->match;
+            match_map_t::const_iterator it = oldEntries->find(key);
+            if (it != oldEntries->end() && !it->second.empty()) {
+                const FlowEntryPtr& old = it->second.back();
+                if (old->entry->cookie == fe->entry->cookie &&
+                    old->entry->flags == fe->entry->flags &&
+                    old->entry->idle_timeout == fe->entry->idle_timeout &&
+                    old->entry->hard_timeout == fe->entry->hard_timeout &&
+                    old->actionEq(fe.get())) {
+                    fe = old;
+                    continue;
+                }
+            }
+        }
+        fe = fe->clone();
+    }
+}
+
 void TableState::apply(const std::string& objId,
                        FlowEntryList& newEntries,
                        /* out */ FlowEdit& diffs) {
     diffs.edits.clear();
 
+    {
+        entry_map_t::const_iterator eit = pimpl->entry_map.find(objId);
+        persistArenaEntries(eit != pimpl->entry_map.end()
+                            ? &eit->second : NULL,
+                            newEntries);
+    }
+
     match_map_t new_entries;
     for (const FlowEntryPtr& fe : newEntries) {
 
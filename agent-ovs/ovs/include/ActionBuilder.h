@@ -31,6 +31,7 @@ struct ofpact;
 namespace opflexagent {
 
 class FlowBuilder;
+class FlowEntry;
 
 /**
  * Class to help construct the actions part of a table entry incrementally.
@@ -50,6 +51,13 @@ public:
      */
     void build(ofputil_flow_stats *dstEntry);
 
+    /**
+     * Construct and install the action structure to the given flow
+     * entry, using storage from the entry's flow arena if it has one
+     * @param dstEntry the entry to write to
+     */
+    void build(FlowEntry& dstEntry);
+
     /**
      * Construct and install the action structure to 'dstMod'
      * @param dstMod the entry to write to
@@ -377,6 +385,20 @@ public:
                              uint32_t arg,
                              mf_field_id dst);
 
+    /**
+     * Make the flow one clause of a conjunctive match.  A flow with
+     * conjunction actions must have no other actions, and the flow
+     * matching the conjunction ID must have the same priority as its
+     * clauses.
+     *
+     * @param id the conjunction ID
+     * @param clause the clause that this flow satisfies, from 1 to
+     * nClauses
+     * @param nClauses the number of clauses in the conjunction
+     */
+    ActionBuilder& conjunction(uint32_t id, uint8_t clause,
+                               uint8_t nClauses);
+
     /**
      * Perform a MAC/VLAN learning action and write the result to the
      * specified table with the specified priority and cookie.
@@ -415,7 +437,14 @@ public:
     static ofpact* getActionsFromBuffer(ofpbuf *buf, size_t& actsLen);
 
 private:
+    /**
+     * Size of the inline buffer actions are built in before
+     * spilling to the heap
+     */
+    static const size_t STUB_SIZE = 256;
+
     struct ofpbuf* buf;
+    uint64_t stub[STUB_SIZE / sizeof(uint64_t)];
     bool flowHasVlan;
     boost::optional<FlowBuilder&> fb;
 };
@@ -18,12 +18,20 @@
 #include <boost/noncopyable.hpp>
 #include <boost/asio/deadline_timer.hpp>
 
+#include <chrono>
+#include <deque>
 #include <mutex>
 #include <random>
+#include <unordered_set>
+#include <vector>
 
 namespace opflexagent {
 
 class IntFlowManager;
+struct EpAdvDest;
+namespace packets {
+class PacketBatch;
+}
 
 /**
  * Class that handles generating all unsolicited advertisements with
@@ -105,6 +113,41 @@ public:
     { tunnelEndpointAdv = tunnelMode;
       tunnelEpAdvInterval = delay;}
 
+    /**
+     * Set the rate at which endpoint advertisements are sent.
+     * Advertisements are paced with a token bucket that refills at
+     * rate packets per second and holds at most burst packets.
+     *
+     * @param rate the sustained send rate in packets per second, or 0
+     * to send advertisements without pacing
+     * @param burst the number of advertisements that can be sent
+     * back to back
+     */
+    void setEndpointAdvRate(uint32_t rate, uint32_t burst);
+
+    /**
+     * Get the number of endpoints currently waiting for their
+     * advertisements to be sent
+     */
+    size_t getEndpointAdvQueueDepth();
+
+    /**
+     * Get the total number of endpoint advertisements sent
+     */
+    uint64_t getEndpointAdvsSent() const { return advSent; }
+
+    /**
+     * Get the number of endpoint advertisement requests that were
+     * merged into a request already pending for the same endpoint
+     */
+    uint64_t getCoalescedEndpointAdvs() const { return advCoalesced; }
+
+    /**
+     * Get the endpoint advertisement send rate in packets per second
+     * measured over the last completed interval of at least a second
+     */
+    double getEndpointAdvSendRate();
+
     /**
      * Module start
      */
@@ -170,18 +213,57 @@ private:
     std::atomic<int> initialRouterAdvs;
 
     /**
-     * Synchronously send endpoint gratuitous advertisements for the
-     * specified endpoint
+     * Queue the specified endpoints to have their gratuitous
+     * advertisements sent.  An endpoint that is already queued is
+     * not queued again.
+     *
+     * @param uuids the UUIDs of the endpoints
+     */
+    void queueEndpointAdvs(const std::vector<std::string>& uuids);
+
+    /**
+     * Queue all active endpoints that fall in the given slot of the
+     * periodic advertisement sweep
+     *
+     * @param slot the slot to queue, or EP_ADV_SLOTS to queue every
+     * endpoint
+     */
+    void queueAllEndpointAdvs(size_t slot);
+
+    /**
+     * Send as many queued endpoint advertisements as the token
+     * bucket allows, and schedule another round if endpoints remain
+     * queued
+     */
+    void drainEndpointAdvs();
+    void onAdvSendTimer(const boost::system::error_code& ec);
+
+    /**
+     * Recompute the send rate if the current measurement interval
+     * has completed.  Must be called with adv_mutex held.
+     */
+    void updateAdvSendRate(std::chrono::steady_clock::time_point now);
+
+    /**
+     * Compose the gratuitous advertisements for the specified
+     * endpoint into a batch
      *
      * @param uuid the UUID of the endpoint
+     * @param batch the batch to add the advertisements to
+     * @param dests the destination of each advertisement added
      */
-    void sendEndpointAdvs(const std::string& uuid);
+    void composeEndpointAdvs(const std::string& uuid,
+                             packets::PacketBatch& batch,
+                             std::vector<EpAdvDest>& dests);
 
     /**
-     * Synchronously send endpoint gratuitous advertisements for all
-     * active endpoints.
+     * Send a batch of endpoint advertisements to the tunnel port
+     *
+     * @param batch the advertisements to send
+     * @param dests the destination of each advertisement
      */
-    void sendAllEndpointAdvs();
+    void sendEndpointAdvBatch(const packets::PacketBatch& batch,
+                              const std::vector<EpAdvDest>& dests);
 
     /**
      * Synchronously send service gratuitous advertisements for all
@@ -230,6 +312,32 @@ private:
     std::unique_ptr<boost::asio::deadline_timer> endpointAdvTimer;
     std::unique_ptr<boost::asio::deadline_timer> allEndpointAdvTimer;
     std::unique_ptr<boost::asio::deadline_timer> tunnelEpAdvTimer;
+    std::unique_ptr<boost::asio::deadline_timer> advSendTimer;
+    bool epAdvTimerPending;
+
+    /**
+     * The periodic advertisement of all endpoints is split into
+     * EP_ADV_SLOTS slots by endpoint UUID hash, one slot queued per
+     * tick, so that a sweep is spread over the whole interval
+     */
+    static const size_t EP_ADV_SLOTS = 32;
+    size_t allEpAdvSlot;
+    uint64_t allEpAdvSlotInterval;
+
+    std::mutex adv_mutex;
+    std::deque<std::string> advQueue;
+    std::unordered_set<std::string> advQueued;
+    bool advDrainPending;
+    uint32_t advRate;
+    uint32_t advBurst;
+    double advTokens;
+    std::chrono::steady_clock::time_point advLastRefill;
+    std::atomic<uint64_t> advSent;
+    std::atomic<uint64_t> advCoalesced;
+    std::chrono::steady_clock::time_point advRateStart;
+    uint64_t advRateSent;
+    double advSendRate;
+
     std::mutex ep_mutex;
     std::mutex tunnelep_mutex;
     typedef std::unordered_map<std::string, uint8_t> pending_ep_map_t;
@@ -17,6 +17,13 @@
 
 #include <string>
 #include <cstdint>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <bitset>
 #include <boost/noncopyable.hpp>
 
 namespace opflexagent {
@@ -28,9 +35,21 @@ class IdGenerator;
  * kernel.  When an ID is allocated, we ensure that no stale
  * connection state exists for that zone in the connection tracking
  * table.
+ *
+ * Zones released by the IdGenerator are flushed on a background
+ * thread and held back from reuse until the flush completes, so
+ * that allocating a zone that was flushed on release does not need
+ * to touch the kernel.  Zones that are free at startup are flushed
+ * together by the same thread, and allocating one of them waits for
+ * that flush to complete.
  */
 class CtZoneManager : private boost::noncopyable {
 public:
+    /**
+     * A set of connection tracking zones
+     */
+    typedef std::bitset<65536> zone_set_t;
+
     /**
      * Allocate a new CtZoneManager
      *
@@ -38,7 +57,7 @@ public:
      * the IdGenerator
      */
     CtZoneManager(IdGenerator& gen);
-    ~CtZoneManager();
+    virtual ~CtZoneManager();
 
     /**
      * Set the range of connection tracking zone IDs to use
@@ -75,6 +94,58 @@ public:
      */
     void erase(const std::string& str);
 
+    /**
+     * Stop the background flush of released zones.  Zones still
+     * waiting to be flushed are not returned to the IdGenerator.
+     */
+    void stop();
+
+    /**
+     * Get the number of released zones waiting to be flushed
+     * @return the number of zones held back from reuse
+     */
+    size_t getFlushQueueDepth();
+
+    /**
+     * Get the number of zones flushed in the background
+     * @return the number of zones
+     */
+    uint64_t getFlushedZones() const { return flushedZones; }
+
+    /**
+     * Get the number of connection tracking entries deleted by zone
+     * flushes
+     * @return the number of entries
+     */
+    uint64_t getFlushedEntries() const { return flushedEntries; }
+
+    /**
+     * Get the duration of the last zone flush
+     * @return the duration in milliseconds
+     */
+    uint64_t getLastFlushDuration() const { return lastFlushDuration; }
+
+protected:
+    /**
+     * Install the IdGenerator hooks for the namespace and start the
+     * thread that flushes released zones
+     */
+    void startZoneFlush();
+
+    /**
+     * Delete all connection tracking entries in a zone
+     * @param zoneId the zone to flush
+     * @return true if the zone was flushed
+     */
+    virtual bool flushZone(uint16_t zoneId);
+
+    /**
+     * Delete all connection tracking entries in a set of zones
+     * @param zones the zones to flush
+     * @return true if the zones were flushed
+     */
+    virtual bool flushZones(const zone_set_t& zones);
+
 private:
     uint16_t minId;
     uint16_t maxId;
@@ -83,7 +154,24 @@ private:
     IdGenerator& gen;
     std::string nmspc;
 
+    std::mutex flushMutex;
+    std::condition_variable flushCond;
+    std::deque<uint16_t> flushQueue;
+    /* zones flushed since they were last used */
+    zone_set_t cleanZones;
+    /* zones free at startup that are waiting for their first flush */
+    zone_set_t startupZones;
+    std::condition_variable startupCond;
+    std::unique_ptr<std::thread> flushThread;
+    bool flushStopping;
+
+    std::atomic<uint64_t> flushedZones;
+    std::atomic<uint64_t> flushedEntries;
+    std::atomic<uint64_t> lastFlushDuration;
+
     bool ctZoneAllocHook(const std::string&, uint32_t);
+    bool ctZoneFreeHook(const std::string&, uint32_t);
+    void flushWorker();
 };
 
 } /* namespace opflexagent */
@@ -0,0 +1,192 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Definition of FlowArena class
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_FLOWARENA_H_
+#define OPFLEXAGENT_FLOWARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace opflexagent {
+
+/**
+ * A bump allocator used to build flow entries during a render pass.
+ * Flow entries, their flow stats and their action buffers are carved
+ * out of large blocks and released all together when the pass
+ * completes, instead of being individually allocated and freed.
+ *
+ * Flow entries built in an arena are only valid until the end of the
+ * render pass; TableState makes heap copies of the entries it keeps.
+ *
+ * An arena is not thread-safe.  Each thread has its own arena which
+ * is activated for the duration of a FlowArena::Scope.
+ *
+ * The memory handed out between resets is capped.  Once an arena is
+ * full, for example because a flow entry was kept past the end of a
+ * render pass so that the arena could not be reset, new flow entries
+ * are allocated from the heap until the arena is next reset.
+ */
+class FlowArena : private boost::noncopyable {
+public:
+    /**
+     * Create an empty arena
+     *
+     * @param blockSize size of the blocks to allocate from
+     * @param maxBytes the number of bytes after which the arena is
+     * considered full
+     */
+    FlowArena(size_t blockSize = DEFAULT_BLOCK_SIZE,
+              size_t maxBytes = DEFAULT_MAX_BYTES);
+    ~FlowArena();
+
+    /**
+     * Allocate zeroed memory from the arena
+     *
+     * @param size the number of bytes to allocate
+     * @param align the required alignment
+     * @return a pointer to the allocated memory
+     */
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    /**
+     * Release all memory allocated from the arena for reuse.  This
+     * is a no-op if any flow entry built in the arena is still alive.
+     */
+    void reset();
+
+    /**
+     * Get the number of live flow entries allocated from the arena
+     */
+    size_t getLiveEntries() const { return liveEntries; }
+
+    /**
+     * Get the total number of bytes handed out since the last reset
+     */
+    size_t getBytesUsed() const { return bytesUsed; }
+
+    /**
+     * Check whether the arena has handed out its maximum number of
+     * bytes since the last reset.  New flow entries should not be
+     * allocated from a full arena.
+     */
+    bool isFull() const { return bytesUsed >= maxBytes; }
+
+    /**
+     * Get the arena active on the current thread, if any
+     *
+     * @return the active arena or nullptr
+     */
+    static FlowArena* current();
+
+    /**
+     * Activate the arena of the current thread for the lifetime of
+     * this object.  Nested scopes share the outermost arena, which
+     * is reset when the outermost scope exits.
+     */
+    class Scope : private boost::noncopyable {
+    public:
+        Scope();
+        ~Scope();
+    private:
+        bool owner;
+    };
+
+    /**
+     * Allocator that draws from a flow arena and never frees
+     * individual allocations.  Used with std::allocate_shared so
+     * that flow entries and their control blocks live in the arena.
+     */
+    template <typename T>
+    class Allocator {
+    public:
+        /** the allocated type */
+        typedef T value_type;
+
+        /**
+         * Create an allocator for the given arena
+         * @param arena_ the arena to allocate from
+         */
+        explicit Allocator(FlowArena& arena_) : arena(&arena_) {}
+
+        /**
+         * Rebind constructor
+         * @param o the allocator to copy
+         */
+        template <typename U>
+        Allocator(const Allocator<U>& o) : arena(o.arena) {}
+
+        /**
+         * Allocate storage for n objects
+         * @param n the number of objects
+         * @return the storage
+         */
+        T* allocate(size_t n) {
+            return static_cast<T*>(arena->allocate(n * sizeof(T),
+                                                   alignof(T)));
+        }
+
+        /**
+         * Arena storage is released with the arena
+         */
+        void deallocate(T*, size_t) {}
+
+        /** the arena to allocate from */
+        FlowArena* arena;
+    };
+
+    /** The default size of the blocks allocated by the arena */
+    static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    /** The default number of bytes after which the arena is full */
+    static const size_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+private:
+    friend class FlowEntry;
+
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    size_t blockSize;
+    size_t maxBytes;
+    std::vector<Block> blocks;
+    size_t curBlock;
+    size_t offset;
+    size_t bytesUsed;
+    size_t liveEntries;
+};
+
+/**
+ * Check whether two arena allocators are equal
+ */
+template <typename T, typename U>
+bool operator==(const FlowArena::Allocator<T>& a,
+                const FlowArena::Allocator<U>& b) {
+    return a.arena == b.arena;
+}
+
+/**
+ * Check whether two arena allocators are not equal
+ */
+template <typename T, typename U>
+bool operator!=(const FlowArena::Allocator<T>& a,
+                const FlowArena::Allocator<U>& b) {
+    return !(a == b);
+}
+
+} // namespace opflexagent
+
+#endif /* OPFLEXAGENT_FLOWARENA_H_ */
@@ -21,7 +21,9 @@
 namespace opflexagent {
 
 /**
- * Build a flow entry
+ * Build a flow entry.  When a FlowArena::Scope is active on the
+ * current thread, the entry and its actions are allocated from the
+ * thread's flow arena.
  */
 class FlowBuilder {
 public:
@@ -253,6 +255,13 @@ public:
      */
     FlowBuilder& tunId(uint64_t tunId);
 
+    /**
+     * Add a match against the ID of a conjunctive match
+     * @param id the conjunction ID to match
+     * @return this flow builder for chaining
+     */
+    FlowBuilder& conjId(uint32_t id);
+
     /**
      * Add a match against the value of a register
      * @param reg the register to match against
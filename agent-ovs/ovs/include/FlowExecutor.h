@@ -18,6 +18,8 @@
 #include <unordered_map>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <array>
 
 namespace opflexagent {
 
@@ -131,6 +133,18 @@ public:
      */
     static OfpBuf EncodeGroupMod(const GroupEdit::Entry& edit,
                                  int ofVersion);
+
+    /**
+     * Get the number of bytes of flow-modification messages encoded
+     * for a flow table
+     *
+     * @param tableId the flow table
+     * @return the number of bytes sent since the executor was created
+     */
+    uint64_t getEncodedBytes(uint8_t tableId) const {
+        return encodedBytes[tableId].load(std::memory_order_relaxed);
+    }
+
 private:
     /**
      * Internal helper function to execute blocking flow/group-edits.
@@ -186,6 +200,19 @@ private:
 
     SwitchConnection *swConn;
 
+    /* Bytes of flow mods encoded for each flow table */
+    std::array<std::atomic<uint64_t>, 256> encodedBytes;
+
+    /**
+     * Count the bytes of an encoded flow/group/tlv modification
+     *
+     * @param edit the modification
+     * @param size the size of the encoded message
+     */
+    void countEncoded(const FlowEdit::Entry& edit, size_t size);
+    void countEncoded(const GroupEdit::Entry&, size_t) {}
+    void countEncoded(const TlvEdit::Entry&, size_t) {}
+
     /**
      * @brief Maintains information about outstanding requests that
      * need to be tracked.
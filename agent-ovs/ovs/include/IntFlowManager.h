@@ -161,6 +161,108 @@ public:
      */
     void setFloodScope(FloodScope floodScope);
 
+    /**
+     * Methods for spreading service traffic over its next hops
+     */
+    enum ServiceLbMode {
+        /**
+         * Hash each flow directly to one of the next hops.  Any
+         * change to the set of next hops remaps existing flows and
+         * rewrites every next hop flow of the service.
+         */
+        SVC_LB_HASH,
+
+        /**
+         * Hash each flow to a bucket of a Maglev lookup table that
+         * maps buckets to next hops.  A change to the set of next
+         * hops rewrites and remaps only the buckets that move.
+         */
+        SVC_LB_MAGLEV
+    };
+
+    /**
+     * Set the service load balancing mode
+     * @param mode the service load balancing mode
+     */
+    void setServiceLbMode(ServiceLbMode mode);
+
+    /**
+     * Granularity of the counters kept for pod<-->service traffic
+     */
+    enum PodSvcStatsMode {
+        /**
+         * Keep a pair of counters for each endpoint and service
+         */
+        POD_SVC_STATS_PAIR,
+
+        /**
+         * Keep a pair of counters for each service, shared by all
+         * local endpoints
+         */
+        POD_SVC_STATS_SERVICE,
+
+        /**
+         * Keep a pair of counters for each local endpoint, shared by
+         * all services
+         */
+        POD_SVC_STATS_POD
+    };
+
+    /**
+     * Set how pod<-->service traffic is counted
+     *
+     * @param mode the granularity of the counters
+     * @param samplePercent the percentage of endpoint/service pairs
+     * for which stats flows are installed.  Pairs are chosen by a
+     * hash of their UUIDs, so the same pairs are tracked for as long
+     * as they exist.  Only used in the pair mode.
+     */
+    void setPodSvcStatsMode(PodSvcStatsMode mode, uint32_t samplePercent);
+
+    /**
+     * Get the sample bucket of a pod<-->svc pair.  A pair is tracked
+     * if its bucket is below the sample percentage.
+     *
+     * @param uuid the ep-uuid:svc-uuid pair
+     * @return the bucket, from 0 to 99
+     */
+    static uint32_t getPodSvcSampleBucket(const std::string& uuid);
+
+    /**
+     * Get the number of endpoint group updates that did not need to
+     * re-render the member endpoints because none of the group
+     * inputs to endpoint flows changed
+     *
+     * @return the number of skipped endpoint re-renders
+     */
+    uint64_t getEpgRenderSkipped() const { return epgRenderSkipped; }
+
+    /**
+     * Get the number of endpoint group updates that re-rendered the
+     * member endpoints
+     *
+     * @return the number of endpoint re-renders
+     */
+    uint64_t getEpgRenderFanouts() const { return epgRenderFanouts; }
+
+    /**
+     * Set how long a queued update waits before it is rendered so
+     * that a burst of updates for the same object renders once
+     *
+     * @param delay the debounce window, or zero to render updates as
+     * soon as possible
+     */
+    void setTaskDebounce(std::chrono::milliseconds delay);
+
+    /**
+     * Get queue depth, wait time and run time for each class of
+     * render task
+     *
+     * @param stats a map from task class to statistics to fill in
+     */
+    void getTaskStats(std::unordered_map<std::string,
+                                         TaskQueue::TaskStats>& stats) const;
+
     /**
      * Set the tunnel remote IP and port to use for tunnel traffic
      * @param tunnelRemoteIp the remote tunnel IP
@@ -202,10 +304,14 @@ public:
      * @param mode the endpoint advertisement mode
      * @param tunnelMode the tunnel endpoint advertisement mode
      * @param tunnelAdvIntvl the tunnel endpoint advertisement interval
+     * @param advRate the endpoint advertisement rate in packets per
+     * second, or 0 for no pacing
+     * @param advBurst the endpoint advertisement burst size
      */
     void setEndpointAdv(AdvertManager::EndpointAdvMode mode,
             AdvertManager::EndpointAdvMode tunnelMode,
-            uint64_t tunnelAdvIntvl=600);
+            uint64_t tunnelAdvIntvl=600,
+            uint32_t advRate=1000, uint32_t advBurst=64);
 
     /**
      * Set the multicast group file
@@ -497,13 +603,14 @@ public:
                              bool ep_to_svc,
                              uint64_t &cookie) {
         const std::lock_guard<mutex> lock(svcStatMutex);
-        if(podSvcUuidCkMap.find(uuid) == podSvcUuidCkMap.end()) {
+        std::string key = getPodSvcStatsKey(uuid);
+        if(podSvcUuidCkMap.find(key) == podSvcUuidCkMap.end()) {
             return false;
         }
         if(ep_to_svc) {
-                cookie = podSvcUuidCkMap[uuid].first;
+                cookie = podSvcUuidCkMap[key].first;
         } else {
-                cookie = podSvcUuidCkMap[uuid].second;
+                cookie = podSvcUuidCkMap[key].second;
         }
         return true;
     }
@@ -846,6 +953,7 @@ private:
     EncapType encapType;
     std::string encapIface, uplinkIface;
     FloodScope floodScope;
+    ServiceLbMode svcLbMode;
     boost::asio::ip::address tunnelDst;
     std::string tunnelPortStr;
     boost::optional<boost::asio::ip::address> mcastTunDst;
@@ -861,11 +969,88 @@ private:
     boost::asio::ip::address dropLogDst;
     uint16_t dropLogRemotePort;
     bool serviceStatsFlowDisabled;
+    PodSvcStatsMode podSvcStatsMode;
+    uint32_t podSvcStatsSamplePercent;
+
+    /* Maglev table size in use for each mapping of each service.
+     * Tables only grow while the service exists, so that a next hop
+     * count going back and forth across a size boundary does not
+     * remap every bucket. */
+    std::mutex svcLbMutex;
+    unordered_map<std::string,
+                  unordered_map<std::string, size_t>> svcLbTableSize;
+
+    /**
+     * Get the Maglev table size to use for a service mapping
+     *
+     * @param uuid the UUID of the service
+     * @param sm the service mapping
+     * @param nextHops the number of next hops of the mapping
+     * @return the table size
+     */
+    size_t getServiceLbTableSize(const std::string& uuid,
+                                 const Service::ServiceMapping& sm,
+                                 size_t nextHops);
+
+    /**
+     * Forget the Maglev table sizes of mappings that are no longer
+     * part of a service
+     *
+     * @param uuid the UUID of the service
+     * @param as the service
+     */
+    void pruneServiceLbTables(const std::string& uuid, const Service& as);
 
     /* Map containing ingress and egress cookie: Flows generated out
      * of same pod<-->svc uuid will use these cookies */
     unordered_map<std::string, pair<uint64_t, uint64_t>> podSvcUuidCkMap;
 
+    /* pod<-->svc uuids sharing the counters of each aggregated
+     * ep-uuid:* or *:svc-uuid key.  The counters are removed along
+     * with the last pair. */
+    unordered_map<std::string, unordered_set<std::string>> podSvcAggMap;
+
+    /* In the service and pod modes: the endpoint IPs counted for each
+     * pair, by endpoint uuid and then service uuid, and the endpoints
+     * paired with each service */
+    unordered_map<std::string,
+                  unordered_map<std::string,
+                                unordered_set<std::string>>> podSvcAggEps;
+    unordered_map<std::string, unordered_set<std::string>> podSvcAggSvcs;
+
+    /**
+     * Write the conjunction clause flows that match the IPs of an
+     * endpoint for the aggregated pod<-->svc counters
+     *
+     * @param epUuid the UUID of the endpoint
+     */
+    void writePodSvcAggEpFlows(const std::string& epUuid);
+
+    /**
+     * Write the conjunction clause flows that match the mappings of
+     * a service for the aggregated pod<-->svc counters
+     *
+     * @param svcUuid the UUID of the service
+     */
+    void writePodSvcAggSvcFlows(const std::string& svcUuid);
+
+    /**
+     * Get the key of the counters for a pod<-->svc uuid in the
+     * current stats mode
+     *
+     * @param uuid the ep-uuid:svc-uuid pair
+     * @return the pair itself, ep-uuid:* or *:svc-uuid
+     */
+    std::string getPodSvcStatsKey(const std::string& uuid) const;
+
+    /**
+     * Check whether stats flows are installed for a pod<-->svc uuid
+     *
+     * @param uuid the ep-uuid:svc-uuid pair
+     * @return true if the pair is sampled
+     */
+    bool isPodSvcPairTracked(const std::string& uuid) const;
+
     /* Cookie cleanup of any<-->svc flows:
      * The key for every cookie is per NH svc-tgt.
      * svctoan:svc-tgt:svcuuid:nhip
@@ -890,6 +1075,37 @@ private:
     typedef std::unordered_map<opflex::modb::URI, Ep2PortMap> FloodGroupMap;
     FloodGroupMap floodGroupMap;
 
+    /**
+     * The inputs to endpoint flows that come from an endpoint group
+     * and its forwarding domains, as of the last time the group was
+     * rendered.  When a group update leaves these unchanged, its
+     * member endpoints are not re-rendered.
+     */
+    struct EpgRenderState {
+        uint32_t vnid;
+        uint32_t rdId;
+        uint32_t bdId;
+        uint32_t fgrpId;
+        uint8_t routingMode;
+        uint8_t arpMode;
+        uint8_t ndMode;
+        uint8_t unkFloodMode;
+        uint8_t bcastFloodMode;
+        boost::asio::ip::address tunDst;
+        uint64_t generation;
+
+        bool operator==(const EpgRenderState& o) const;
+    };
+    std::unordered_map<opflex::modb::URI, EpgRenderState> epgRenderStates;
+
+    /**
+     * Incremented when global state used to render endpoints
+     * changes, so that every group re-renders its endpoints
+     */
+    uint64_t renderGeneration;
+    std::atomic<uint64_t> epgRenderFanouts;
+    std::atomic<uint64_t> epgRenderSkipped;
+
     uint32_t getExtNetVnid(const opflex::modb::URI& uri);
 
     AdvertManager advertManager;
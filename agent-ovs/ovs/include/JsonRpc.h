@@ -44,6 +44,13 @@ static const string ERSPAN_PORT_PREFIX("erspan");
 
 /**
  * class to handle JSON/RPC transactions without opflex.
+ *
+ * There is no local replica of OVSDB: every lookup is a select that
+ * waits for its reply from ovsdb-server.  Keeping a replica would
+ * need a monitor and its update notifications, which the JSON/RPC
+ * layer drops since it accepts no frames without an id.  Callers
+ * that need several rows should use the lookups that read them in
+ * one select, such as getPortUuids.
  */
 class JsonRpc : public Transaction {
 public:
@@ -120,10 +127,10 @@ public:
     bool createMirror(const string& uuid, const string& name, const set<string>& srcPorts, const set<string>& dstPorts);
 
     /**
-     * get port uuids from OVSDB
-     * @param[out] ports map of mirror ports. The uuids are populated in
-     * map.
-     *
+     * get port uuids from OVSDB using a single select of the port
+     * table
+     * @param[in,out] ports map of mirror port names to uuids. The
+     * uuids of ports found in OVSDB are populated in the map.
      */
     void getPortUuids(map<string, string>& ports);
 
@@ -136,14 +143,15 @@ public:
     bool deleteMirror(const string& brName, const string& sessionName);
 
     /**
-     * get uuid of bridge from OVSDB
+     * get uuid of bridge from OVSDB.  This is one round trip.
      * @param[in] name name of bridge
      * @param[out] uuid of the bridge or empty
      */
     void getBridgeUuid(const string& name, string& uuid);
 
     /**
-     * get uuid of the named mirror from OVSDB
+     * get uuid of the named mirror from OVSDB.  This is one round
+     * trip.
      * @param[in] name name of mirror
      * @param[out] uuid of the mirror or empty
      */
@@ -166,7 +174,8 @@ public:
     bool addErspanPort(const string& bridgeName, ErspanParams& params);
 
     /**
-     * createNetFlow
+     * createNetFlow.  Any IPFIX exporter on the bridge is removed in
+     * the same transaction.
      * @param[in] brUuid uuid of the bridge to add the netflow to.
      * @param[in] target target of netflow
      * @param[in] timeout timeout of netflow
@@ -183,7 +192,8 @@ public:
     bool deleteNetFlow(const string& brName);
 
     /**
-     * createNetFlow
+     * createIpfix.  Any NetFlow exporter on the bridge is removed in
+     * the same transaction.
      * @param[in] brUuid uuid of the bridge to add the ipfix to.
      * @param[in] target target of ipfix
      * @param[in] sampling sampling of ipfix
@@ -223,7 +233,8 @@ public:
     static bool handleMirrorConfig(const rapidjson::Document& payload, mirror& mir);
 
     /**
-     * get the mirror config from OVSDB.
+     * get the mirror config from OVSDB.  This takes a round trip for
+     * the mirror and one for the names of its ports.
      * @param[in] sessionName session name
      * @param[out] mir struct to hold mirror data
      * @return bool true if retrieval succeeded, false otherwise.
@@ -0,0 +1,66 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Definition of MaglevTable class
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef OPFLEXAGENT_MAGLEVTABLE_H_
+#define OPFLEXAGENT_MAGLEVTABLE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Consistent hashing lookup table as described in "Maglev: A Fast
+ * and Reliable Software Network Load Balancer" (NSDI '16).  Every
+ * bucket of the table maps to one backend; each backend gets an
+ * almost equal share of the buckets, and adding or removing a
+ * backend moves only a small fraction of the buckets that belong to
+ * the other backends.
+ */
+class MaglevTable {
+public:
+    /**
+     * Number of buckets allocated for each backend when sizing a
+     * table.  The share of buckets of any two backends differs by at
+     * most one, so this bounds the imbalance to 1/BUCKETS_PER_BACKEND.
+     */
+    static const size_t BUCKETS_PER_BACKEND = 8;
+
+    /**
+     * Get the table size to use for the given number of backends.
+     * The size is a prime of at least BUCKETS_PER_BACKEND buckets per
+     * backend, and at least minSize, up to a maximum of 65521.
+     *
+     * @param backends the number of backends
+     * @param minSize the smallest acceptable table size; pass the
+     * size currently in use to avoid shrinking a table and remapping
+     * every bucket
+     * @return the table size
+     */
+    static size_t getTableSize(size_t backends, size_t minSize = 0);
+
+    /**
+     * Populate a lookup table.  The result depends only on the set
+     * of backend names and not on their order.
+     *
+     * @param backends the names of the backends
+     * @param size the table size, which must be prime
+     * @param table the table to fill; each entry is set to the index
+     * in backends of the backend for that bucket.  The table is
+     * empty if there are no backends.
+     */
+    static void populate(const std::vector<std::string>& backends,
+                         size_t size, std::vector<size_t>& table);
+};
+
+}   // namespace opflexagent
+
+#endif // OPFLEXAGENT_MAGLEVTABLE_H_
@@ -105,6 +105,9 @@ private:
     AdvertManager::EndpointAdvMode endpointAdvMode;
     AdvertManager::EndpointAdvMode tunnelEndpointAdvMode;
     uint64_t tunnelEndpointAdvIntvl;
+    uint32_t endpointAdvRate;
+    uint32_t endpointAdvBurst;
+    uint32_t updateDebounce;
     bool virtualDHCP;
     std::string virtualDHCPMac;
     std::string flowIdCache;
@@ -112,6 +115,7 @@ private:
     bool connTrack;
     uint16_t ctZoneRangeStart;
     uint16_t ctZoneRangeEnd;
+    IntFlowManager::ServiceLbMode serviceLbMode;
     bool ovsdbUseLocalTcpPort;
 
     bool ifaceStatsEnabled;
@@ -119,6 +123,8 @@ private:
     bool contractStatsEnabled;
     long contractStatsInterval;
     bool serviceStatsFlowDisabled;
+    IntFlowManager::PodSvcStatsMode podSvcStatsMode;
+    uint32_t podSvcStatsSamplePercent;
     bool serviceStatsEnabled;
     long serviceStatsInterval;
     bool secGroupStatsEnabled;
@@ -143,6 +149,14 @@ private:
     void onCleanupTimer(const boost::system::error_code& ec);
     std::unique_ptr<boost::asio::deadline_timer> cleanupTimer;
 
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    /**
+     * Timer callback to publish renderer statistics
+     */
+    void onStatsTimer(const boost::system::error_code& ec);
+    std::unique_ptr<boost::asio::deadline_timer> statsTimer;
+#endif
+
     /**
      * Start packet logger
      */
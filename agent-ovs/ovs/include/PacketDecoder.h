@@ -22,6 +22,7 @@
 #include <boost/functional/hash.hpp>
 #include <map>
 #include <time.h>
+#include <cstring>
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 #include <iomanip>
@@ -84,6 +85,18 @@ public:
         }
         value = fields[index].second;
     }
+    /**
+     * append a named member after the standard tuple members
+     * @param name name of the member
+     * @param value value of the member
+     * */
+    void addField(const std::string &name, const std::string &value);
+    /**
+     * format a time as used in the TimeStamp member
+     * @param ts time to format
+     * @return formatted time
+     * */
+    static std::string formatTimeStamp(time_t ts);
     /**
      * serialize this packet tuple into a json stream
      * @param writer JSON encoder
@@ -108,6 +121,77 @@ public:
  */
 bool operator== (const PacketTuple &lhs, const PacketTuple &rhs);
 
+/* Allowed header field types */
+typedef enum  {
+    FLDTYPE_NONE,
+    FLDTYPE_BITFIELD,
+    FLDTYPE_BYTES,
+    FLDTYPE_IPv4ADDR,
+    FLDTYPE_IPv6ADDR,
+    FLDTYPE_MAC,
+    FLDTYPE_VARBYTES,
+    FLDTYPE_OPTBYTES
+} PacketDecoderLayerFieldType;
+
+class PacketDecoderLayerField;
+class PacketDecoderLayer;
+class PacketDecoderLayerVariant;
+
+/**
+ * Raw value of a decoded header field.  Values are stored in binary
+ * form and only converted to text when the packet is logged or
+ * exported.
+ */
+struct PacketFieldValue {
+    /**
+     * Field that produced this value, or nullptr if not decoded
+     */
+    const PacketDecoderLayerField *field;
+    /**
+     * Layer type that the value selects if the field is a next
+     * layer key
+     */
+    uint32_t nextLayerTypeId;
+    /**
+     * Number of valid bytes for byte string values
+     */
+    uint32_t length;
+    /**
+     * The value
+     */
+    union {
+        /** Integer value */
+        uint32_t value;
+        /** Address and byte string values */
+        uint8_t bytes[16];
+    };
+};
+
+/**
+ * Text formatter for a layer output format string such as
+ * " SPT=%1% DPT=%2%".  The format string is split once into literal
+ * text and argument references.
+ */
+class PacketLayerFormat {
+public:
+    /**
+     * Split the given format string
+     * @param fmt format string with %N% argument references
+     */
+    void parse(const std::string &fmt);
+    /**
+     * Append the formatted output
+     * @param args argument values
+     * @param numArgs number of argument values
+     * @param out string to append to
+     */
+    void render(const std::string *args, unsigned numArgs,
+                std::string &out) const;
+private:
+    /* Literal text followed by an argument index, or -1 for none */
+    std::vector<std::pair<std::string, int>> segments;
+};
+
 /**
  *  Struct to hold parsing context
  */
@@ -118,19 +202,12 @@ struct ParseInfo {
      * driving the parsing
      */
     ParseInfo(PacketDecoder *_decoder):pktDecoder(_decoder),nextLayerTypeId(0),
-            nextKey(0), optionLayerTypeId(0), parsedLength(0), parsedString(),
-            formattedFields(), layerFormatterString(), hasOptBytes(false),
-            pendingOptionLength(0), inferredLength(0), inferredDataLength(0),
-            scratchpad{0,0,0,0}, packetTuple() {
-        time_t rawtime = std::time(nullptr);
-        char currTime[256];
-        std::strftime(currTime, sizeof(currTime),"%a %b %d %H:%M:%S %Z %Y", std::localtime(&rawtime));
-        packetTuple.TimeStamp = std::string(currTime);
-        /*Remove trailing newline as it causes issues in JSON decoding*/
-        if(!packetTuple.TimeStamp.empty() &&
-           packetTuple.TimeStamp[packetTuple.TimeStamp.length() -1] == '\n') {
-           packetTuple.TimeStamp.erase(packetTuple.TimeStamp.length()-1);
-        }
+            nextKey(0), optionLayerTypeId(0), parsedLength(0),
+            hasOptBytes(false), pendingOptionLength(0), inferredLength(0),
+            inferredDataLength(0), scratchpad{0,0,0,0}, meta{0,0},
+            timeStamp(std::time(nullptr)), numLayers(0), numValues(0),
+            layerStart(0) {
+        memset(tuple, 0, sizeof(tuple));
     };
     /**
      * Packet decoder instance
@@ -152,22 +229,6 @@ struct ParseInfo {
      * Bytes parsed by current layer
      */
     uint32_t parsedLength;
-    /**
-     * Parsed output
-     */
-    std::string parsedString;
-    /**
-     * Parsed output for current layer
-     */
-    std::string parsedLayerString;
-    /**
-     * Field values in the format string of a given layer
-     */
-    std::vector<std::string> formattedFields;
-    /**
-     * Format string of a given layer
-     */
-    boost::format layerFormatterString;
     /**
      * Layer has variable length data
      */
@@ -188,27 +249,92 @@ struct ParseInfo {
      * Scratchpad to store 4 select field values in a layer
      */
     uint32_t scratchpad[4];
-    /**
-     * Packet Tuple used to generate events
-     */
-    PacketTuple packetTuple;
     /**
      * Source Bridge and TableId
      */
     uint32_t meta[2];
-};
+    /**
+     * Time when the packet was received
+     */
+    time_t timeStamp;
 
-/* Allowed header field types */
-typedef enum  {
-    FLDTYPE_NONE,
-    FLDTYPE_BITFIELD,
-    FLDTYPE_BYTES,
-    FLDTYPE_IPv4ADDR,
-    FLDTYPE_IPv6ADDR,
-    FLDTYPE_MAC,
-    FLDTYPE_VARBYTES,
-    FLDTYPE_OPTBYTES
-} PacketDecoderLayerFieldType;
+    /**
+     * Render the decoded layers in human-readable form
+     * @return parsed output
+     */
+    std::string getParsedString() const;
+    /**
+     * Render the packet tuple used to generate events
+     * @param packetTuple tuple to fill in
+     */
+    void getPacketTuple(PacketTuple &packetTuple) const;
+    /**
+     * Get the raw value of a packet tuple field
+     * @param index index of the tuple field
+     * @return the value; its field is nullptr if it was not decoded
+     */
+    const PacketFieldValue &getTupleValue(unsigned index) const {
+        return tuple[index];
+    }
+
+    /**
+     * Start recording the output fields of a layer
+     */
+    void beginLayer() {
+        layerStart = numValues;
+    }
+    /**
+     * Finish recording the output fields of a layer
+     * @param layer the layer being decoded
+     * @param variant variant of the layer, if any
+     */
+    void endLayer(const PacketDecoderLayer *layer,
+                  const PacketDecoderLayerVariant *variant);
+    /**
+     * Discard the output fields recorded for the current layer
+     */
+    void abortLayer() {
+        numValues = layerStart;
+    }
+    /**
+     * Record a decoded field value
+     * @param v the value
+     * @param output whether the value is part of the layer output
+     * @param tupleSeq position of the value in the packet tuple, or 0
+     */
+    void recordValue(const PacketFieldValue &v, bool output, int tupleSeq) {
+        if (output && numValues < MAX_VALUES) {
+            values[numValues++] = v;
+        }
+        if (tupleSeq > 0 && tupleSeq <= TUPLE_FIELDS) {
+            tuple[tupleSeq-1] = v;
+        }
+    }
+
+    /**
+     * Number of fields in a packet tuple
+     */
+    static const int TUPLE_FIELDS = 9;
+
+private:
+    static const unsigned MAX_LAYERS = 16;
+    static const unsigned MAX_VALUES = 64;
+    static const unsigned MAX_ARGS = 16;
+
+    struct DecodedLayer {
+        const PacketDecoderLayer *layer;
+        const PacketDecoderLayerVariant *variant;
+        unsigned firstValue;
+        unsigned numValues;
+    };
+
+    DecodedLayer layers[MAX_LAYERS];
+    unsigned numLayers;
+    PacketFieldValue values[MAX_VALUES];
+    unsigned numValues;
+    PacketFieldValue tuple[TUPLE_FIELDS];
+    unsigned layerStart;
+};
 
 /**
  * Class to represent a packet header field
@@ -234,7 +360,9 @@ public:
             int printSeq = 0, int tupleSeq_ = 0, int metaSeq_ = 0):
         fieldType(type), fieldName(name), bitLength(len), bitOffset(offset),
         isNextKey(nextKey), isLength(length), scratchOffset(_scratchOffset),
-        outSeq(printSeq), tupleSeq(tupleSeq_), metaSeq(metaSeq_) {}
+        outSeq(printSeq), tupleSeq(tupleSeq_), metaSeq(metaSeq_) {
+        computeExtraction();
+    }
     /**
      * Whether matching traffic should be allowed or dropped
      * @return true if this field indicates the length of the containing Layer
@@ -248,6 +376,19 @@ public:
      * @return true if required number of bits were extracted and valid.
      */
     int decode(const unsigned char *buf, std::size_t length, ParseInfo &p);
+    /**
+     * Append the human readable form of a value decoded by this field
+     * @param v decoded value
+     * @param decoder decoder used to resolve next layer names
+     * @param out string to append to
+     */
+    void render(const PacketFieldValue &v, PacketDecoder *decoder,
+                std::string &out) const;
+    /**
+     * Get the position of this field in the layer output
+     * @return output sequence number, or 0 if not printed
+     */
+    int getOutSeq() const {return outSeq;}
     /**
      * populate human readable strings for specific field values as a map
      * @param outMap value to string map for field values.
@@ -261,12 +402,15 @@ private:
     bool isNextKey,isLength;
     int scratchOffset, outSeq, tupleSeq, metaSeq;
     std::unordered_map<uint32_t, std::string> kvOutMap;
+    /* Byte range and shift used to extract the value, computed once */
+    uint32_t byteOffset, byteCount, shift, mask;
+    void computeExtraction();
+    uint32_t extract(const unsigned char *buf) const;
     bool getIsNextKey() {return isNextKey;}
     bool shouldSave(int &_offset) {_offset=scratchOffset; return (_offset != -1);}
     bool shouldLog() {return (outSeq != 0);}
     bool isTupleField() {return (tupleSeq != 0);}
     bool isMetaField() {return (metaSeq != 0);}
-    void transformLog(uint32_t val, std::stringstream &ostr, ParseInfo &p);
 };
 
 /**
@@ -292,9 +436,9 @@ public:
 
     /**
      * Get the format string for this variant's output
-     * @param fmtStr format String for variant output
+     * @return format String for variant output
      */
-    virtual void getFormatString(boost::format &fmtStr)=0;
+    virtual const char *getFormatString()=0;
     /**
      * Configure the variant and contained fields
      * @return 0 if successfully configured
@@ -336,6 +480,15 @@ public:
         keyData.push_back(key);
         boost::hash_combine(hash,key);
     }
+    /**
+     * Get the parsed format for this variant's output
+     * @return output format
+     */
+    const PacketLayerFormat &getFormat() const { return outFormat; }
+    /**
+     * Parse the format string of this variant
+     */
+    void initFormat() { outFormat.parse(getFormatString()); }
 protected:
     ///@{
     /** Layer Identifiers as mentioned */
@@ -349,6 +502,8 @@ protected:
     std::vector<uint32_t> keyData;
     /** Hash of key data */
     std::size_t hash;
+    /** Parsed output format */
+    PacketLayerFormat outFormat;
 };
 
 /**
@@ -497,9 +652,23 @@ public:
     virtual bool hasOptBytes(ParseInfo &p) {return 0;}
     /**
      * Get the format string for this layer's output
-     * @param fmtStr format String for layer output
+     * @return format String for layer output
+     */
+    virtual const char *getFormatString()=0;
+    /**
+     * Get the parsed format for this layer's output
+     * @return output format
+     */
+    const PacketLayerFormat &getFormat() const { return outFormat; }
+    /**
+     * Parse the format string of this layer
      */
-    virtual void getFormatString(boost::format &fmtStr)=0;
+    void initFormat() { outFormat.parse(getFormatString()); }
+    /**
+     * Get the number of arguments in the format string
+     * @return number of arguments
+     */
+    uint32_t getNumOutArgs() const { return numOutArgs; }
     /**
      * Get the variant layer from parsed data
      * @param p Parsing Context and output
@@ -534,6 +703,10 @@ protected:
      * This is an option header layer
      */
     bool amOptionLayer;
+    /**
+     * Parsed output format
+     */
+    PacketLayerFormat outFormat;
     /**
      * Add a field to this layer
      * @param name field name
@@ -22,7 +22,7 @@ public:
     EthernetLayer():PacketDecoderLayer("Datalink", 25944, "Ethernet", 14, "EProto", "none", 1, 1, 2, 0, 0, 3){};
     virtual ~EthernetLayer() {};
     virtual int configure();
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 /**
@@ -33,7 +33,7 @@ public:
     QtagLayer():PacketDecoderLayer("EProto", 33024, "Qtag", 4, "EProto", "none", 2, 2, 2, 0, 0, 1){};
     virtual ~QtagLayer() {};
     virtual int configure();
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 /**
@@ -45,7 +45,7 @@ public:
     virtual ~IPv4Layer() {};
     virtual int configure();
     virtual void getOptionLength(ParseInfo &p);
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 /**
@@ -58,7 +58,7 @@ public:
     virtual ~GeneveLayer() {};
     virtual int configure();
     virtual void getOptionLength(ParseInfo &p);
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 /**
@@ -71,7 +71,7 @@ public:
     virtual int configure();
     virtual uint32_t getVariableDataLength(uint32_t hdrLength);
     virtual uint32_t getVariableHeaderLength(uint32_t fldVal);
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
     virtual std::shared_ptr<PacketDecoderLayerVariant>
             getVariant(ParseInfo &p);
 };
@@ -84,7 +84,7 @@ public:
     GeneveOptTableIdLayerVariant():PacketDecoderLayerVariant("GeneveOpt", "TableId", 5, 1){};
     virtual ~GeneveOptTableIdLayerVariant() {};
     virtual int configure();
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
     virtual void reParse(ParseInfo &p);
 };
 
@@ -96,7 +96,7 @@ public:
     ARPLayer():PacketDecoderLayer("EProto", 2054, "ARP", 28, "none", "none", 2, 7, 1, 0, 0, 3){};
     virtual ~ARPLayer() {};
     virtual int configure();
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 /**
@@ -107,7 +107,7 @@ public:
     ICMPLayer():PacketDecoderLayer("IPProto", 1, "ICMP", 8, "none", "none", 4, 8, 1, 0, 0, 4){};
     virtual ~ICMPLayer() {};
     virtual int configure();
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 /**
@@ -119,7 +119,7 @@ public:
     virtual ~TCPLayer() {};
     virtual int configure();
     virtual void getOptionLength(ParseInfo &p);
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 /**
@@ -133,7 +133,7 @@ public:
     virtual uint32_t getVariableDataLength(uint32_t hdrLength);
     virtual uint32_t getVariableHeaderLength(uint32_t fldVal);
     virtual bool hasOptBytes(ParseInfo &p);
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 /**
@@ -144,7 +144,7 @@ public:
     UDPLayer():PacketDecoderLayer("IPProto", 17, "UDP", 8, "none", "none", 4, 11, 7, 0, 0, 3){};
     virtual ~UDPLayer() {};
     virtual int configure();
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 /**
@@ -155,7 +155,7 @@ public:
     IPv6Layer():PacketDecoderLayer("EProto", 34525, "IPv6", 40, "IPProto", "none", 2, 12, 4, 0, 0, 7){};
     virtual ~IPv6Layer() {};
     virtual int configure();
-    virtual void getFormatString(boost::format &fmtStr);
+    virtual const char *getFormatString();
 };
 
 }
@@ -19,6 +19,13 @@
 #include "FlowReader.h"
 #include "TableState.h"
 #include <opflexagent/Agent.h>
+#include <opflexagent/EndpointListener.h>
+#include "ovs-ofpbuf.h"
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 struct dp_packet;
 struct flow;
@@ -28,10 +35,75 @@ namespace opflexagent {
 
 class IntFlowManager;
 
+/**
+ * Cache of DHCP replies composed for each endpoint.  A cached reply
+ * is a template that only needs its transaction ID and client address
+ * patched before it can be sent, so retrying clients do not cause the
+ * reply to be composed again.
+ */
+class DhcpReplyCache : private boost::noncopyable {
+public:
+    /**
+     * A function that composes a reply
+     */
+    typedef std::function<OfpBuf ()> compose_t;
+
+    /**
+     * Get a copy of the reply for the given endpoint and key,
+     * composing and caching it if there is no cached reply for the
+     * current version of the endpoint.
+     *
+     * @param ep the endpoint the reply is for
+     * @param key identifies the reply among the replies for the
+     * endpoint
+     * @param compose the function used to compose the reply on a
+     * cache miss
+     * @return a copy of the reply, or a null buffer if the reply
+     * could not be composed
+     */
+    OfpBuf get(const std::shared_ptr<const Endpoint>& ep,
+               const std::string& key,
+               const compose_t& compose);
+
+    /**
+     * Drop the cached replies for an endpoint
+     *
+     * @param uuid the UUID of the endpoint
+     */
+    void invalidate(const std::string& uuid);
+
+    /**
+     * Drop all cached replies
+     */
+    void clear();
+
+    /**
+     * Get the number of replies currently cached
+     */
+    size_t size();
+
+    /**
+     * Maximum number of replies cached for a single endpoint
+     */
+    static const size_t MAX_REPLIES_PER_EP = 8;
+
+private:
+    struct CacheEntry {
+        std::shared_ptr<const Endpoint> ep;
+        std::unordered_map<std::string, OfpBuf> replies;
+    };
+
+    std::mutex cacheMutex;
+    std::unordered_map<std::string, CacheEntry> cache;
+    /** incremented on invalidation to detect races with compose */
+    uint64_t generation = 0;
+};
+
 /**
  * Handler for packet-in messages arriving from the switch
  */
 class PacketInHandler : public MessageHandler,
+                        public EndpointListener,
                         private boost::noncopyable {
 public:
     /**
@@ -80,6 +152,17 @@ public:
                         ofpbuf *msg,
                         struct ofputil_flow_removed* fentry=NULL);
 
+    // ****************
+    // EndpointListener
+    // ****************
+
+    virtual void endpointUpdated(const std::string& uuid);
+
+    /**
+     * Get the cache of composed DHCP replies
+     */
+    DhcpReplyCache& getDhcpReplyCache() { return dhcpReplyCache; }
+
 private:
     Agent& agent;
     IntFlowManager& intFlowManager;
@@ -88,6 +171,7 @@ private:
     FlowReader* intFlowReader;
     SwitchConnection* intSwConnection;
     SwitchConnection* accSwConnection;
+    DhcpReplyCache dhcpReplyCache;
 };
 } /* namespace opflexagent */
 
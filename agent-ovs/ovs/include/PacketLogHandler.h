@@ -20,6 +20,8 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <list>
+#include <unordered_map>
 
 #pragma once
 #ifndef OPFLEXAGENT_PACKETLOGHANDLER_H_
@@ -142,6 +144,7 @@ private:
     bool connected;
     unsigned pendingDataLen;
     static const unsigned maxEventsPerBuffer=10;
+    static const unsigned maxEventSize=1024;
 };
 
 /**
@@ -156,7 +159,8 @@ public:
      */
     PacketLogHandler(boost::asio::io_service &_io,
             boost::asio::io_service &_clientio):server_io(_io),
-            client_io(_clientio), port(0), stopped(false), throttleActive(false){}
+            client_io(_clientio), port(0), stopped(false), throttleActive(false),
+            lostDropFlowSummaries(0) {}
     /**
      * set IPv4 listening address for the socket
      * @param _addr IPv4 address
@@ -218,8 +222,96 @@ public:
      * @param length total length of packet
      */
     void parseLog(unsigned char *buf , std::size_t length);
+    /**
+     * Emit a summary for every drop flow seen since the last call
+     * and forget flows that have been idle since then.  Called
+     * periodically from the listener.
+     */
+    void flushDropFlows();
 
 protected:
+    /**
+     * Key identifying a flow of dropped packets: the bridge and
+     * table that dropped it and the packet 5-tuple
+     */
+    struct DropFlowKey {
+        /** Bridge and table id */
+        uint32_t meta[2];
+        /** Ethertype */
+        uint32_t ethType;
+        /** IP protocol */
+        uint32_t ipProto;
+        /** Source port */
+        uint32_t srcPort;
+        /** Destination port */
+        uint32_t dstPort;
+        /** Source address */
+        uint8_t srcIp[16];
+        /** Destination address */
+        uint8_t dstIp[16];
+
+        /** Equality operator */
+        bool operator==(const DropFlowKey &rhs) const {
+            return memcmp(this, &rhs, sizeof(*this)) == 0;
+        }
+    };
+
+    /**
+     * Hash function for DropFlowKey
+     */
+    struct DropFlowKeyHash {
+        /** Hash the key */
+        std::size_t operator()(const DropFlowKey &key) const {
+            const uint8_t *b = reinterpret_cast<const uint8_t*>(&key);
+            return boost::hash_range(b, b + sizeof(key));
+        }
+    };
+
+    /**
+     * Packets dropped for a flow since the last summary
+     */
+    struct DropFlow {
+        /** Flow key */
+        DropFlowKey key;
+        /** Packet tuple of the first packet, with drop reason */
+        PacketTuple tuple;
+        /** Packets dropped */
+        uint64_t packets;
+        /** Bytes dropped */
+        uint64_t bytes;
+        /** Packets already logged individually */
+        uint64_t loggedPackets;
+        /** Packets already exported as individual events */
+        uint64_t exportedPackets;
+        /** Time of first dropped packet */
+        time_t firstSeen;
+        /** Time of last dropped packet */
+        time_t lastSeen;
+    };
+
+    /**
+     * Count a dropped packet against its flow
+     * @param p parsing context of the packet
+     * @param dropReason drop reason of the packet
+     * @param length length of the packet
+     * @return the flow if it was not seen since the last summary,
+     * or nullptr otherwise
+     */
+    DropFlow *updateDropFlow(const ParseInfo &p,
+                             const std::string &dropReason,
+                             std::size_t length);
+    /**
+     * Log a summary for a drop flow and queue it for export.  The
+     * summary is only logged or exported if the flow dropped packets
+     * that were not already logged or exported individually.
+     * @param flow the flow
+     */
+    void emitDropFlowSummary(const DropFlow &flow);
+    /**
+     * Schedule the next drop flow summary
+     */
+    void startSummaryTimer();
+
     ///@{
     /** Member names are self-explanatory */
     boost::asio::io_service &server_io;
@@ -234,9 +326,17 @@ protected:
     std::mutex qMutex;
     std::condition_variable cond;
     std::queue<PacketTuple> packetTupleQ;
+    std::queue<PacketTuple> dropFlowSummaryQ;
     bool throttleActive;
+    uint64_t lostDropFlowSummaries;
     TableDescriptionMap intTableDescMap, accTableDescMap;
+    std::list<DropFlow> dropFlowLru;
+    std::unordered_map<DropFlowKey, std::list<DropFlow>::iterator,
+                       DropFlowKeyHash> dropFlowMap;
+    std::unique_ptr<boost::asio::deadline_timer> summaryTimer;
     static const unsigned maxOutstandingEvents=30;
+    static const unsigned maxDropFlows=1024;
+    static const unsigned dropFlowSummaryInterval=10;
     friend UdpServer;
     friend LocalClient;
     ///@}
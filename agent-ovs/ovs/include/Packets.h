@@ -13,6 +13,7 @@
 #define OPFLEXAGENT_PACKETS_H
 
 #include <cstdint>
+#include <vector>
 #include <arpa/inet.h>
 
 #include <boost/asio/ip/address.hpp>
@@ -86,6 +87,73 @@ void chksum_accum(uint32_t& chksum, uint16_t* addr, size_t len);
  */
 uint16_t chksum_finalize(uint32_t chksum);
 
+/**
+ * A set of packets composed back to back into one buffer.  The
+ * buffer is sized once for the whole batch, so composing a burst of
+ * packets does not allocate for each packet.
+ */
+class PacketBatch {
+public:
+    /**
+     * Construct a batch
+     *
+     * @param sizeHint the expected total size of the packets in
+     * bytes
+     * @param countHint the expected number of packets
+     */
+    PacketBatch(size_t sizeHint = 0, size_t countHint = 0) {
+        buf.reserve(sizeHint);
+        packets.reserve(countHint);
+    }
+
+    /**
+     * Add a new zero-filled packet to the end of the batch
+     *
+     * @param len the length of the packet
+     * @return a pointer to the packet data, valid until the next
+     * call to append
+     */
+    void* append(size_t len) {
+        size_t offset = buf.size();
+        buf.resize(offset + len);
+        packets.emplace_back(offset, len);
+        return buf.data() + offset;
+    }
+
+    /**
+     * Get the number of packets in the batch
+     */
+    size_t size() const { return packets.size(); }
+
+    /**
+     * Get the data for a packet in the batch
+     *
+     * @param i the index of the packet
+     */
+    const void* data(size_t i) const {
+        return buf.data() + packets[i].first;
+    }
+
+    /**
+     * Get the length of a packet in the batch
+     *
+     * @param i the index of the packet
+     */
+    size_t length(size_t i) const { return packets[i].second; }
+
+    /**
+     * Remove all packets from the batch, keeping the buffer
+     */
+    void clear() {
+        buf.clear();
+        packets.clear();
+    }
+
+private:
+    std::vector<uint8_t> buf;
+    std::vector<std::pair<size_t, size_t> > packets;
+};
+
 /**
  * Compose an ICMP6 neighbor advertisement ethernet frame
  *
@@ -102,6 +170,24 @@ OfpBuf compose_icmp6_neigh_ad(uint32_t naFlags,
                               const struct in6_addr* srcIp,
                               const struct in6_addr* dstIp);
 
+/**
+ * Compose an ICMP6 neighbor advertisement ethernet frame at the end
+ * of a batch
+ *
+ * @param batch the batch to add the frame to
+ * @param naFlags the flags to set in the NA
+ * @param srcMac the source MAC
+ * @param dstMac the target MAC
+ * @param srcIp the source IP
+ * @param dstIp the destination Ip
+ */
+void compose_icmp6_neigh_ad(PacketBatch& batch,
+                            uint32_t naFlags,
+                            const uint8_t* srcMac,
+                            const uint8_t* dstMac,
+                            const struct in6_addr* srcIp,
+                            const struct in6_addr* dstIp);
+
 /**
  * Compose an ICMP6 neighbor solicitation ethernet frame
  *
@@ -119,6 +205,25 @@ OfpBuf compose_icmp6_neigh_solit(const uint8_t* srcMac,
                                  const struct in6_addr* dstIp,
                                  const struct in6_addr* targetIp);
 
+/**
+ * Compose an ICMP6 neighbor solicitation ethernet frame at the end
+ * of a batch
+ *
+ * @param batch the batch to add the frame to
+ * @param srcMac the source MAC
+ * @param dstMac the target MAC
+ * @param srcIp the source IP
+ * @param dstIp the destination IP.  Should be the solicited node IP
+ * address for the target IP
+ * @param targetIp The target IP for the solicitation
+ */
+void compose_icmp6_neigh_solit(PacketBatch& batch,
+                               const uint8_t* srcMac,
+                               const uint8_t* dstMac,
+                               const struct in6_addr* srcIp,
+                               const struct in6_addr* dstIp,
+                               const struct in6_addr* targetIp);
+
 /**
  * Compose an ICMP6 router advertisement ethernet frame
  *
@@ -213,6 +318,32 @@ OfpBuf compose_dhcpv6_reply(uint8_t message_type,
                             const boost::optional<uint32_t>& preferredLifetime,
                             const boost::optional<uint32_t>& validLifetime);
 
+/**
+ * Update the transaction ID and client hardware address of a DHCPv4
+ * reply created by compose_dhcpv4_reply so that it can be reused to
+ * answer another request.  The UDP checksum is updated incrementally.
+ *
+ * @param reply the reply to update
+ * @param xid the transaction ID for the message
+ * @param clientMac the MAC address for the requesting client
+ */
+void patch_dhcpv4_reply(OfpBuf& reply,
+                        uint32_t xid,
+                        const uint8_t* clientMac);
+
+/**
+ * Update the transaction ID and destination MAC of a DHCPv6 reply
+ * created by compose_dhcpv6_reply so that it can be reused to answer
+ * another request.  The UDP checksum is updated incrementally.
+ *
+ * @param reply the reply to update
+ * @param xid the transaction ID for the message
+ * @param clientMac the MAC address for the requesting client
+ */
+void patch_dhcpv6_reply(OfpBuf& reply,
+                        const uint8_t* xid,
+                        const uint8_t* clientMac);
+
 /**
  * Compose an ARP packet
  *
@@ -234,6 +365,29 @@ OfpBuf compose_arp(uint16_t op,
                    uint32_t tpa,
                    bool rarp = false);
 
+/**
+ * Compose an ARP packet at the end of a batch
+ *
+ * @param batch the batch to add the packet to
+ * @param op the opcode
+ * @param srcMac the source MAC for the ethernet header
+ * @param dstMac the destination MAC for the ethernet header
+ * @param sha the source hardware address
+ * @param tha the target hardware address
+ * @param spa the source protocol address
+ * @param tpa the target protocol address
+ * @param rarp use RARP ethertype instead
+ */
+void compose_arp(PacketBatch& batch,
+                 uint16_t op,
+                 const uint8_t* srcMac,
+                 const uint8_t* dstMac,
+                 const uint8_t* sha,
+                 const uint8_t* tha,
+                 uint32_t spa,
+                 uint32_t tpa,
+                 bool rarp = false);
+
 } /* namespace packets */
 } /* namespace opflexagent */
 
@@ -25,6 +25,8 @@
 
 #include <string>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace opflexagent {
 
@@ -157,6 +159,13 @@ public:
      */
     bool writeFlow(const std::string& objId, int tableId, FlowEntryPtr e);
 
+    /**
+     * Forget the cached contents of all flow tables without writing
+     * anything to the switch, so that the next write of each object
+     * is rendered in full.  Must be called on the agent thread.
+     */
+    void clearTableState();
+
     /**
      * Write a group-table change to the switch
      *
@@ -213,6 +222,56 @@ public:
      */
     void getForwardingTableList(TableDescriptionMap& forwardingTableMap) const;
 
+    /**
+     * Counters of the flows written through the switch manager.  The
+     * counts are cumulative, so that rates can be computed by the
+     * reader.
+     */
+    struct FlowCounters {
+        /** Number of flows currently cached */
+        uint64_t flows = 0;
+        /** Number of calls writing or clearing flows */
+        uint64_t writes = 0;
+        /** Number of flows added */
+        uint64_t adds = 0;
+        /** Number of flows modified */
+        uint64_t mods = 0;
+        /** Number of flows deleted */
+        uint64_t deletes = 0;
+        /** Time spent computing differences, in microseconds */
+        uint64_t diffTimeUs = 0;
+        /** Bytes of flow mods encoded, only tracked per table */
+        uint64_t encodedBytes = 0;
+    };
+
+    /**
+     * Get the counters of the flows written to a flow table
+     *
+     * @param tableId the flow table
+     * @param counters returns the counters
+     */
+    void getTableCounters(int tableId, FlowCounters& counters);
+
+    /**
+     * Get the counters of the flows written for each type of object
+     *
+     * @param counters returns the counters, keyed by object type
+     */
+    void getObjectTypeCounters(std::unordered_map<std::string,
+                                                  FlowCounters>& counters);
+
+    /**
+     * Classify an object ID written to the flow tables.  Object IDs
+     * that are URIs map to the class of the object, and IDs of the
+     * form "prefix:rest" map to their prefix unless the prefix is a
+     * UUID in its canonical 8-4-4-4-12 form.  UUIDs map to "uuid" and
+     * all other IDs map to "other".
+     *
+     * @param objId the object ID
+     * @return the type of the object
+     */
+    static std::string getObjectType(const std::string& objId);
+
 protected:
     /**
      * Connection for this switch
@@ -305,6 +364,18 @@ private:
     /*Drop counter table list*/
     TableDescriptionMap tableDescriptionMap;
 
+    // flow programming counters
+    std::mutex countersMutex;
+    std::vector<FlowCounters> tableCounters;
+    std::unordered_map<std::string, FlowCounters> objTypeCounters;
+    void countFlowEdits(const std::string& objId, int tableId,
+                        const FlowEdit& diffs, uint64_t diffTimeUs);
+
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    std::unique_ptr<boost::asio::deadline_timer> countersTimer;
+    void onCountersTimer(const boost::system::error_code& ec);
+#endif
+
 };
 
 } // namespace opflexagent
@@ -22,17 +22,49 @@ struct ofputil_flow_stats;
 struct ofputil_group_mod;
 struct match;
 struct ofputil_tlv_map;
+struct ofpact;
 
 namespace opflexagent {
 
+class FlowArena;
+
 /**
  * Class representing an entry in a flow table.
  */
 class FlowEntry : private boost::noncopyable {
 public:
     FlowEntry();
+    /**
+     * Create a flow entry whose flow stats and actions are allocated
+     * from the given arena.  The entry must not outlive the current
+     * render pass of the arena.
+     *
+     * @param arena the arena to allocate from
+     */
+    explicit FlowEntry(FlowArena& arena);
     ~FlowEntry();
 
+    /**
+     * Check whether this entry is allocated from a flow arena
+     * @return true if the entry is allocated from an arena
+     */
+    bool isArenaBacked() const { return arena != NULL; }
+
+    /**
+     * Make a heap allocated copy of this entry
+     * @return the new entry
+     */
+    std::shared_ptr<FlowEntry> clone() const;
+
+    /**
+     * Allocate storage for the actions of this entry from the
+     * same place the entry itself was allocated
+     *
+     * @param len the size of the actions in bytes
+     * @return the storage for the actions
+     */
+    struct ofpact* allocActions(size_t len);
+
     /**
      * Check whether the given flow entry is equal to this one
      * @param rhs the entry to compare against
@@ -51,6 +83,9 @@ public:
      * The flow entry
      */
     struct ofputil_flow_stats* entry;
+
+private:
+    FlowArena* arena;
 };
 /**
  * A shared pointer to a flow entry
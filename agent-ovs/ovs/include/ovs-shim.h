@@ -230,6 +230,14 @@ extern "C" {
                        uint32_t arg,
                        int dst);
 
+    /**
+     * conjunction
+     */
+    void act_conjunction(struct ofpbuf* buf,
+                         uint32_t id,
+                         uint8_t clause,
+                         uint8_t nClauses);
+
     /**
      * MAC/VLAN learn
      */
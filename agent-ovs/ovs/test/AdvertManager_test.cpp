@@ -210,6 +210,22 @@ public:
     }
 };
 
+class EpAdvertFixturePaced : public AdvertManagerFixture {
+public:
+    EpAdvertFixturePaced()
+        : AdvertManagerFixture() {
+        advertManager.
+            enableEndpointAdv(AdvertManager::EPADV_GRATUITOUS_BROADCAST);
+        advertManager.setEndpointAdvRate(20, 1);
+        start();
+        advertManager.scheduleInitialEndpointAdv(10);
+    }
+
+    ~EpAdvertFixturePaced() {
+        stop();
+    }
+};
+
 class RouterAdvertFixture : public AdvertManagerFixture {
 public:
     RouterAdvertFixture()
@@ -339,6 +355,18 @@ BOOST_FIXTURE_TEST_CASE(endpointAdvertGB, EpAdvertFixtureGB) {
     testEpAdvert(AdvertManager::EPADV_GRATUITOUS_BROADCAST);
 }
 
+BOOST_FIXTURE_TEST_CASE(endpointAdvertPaced, EpAdvertFixturePaced) {
+    // 8 endpoint advertisements at 20 per second, plus the services
+    testEpAdvert(AdvertManager::EPADV_GRATUITOUS_BROADCAST);
+    BOOST_CHECK_EQUAL(0, advertManager.getEndpointAdvQueueDepth());
+    BOOST_CHECK_EQUAL(8, advertManager.getEndpointAdvsSent());
+
+    // repeated requests for the same endpoint are merged
+    advertManager.scheduleEndpointAdv(ep0->getUUID());
+    advertManager.scheduleEndpointAdv(ep0->getUUID());
+    BOOST_CHECK_EQUAL(1, advertManager.getCoalescedEndpointAdvs());
+}
+
 BOOST_FIXTURE_TEST_CASE(routerAdvert, RouterAdvertFixture) {
     WAIT_FOR(conn->getSentMsgCount() == 1, 1000);
     BOOST_CHECK_EQUAL(1, conn->getSentMsgCount());
@@ -0,0 +1,184 @@
+/*
+ * Test suite for class CtZoneManager.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <opflexagent/IdGenerator.h>
+#include <opflexagent/test/BaseFixture.h>
+
+#include "CtZoneManager.h"
+
+using namespace opflexagent;
+using std::string;
+using std::vector;
+
+static const string NMSPC("conntrack");
+
+/**
+ * A CtZoneManager that records zone flushes instead of touching the
+ * kernel, and can hold a flush until it is unblocked
+ */
+class TestCtZoneManager : public CtZoneManager {
+public:
+    TestCtZoneManager(IdGenerator& gen)
+        : CtZoneManager(gen), blocked(false), result(true) {}
+
+    ~TestCtZoneManager() {
+        // the flush thread calls flushZone, so stop it before this
+        // object goes away
+        block(false);
+        stop();
+    }
+
+    virtual void init(const string& nmspc) {
+        CtZoneManager::init(nmspc);
+        startZoneFlush();
+    }
+
+    void block(bool b) {
+        std::lock_guard<std::mutex> guard(mutex);
+        blocked = b;
+        cond.notify_all();
+    }
+
+    void setResult(bool r) {
+        std::lock_guard<std::mutex> guard(mutex);
+        result = r;
+    }
+
+    vector<uint16_t> getFlushes() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return flushes;
+    }
+
+    vector<size_t> getMultiFlushes() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return multiFlushes;
+    }
+
+protected:
+    virtual bool flushZone(uint16_t zoneId) {
+        std::unique_lock<std::mutex> guard(mutex);
+        flushes.push_back(zoneId);
+        cond.wait(guard, [this] { return !blocked; });
+        return result;
+    }
+
+    virtual bool flushZones(const zone_set_t& zones) {
+        std::unique_lock<std::mutex> guard(mutex);
+        multiFlushes.push_back(zones.count());
+        cond.wait(guard, [this] { return !blocked; });
+        return result;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    vector<uint16_t> flushes;
+    vector<size_t> multiFlushes;
+    bool blocked;
+    bool result;
+};
+
+static void releaseZone(IdGenerator& gen, CtZoneManager& ctZoneManager,
+                        const string& str) {
+    ctZoneManager.erase(str);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    gen.cleanup();
+}
+
+BOOST_AUTO_TEST_SUITE(CtZoneManager_test)
+
+BOOST_AUTO_TEST_CASE(flushOnRelease) {
+    IdGenerator gen(std::chrono::milliseconds(1));
+    TestCtZoneManager ctZoneManager(gen);
+    ctZoneManager.setCtZoneRange(1, 1);
+    ctZoneManager.init(NMSPC);
+
+    // a zone cleared by the startup flush is allocated without
+    // flushing it again
+    BOOST_CHECK_EQUAL(1, ctZoneManager.getId("ep1"));
+    BOOST_CHECK(ctZoneManager.getFlushes().empty());
+    BOOST_CHECK_EQUAL(1, ctZoneManager.getFlushedZones());
+
+    // a released zone is flushed in the background and is not
+    // reused until the flush completes
+    ctZoneManager.block(true);
+    releaseZone(gen, ctZoneManager, "ep1");
+    WAIT_FOR(ctZoneManager.getFlushes().size() == 1, 500);
+    BOOST_CHECK_EQUAL(1, ctZoneManager.getFlushQueueDepth());
+    BOOST_CHECK_EQUAL(1, ctZoneManager.getFlushedZones());
+    BOOST_CHECK_EQUAL(0, gen.getRemainingIds(NMSPC));
+
+    ctZoneManager.block(false);
+    WAIT_FOR(gen.getRemainingIds(NMSPC) == 1, 500);
+    BOOST_CHECK_EQUAL(0, ctZoneManager.getFlushQueueDepth());
+    BOOST_CHECK_EQUAL(2, ctZoneManager.getFlushedZones());
+
+    // the clean zone is reused without flushing it again
+    BOOST_CHECK_EQUAL(1, ctZoneManager.getId("ep2"));
+    BOOST_CHECK(ctZoneManager.getFlushes() == vector<uint16_t>({1}));
+}
+
+BOOST_AUTO_TEST_CASE(flushFailed) {
+    IdGenerator gen(std::chrono::milliseconds(1));
+    TestCtZoneManager ctZoneManager(gen);
+    ctZoneManager.setCtZoneRange(1, 1);
+    ctZoneManager.init(NMSPC);
+
+    BOOST_CHECK_EQUAL(1, ctZoneManager.getId("ep1"));
+
+    // a zone whose background flush failed is still released
+    ctZoneManager.setResult(false);
+    releaseZone(gen, ctZoneManager, "ep1");
+    WAIT_FOR(gen.getRemainingIds(NMSPC) == 1, 500);
+    BOOST_CHECK_EQUAL(1, ctZoneManager.getFlushedZones());
+
+    // but is flushed again when it is allocated
+    ctZoneManager.setResult(true);
+    BOOST_CHECK_EQUAL(1, ctZoneManager.getId("ep2"));
+    BOOST_CHECK(ctZoneManager.getFlushes() == vector<uint16_t>({1, 1}));
+}
+
+BOOST_AUTO_TEST_CASE(startupFlush) {
+    IdGenerator gen(std::chrono::milliseconds(1));
+    TestCtZoneManager ctZoneManager(gen);
+    ctZoneManager.setCtZoneRange(1, 3);
+
+    // all zones free at startup are flushed in the background with
+    // one pass over the table
+    ctZoneManager.block(true);
+    ctZoneManager.init(NMSPC);
+    WAIT_FOR(ctZoneManager.getMultiFlushes().size() == 1, 500);
+    BOOST_CHECK_EQUAL(3, ctZoneManager.getMultiFlushes()[0]);
+
+    // allocation waits for the startup flush instead of flushing the
+    // zone itself
+    std::atomic<uint16_t> zone(0);
+    std::thread alloc([&]() { zone = ctZoneManager.getId("ep1"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_CHECK_EQUAL(0, zone);
+
+    ctZoneManager.block(false);
+    alloc.join();
+    BOOST_CHECK_EQUAL(1, zone);
+    BOOST_CHECK(ctZoneManager.getFlushes().empty());
+    BOOST_CHECK_EQUAL(3, ctZoneManager.getFlushedZones());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
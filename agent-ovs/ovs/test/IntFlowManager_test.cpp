@@ -9,6 +9,8 @@
  */
 
 #include <sstream>
+#include <algorithm>
+#include <future>
 #include <boost/test/unit_test.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/assign/list_of.hpp>
@@ -39,6 +41,7 @@
 #include "FlowUtils.h"
 #include "FlowManagerFixture.h"
 #include "FlowBuilder.h"
+#include "MaglevTable.h"
 #include "ovs-shim.h"
 
 using namespace boost::assign;
@@ -157,7 +160,8 @@ public:
                      uint32_t bdId = 1, uint32_t rdId = 1);
 
     /** Initialize service-scoped flow entries for local services */
-    void initExpAnycastService(Service &as, int nextHop = 0);
+    void initExpAnycastService(Service &as, int nextHop = 0,
+                               bool maglev = false);
 
     /**
      * Initialize flows in stats table for pod to svc
@@ -222,6 +226,20 @@ public:
     void loadBalancedServiceTest();
     void remoteEndpointTest();
 
+    /** Create a load balanced service used by the pod<-->svc tests */
+    void initPodSvcStatsService(Service& as);
+
+    /** Count the stats table flows that carry the given cookie */
+    size_t countStatsFlows(uint64_t cookie);
+
+    /** Count the stats table flows that match the given IPv4 source */
+    size_t countStatsFlowsFrom(const string& ip);
+
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    /** Check whether the exported metrics contain the given line */
+    bool hasMetric(const string& metric);
+#endif
+
     IntFlowManager intFlowManager;
     PacketInHandler pktInHandler;
     PolicyManager& policyMgr;
@@ -433,6 +451,91 @@ BOOST_FIXTURE_TEST_CASE(epg_vlan, VlanIntFlowManagerFixture) {
     epgTest();
 }
 
+BOOST_FIXTURE_TEST_CASE(flowCounters, VxlanIntFlowManagerFixture) {
+    BOOST_CHECK_EQUAL("GbpEpGroup",
+                      SwitchManager::getObjectType(epg0->getURI()
+                                                   .toString()));
+    // the test endpoint IDs are not in the canonical UUID form
+    BOOST_CHECK_EQUAL("other", SwitchManager::getObjectType(ep0->getUUID()));
+    BOOST_CHECK_EQUAL("eptosvc",
+                      SwitchManager::getObjectType("eptosvc:a:b"));
+    BOOST_CHECK_EQUAL("other", SwitchManager::getObjectType("static"));
+    BOOST_CHECK_EQUAL("other", SwitchManager::getObjectType("veth0"));
+    BOOST_CHECK_EQUAL("uuid", SwitchManager::getObjectType(
+                          "ed84daef-1696-4b98-8c80-6b22d85f4dc2:1"));
+    BOOST_CHECK_EQUAL("other", SwitchManager::getObjectType("add"));
+    BOOST_CHECK_EQUAL("other", SwitchManager::getObjectType("beef"));
+    BOOST_CHECK_EQUAL("ab", SwitchManager::getObjectType("ab:x"));
+    BOOST_CHECK_EQUAL("other", SwitchManager::getObjectType(":x"));
+
+    setConnected();
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    initExpStatic();
+    initExpEpg(epg0);
+    initExpBd();
+    initExpEp(ep0, epg0);
+    initExpEp(ep2, epg0);
+    WAIT_FOR_TABLES("create", 500);
+
+    SwitchManager::FlowCounters c;
+    switchManager.getTableCounters(IntFlowManager::SEC_TABLE_ID, c);
+    BOOST_CHECK(c.writes > 0);
+    BOOST_CHECK(c.adds > 0);
+    BOOST_CHECK_EQUAL(c.adds - c.deletes, c.flows);
+
+    std::unordered_map<std::string, SwitchManager::FlowCounters> types;
+    switchManager.getObjectTypeCounters(types);
+    BOOST_CHECK(types.find("other") != types.end());
+    BOOST_CHECK(types.find("GbpEpGroup") != types.end());
+
+    // forgetting the cached flows resets the flow counts but keeps
+    // the cumulative counters
+    uint64_t adds = c.adds;
+    switchManager.clearTableState();
+    switchManager.getTableCounters(IntFlowManager::SEC_TABLE_ID, c);
+    BOOST_CHECK_EQUAL(0, c.flows);
+    BOOST_CHECK_EQUAL(adds, c.adds);
+}
+
+BOOST_FIXTURE_TEST_CASE(epgRenderSkip, VxlanIntFlowManagerFixture) {
+    setConnected();
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    initExpStatic();
+    initExpEpg(epg0);
+    initExpBd();
+    initExpEp(ep0, epg0);
+    initExpEp(ep2, epg0);
+    WAIT_FOR_TABLES("create", 500);
+
+    /* an update with no forwarding changes leaves endpoints alone */
+    uint64_t skipped = intFlowManager.getEpgRenderSkipped();
+    uint64_t fanouts = intFlowManager.getEpgRenderFanouts();
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    WAIT_FOR(intFlowManager.getEpgRenderSkipped() > skipped, 500);
+    WAIT_FOR_TABLES("unchanged", 500);
+    BOOST_CHECK_EQUAL(fanouts, intFlowManager.getEpgRenderFanouts());
+
+    /* a forwarding change still re-renders the endpoints */
+    {
+        Mutator mutator(framework, policyOwner);
+        bd0->setRoutingMode(RoutingModeEnumT::CONST_DISABLED);
+        mutator.commit();
+    }
+    WAIT_FOR(policyMgr.getBDForGroup(epg0->getURI()).get()
+             ->getRoutingMode(RoutingModeEnumT::CONST_ENABLED) ==
+             RoutingModeEnumT::CONST_DISABLED, 500);
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    WAIT_FOR(intFlowManager.getEpgRenderFanouts() > fanouts, 500);
+
+    clearExpFlowTables();
+    initExpStatic();
+    initExpEpg(epg0);
+    initExpBd(1, 1, false);
+    initExpEp(ep0, epg0, 0, 1, 1, true, false);
+    initExpEp(ep2, epg0, 0, 1, 1, true, false);
+    WAIT_FOR_TABLES("disable", 500);
+}
+
 void BaseIntFlowManagerFixture::routeModeTest() {
     setConnected();
     intFlowManager.egDomainUpdated(epg0->getURI());
@@ -680,6 +783,15 @@ void BaseIntFlowManagerFixture::fdTest() {
     initExpEp(ep2, epg0, 1, 1, 1);
     WAIT_FOR_TABLES("ep2", 500);
 
+    /* joining the group only modifies its buckets; the flood output
+       flow was written when the group was created */
+    {
+        std::unordered_map<std::string, SwitchManager::FlowCounters> types;
+        switchManager.getObjectTypeCounters(types);
+        BOOST_REQUIRE(types.find("fd") != types.end());
+        BOOST_CHECK_EQUAL(1, types["fd"].writes);
+    }
+
     /* remove port-mapping for ep2 */
     portmapper.erasePort(ep2->getInterfaceName().get());
     exec.Clear();
@@ -1437,6 +1549,101 @@ BOOST_FIXTURE_TEST_CASE(anycastService, VxlanIntFlowManagerFixture) {
     WAIT_FOR_TABLES("delete", 500);
 }
 
+BOOST_FIXTURE_TEST_CASE(maglevService, VxlanIntFlowManagerFixture) {
+    intFlowManager.setServiceLbMode(IntFlowManager::SVC_LB_MAGLEV);
+    setConnected();
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    intFlowManager.domainUpdated(RoutingDomain::CLASS_ID, rd0->getURI());
+    portmapper.setPort("service-iface", 17);
+    portmapper.setPort(17, "service-iface");
+
+    Service as;
+    as.setUUID("ed84daef-1696-4b98-8c80-6b22d85f4dc2");
+    as.setServiceMAC(MAC("ed:84:da:ef:16:96"));
+    as.setDomainURI(URI(rd0->getURI()));
+    as.setInterfaceName("service-iface");
+
+    Service::ServiceMapping sm1;
+    sm1.setServiceIP("169.254.169.254");
+    sm1.setGatewayIP("169.254.1.1");
+    sm1.addNextHopIP("169.254.169.1");
+    sm1.addNextHopIP("169.254.169.2");
+    as.addServiceMapping(sm1);
+
+    Service::ServiceMapping sm2;
+    sm2.setServiceIP("fe80::a9:fe:a9:fe");
+    sm2.setGatewayIP("fe80::1");
+    sm2.addNextHopIP("fe80::a9:fe:a9:1");
+    sm2.addNextHopIP("fe80::a9:fe:a9:2");
+    as.addServiceMapping(sm2);
+
+    // both next hops own a share of the lookup table
+    {
+        vector<size_t> table;
+        MaglevTable::populate({"169.254.169.1", "169.254.169.2"},
+                              MaglevTable::getTableSize(2), table);
+        size_t first = std::count(table.begin(), table.end(), 0);
+        BOOST_CHECK(first > 0);
+        BOOST_CHECK(first < table.size());
+    }
+
+    servSrc.updateService(as);
+    intFlowManager.serviceUpdated(as.getUUID());
+
+    initExpStatic();
+    initExpEpg(epg0);
+    initExpBd();
+    initExpRd();
+    initExpEp(ep0, epg0);
+    initExpEp(ep2, epg0);
+    initExpAnycastService(as, 2, true);
+    WAIT_FOR_TABLES("maglev", 500);
+
+    // a single next hop needs no lookup table
+    as.clearServiceMappings();
+    Service::ServiceMapping sm3;
+    sm3.setServiceIP("169.254.169.254");
+    sm3.setGatewayIP("169.254.1.1");
+    sm3.addNextHopIP("169.254.169.1");
+    as.addServiceMapping(sm3);
+    Service::ServiceMapping sm4;
+    sm4.setServiceIP("fe80::a9:fe:a9:fe");
+    sm4.setGatewayIP("fe80::1");
+    sm4.addNextHopIP("fe80::a9:fe:a9:1");
+    as.addServiceMapping(sm4);
+
+    servSrc.updateService(as);
+    intFlowManager.serviceUpdated(as.getUUID());
+
+    clearExpFlowTables();
+    initExpStatic();
+    initExpEpg(epg0);
+    initExpBd();
+    initExpRd();
+    initExpEp(ep0, epg0);
+    initExpEp(ep2, epg0);
+    initExpAnycastService(as, 1, true);
+    WAIT_FOR_TABLES("single", 500);
+
+    // restoring the second next hop restores the same table
+    as.clearServiceMappings();
+    as.addServiceMapping(sm1);
+    as.addServiceMapping(sm2);
+
+    servSrc.updateService(as);
+    intFlowManager.serviceUpdated(as.getUUID());
+
+    clearExpFlowTables();
+    initExpStatic();
+    initExpEpg(epg0);
+    initExpBd();
+    initExpRd();
+    initExpEp(ep0, epg0);
+    initExpEp(ep2, epg0);
+    initExpAnycastService(as, 2, true);
+    WAIT_FOR_TABLES("restore", 500);
+}
+
 BOOST_FIXTURE_TEST_CASE(loadBalancedService_vxlan, VxlanIntFlowManagerFixture) {
     loadBalancedServiceTest();
 }
@@ -1445,6 +1652,216 @@ BOOST_FIXTURE_TEST_CASE(loadBalancedService_vlan, VlanIntFlowManagerFixture) {
     loadBalancedServiceTest();
 }
 
+void BaseIntFlowManagerFixture::initPodSvcStatsService(Service& as) {
+    as.setUUID("ed84daef-1696-4b98-8c80-6b22d85f4dc2");
+    as.setDomainURI(URI(rd0->getURI()));
+    as.setServiceMode(Service::LOADBALANCER);
+    Service::ServiceMapping sm;
+    sm.setServiceIP("169.254.169.254");
+    sm.setServiceProto("udp");
+    sm.addNextHopIP("169.254.169.2");
+    sm.setServicePort(53);
+    sm.setNextHopPort(5353);
+    as.addServiceMapping(sm);
+    as.addAttribute("name", "coredns");
+    as.addAttribute("namespace", "default");
+    servSrc.updateService(as);
+    intFlowManager.serviceUpdated(as.getUUID());
+}
+
+size_t BaseIntFlowManagerFixture::countStatsFlows(uint64_t cookie) {
+    // flow tables are only accessed from the agent thread
+    std::promise<size_t> count;
+    agent.getAgentIOService().dispatch([&]() {
+            size_t n = 0;
+            TableState::cookie_callback_t cb =
+                [&n, cookie](uint64_t c, uint16_t, const struct match&) {
+                if (c == cookie) n += 1;
+            };
+            switchManager.forEachCookieMatch(IntFlowManager::STATS_TABLE_ID,
+                                             cb);
+            count.set_value(n);
+        });
+    return count.get_future().get();
+}
+
+size_t BaseIntFlowManagerFixture::countStatsFlowsFrom(const string& ip) {
+    const uint32_t addr =
+        htonl(boost::asio::ip::address_v4::from_string(ip).to_ulong());
+    std::promise<size_t> count;
+    agent.getAgentIOService().dispatch([&]() {
+            size_t n = 0;
+            TableState::cookie_callback_t cb =
+                [&n, addr](uint64_t, uint16_t, const struct match& m) {
+                if (m.wc.masks.nw_src == 0xffffffff &&
+                    m.flow.nw_src == addr)
+                    n += 1;
+            };
+            switchManager.forEachCookieMatch(IntFlowManager::STATS_TABLE_ID,
+                                             cb);
+            count.set_value(n);
+        });
+    return count.get_future().get();
+}
+
+#ifdef HAVE_PROMETHEUS_SUPPORT
+bool BaseIntFlowManagerFixture::hasMetric(const string& metric) {
+    static const string cmd =
+        "curl --proxy \"\" --compressed --silent "
+        "http://127.0.0.1:9612/metrics 2>&1;";
+    const string& output = BaseFixture::getOutputFromCommand(cmd);
+    return output.find(metric) != string::npos;
+}
+#endif
+
+BOOST_FIXTURE_TEST_CASE(podSvcStatsPerService, VxlanIntFlowManagerFixture) {
+    setConnected();
+    // sampling is ignored for aggregated counters, which would
+    // otherwise undercount
+    intFlowManager.setPodSvcStatsMode(IntFlowManager::POD_SVC_STATS_SERVICE,
+                                      50);
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    intFlowManager.domainUpdated(RoutingDomain::CLASS_ID, rd0->getURI());
+
+    Service as;
+    initPodSvcStatsService(as);
+
+    // all local endpoints count their traffic to the service under
+    // the same cookie
+    uint64_t ck0 = 0, ck2 = 0;
+    WAIT_FOR(intFlowManager.getPodSvcUuidCookie(ep0->getUUID() + ":" +
+                                                as.getUUID(), true, ck0),
+             500);
+    WAIT_FOR(intFlowManager.getPodSvcUuidCookie(ep2->getUUID() + ":" +
+                                                as.getUUID(), true, ck2),
+             500);
+    BOOST_CHECK(ck0 != 0);
+    BOOST_CHECK_EQUAL(ck0, ck2);
+    // the aggregate is counted by a single conjunction flow, and each
+    // endpoint IP gets one clause flow whatever the number of
+    // services
+    BOOST_CHECK_EQUAL(1, countStatsFlows(ck0));
+    BOOST_CHECK_EQUAL(1, countStatsFlowsFrom("10.20.44.21"));
+
+    // the aggregated counters name the endpoint side "*"
+    const string aUuid = boost::lexical_cast<string>(agent.getUuid());
+    const string epToSvc = "eptosvc:*:" + as.getUUID();
+    optional<shared_ptr<SvcStatUniverse> > su =
+        SvcStatUniverse::resolve(agent.getFramework());
+    BOOST_REQUIRE(su);
+    WAIT_FOR(su.get()->resolveGbpeEpToSvcCounter(aUuid, epToSvc), 500);
+    auto counter = su.get()->resolveGbpeEpToSvcCounter(aUuid, epToSvc);
+    BOOST_REQUIRE(counter);
+    BOOST_CHECK_EQUAL("*", counter.get()->getEp(""));
+    BOOST_CHECK_EQUAL("coredns", counter.get()->getSvc(""));
+
+    intFlowManager.updateSvcStatsCounters(ck0, 10, 1000);
+    WAIT_FOR(su.get()->resolveGbpeEpToSvcCounter(aUuid, epToSvc).get()
+             ->getPackets(0) == 10, 500);
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    BOOST_CHECK(hasMetric("opflex_endpoint_to_svc_packets{ep_name=\"*\","
+                          "svc_name=\"coredns\","
+                          "svc_namespace=\"default\"} 10.000000"));
+#endif
+
+    // the counters stay while any endpoint still talks to the service
+    epSrc.removeEndpoint(ep2->getUUID());
+    intFlowManager.endpointUpdated(ep2->getUUID());
+    WAIT_FOR(countStatsFlowsFrom("10.20.44.21") == 0, 500);
+    BOOST_CHECK_EQUAL(1, countStatsFlows(ck0));
+    BOOST_CHECK(su.get()->resolveGbpeEpToSvcCounter(aUuid, epToSvc));
+    BOOST_CHECK(intFlowManager.getPodSvcUuidCookie(ep0->getUUID() + ":" +
+                                                   as.getUUID(), true, ck0));
+
+    // and are removed with the last pair
+    servSrc.removeService(as.getUUID());
+    intFlowManager.serviceUpdated(as.getUUID());
+    WAIT_FOR(!intFlowManager.getPodSvcUuidCookie(ep0->getUUID() + ":" +
+                                                 as.getUUID(), true, ck0),
+             500);
+    WAIT_FOR(!su.get()->resolveGbpeEpToSvcCounter(aUuid, epToSvc), 500);
+    BOOST_CHECK_EQUAL(0, countStatsFlows(ck0));
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    BOOST_CHECK(!hasMetric("opflex_endpoint_to_svc_packets{ep_name=\"*\","
+                           "svc_name=\"coredns\""));
+#endif
+}
+
+BOOST_FIXTURE_TEST_CASE(podSvcStatsPerPod, VxlanIntFlowManagerFixture) {
+    setConnected();
+    intFlowManager.setPodSvcStatsMode(IntFlowManager::POD_SVC_STATS_POD,
+                                      100);
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    intFlowManager.domainUpdated(RoutingDomain::CLASS_ID, rd0->getURI());
+
+    Service as;
+    initPodSvcStatsService(as);
+
+    uint64_t ck0 = 0;
+    WAIT_FOR(intFlowManager.getPodSvcUuidCookie(ep0->getUUID() + ":" +
+                                                as.getUUID(), true, ck0),
+             500);
+    BOOST_CHECK_EQUAL(1, countStatsFlows(ck0));
+
+    // the aggregated counters name the service side "*"
+    const string aUuid = boost::lexical_cast<string>(agent.getUuid());
+    const string epToSvc = "eptosvc:" + ep0->getUUID() + ":*";
+    optional<shared_ptr<SvcStatUniverse> > su =
+        SvcStatUniverse::resolve(agent.getFramework());
+    BOOST_REQUIRE(su);
+    WAIT_FOR(su.get()->resolveGbpeEpToSvcCounter(aUuid, epToSvc), 500);
+    auto counter = su.get()->resolveGbpeEpToSvcCounter(aUuid, epToSvc);
+    BOOST_REQUIRE(counter);
+    BOOST_CHECK_EQUAL("coredns", counter.get()->getEp(""));
+    BOOST_CHECK_EQUAL("*", counter.get()->getSvc(""));
+
+    intFlowManager.updateSvcStatsCounters(ck0, 10, 1000);
+    WAIT_FOR(su.get()->resolveGbpeEpToSvcCounter(aUuid, epToSvc).get()
+             ->getPackets(0) == 10, 500);
+#ifdef HAVE_PROMETHEUS_SUPPORT
+    BOOST_CHECK(hasMetric("opflex_endpoint_to_svc_packets{ep_name=\"coredns\","
+                          "ep_namespace=\"default\",svc_name=\"*\"} "
+                          "10.000000"));
+#endif
+
+    // removing the only service removes the endpoint's counters
+    servSrc.removeService(as.getUUID());
+    intFlowManager.serviceUpdated(as.getUUID());
+    WAIT_FOR(!su.get()->resolveGbpeEpToSvcCounter(aUuid, epToSvc), 500);
+    BOOST_CHECK_EQUAL(0, countStatsFlows(ck0));
+}
+
+BOOST_FIXTURE_TEST_CASE(podSvcStatsSample, VxlanIntFlowManagerFixture) {
+    Service as;
+    const string pair0 = ep0->getUUID() + ":ed84daef-1696-4b98-8c80-6b22d85f4dc2";
+    const string pair2 = ep2->getUUID() + ":ed84daef-1696-4b98-8c80-6b22d85f4dc2";
+
+    // pick a sample that includes exactly the pair with the lower
+    // hash, or both pairs if they hash the same
+    uint32_t h0 = IntFlowManager::getPodSvcSampleBucket(pair0);
+    uint32_t h2 = IntFlowManager::getPodSvcSampleBucket(pair2);
+    uint32_t percent = h0 == h2 ? h0 + 1 : std::max(h0, h2);
+    bool tracked0 = h0 < percent;
+    bool tracked2 = h2 < percent;
+
+    setConnected();
+    intFlowManager.setPodSvcStatsMode(IntFlowManager::POD_SVC_STATS_PAIR,
+                                      percent);
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    intFlowManager.domainUpdated(RoutingDomain::CLASS_ID, rd0->getURI());
+    initPodSvcStatsService(as);
+
+    // the flows for both pairs are written together, so once one
+    // tracked pair is seen the other pair has been handled too
+    uint64_t ck = 0;
+    const string& seen = tracked0 ? pair0 : pair2;
+    WAIT_FOR(intFlowManager.getPodSvcUuidCookie(seen, true, ck), 500);
+    BOOST_CHECK_EQUAL(tracked0,
+                      intFlowManager.getPodSvcUuidCookie(pair0, true, ck));
+    BOOST_CHECK_EQUAL(tracked2,
+                      intFlowManager.getPodSvcUuidCookie(pair2, true, ck));
+}
+
 void BaseIntFlowManagerFixture::loadBalancedServiceTest() {
     setConnected();
     LOG(DEBUG) << "#### Starting LB Service Test ####";
@@ -2646,7 +3063,8 @@ void BaseIntFlowManagerFixture::initExpRemoteEp() {
     }
 }
 
-void BaseIntFlowManagerFixture::initExpAnycastService(Service &as, int nextHop) {
+void BaseIntFlowManagerFixture::initExpAnycastService(Service &as, int nextHop,
+                                                      bool maglev) {
     string mac = "ed:84:da:ef:16:96";
     string bmac("ff:ff:ff:ff:ff:ff");
     uint8_t rmacArr[6];
@@ -2655,9 +3073,25 @@ void BaseIntFlowManagerFixture::initExpAnycastService(Service &as, int nextHop)
     string mmac("01:00:00:00:00:00/01:00:00:00:00:00");
 
     if (nextHop) {
+        // in Maglev mode the hash selects a bucket of each mapping's
+        // lookup table instead of a next hop
+        size_t lbSize = 0;
+        vector<string> v4Hops = {"169.254.169.1", "169.254.169.2"};
+        vector<string> v6Hops = {"fe80::a9:fe:a9:1", "fe80::a9:fe:a9:2"};
+        vector<size_t> v4Table, v6Table;
+        if (maglev && nextHop >= 2) {
+            lbSize = MaglevTable::getTableSize(nextHop);
+            MaglevTable::populate(v4Hops, lbSize, v4Table);
+            MaglevTable::populate(v6Hops, lbSize, v6Table);
+        }
+
         std::stringstream mss;
-        mss << "symmetric_l3l4+udp,1024,iter_hash,"
-            << nextHop << ",32,NXM_NX_REG7[]";
+        if (lbSize)
+            mss << "symmetric_l3l4+udp,1024,modulo_n,"
+                << lbSize << ",32,NXM_NX_REG7[]";
+        else
+            mss << "symmetric_l3l4+udp,1024,iter_hash,"
+                << nextHop << ",32,NXM_NX_REG7[]";
         ADDF(Bldr().table(BR).priority(50)
              .ip().reg(RD, 1).isIpDst("169.254.169.254")
              .actions()
@@ -2703,7 +3137,27 @@ void BaseIntFlowManagerFixture::initExpAnycastService(Service &as, int nextHop)
              .meta(opflexagent::flow::meta::ROUTED, opflexagent::flow::meta::ROUTED)
              .go(SVD).done());
 
-        if (nextHop >= 2) {
+        if (lbSize) {
+            // every bucket of the lookup table maps to the next hop
+            // that owns it
+            for (size_t bucket = 0; bucket < lbSize; ++bucket) {
+                ADDF(Bldr().table(SVH).priority(100)
+                     .ip().reg(RD, 1)
+                     .reg(OUTPORT, static_cast<uint32_t>(bucket))
+                     .isIpDst("169.254.169.254")
+                     .actions()
+                     .ipDst(v4Hops[v4Table[bucket]]).decTtl()
+                     .outPort(17).done());
+                ADDF(Bldr().table(SVH).priority(100)
+                     .ipv6().reg(RD, 1)
+                     .reg(OUTPORT, static_cast<uint32_t>(bucket))
+                     .isIpv6Dst("fe80::a9:fe:a9:fe")
+                     .actions()
+                     .ipv6Dst(v6Hops[v6Table[bucket]])
+                     .decTtl()
+                     .outPort(17).done());
+            }
+        } else if (nextHop >= 2) {
             ADDF(Bldr().table(SVH).priority(100)
                  .ip().reg(RD, 1).reg(OUTPORT, 1)
                  .isIpDst("169.254.169.254")
@@ -2717,6 +3171,9 @@ void BaseIntFlowManagerFixture::initExpAnycastService(Service &as, int nextHop)
                  .ipv6Dst("fe80::a9:fe:a9:2")
                  .decTtl()
                  .outPort(17).done());
+        }
+
+        if (nextHop >= 2) {
 
             ADDF(Bldr().table(SEC).priority(100).ip().in(17)
                  .isEthSrc("ed:84:da:ef:16:96")
@@ -0,0 +1,104 @@
+/*
+ * Test suite for class MaglevTable.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "MaglevTable.h"
+
+using namespace opflexagent;
+using std::string;
+using std::vector;
+
+static vector<string> makeBackends(size_t count) {
+    vector<string> backends;
+    for (size_t i = 0; i < count; ++i)
+        backends.push_back("10.1." + std::to_string(i / 256) + "." +
+                           std::to_string(i % 256));
+    return backends;
+}
+
+static vector<string> resolve(const vector<string>& backends,
+                              const vector<size_t>& table) {
+    vector<string> names;
+    for (size_t i : table)
+        names.push_back(backends.at(i));
+    return names;
+}
+
+BOOST_AUTO_TEST_SUITE(MaglevTable_test)
+
+BOOST_AUTO_TEST_CASE(size) {
+    BOOST_CHECK_EQUAL(31, MaglevTable::getTableSize(1));
+    BOOST_CHECK_EQUAL(61, MaglevTable::getTableSize(4));
+    BOOST_CHECK_EQUAL(2039, MaglevTable::getTableSize(200));
+    // never shrink below the size in use
+    BOOST_CHECK_EQUAL(2039, MaglevTable::getTableSize(10, 2039));
+    BOOST_CHECK_EQUAL(65521, MaglevTable::getTableSize(100000));
+}
+
+BOOST_AUTO_TEST_CASE(balance) {
+    vector<string> backends = makeBackends(10);
+    size_t size = MaglevTable::getTableSize(backends.size());
+    vector<size_t> table;
+    MaglevTable::populate(backends, size, table);
+    BOOST_REQUIRE_EQUAL(size, table.size());
+
+    vector<size_t> counts(backends.size(), 0);
+    for (size_t i : table)
+        counts.at(i) += 1;
+    auto mm = std::minmax_element(counts.begin(), counts.end());
+    BOOST_CHECK(*mm.second - *mm.first <= 1);
+
+    table.clear();
+    MaglevTable::populate(vector<string>(), size, table);
+    BOOST_CHECK(table.empty());
+}
+
+BOOST_AUTO_TEST_CASE(order) {
+    vector<string> backends = makeBackends(20);
+    vector<string> reversed(backends.rbegin(), backends.rend());
+    size_t size = MaglevTable::getTableSize(backends.size());
+
+    vector<size_t> t1, t2;
+    MaglevTable::populate(backends, size, t1);
+    MaglevTable::populate(reversed, size, t2);
+    BOOST_CHECK(resolve(backends, t1) == resolve(reversed, t2));
+}
+
+BOOST_AUTO_TEST_CASE(disruption) {
+    vector<string> backends = makeBackends(100);
+    size_t size = MaglevTable::getTableSize(backends.size());
+
+    vector<size_t> table;
+    MaglevTable::populate(backends, size, table);
+    vector<string> before = resolve(backends, table);
+
+    // remove one backend: its buckets move, and only a few others
+    string removed = backends[37];
+    backends.erase(backends.begin() + 37);
+    MaglevTable::populate(backends, size, table);
+    vector<string> after = resolve(backends, table);
+
+    size_t moved = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (before[i] == removed)
+            BOOST_CHECK(after[i] != removed);
+        else if (before[i] != after[i])
+            moved += 1;
+    }
+    // a full remap would move almost every bucket
+    BOOST_CHECK_MESSAGE(moved < size / 20, "moved " << moved);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -31,6 +31,13 @@ static const uint8_t arp_buf[] = {0x04, 0x00, 0x65, 0x58, 0x00, 0x00, 0x01,
 0x9e, 0x72, 0xa6, 0x94, 0x18, 0xaf, 0x0d, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
 0x00, 0x00, 0x00, 0x0d, 0x00, 0x00, 0x05};
 
+static const uint8_t vlan_buf[] = {0x04, 0x00, 0x65, 0x58, 0x00, 0x00, 0x01,
+0x00, 0xff, 0xff, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x0c, 0x01,
+0x00, 0x00, 0x00, 0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x9e, 0x72, 0xa6,
+0x94, 0x18, 0xaf, 0x81, 0x00, 0x20, 0x0a, 0x08, 0x06, 0x01, 0x01, 0x08, 0x00,
+0x06, 0x04, 0x00, 0x01, 0x9e, 0x72, 0xa6, 0x94, 0x18, 0xaf, 0x0d, 0x00, 0x00,
+0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0d, 0x00, 0x00, 0x05};
+
 static const uint8_t icmp_buf[] = {0x04, 0x00, 0x65, 0x58, 0x00, 0x00, 0x02,
 0x00, 0xff, 0xff, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x0c, 0x01,
 0x00, 0x00, 0x00, 0x01, 0x5a, 0x08, 0x66, 0xce, 0x0b, 0x49, 0x9e, 0x72, 0xa6,
@@ -82,9 +89,26 @@ BOOST_FIXTURE_TEST_CASE(arp_test, PacketDecoderFixture) {
     pktDecoder.decode(arp_buf, 66, p);
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
-    p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
-    BOOST_CHECK(p.packetTuple == expectedTuple);
+    PacketTuple packetTuple;
+    p.getPacketTuple(packetTuple);
+    packetTuple.setField(0, dropReason);
+    BOOST_CHECK(p.getParsedString() == expected);
+    BOOST_CHECK(packetTuple == expectedTuple);
+}
+
+BOOST_FIXTURE_TEST_CASE(vlan_test, PacketDecoderFixture) {
+    auto pktDecoder = pktLogger.getDecoder();
+    ParseInfo p(&pktDecoder);
+    PacketTuple expectedTuple("", "Int-PORT_SECURITY_TABLE", "9e:72:a6:94:18:af", "ff:ff:ff:ff:ff:ff", "ARP", "13.0.0.3", "13.0.0.5" ,"", "", "");
+    std::string expected(" MAC=ff:ff:ff:ff:ff:ff:9e:72:a6:94:18:af:Qtag QTAG=10 ARP_SPA=13.0.0.3 ARP_TPA=13.0.0.5 ARP_OP=1");
+    pktDecoder.decode(vlan_buf, 70, p);
+    std::string dropReason;
+    pktLogger.getDropReason(p, dropReason);
+    PacketTuple packetTuple;
+    p.getPacketTuple(packetTuple);
+    packetTuple.setField(0, dropReason);
+    BOOST_CHECK(p.getParsedString() == expected);
+    BOOST_CHECK(packetTuple == expectedTuple);
 }
 
 BOOST_FIXTURE_TEST_CASE(icmp_test, PacketDecoderFixture) {
@@ -95,9 +119,11 @@ BOOST_FIXTURE_TEST_CASE(icmp_test, PacketDecoderFixture) {
     pktDecoder.decode(icmp_buf, 66, p);
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
-    p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
-    BOOST_CHECK(p.packetTuple == expectedTuple);
+    PacketTuple packetTuple;
+    p.getPacketTuple(packetTuple);
+    packetTuple.setField(0, dropReason);
+    BOOST_CHECK(p.getParsedString() == expected);
+    BOOST_CHECK(packetTuple == expectedTuple);
 }
 
 BOOST_FIXTURE_TEST_CASE(tcp_test, PacketDecoderFixture) {
@@ -108,9 +134,11 @@ BOOST_FIXTURE_TEST_CASE(tcp_test, PacketDecoderFixture) {
     pktDecoder.decode(tcp_buf, 98, p);
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
-    p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
-    BOOST_CHECK(p.packetTuple == expectedTuple);
+    PacketTuple packetTuple;
+    p.getPacketTuple(packetTuple);
+    packetTuple.setField(0, dropReason);
+    BOOST_CHECK(p.getParsedString() == expected);
+    BOOST_CHECK(packetTuple == expectedTuple);
 }
 
 BOOST_FIXTURE_TEST_CASE(udp_test, PacketDecoderFixture) {
@@ -121,9 +149,11 @@ BOOST_FIXTURE_TEST_CASE(udp_test, PacketDecoderFixture) {
     pktDecoder.decode(udp_buf, 66, p);
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
-    p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
-    BOOST_CHECK(p.packetTuple == expectedTuple);
+    PacketTuple packetTuple;
+    p.getPacketTuple(packetTuple);
+    packetTuple.setField(0, dropReason);
+    BOOST_CHECK(p.getParsedString() == expected);
+    BOOST_CHECK(packetTuple == expectedTuple);
 }
 
 BOOST_FIXTURE_TEST_CASE(udp_over_v6_test, PacketDecoderFixture) {
@@ -134,9 +164,11 @@ BOOST_FIXTURE_TEST_CASE(udp_over_v6_test, PacketDecoderFixture) {
     pktDecoder.decode(udpv6_buf, 86, p);
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
-    p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
-    BOOST_CHECK(p.packetTuple == expectedTuple);
+    PacketTuple packetTuple;
+    p.getPacketTuple(packetTuple);
+    packetTuple.setField(0, dropReason);
+    BOOST_CHECK(p.getParsedString() == expected);
+    BOOST_CHECK(packetTuple == expectedTuple);
 }
 
 BOOST_FIXTURE_TEST_CASE(tcp_over_v6_test, PacketDecoderFixture) {
@@ -147,9 +179,53 @@ BOOST_FIXTURE_TEST_CASE(tcp_over_v6_test, PacketDecoderFixture) {
     pktDecoder.decode(tcpv6_buf, 118, p);
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
-    p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
-    BOOST_CHECK(p.packetTuple == expectedTuple);
+    PacketTuple packetTuple;
+    p.getPacketTuple(packetTuple);
+    packetTuple.setField(0, dropReason);
+    BOOST_CHECK(p.getParsedString() == expected);
+    BOOST_CHECK(packetTuple == expectedTuple);
+}
+
+BOOST_FIXTURE_TEST_CASE(drop_flow_summary_test, PacketDecoderFixture) {
+    std::vector<unsigned char> tcp(tcp_buf, tcp_buf + 98);
+    std::vector<unsigned char> arp(arp_buf, arp_buf + 66);
+    pktLogger.setNotifSock("/tmp/packet-event-test.sock");
+    for (int i = 0; i < 3; i++) {
+        pktLogger.parseLog(tcp.data(), tcp.size());
+    }
+    pktLogger.parseLog(arp.data(), arp.size());
+
+    // only the first packet of each flow is exported individually
+    auto &events = pktLogger.getEventQueue();
+    BOOST_CHECK_EQUAL(2, events.size());
+
+    // the single packet flow was already exported with its event,
+    // so only the repeated flow is summarised
+    pktLogger.flushDropFlows();
+    auto &summaries = pktLogger.getDropFlowSummaryQueue();
+    BOOST_REQUIRE_EQUAL(1, summaries.size());
+    std::string value;
+    summaries.front().getField(0, value);
+    BOOST_CHECK_EQUAL("Int-SOURCE_TABLE", value);
+    summaries.front().getField(9, value);
+    BOOST_CHECK_EQUAL("3", value);
+    summaries.front().getField(10, value);
+    BOOST_CHECK_EQUAL("294", value);
+    summaries.pop();
+
+    // a packet of a known flow is only reported in the summary
+    pktLogger.parseLog(tcp.data(), tcp.size());
+    BOOST_CHECK_EQUAL(2, events.size());
+    pktLogger.flushDropFlows();
+    BOOST_REQUIRE_EQUAL(1, summaries.size());
+    summaries.front().getField(9, value);
+    BOOST_CHECK_EQUAL("1", value);
+
+    // flows idle for a whole interval are forgotten
+    pktLogger.flushDropFlows();
+    BOOST_CHECK_EQUAL(1, summaries.size());
+    pktLogger.parseLog(tcp.data(), tcp.size());
+    BOOST_CHECK_EQUAL(3, events.size());
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -18,6 +18,7 @@
 
 #include "CtZoneManager.h"
 #include "PacketInHandler.h"
+#include "Packets.h"
 #include <opflexagent/test/ModbFixture.h>
 #include "MockSwitchManager.h"
 #include "IntFlowManager.h"
@@ -735,6 +736,77 @@ BOOST_FIXTURE_TEST_CASE(dhcpv4_request_inv, PacketInHandlerFixture) {
     verify_dhcpv4(intConn.getSentMsg(0), opflexagent::dhcp::message_type::NAK);
 }
 
+static void verify_dhcpv4_xid(const OfpBuf& msg, const uint8_t* xid,
+                              const uint8_t* clientMac) {
+    using namespace dhcp;
+    using namespace udp;
+
+    struct ofputil_packet_out po;
+    uint64_t ofpacts_stub[1024 / 8];
+    struct ofpbuf ofpact;
+    ofpbuf_use_stub(&ofpact, ofpacts_stub, sizeof ofpacts_stub);
+    ofputil_decode_packet_out(&po,
+                              (ofp_header*)msg.data(),
+                              NULL,
+                              &ofpact);
+    DpPacketP pkt;
+    struct flow flow;
+    dp_packet_use_const(pkt.get(), po.packet, po.packet_len);
+    flow_extract(pkt.get(), &flow);
+
+    size_t l4_size = dpp_l4_size(pkt.get());
+    BOOST_REQUIRE(l4_size > (sizeof(struct udp_hdr) +
+                             sizeof(struct dhcp_hdr) + 1));
+    struct udp_hdr* udp_pkt = (struct udp_hdr*)dpp_l4(pkt.get());
+    struct dhcp_hdr* dhcp_pkt =
+        (struct dhcp_hdr*)((char*)udp_pkt + sizeof(struct udp_hdr));
+    BOOST_CHECK(0 == memcmp(xid, &dhcp_pkt->xid, sizeof(dhcp_pkt->xid)));
+    BOOST_CHECK(0 == memcmp(clientMac, dhcp_pkt->chaddr, 6));
+
+    // checksum over the pseudoheader and UDP datagram must verify
+    uint32_t chksum = 0;
+    packets::chksum_accum(chksum, (uint16_t*)&flow.nw_src, 4);
+    packets::chksum_accum(chksum, (uint16_t*)&flow.nw_dst, 4);
+    struct {uint8_t zero; uint8_t proto;} proto;
+    proto.zero = 0;
+    proto.proto = 17;
+    packets::chksum_accum(chksum, (uint16_t*)&proto, 2);
+    packets::chksum_accum(chksum, (uint16_t*)&udp_pkt->len, 2);
+    packets::chksum_accum(chksum, (uint16_t*)udp_pkt, l4_size);
+    BOOST_CHECK_EQUAL(0, packets::chksum_finalize(chksum));
+}
+
+BOOST_FIXTURE_TEST_CASE(dhcpv4_reply_cache, PacketInHandlerFixture) {
+    setDhcpv4Config();
+
+    uint8_t buf[sizeof(pkt_dhcpv4_discover)];
+    memcpy(buf, pkt_dhcpv4_discover, sizeof(buf));
+    const size_t xid_off = 46;
+
+    for (int i = 0; i < 3; i++) {
+        // retrying client with a new transaction ID
+        buf[xid_off + 3] = 0x12 + i;
+
+        ofputil_packet_in_private pin;
+        init_packet_in(pin, buf, sizeof(buf),
+                       opflexagent::flow::cookie::DHCP_V4,
+                       IntFlowManager::SEC_TABLE_ID, 80);
+        OfpBuf b(ofputil_encode_packet_in_private(&pin,
+                                                  OFPUTIL_P_OF13_OXM,
+                                                  OFPUTIL_PACKET_IN_NXT));
+        pktInHandler.Handle(&intConn, OFPTYPE_PACKET_IN, b.get());
+        BOOST_REQUIRE_EQUAL(i + 1, intConn.getSentMsgCount());
+
+        verify_dhcpv4(intConn.getSentMsg(i),
+                      opflexagent::dhcp::message_type::OFFER);
+        verify_dhcpv4_xid(intConn.getSentMsg(i), buf + xid_off, buf + 6);
+        BOOST_CHECK_EQUAL(1, pktInHandler.getDhcpReplyCache().size());
+    }
+
+    pktInHandler.endpointUpdated(ep0->getUUID());
+    BOOST_CHECK_EQUAL(0, pktInHandler.getDhcpReplyCache().size());
+}
+
 BOOST_FIXTURE_TEST_CASE(dhcpv6_noconfig, PacketInHandlerFixture) {
     ofputil_packet_in_private pin;
     init_packet_in(pin, &pkt_dhcpv6_solicit, sizeof(pkt_dhcpv6_solicit),
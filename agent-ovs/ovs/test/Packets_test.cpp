@@ -11,6 +11,11 @@
 #include <boost/test/unit_test.hpp>
 
 #include "Packets.h"
+#include "ovs-ofpbuf.h"
+#include "arp.h"
+
+#include <cstring>
+#include <random>
 
 using namespace opflexagent::packets;
 using boost::asio::ip::address;
@@ -41,4 +46,72 @@ BOOST_AUTO_TEST_CASE(chksum) {
     BOOST_CHECK_EQUAL(0x0ae0, result);
 }
 
+// the straightforward 16-bit loop, as a reference
+static void chksum_accum_ref(uint32_t& chksum, uint16_t* addr, size_t len) {
+    while (len > 1)  {
+        chksum += *addr++;
+        len -= 2;
+    }
+    if (len > 0)
+        chksum += *(uint8_t*)addr;
+}
+
+BOOST_AUTO_TEST_CASE(chksum_wide) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> data(2048 + 16);
+    for (uint8_t& b : data) b = byte(gen);
+
+    // all lengths and alignments, with a nonzero starting sum
+    for (size_t off = 0; off < 8; off++) {
+        for (size_t len = 0; len <= 2048; len++) {
+            uint32_t c1 = 0x1234;
+            uint32_t c2 = 0x1234;
+            chksum_accum_ref(c1, (uint16_t*)(data.data() + off), len);
+            chksum_accum(c2, (uint16_t*)(data.data() + off), len);
+            BOOST_REQUIRE_EQUAL(chksum_finalize(c1), chksum_finalize(c2));
+        }
+    }
+
+    // all ones
+    std::vector<uint8_t> ones(1500, 0xff);
+    uint32_t c1 = 0;
+    uint32_t c2 = 0;
+    chksum_accum_ref(c1, (uint16_t*)ones.data(), ones.size());
+    chksum_accum(c2, (uint16_t*)ones.data(), ones.size());
+    BOOST_CHECK_EQUAL(chksum_finalize(c1), chksum_finalize(c2));
+}
+
+BOOST_AUTO_TEST_CASE(batch) {
+    using namespace opflexagent;
+
+    const uint8_t mac1[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x01};
+    const uint8_t mac2[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x02};
+    address_v6::bytes_type ip1 =
+        address_v6::from_string("fd8c:ad36:ceb3:601f::1").to_bytes();
+    address_v6::bytes_type ip2 =
+        address_v6::from_string("ff02::1").to_bytes();
+
+    PacketBatch batch(1024, 2);
+    compose_arp(batch, arp::op::REQUEST, mac1, MAC_ADDR_BROADCAST,
+                mac1, MAC_ADDR_BROADCAST, 0x0a000001, 0x0a000001);
+    compose_icmp6_neigh_ad(batch, 0, mac1, mac2,
+                           (struct in6_addr*)ip1.data(),
+                           (struct in6_addr*)ip2.data());
+    BOOST_REQUIRE_EQUAL(2, batch.size());
+
+    // each packet in the batch matches the standalone version
+    OfpBuf arpb(compose_arp(arp::op::REQUEST, mac1, MAC_ADDR_BROADCAST,
+                            mac1, MAC_ADDR_BROADCAST,
+                            0x0a000001, 0x0a000001));
+    BOOST_REQUIRE_EQUAL(arpb.size(), batch.length(0));
+    BOOST_CHECK(0 == memcmp(arpb.data(), batch.data(0), arpb.size()));
+
+    OfpBuf nab(compose_icmp6_neigh_ad(0, mac1, mac2,
+                                      (struct in6_addr*)ip1.data(),
+                                      (struct in6_addr*)ip2.data()));
+    BOOST_REQUIRE_EQUAL(nab.size(), batch.length(1));
+    BOOST_CHECK(0 == memcmp(nab.data(), batch.data(1), nab.size()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
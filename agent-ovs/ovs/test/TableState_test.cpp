@@ -17,6 +17,7 @@
 
 #include "TableState.h"
 #include "FlowBuilder.h"
+#include "FlowArena.h"
 #include <opflexagent/logging.h>
 
 #include "ovs-shim.h"
@@ -244,4 +245,55 @@ BOOST_FIXTURE_TEST_CASE(diff, TableStateFixture) {
     BOOST_CHECK(diffs.edits[2].second->matchEq(f3_1.get()));
 }
 
+BOOST_FIXTURE_TEST_CASE(arena, TableStateFixture) {
+    el.push_back(f1_1);
+    state.apply("test", el, diffs);
+    BOOST_REQUIRE(1 == diffs.edits.size());
+
+    {
+        FlowArena::Scope scope;
+        FlowArena* arena = FlowArena::current();
+        BOOST_REQUIRE(arena != NULL);
+
+        // unchanged entry is replaced with the cached one
+        el.clear();
+        el.push_back(FlowBuilder().priority(1).inPort(5)
+                     .action().output(4)
+                     .parent().build());
+        BOOST_CHECK(el[0]->isArenaBacked());
+        BOOST_CHECK_EQUAL(1, arena->getLiveEntries());
+        state.apply("test", el, diffs);
+        BOOST_CHECK(0 == diffs.edits.size());
+        BOOST_CHECK(el[0] == f1_1);
+        BOOST_CHECK_EQUAL(0, arena->getLiveEntries());
+
+        // modified and new entries are copied out of the arena
+        el.clear();
+        el.push_back(FlowBuilder().priority(1).inPort(5)
+                     .action().decTtl().output(4)
+                     .parent().build());
+        el.push_back(FlowBuilder().priority(1).inPort(4)
+                     .action().output(5)
+                     .parent().build());
+        state.apply("test", el, diffs);
+        el.clear();
+        BOOST_CHECK_EQUAL(0, arena->getLiveEntries());
+        std::sort(diffs.edits.begin(), diffs.edits.end());
+        BOOST_REQUIRE(2 == diffs.edits.size());
+        BOOST_CHECK_EQUAL(FlowEdit::ADD, diffs.edits[0].first);
+        BOOST_CHECK(!diffs.edits[0].second->isArenaBacked());
+        BOOST_CHECK(diffs.edits[0].second->actionEq(f2_1.get()));
+        BOOST_CHECK_EQUAL(FlowEdit::MOD, diffs.edits[1].first);
+        BOOST_CHECK(!diffs.edits[1].second->isArenaBacked());
+        BOOST_CHECK(diffs.edits[1].second->actionEq(f1_2.get()));
+    }
+    BOOST_CHECK(FlowArena::current() == NULL);
+
+    el.clear();
+    el.push_back(f1_2);
+    el.push_back(f2_1);
+    state.diffSnapshot(el, diffs);
+    BOOST_CHECK(0 == diffs.edits.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark for the packet checksum used by the OVS renderer
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "Packets.h"
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using opflexagent::packets::chksum_accum;
+using opflexagent::packets::chksum_finalize;
+namespace po = boost::program_options;
+
+typedef std::chrono::steady_clock bench_clock;
+
+// the straightforward 16-bit loop, as a reference
+static void chksum_accum_ref(uint32_t& chksum, uint16_t* addr, size_t len) {
+    while (len > 1)  {
+        chksum += *addr++;
+        len -= 2;
+    }
+    if (len > 0)
+        chksum += *(uint8_t*)addr;
+}
+
+template <typename F>
+static uint64_t timeNs(size_t iterations, F f) {
+    auto start = bench_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        f();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>
+        (bench_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t iterations;
+    std::vector<size_t> lengths;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "Print this help message")
+        ("iterations", po::value<size_t>(&iterations)
+         ->default_value(200000), "Checksums to compute per length")
+        ("length", po::value<std::vector<size_t>>(&lengths)
+         ->multitoken(), "Packet lengths to checksum (default: the "
+         "sizes of ARP and neighbor advertisements and a full MTU)")
+        ;
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv)
+                  .options(desc).run(), vm);
+        po::notify(vm);
+        if (vm.count("help")) {
+            std::cout << "Usage: " << argv[0] << " [options]\n";
+            std::cout << desc;
+            return 0;
+        }
+    } catch (const po::error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (lengths.empty())
+        lengths = {64, 86, 342, 1500};
+
+    size_t maxLen = 0;
+    for (size_t len : lengths)
+        maxLen = std::max(maxLen, len);
+    std::vector<uint8_t> data(maxLen);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = i * 7;
+
+    int status = 0;
+    for (size_t len : lengths) {
+        // checksum each packet from scratch as the renderer does, so
+        // that the 32-bit reference sum cannot overflow
+        uint16_t s1 = 0;
+        uint16_t s2 = 0;
+        uint64_t ref = timeNs(iterations, [&]() {
+                uint32_t c = 0;
+                chksum_accum_ref(c, (uint16_t*)data.data(), len);
+                s1 = chksum_finalize(c);
+            });
+        uint64_t cur = timeNs(iterations, [&]() {
+                uint32_t c = 0;
+                chksum_accum(c, (uint16_t*)data.data(), len);
+                s2 = chksum_finalize(c);
+            });
+        if (s1 != s2) {
+            std::cerr << "Checksum mismatch for " << len << " bytes"
+                      << std::endl;
+            status = 2;
+        }
+        std::cout << "chksum " << len << " bytes: reference "
+                  << (iterations ? ref / iterations : 0)
+                  << "ns, current "
+                  << (iterations ? cur / iterations : 0) << "ns"
+                  << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,767 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Flow programming throughput benchmark for the OVS renderer
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/Agent.h>
+#include <opflexagent/EndpointSource.h>
+#include <opflexagent/IdGenerator.h>
+#include <opflexagent/TunnelEpManager.h>
+#include <opflexagent/logging.h>
+
+#include "IntFlowManager.h"
+#include "AccessFlowManager.h"
+#include "CtZoneManager.h"
+#include "FlowBuilder.h"
+#include "FlowExecutor.h"
+#include "TableState.h"
+#include "MockSwitchManager.h"
+#include "MockPortMapper.h"
+#include "MockFlowReader.h"
+
+#include <opflex/modb/Mutator.h>
+#include <modelgbp/dmtree/Root.hpp>
+#include <modelgbp/l2/EtherTypeEnumT.hpp>
+#include <modelgbp/gbp/DirectionEnumT.hpp>
+
+#include <boost/program_options.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/lexical_cast.hpp>
+#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/prettywriter.h>
+
+#include <arpa/inet.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+using boost::lexical_cast;
+using opflex::modb::URI;
+using opflex::modb::Mutator;
+using namespace opflexagent;
+namespace po = boost::program_options;
+
+typedef std::chrono::steady_clock bench_clock;
+
+/*
+ * Count C++ heap allocations made by the process.  Allocations made
+ * with malloc directly (such as OVS ofpbufs) are not included.
+ */
+static std::atomic<uint64_t> allocCount(0);
+static std::atomic<uint64_t> allocBytes(0);
+
+void* operator new(size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+/**
+ * Flow executor that encodes every modification as it would be sent
+ * to the switch and discards the result, counting messages and bytes
+ */
+class SinkFlowExecutor : public FlowExecutor {
+public:
+    SinkFlowExecutor() : flowMods{0, 0, 0}, groupMods(0), bytes(0) {}
+
+    virtual bool Execute(const FlowEdit& fe) {
+        for (const FlowEdit::Entry& e : fe.edits) {
+            OfpBuf msg(EncodeFlowMod(e, OFP13_VERSION));
+            bytes += msg->size;
+            flowMods[e.first] += 1;
+        }
+        return true;
+    }
+    virtual bool Execute(const GroupEdit& ge) {
+        for (const GroupEdit::Entry& e : ge.edits) {
+            OfpBuf msg(EncodeGroupMod(e, OFP13_VERSION));
+            bytes += msg->size;
+            groupMods += 1;
+        }
+        return true;
+    }
+    virtual bool Execute(const TlvEdit&) { return true; }
+    virtual bool ExecuteNoBlock(const FlowEdit& fe) { return Execute(fe); }
+    virtual bool ExecuteNoBlock(const GroupEdit& ge) { return Execute(ge); }
+    virtual bool ExecuteNoBlock(const TlvEdit& te) { return Execute(te); }
+
+    uint64_t totalFlowMods() const {
+        return flowMods[FlowEdit::ADD] + flowMods[FlowEdit::MOD] +
+            flowMods[FlowEdit::DEL];
+    }
+
+    std::atomic<uint64_t> flowMods[3];
+    std::atomic<uint64_t> groupMods;
+    std::atomic<uint64_t> bytes;
+};
+
+class BenchEndpointSource : public EndpointSource {
+public:
+    BenchEndpointSource(EndpointManager* manager)
+        : EndpointSource(manager) {}
+    virtual ~BenchEndpointSource() {}
+};
+
+/**
+ * Latency samples for one handler, in microseconds
+ */
+class LatencyHistogram {
+public:
+    void add(uint64_t us) { samples.push_back(us); }
+
+    void write(rapidjson::PrettyWriter<rapidjson::OStreamWrapper>& w) {
+        std::sort(samples.begin(), samples.end());
+        uint64_t sum = 0;
+        for (uint64_t s : samples) sum += s;
+
+        w.StartObject();
+        w.Key("count");
+        w.Uint64(samples.size());
+        if (!samples.empty()) {
+            w.Key("min_us");
+            w.Uint64(samples.front());
+            w.Key("mean_us");
+            w.Double(double(sum) / samples.size());
+            w.Key("p50_us");
+            w.Uint64(percentile(50));
+            w.Key("p90_us");
+            w.Uint64(percentile(90));
+            w.Key("p99_us");
+            w.Uint64(percentile(99));
+            w.Key("max_us");
+            w.Uint64(samples.back());
+
+            // power of two buckets, keyed by upper bound
+            std::map<uint64_t, uint64_t> buckets;
+            for (uint64_t s : samples) {
+                uint64_t b = 1;
+                while (b < s) b <<= 1;
+                buckets[b] += 1;
+            }
+            w.Key("buckets");
+            w.StartObject();
+            for (const auto& b : buckets) {
+                w.Key(("le_" + lexical_cast<string>(b.first)).c_str());
+                w.Uint64(b.second);
+            }
+            w.EndObject();
+        }
+        w.EndObject();
+    }
+
+private:
+    uint64_t percentile(unsigned p) {
+        size_t idx = (samples.size() - 1) * p / 100;
+        return samples[idx];
+    }
+
+    vector<uint64_t> samples;
+};
+
+struct BenchConfig {
+    size_t endpoints;
+    size_t epgs;
+    size_t contracts;
+    size_t rules;
+    size_t secGroups;
+    size_t iterations;
+    size_t tableObjects;
+    size_t tableFlows;
+};
+
+/**
+ * Get the number of host bits in each group's subnet.  Each subnet
+ * holds its group's share of the endpoints plus the network, router
+ * and broadcast addresses, and the subnets are laid out back to back
+ * in 10.0.0.0/8.
+ *
+ * @return the number of host bits, or 0 if the endpoints and groups
+ * don't fit
+ */
+static size_t getSubnetBits(const BenchConfig& config) {
+    size_t epgs = std::max<size_t>(1, config.epgs);
+    size_t perEpg = (config.endpoints + epgs - 1) / epgs;
+    size_t bits = 8;
+    while ((size_t(1) << bits) < perEpg + 3)
+        bits += 1;
+    if ((epgs << bits) > (size_t(1) << 24))
+        return 0;
+    return bits;
+}
+
+/**
+ * Synthetic population of policy and endpoints that drives the
+ * integration and access flow managers
+ */
+class RenderBench {
+public:
+    RenderBench(const BenchConfig& config_)
+        : config(config_),
+          agent(framework, std::make_tuple("info", false, "")),
+          tunnelEpManager(&agent),
+          intCtZoneManager(intIdGen), accCtZoneManager(accIdGen),
+          intSwitchManager(agent, intExec, intReader, intPortMapper),
+          accSwitchManager(agent, accExec, accReader, accPortMapper),
+          intFlowManager(agent, intSwitchManager, intIdGen,
+                         intCtZoneManager, tunnelEpManager),
+          accessFlowManager(agent, accSwitchManager, accIdGen,
+                            accCtZoneManager),
+          epSrc(&agent.getEndpointManager()) {}
+
+    void start() {
+        agent.setUplinkMac("11:22:33:44:55:66");
+        agent.clearFeatureFlags();
+        agent.start();
+
+        for (CtZoneManager* ct : {&intCtZoneManager, &accCtZoneManager}) {
+            ct->setCtZoneRange(1, 65534);
+            ct->init("conntrack");
+        }
+
+        intPortMapper.setPort("uplink", 1024);
+        intPortMapper.setPort(1024, "uplink");
+        intPortMapper.setPort("br0_vxlan0", 2048);
+        intPortMapper.setPort(2048, "br0_vxlan0");
+
+        for (MockSwitchManager* sm : {&intSwitchManager, &accSwitchManager}) {
+            sm->setSyncDelayOnConnect(0);
+            sm->start("placeholder");
+        }
+
+        intFlowManager.setEncapType(IntFlowManager::ENCAP_VXLAN);
+        intFlowManager.setEncapIface("br0_vxlan0");
+        intFlowManager.setUplinkIface("uplink");
+        intFlowManager.setTunnel("10.11.12.13", 4789);
+        intFlowManager.setVirtualRouter(true, true, "aa:bb:cc:dd:ee:ff");
+        intFlowManager.setVirtualDHCP(true, "aa:bb:cc:dd:ee:ff");
+        intFlowManager.enableConnTrack();
+        intSwitchManager.registerStateHandler(&intFlowManager);
+        intFlowManager.start();
+        intFlowManager.registerModbListeners();
+
+        accSwitchManager.registerStateHandler(&accessFlowManager);
+        accessFlowManager.enableConnTrack();
+        accessFlowManager.start();
+
+        for (MockSwitchManager* sm : {&intSwitchManager, &accSwitchManager}) {
+            sm->enableSync();
+            sm->connect();
+        }
+        barrier();
+    }
+
+    void stop() {
+        accessFlowManager.stop();
+        intFlowManager.stop();
+        intSwitchManager.stop();
+        accSwitchManager.stop();
+        agent.stop();
+    }
+
+    /**
+     * Wait for all tasks queued on the agent thread to complete
+     */
+    void barrier() {
+        std::promise<void> done;
+        agent.getAgentIOService().post([&done]() { done.set_value(); });
+        done.get_future().wait();
+    }
+
+    void createPolicy() {
+        using namespace modelgbp;
+        using namespace modelgbp::gbp;
+        using namespace modelgbp::gbpe;
+
+        shared_ptr<policy::Universe> universe =
+            policy::Universe::resolve(framework).get();
+        Mutator mutator(framework, "policyreg");
+        shared_ptr<policy::Space> space =
+            universe->addPolicySpace("tenant0");
+        universe->addPlatformConfig("default")
+            ->setMulticastGroupIP("224.1.1.1");
+
+        shared_ptr<RoutingDomain> rd = space->addGbpRoutingDomain("rd0");
+        rd->addGbpeInstContext()->setEncapId(0x1);
+        shared_ptr<BridgeDomain> bd = space->addGbpBridgeDomain("bd0");
+        bd->addGbpBridgeDomainToNetworkRSrc()
+            ->setTargetRoutingDomain(rd->getURI());
+        bd->addGbpeInstContext()->setEncapId(0x2);
+
+        subnetBits = getSubnetBits(config);
+        for (size_t i = 0; i < config.epgs; ++i) {
+            const string id = lexical_cast<string>(i);
+            shared_ptr<FloodDomain> fd = space->addGbpFloodDomain("fd" + id);
+            fd->addGbpFloodDomainToNetworkRSrc()
+                ->setTargetBridgeDomain(bd->getURI());
+            fd->addGbpeFloodContext();
+
+            shared_ptr<Subnets> subnets = space->addGbpSubnets("subnets" + id);
+            boost::asio::ip::address_v4 net(0x0a000000 + (i << subnetBits));
+            boost::asio::ip::address_v4 router(0x0a000001 +
+                                               (i << subnetBits));
+            subnets->addGbpSubnet("subnet" + id)
+                ->setAddress(net.to_string())
+                .setPrefixLen(32 - subnetBits)
+                .setVirtualRouterIp(router.to_string());
+            fd->addGbpForwardingBehavioralGroupToSubnetsRSrc()
+                ->setTargetSubnets(subnets->getURI());
+            rd->addGbpRoutingDomainToIntSubnetsRSrc(subnets->getURI()
+                                                    .toString());
+
+            shared_ptr<EpGroup> epg = space->addGbpEpGroup("epg" + id);
+            epg->addGbpEpGroupToNetworkRSrc()
+                ->setTargetFloodDomain(fd->getURI());
+            epg->addGbpeInstContext()->setEncapId(0x1000 + i);
+            epgs.push_back(epg->getURI());
+        }
+
+        for (size_t i = 0; i < config.contracts; ++i) {
+            const string id = lexical_cast<string>(i);
+            shared_ptr<Contract> con = space->addGbpContract("contract" + id);
+            shared_ptr<Subject> subj = con->addGbpSubject("subject" + id);
+            for (size_t r = 0; r < config.rules; ++r) {
+                const string rid = id + "_" + lexical_cast<string>(r);
+                shared_ptr<L24Classifier> cls =
+                    space->addGbpeL24Classifier("classifier" + rid);
+                cls->setOrder(r)
+                    .setEtherT(l2::EtherTypeEnumT::CONST_IPV4)
+                    .setProt(6 /* TCP */)
+                    .setDFromPort(1000 + r)
+                    .setDToPort(1000 + r);
+                subj->addGbpRule("rule" + rid)
+                    ->setDirection(DirectionEnumT::CONST_BIDIRECTIONAL)
+                    .setOrder(r)
+                    .addGbpRuleToClassifierRSrc(cls->getURI().toString());
+            }
+            contracts.push_back(con->getURI());
+
+            if (epgs.size() < 2) continue;
+            // each contract is provided by one group and consumed by
+            // the next one
+            shared_ptr<EpGroup> prov =
+                EpGroup::resolve(framework, epgs[i % epgs.size()]).get();
+            shared_ptr<EpGroup> cons =
+                EpGroup::resolve(framework,
+                                 epgs[(i + 1) % epgs.size()]).get();
+            prov->addGbpEpGroupToProvContractRSrc(con->getURI().toString());
+            cons->addGbpEpGroupToConsContractRSrc(con->getURI().toString());
+        }
+
+        for (size_t i = 0; i < config.secGroups; ++i) {
+            const string id = lexical_cast<string>(i);
+            shared_ptr<SecGroup> sg = space->addGbpSecGroup("secgrp" + id);
+            shared_ptr<SecGroupSubject> subj =
+                sg->addGbpSecGroupSubject("subject" + id);
+            for (size_t r = 0; r < config.rules; ++r) {
+                const string rid = id + "_" + lexical_cast<string>(r);
+                shared_ptr<L24Classifier> cls =
+                    space->addGbpeL24Classifier("sgclassifier" + rid);
+                cls->setOrder(r)
+                    .setEtherT(l2::EtherTypeEnumT::CONST_IPV4)
+                    .setProt(17 /* UDP */)
+                    .setDFromPort(2000 + r)
+                    .setDToPort(2000 + r);
+                subj->addGbpSecGroupRule("rule" + rid)
+                    ->setDirection(r % 2 ? DirectionEnumT::CONST_IN
+                                   : DirectionEnumT::CONST_OUT)
+                    .setOrder(r)
+                    .addGbpRuleToClassifierRSrc(cls->getURI().toString());
+            }
+            secGroups.push_back(sg->getURI());
+        }
+
+        mutator.commit();
+    }
+
+    Endpoint makeEndpoint(size_t i) {
+        Endpoint ep("bench-ep-" + lexical_cast<string>(i));
+        const string iface = "veth" + lexical_cast<string>(i);
+        ep.setInterfaceName(iface);
+        ep.setAccessInterface(iface + "-access");
+        ep.setAccessUplinkInterface(iface + "-uplink");
+
+        uint8_t mac[6] = {0x02, 0x00, 0, 0, 0, 0};
+        uint32_t n = htonl(i);
+        memcpy(mac + 2, &n, 4);
+        ep.setMAC(opflex::modb::MAC(mac));
+
+        // endpoint i is the (i / epgs)th endpoint of its group, which
+        // always fits in the group's subnet
+        size_t epg = epgs.empty() ? 0 : i % epgs.size();
+        size_t index = i / std::max<size_t>(1, epgs.size());
+        boost::asio::ip::address_v4 ip(0x0a000000 + (epg << subnetBits) +
+                                       2 + index);
+        ep.addIP(ip.to_string());
+        if (!epgs.empty())
+            ep.setEgURI(epgs[epg]);
+        if (!secGroups.empty())
+            ep.addSecurityGroup(secGroups[i % secGroups.size()]);
+        return ep;
+    }
+
+    void createEndpoints() {
+        for (size_t i = 0; i < config.endpoints; ++i) {
+            Endpoint ep = makeEndpoint(i);
+            uint32_t port = 100 + i;
+            intPortMapper.setPort(ep.getInterfaceName().get(), port);
+            intPortMapper.setPort(port, ep.getInterfaceName().get());
+            accPortMapper.setPort(ep.getAccessInterface().get(), 2 * port);
+            accPortMapper.setPort(2 * port, ep.getAccessInterface().get());
+            accPortMapper.setPort(ep.getAccessUplinkInterface().get(),
+                                  2 * port + 1);
+            accPortMapper.setPort(2 * port + 1,
+                                  ep.getAccessUplinkInterface().get());
+            epSrc.updateEndpoint(ep);
+            endpoints.push_back(ep.getUUID());
+        }
+    }
+
+    /**
+     * Time a single render of one object by dispatching it and
+     * waiting for the agent thread to drain
+     */
+    template <typename F>
+    void timeRender(const string& handler, F dispatch) {
+        auto start = bench_clock::now();
+        dispatch();
+        barrier();
+        auto end = bench_clock::now();
+        latency[handler].add(std::chrono::duration_cast
+                             <std::chrono::microseconds>(end - start)
+                             .count());
+    }
+
+    /**
+     * Forget the flows cached by both switch managers so that the
+     * next render of every object produces a full set of flow mods
+     * rather than an empty diff
+     */
+    void clearTableState() {
+        agent.getAgentIOService().post([this]() {
+                intSwitchManager.clearTableState();
+                accSwitchManager.clearTableState();
+            });
+        barrier();
+    }
+
+    void renderAll() {
+        for (size_t it = 0; it < config.iterations; ++it) {
+            clearTableState();
+            for (const URI& epg : epgs) {
+                timeRender("int_epg_domain", [&]() {
+                        intFlowManager.egDomainUpdated(epg);
+                    });
+            }
+            for (const URI& con : contracts) {
+                timeRender("int_contract", [&]() {
+                        intFlowManager.contractUpdated(con);
+                    });
+            }
+            for (const string& uuid : endpoints) {
+                timeRender("int_endpoint", [&]() {
+                        intFlowManager.endpointUpdated(uuid);
+                    });
+                timeRender("access_endpoint", [&]() {
+                        accessFlowManager.endpointUpdated(uuid);
+                    });
+            }
+            for (const URI& sg : secGroups) {
+                timeRender("access_secgroup", [&]() {
+                        accessFlowManager.secGroupUpdated(sg);
+                    });
+            }
+        }
+    }
+
+    /**
+     * Apply synthetic flow entries to a standalone table, timing the
+     * diff computed by the table separately from encoding the
+     * resulting flow mods
+     */
+    void tableStateBench() {
+        TableState table;
+        FlowEdit diffs;
+        for (size_t pass = 0; pass < 3; ++pass) {
+            for (size_t o = 0; o < config.tableObjects; ++o) {
+                const string objId = "obj" + lexical_cast<string>(o);
+                FlowEntryList el;
+                for (size_t f = 0; f < config.tableFlows; ++f) {
+                    // the second pass is unchanged, the third modifies
+                    // every action
+                    el.push_back(FlowBuilder()
+                                 .priority(100)
+                                 .inPort(o)
+                                 .ipDst(boost::asio::ip::address_v4
+                                        (0x0a000000 + f))
+                                 .action().output(pass == 2 ? 2 : 1)
+                                 .parent().build());
+                }
+                auto start = bench_clock::now();
+                table.apply(objId, el, diffs);
+                auto applied = bench_clock::now();
+                tableExec.Execute(diffs);
+                auto end = bench_clock::now();
+
+                static const char* applyNames[] =
+                    {"table_apply_add", "table_apply_noop",
+                     "table_apply_mod"};
+                static const char* encodeNames[] =
+                    {"table_encode_add", "table_encode_noop",
+                     "table_encode_mod"};
+                uint64_t applyUs = std::chrono::duration_cast
+                    <std::chrono::microseconds>(applied - start).count();
+                uint64_t encodeUs = std::chrono::duration_cast
+                    <std::chrono::microseconds>(end - applied).count();
+                latency[applyNames[pass]].add(applyUs);
+                latency[encodeNames[pass]].add(encodeUs);
+                tableApplyUs += applyUs;
+                tableEncodeUs += encodeUs;
+            }
+        }
+    }
+
+    void writeExec(rapidjson::PrettyWriter<rapidjson::OStreamWrapper>& w,
+                   const SinkFlowExecutor& exec) {
+        w.StartObject();
+        w.Key("flow_adds");
+        w.Uint64(exec.flowMods[FlowEdit::ADD]);
+        w.Key("flow_mods");
+        w.Uint64(exec.flowMods[FlowEdit::MOD]);
+        w.Key("flow_dels");
+        w.Uint64(exec.flowMods[FlowEdit::DEL]);
+        w.Key("group_mods");
+        w.Uint64(exec.groupMods);
+        w.Key("bytes_encoded");
+        w.Uint64(exec.bytes);
+        w.EndObject();
+    }
+
+    BenchConfig config;
+    opflex::ofcore::OFFramework framework;
+    Agent agent;
+    TunnelEpManager tunnelEpManager;
+    IdGenerator intIdGen;
+    IdGenerator accIdGen;
+    CtZoneManager intCtZoneManager;
+    CtZoneManager accCtZoneManager;
+    SinkFlowExecutor intExec;
+    SinkFlowExecutor accExec;
+    SinkFlowExecutor tableExec;
+    MockFlowReader intReader;
+    MockFlowReader accReader;
+    MockPortMapper intPortMapper;
+    MockPortMapper accPortMapper;
+    MockSwitchManager intSwitchManager;
+    MockSwitchManager accSwitchManager;
+    IntFlowManager intFlowManager;
+    AccessFlowManager accessFlowManager;
+    BenchEndpointSource epSrc;
+
+    vector<URI> epgs;
+    vector<URI> contracts;
+    vector<URI> secGroups;
+    vector<string> endpoints;
+    size_t subnetBits = 8;
+    std::map<string, LatencyHistogram> latency;
+    uint64_t tableApplyUs = 0;
+    uint64_t tableEncodeUs = 0;
+};
+
+struct Phase {
+    string name;
+    double seconds;
+    uint64_t flowMods;
+    uint64_t allocations;
+    uint64_t allocBytes;
+};
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    string output;
+    string logLevel;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "Print this help message")
+        ("endpoints", po::value<size_t>(&config.endpoints)
+         ->default_value(1000), "Number of local endpoints")
+        ("epgs", po::value<size_t>(&config.epgs)
+         ->default_value(50), "Number of endpoint groups")
+        ("contracts", po::value<size_t>(&config.contracts)
+         ->default_value(50), "Number of contracts between groups")
+        ("rules", po::value<size_t>(&config.rules)
+         ->default_value(10), "Number of rules per contract and "
+         "security group")
+        ("secgroups", po::value<size_t>(&config.secGroups)
+         ->default_value(20), "Number of security groups")
+        ("iterations", po::value<size_t>(&config.iterations)
+         ->default_value(1), "Number of full re-render passes to time")
+        ("table-objects", po::value<size_t>(&config.tableObjects)
+         ->default_value(1000), "Number of objects for the TableState "
+         "benchmark")
+        ("table-flows", po::value<size_t>(&config.tableFlows)
+         ->default_value(20), "Number of flows per object for the "
+         "TableState benchmark")
+        ("output,o", po::value<string>(&output),
+         "Write the JSON report to this file instead of stdout")
+        ("log-level", po::value<string>(&logLevel)->default_value("error"),
+         "Log level: debug, info, warning, error, fatal")
+        ;
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv)
+                  .options(desc).run(), vm);
+        po::notify(vm);
+        if (vm.count("help")) {
+            std::cout << "Usage: " << argv[0] << " [options]\n";
+            std::cout << desc;
+            return 0;
+        }
+    } catch (const po::unknown_option& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (getSubnetBits(config) == 0) {
+        std::cerr << "Too many endpoints and groups to address within "
+                  << "10.0.0.0/8" << std::endl;
+        return 1;
+    }
+
+    initLogging(logLevel, false, "");
+
+    vector<Phase> phases;
+    RenderBench bench(config);
+    bench.start();
+
+    // flow mods produced by the managers, plus the edits computed by
+    // the standalone table in the table_state phase
+    auto totalMods = [&]() {
+        return bench.intExec.totalFlowMods() +
+            bench.accExec.totalFlowMods() +
+            bench.tableExec.totalFlowMods();
+    };
+    auto runPhase = [&](const string& name, std::function<void()> f) {
+        uint64_t mods = totalMods();
+        uint64_t allocs = allocCount;
+        uint64_t bytes = allocBytes;
+        auto start = bench_clock::now();
+        f();
+        bench.barrier();
+        std::chrono::duration<double> d = bench_clock::now() - start;
+        phases.push_back({name, d.count(), totalMods() - mods,
+                    allocCount - allocs, allocBytes - bytes});
+    };
+
+    runPhase("create_policy", [&]() { bench.createPolicy(); });
+    runPhase("create_endpoints", [&]() { bench.createEndpoints(); });
+    runPhase("rerender", [&]() { bench.renderAll(); });
+    runPhase("table_state", [&]() { bench.tableStateBench(); });
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::ofstream file;
+    if (!output.empty())
+        file.open(output.c_str());
+    rapidjson::OStreamWrapper osw(output.empty() ? std::cout : file);
+    rapidjson::PrettyWriter<rapidjson::OStreamWrapper> w(osw);
+
+    w.StartObject();
+    w.Key("config");
+    w.StartObject();
+    w.Key("endpoints");
+    w.Uint64(config.endpoints);
+    w.Key("epgs");
+    w.Uint64(config.epgs);
+    w.Key("contracts");
+    w.Uint64(config.contracts);
+    w.Key("rules");
+    w.Uint64(config.rules);
+    w.Key("secgroups");
+    w.Uint64(config.secGroups);
+    w.Key("iterations");
+    w.Uint64(config.iterations);
+    w.EndObject();
+
+    w.Key("phases");
+    w.StartArray();
+    for (const Phase& p : phases) {
+        w.StartObject();
+        w.Key("name");
+        w.String(p.name.c_str());
+        w.Key("seconds");
+        w.Double(p.seconds);
+        w.Key("flow_mods");
+        w.Uint64(p.flowMods);
+        w.Key("flows_per_sec");
+        w.Double(p.seconds > 0 ? p.flowMods / p.seconds : 0);
+        w.Key("allocations");
+        w.Uint64(p.allocations);
+        w.Key("allocated_bytes");
+        w.Uint64(p.allocBytes);
+        w.EndObject();
+    }
+    w.EndArray();
+
+    w.Key("latency");
+    w.StartObject();
+    for (auto& l : bench.latency) {
+        w.Key(l.first.c_str());
+        l.second.write(w);
+    }
+    w.EndObject();
+
+    w.Key("int_bridge");
+    bench.writeExec(w, bench.intExec);
+    w.Key("access_bridge");
+    bench.writeExec(w, bench.accExec);
+    w.Key("table_state");
+    bench.writeExec(w, bench.tableExec);
+    w.Key("table_state_time");
+    w.StartObject();
+    w.Key("apply_seconds");
+    w.Double(bench.tableApplyUs / 1e6);
+    w.Key("encode_seconds");
+    w.Double(bench.tableEncodeUs / 1e6);
+    w.EndObject();
+
+    w.Key("peak_rss_kb");
+    w.Int64(usage.ru_maxrss);
+    w.EndObject();
+    (output.empty() ? std::cout : file) << std::endl;
+
+    bench.stop();
+    return 0;
+}
@@ -63,6 +63,20 @@ public:
      PacketDecoder &getDecoder() {
          return pktDecoder;
      }
+    /**
+     * Get the queue of packet events to export
+     * @return packet event queue
+     */
+    std::queue<PacketTuple> &getEventQueue() {
+        return packetTupleQ;
+    }
+    /**
+     * Get the queue of drop flow summaries to export
+     * @return drop flow summary queue
+     */
+    std::queue<PacketTuple> &getDropFlowSummaryQueue() {
+        return dropFlowSummaryQ;
+    }
 };
 
 }
@@ -91,12 +91,12 @@ public:
     /**
      * number of span responses to send
      */
-    static const unsigned int no_of_span_msgs = 16;
+    static const unsigned int no_of_span_msgs = 14;
 
     /**
      * number of netflow responses to send
      */
-    static const unsigned int no_of_netflow_msgs = 14;
+    static const unsigned int no_of_netflow_msgs = 8;
 
     /**
      * rapidjson Document object array
@@ -231,11 +231,11 @@ private:
 
     string response[no_of_span_msgs + no_of_netflow_msgs] = {response1, selectPortsResp, response3,
             updateBridgePortsResp, getMirrorUuidResp, deleteMirrorResp, interfaceInsertResp, bridgeUuidResp,
-            selectPortsResp, selectPortsResp, selectPortsResp, createMirrorResp, interfaceInsertResp,
+            selectPortsResp, createMirrorResp, interfaceInsertResp,
             selectPortsResp, updateBridgePortsResp, selectInterfaceResp,
-            deleteResp, deleteResp, getBridgeUuidResp, createNetflowResp, deleteResp,
-            deleteResp, deleteResp, getBridgeUuidResp, createIpFixResp,
-            deleteResp, deleteResp, getBridgeUuidResp, createIpFixResp, deleteResp};
+            getBridgeUuidResp, createNetflowResp, deleteResp,
+            getBridgeUuidResp, createIpFixResp,
+            getBridgeUuidResp, createIpFixResp, deleteResp};
 
 };
 
@@ -73,6 +73,11 @@ const std::vector<std::string>& GbpOpflexServer::getProxies() const {
 uint16_t GbpOpflexServer::getPort() const { return pimpl->getPort(); }
 uint8_t GbpOpflexServer::getRoles() const { return pimpl->getRoles(); }
 
+void GbpOpflexServer::getStats(uint64_t& messagesSent,
+                               size_t& queueDepth) const {
+    pimpl->getListener().getStats(messagesSent, queueDepth);
+}
+
 } /* namespace test */
 
 namespace engine {
@@ -42,7 +42,7 @@ using yajr::transport::ZeroCopyOpenSSL;
 
 OpflexConnection::OpflexConnection(HandlerFactory& handlerFactory)
     : handler(handlerFactory.newHandler(this))
-    ,requestId(1) ,connGeneration(0)
+    ,requestId(1) ,connGeneration(0), messagesSent(0)
 {
     uv_mutex_init(&queue_mutex);
     connect();
@@ -117,6 +117,12 @@ void OpflexConnection::doWrite(OpflexMessage* message) {
         }
         break;
     }
+    messagesSent += 1;
+}
+
+size_t OpflexConnection::getWriteQueueSize() {
+    util::LockGuard guard(&queue_mutex);
+    return write_queue.size();
 }
 
 void OpflexConnection::processWriteQueue() {
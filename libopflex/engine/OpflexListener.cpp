@@ -40,7 +40,8 @@ OpflexListener::OpflexListener(HandlerFactory& handlerFactory_,
                                const std::string& name_,
                                const std::string& domain_)
     : handlerFactory(handlerFactory_), port(port_),
-      name(name_), domain(domain_), active(true) {
+      name(name_), domain(domain_), active(true),
+      closedMessagesSent(0) {
     uv_mutex_init(&conn_mutex);
     uv_key_create(&conn_mutex_key);
 }
@@ -50,7 +51,8 @@ OpflexListener::OpflexListener(HandlerFactory& handlerFactory_,
                                const std::string& name_,
                                const std::string& domain_)
     : handlerFactory(handlerFactory_), socketName(socketName_),
-      port(0), name(name_), domain(domain_), active(true) {
+      port(0), name(name_), domain(domain_), active(true),
+      closedMessagesSent(0) {
     uv_mutex_init(&conn_mutex);
     uv_key_create(&conn_mutex_key);
 }
@@ -171,6 +173,7 @@ void* OpflexListener::on_new_connection(yajr::Listener* ylistener,
 void OpflexListener::connectionClosed(OpflexServerConnection* conn) {
     util::RecursiveLockGuard guard(&conn_mutex, &conn_mutex_key);
     conns.erase(conn);
+    closedMessagesSent += conn->getMessagesSent();
     delete conn;
     guard.release();
     if (!active)
@@ -220,6 +223,16 @@ void OpflexListener::sendTimeouts() {
     }
 }
 
+void OpflexListener::getStats(uint64_t& messagesSent, size_t& queueDepth) {
+    util::RecursiveLockGuard guard(&conn_mutex, &conn_mutex_key);
+    messagesSent = closedMessagesSent;
+    queueDepth = 0;
+    BOOST_FOREACH(OpflexServerConnection* conn, conns) {
+        messagesSent += conn->getMessagesSent();
+        queueDepth += conn->getWriteQueueSize();
+    }
+}
+
 bool OpflexListener::applyConnPred(conn_pred_t pred, void* user) {
     util::RecursiveLockGuard guard(&conn_mutex, &conn_mutex_key);
     BOOST_FOREACH(OpflexServerConnection* conn, conns) {
@@ -30,6 +30,28 @@ void GenericOpflexMessage::serializePayload(yajr::rpc::SendHandler& writer) {
     (*this)(writer);
 }
 
+SerializedOpflexMessage::SerializedOpflexMessage(OpflexMessage& message)
+    : OpflexMessage(message.getMethod(), message.getType()),
+      xid(message.getReqXid()) {
+    yajr::internal::StringQueue sq;
+    yajr::rpc::SendHandler writer(sq);
+    message.serializePayload(writer);
+    payload.reset(new std::string(sq.deque_.begin(), sq.deque_.end()));
+}
+
+void SerializedOpflexMessage::serializePayload(yajr::rpc::SendHandler& writer) {
+    rapidjson::Type type = rapidjson::kNullType;
+    if (!payload->empty()) {
+        switch ((*payload)[0]) {
+        case '[': type = rapidjson::kArrayType; break;
+        case '{': type = rapidjson::kObjectType; break;
+        case '"': type = rapidjson::kStringType; break;
+        default:  type = rapidjson::kNumberType; break;
+        }
+    }
+    writer.RawValue(payload->data(), payload->size(), type);
+}
+
 } /* namespace internal */
 } /* namespace engine */
 } /* namespace opflex */
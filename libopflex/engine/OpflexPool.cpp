@@ -417,6 +417,12 @@ size_t OpflexPool::sendToRole(OpflexMessage* message,
         if (!conn->isReady()) continue;
         ready.push_back(conn);
     }
+    if (ready.size() > 1 && message->getType() == OpflexMessage::REQUEST) {
+        // Serialize the payload once and share it between all the
+        // connections rather than serializing a copy per connection
+        message = new SerializedOpflexMessage(*message);
+        messagep.reset(message);
+    }
     BOOST_FOREACH(OpflexClientConnection* conn, ready) {
         if (i < (ready.size() - 1)) {
             m_copy = message->clone();
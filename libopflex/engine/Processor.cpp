@@ -55,6 +55,18 @@ static const uint64_t DEFAULT_RETRY_DELAY = 1000*60*2;
 static const uint64_t FIRST_XID = (uint64_t)1 << 63;
 static const uint32_t MAX_PROCESS = 1024;
 
+// Number of items taken from each ready queue per scheduling round
+static const uint32_t QUEUE_WEIGHTS[] = {
+    /* DECLARE_QUEUE */ 8,
+    /* RESOLVE_QUEUE */ 8,
+    /* RETRY_QUEUE */ 2,
+    /* REFRESH_QUEUE */ 1,
+    /* OBSERVABLE_QUEUE */ 1
+};
+static const char* QUEUE_NAMES[] = {
+    "declare", "resolve", "retry", "refresh", "observable"
+};
+
 std::random_device rd;
 std::mt19937 gen(rd());
 
@@ -64,9 +76,12 @@ Processor::Processor(ObjectStore* store_, ThreadManager& threadManager_)
       threadManager(threadManager_),
       pool(*this, threadManager_), nextXid(FIRST_XID),
       reportObservables(true),
+      curQueue(0), curCredit(QUEUE_WEIGHTS[0]),
       processingDelay(DEFAULT_PROC_DELAY),
       retryDelay(DEFAULT_RETRY_DELAY),
       proc_active(false) {
+    for (size_t q = 0; q < NUM_READY_QUEUES; ++q)
+        queueStats[q] = OF_MAKE_SHARED<OFProcessorQueueStats>();
     uv_mutex_init(&item_mutex);
 }
 
@@ -98,13 +113,82 @@ void Processor::setPrrTimerDuration(uint64_t duration) {
     prrTimerDuration = duration;
     policyRefTimerDuration = 1000*prrTimerDuration/2;
 }
-// check whether the object state index has work for us
-bool Processor::hasWork(/* out */ obj_state_by_exp::iterator& it) {
-    if (obj_state.empty()) return false;
+// pick the ready queue for a due item
+Processor::ReadyQueue Processor::classifyItem(const item& i) {
+    if (i.details->local) {
+        const ClassInfo& ci = store->getClassInfo(i.details->class_id);
+        if (ci.getType() == ClassInfo::OBSERVABLE)
+            return OBSERVABLE_QUEUE;
+        if (i.details->state == NEW || i.details->state == UPDATED)
+            return DECLARE_QUEUE;
+        if (i.details->pending_reqs > 0)
+            return RETRY_QUEUE;
+        return REFRESH_QUEUE;
+    }
+    if (i.details->pending_reqs > 0)
+        return RETRY_QUEUE;
+    if (i.details->resolve_time == 0)
+        return RESOLVE_QUEUE;
+    return REFRESH_QUEUE;
+}
+
+// move items that are due from the object state index to the ready
+// queues.  Queued items are parked at the end of the expiration index
+// until they are processed.
+void Processor::enqueueReady() {
     obj_state_by_exp& exp_index = obj_state.get<expiration_tag>();
-    it = exp_index.begin();
-    if (it->expiration == 0 || now(proc_loop) >= it->expiration) return true;
-    return false;
+    uint64_t curTime = now(proc_loop);
+    while (!exp_index.empty()) {
+        obj_state_by_exp::iterator it = exp_index.begin();
+        if (it->expiration != 0 && curTime < it->expiration)
+            break;
+        if (!it->details->queued) {
+            ReadyQueue q = classifyItem(*it);
+            readyQueues[q].push_back({it->uri, curTime});
+            queueStats[q]->setDepth(readyQueues[q].size());
+            it->details->queued = true;
+        }
+        exp_index.modify(it,
+                         change_expiration(std::numeric_limits<uint64_t>::max()));
+    }
+}
+
+// get the next item to process using weighted round robin over the
+// ready queues
+bool Processor::nextReady(/* out */ obj_state_by_exp::iterator& it) {
+    enqueueReady();
+
+    uint64_t curTime = now(proc_loop);
+    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+    while (true) {
+        size_t tries = 0;
+        while (readyQueues[curQueue].empty() || curCredit == 0) {
+            if (++tries > NUM_READY_QUEUES)
+                return false;
+            curQueue = (curQueue + 1) % NUM_READY_QUEUES;
+            curCredit = QUEUE_WEIGHTS[curQueue];
+        }
+
+        ready_item ri = readyQueues[curQueue].front();
+        readyQueues[curQueue].pop_front();
+        queueStats[curQueue]->setDepth(readyQueues[curQueue].size());
+        curCredit -= 1;
+
+        obj_state_by_uri::iterator uit = uri_index.find(ri.uri);
+        if (uit == uri_index.end() || !uit->details->queued)
+            continue;
+        uit->details->queued = false;
+
+        // The item was rescheduled while it was waiting, for example
+        // because a response was received or it was updated again.
+        if (uit->expiration != std::numeric_limits<uint64_t>::max() &&
+            uit->expiration > curTime)
+            continue;
+
+        queueStats[curQueue]->addProcessed(curTime - ri.enqueued);
+        it = obj_state.project<expiration_tag>(uit);
+        return true;
+    }
 }
 
 // add a reference if it doesn't already exist
@@ -318,6 +402,12 @@ void Processor::disableObservableReporting() {
     reportObservables = false;
 }
 
+void Processor::getQueueStats(std::unordered_map<std::string,
+                              OF_SHARED_PTR<OFProcessorQueueStats>>& stats) {
+    for (size_t q = 0; q < NUM_READY_QUEUES; ++q)
+        stats[QUEUE_NAMES[q]] = queueStats[q];
+}
+
 bool Processor::declareObj(ClassInfo::class_type_t type, const item& i,
                            uint64_t& newexp) {
     uint64_t curTime = now(proc_loop);
@@ -539,7 +629,7 @@ void Processor::doProcess() {
     while (proc_active) {
         {
             util::LockGuard guard(&item_mutex);
-            if (!hasWork(it))
+            if (!nextReady(it))
                 break;
         }
         processItem(it);
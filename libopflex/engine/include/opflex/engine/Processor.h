@@ -16,6 +16,9 @@
 #define OPFLEX_ENGINE_PROCESSOR_H
 
 #include <vector>
+#include <deque>
+#include <string>
+#include <unordered_map>
 #include <utility>
 
 #include <boost/atomic.hpp>
@@ -33,6 +36,7 @@
 #include "opflex/engine/internal/MOSerializer.h"
 #include "opflex/engine/internal/AbstractObjectListener.h"
 
+#include "opflex/ofcore/OFStats.h"
 #include "opflex/util/ThreadManager.h"
 
 namespace opflex {
@@ -262,6 +266,14 @@ public:
      */
     void disableObservableReporting();
 
+    /**
+     * Get the counters for each of the processor ready queues
+     *
+     * @param stats map of queue names to the associated counters
+     */
+    void getQueueStats(std::unordered_map<std::string,
+                       OF_SHARED_PTR<OFProcessorQueueStats>>& stats);
+
 private:
     /**
      * The system store client
@@ -370,6 +382,11 @@ private:
          * Number of retries for this item
          */
         uint16_t retry_count;
+
+        /**
+         * Whether the item is waiting in a ready queue
+         */
+        bool queued;
     };
 
     /**
@@ -395,6 +412,7 @@ private:
             details->resolve_time = 0;
             details->pending_reqs = 0;
             details->retry_count = 0;
+            details->queued = false;
         }
         ~item() { if (details) delete details; }
         item& operator=( const item& rhs ) {
@@ -492,6 +510,46 @@ private:
     object_state_t obj_state;
     uv_mutex_t item_mutex;
 
+    /**
+     * Ready queues that due items are moved to before processing.
+     * Each class of work has its own queue so that new endpoint
+     * declarations and first-time resolves are not stuck behind a
+     * large batch of refreshes or state reports.
+     */
+    enum ReadyQueue {
+        /** new or updated local items */
+        DECLARE_QUEUE,
+        /** nonlocal items that have not been resolved yet */
+        RESOLVE_QUEUE,
+        /** items with requests awaiting a response */
+        RETRY_QUEUE,
+        /** periodic refresh of resolved and declared items */
+        REFRESH_QUEUE,
+        /** local observables to report */
+        OBSERVABLE_QUEUE,
+        NUM_READY_QUEUES
+    };
+
+    /**
+     * An entry in a ready queue
+     */
+    struct ready_item {
+        /** the URI of the item */
+        modb::URI uri;
+        /** the time the item was queued */
+        uint64_t enqueued;
+    };
+
+    std::deque<ready_item> readyQueues[NUM_READY_QUEUES];
+    OF_SHARED_PTR<OFProcessorQueueStats> queueStats[NUM_READY_QUEUES];
+
+    /**
+     * The queue currently being served and the number of items it
+     * may still take in the current round
+     */
+    size_t curQueue;
+    uint32_t curCredit;
+
     /**
      * Processing delay to allow batching updates
      */
@@ -530,7 +588,9 @@ private:
     static void proc_async_cb(uv_async_t *handle);
     static void connect_async_cb(uv_async_t *handle);
 
-    bool hasWork(/* out */ obj_state_by_exp::iterator& it);
+    ReadyQueue classifyItem(const item& i);
+    void enqueueReady();
+    bool nextReady(/* out */ obj_state_by_exp::iterator& it);
     void addRef(obj_state_by_exp::iterator& it,
                 const modb::reference_t& up);
     void removeRef(obj_state_by_exp::iterator& it,
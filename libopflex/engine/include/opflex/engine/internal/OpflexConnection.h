@@ -16,6 +16,7 @@
 #include <sstream>
 #include <list>
 #include <utility>
+#include <atomic>
 
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
@@ -134,6 +135,20 @@ public:
      */
     void processWriteQueue();
 
+    /**
+     * Get the number of messages written to the peer so far
+     *
+     * @return the message count
+     */
+    uint64_t getMessagesSent() const { return messagesSent; }
+
+    /**
+     * Get the number of messages waiting in the write queue
+     *
+     * @return the queue depth
+     */
+    size_t getWriteQueueSize();
+
     /**
      * Get the peer handshake timeout (in ms)
      * @return timeout
@@ -180,6 +195,7 @@ private:
     typedef std::list<write_queue_item_t> write_queue_t;
     write_queue_t write_queue;
     uv_mutex_t queue_mutex;
+    std::atomic<uint64_t> messagesSent;
     uint32_t handshakeTimeout;
 
     void doWrite(OpflexMessage* message);
@@ -162,6 +162,17 @@ public:
      */
     HandlerFactory *getHandlerFactory() { return &handlerFactory; }
 
+    /**
+     * Get message counters summed over the connections to this
+     * listener, including connections that have since closed
+     *
+     * @param messagesSent set to the number of messages written to
+     * peers
+     * @param queueDepth set to the number of messages waiting in the
+     * write queues of the open connections
+     */
+    void getStats(uint64_t& messagesSent, size_t& queueDepth);
+
     /**
      * A predicate for use with applyConnPred
      */
@@ -205,6 +216,7 @@ private:
     uv_key_t conn_mutex_key;
     typedef std::set<OpflexServerConnection*> conn_set_t;
     conn_set_t conns;
+    uint64_t closedMessagesSent;
 
     uv_async_t cleanup_async;
     uv_async_t writeq_async;
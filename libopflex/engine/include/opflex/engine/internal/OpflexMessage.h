@@ -20,6 +20,7 @@
 
 #include "opflex/yajr/rpc/message_factory.hpp"
 #include "opflex/rpc/JsonRpcMessage.h"
+#include "opflex/ofcore/OFTypes.h"
 
 #pragma once
 #ifndef OPFLEX_ENGINE_OPFLEXMESSAGE_H
@@ -94,6 +95,50 @@ public:
 
 };
 
+/**
+ * A message whose payload has already been serialized.  Copies of
+ * the message share the same immutable payload buffer, so a message
+ * sent to several peers is serialized only once.
+ */
+class SerializedOpflexMessage : public OpflexMessage {
+public:
+    /**
+     * Serialize the payload of the given message.  The message must
+     * be a request, since the ID of a response is not copied.
+     *
+     * @param message the message to serialize
+     */
+    explicit SerializedOpflexMessage(OpflexMessage& message);
+
+    /**
+     * Destroy the message
+     */
+    virtual ~SerializedOpflexMessage() {}
+
+    /**
+     * Clone the opflex message.  The clone shares the serialized
+     * payload.
+     */
+    virtual SerializedOpflexMessage* clone() {
+        return new SerializedOpflexMessage(*this);
+    }
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer);
+
+    virtual uint64_t getReqXid() { return xid; }
+
+    /**
+     * Get the serialized payload
+     *
+     * @return the payload as a JSON string
+     */
+    const std::string& getPayload() const { return *payload; }
+
+private:
+    OF_SHARED_PTR<const std::string> payload;
+    uint64_t xid;
+};
+
 } /* namespace internal */
 } /* namespace engine */
 } /* namespace opflex */
@@ -232,6 +232,8 @@ public:
     /**
      * Send a given message to all the connected and ready peers with
      * the given role.  This message can be called from any thread.
+     * When there are several such peers, a request payload is
+     * serialized once and the buffer is shared by all of them.
      *
      * @param message the message to write.  The memory will be owned by the pool.
      * @param role the role to which the message should be sent
@@ -16,9 +16,11 @@
 
 
 #include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
 
 #include "opflex/ofcore/OFConstants.h"
 #include "opflex/engine/internal/OpflexPool.h"
+#include "opflex/engine/internal/OpflexMessage.h"
 
 using namespace opflex::engine;
 using namespace opflex::engine::internal;
@@ -54,10 +56,43 @@ public:
     virtual void close() {
         closed = true;
     }
+    virtual void sendMessage(OpflexMessage* message, bool sync = false) {
+        sent.push_back(message);
+    }
+    virtual ~MockClientConn() {
+        BOOST_FOREACH(OpflexMessage* m, sent)
+            delete m;
+    }
     bool ready;
     bool closed;
+    std::vector<OpflexMessage*> sent;
 };
 
+class CountingReq : public OpflexMessage {
+public:
+    CountingReq() : OpflexMessage("endpoint_declare", REQUEST) {}
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) {
+        serializeCount += 1;
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("prr");
+        writer.Int64(3600);
+        writer.EndObject();
+        writer.EndArray();
+    }
+
+    virtual CountingReq* clone() {
+        return new CountingReq(*this);
+    }
+
+    virtual uint64_t getReqXid() { return 42; }
+
+    static int serializeCount;
+};
+
+int CountingReq::serializeCount = 0;
+
 class PoolFixture {
 public:
     PoolFixture() : pool(handlerFactory, threadManager) {
@@ -133,6 +168,46 @@ BOOST_FIXTURE_TEST_CASE( manage_roles , PoolFixture ) {
     BOOST_CHECK_EQUAL(0, pool.getRoleCount(OFConstants::ENDPOINT_REGISTRY));
 }
 
+BOOST_FIXTURE_TEST_CASE( serialize_once , PoolFixture ) {
+    MockClientConn* c1 = new MockClientConn(handlerFactory, &pool,
+                                            "1.2.3.4", 1234);
+    MockClientConn* c2 = new MockClientConn(handlerFactory, &pool,
+                                            "1.2.3.4", 1235);
+    pool.addPeer(c1);
+    pool.addPeer(c2);
+    pool.setRoles(c1, OFConstants::ENDPOINT_REGISTRY);
+    pool.setRoles(c2, OFConstants::ENDPOINT_REGISTRY);
+
+    CountingReq::serializeCount = 0;
+    BOOST_CHECK_EQUAL(2, pool.sendToRole(new CountingReq(),
+                                         OFConstants::ENDPOINT_REGISTRY));
+    BOOST_CHECK_EQUAL(1, CountingReq::serializeCount);
+
+    BOOST_REQUIRE_EQUAL(1, c1->sent.size());
+    BOOST_REQUIRE_EQUAL(1, c2->sent.size());
+    SerializedOpflexMessage* m1 =
+        dynamic_cast<SerializedOpflexMessage*>(c1->sent[0]);
+    SerializedOpflexMessage* m2 =
+        dynamic_cast<SerializedOpflexMessage*>(c2->sent[0]);
+    BOOST_REQUIRE(m1 != NULL);
+    BOOST_REQUIRE(m2 != NULL);
+    BOOST_CHECK_EQUAL(&m1->getPayload(), &m2->getPayload());
+    BOOST_CHECK_EQUAL("[{\"prr\":3600}]", m1->getPayload());
+    BOOST_CHECK_EQUAL("endpoint_declare", m2->getMethod());
+    BOOST_CHECK_EQUAL(42, m2->getReqXid());
+
+    // a single peer serializes the original message when written
+    c2->ready = false;
+    BOOST_CHECK_EQUAL(1, pool.sendToRole(new CountingReq(),
+                                         OFConstants::ENDPOINT_REGISTRY));
+    BOOST_CHECK_EQUAL(1, CountingReq::serializeCount);
+    BOOST_REQUIRE_EQUAL(2, c1->sent.size());
+    BOOST_CHECK(dynamic_cast<CountingReq*>(c1->sent[1]) != NULL);
+
+    c1->disconnect();
+    c2->disconnect();
+}
+
 BOOST_FIXTURE_TEST_CASE( manage_ivxlan_roles , PoolFixture ) {
     MockClientConn* c1 = new MockClientConn(handlerFactory, &pool,
                                             "1.2.3.4", 1234);
@@ -579,10 +579,17 @@ BOOST_FIXTURE_TEST_CASE( policy_resolve, PolicyFixture ) {
     rclient->put(4, c4u, oi4);
     rclient->put(6, c6u, oi6);
 
+    uint64_t sentBefore, sentAfter;
+    size_t queueDepth;
+    opflexServer.getListener().getStats(sentBefore, queueDepth);
+    BOOST_CHECK(sentBefore > 0);
+
     merge.emplace_back(4, c4u);
     opflexServer.policyUpdate(replace, merge, del);
     WAIT_FOR("moretesting" == client2->get(4, c4u)->getString(9), 1000);
     BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
+    opflexServer.getListener().getStats(sentAfter, queueDepth);
+    BOOST_CHECK(sentAfter > sentBefore);
 
     oi4->setString(9, "evenmore");
     rclient->put(4, c4u, oi4);
@@ -729,6 +736,29 @@ BOOST_FIXTURE_TEST_CASE( state_report, StateFixture ) {
     BOOST_CHECK_EQUAL("update", rclient->get(3, u3)->getString(16));
 }
 
+static uint64_t queueProcessed(Processor& processor,
+                               const std::string& queue) {
+    std::unordered_map<std::string, OF_SHARED_PTR<OFProcessorQueueStats>> stats;
+    processor.getQueueStats(stats);
+    return stats.at(queue)->getProcessed();
+}
+
+// test that local observables are processed through their own queue
+BOOST_FIXTURE_TEST_CASE( queue_stats, StateFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+
+    std::unordered_map<std::string, OF_SHARED_PTR<OFProcessorQueueStats>> stats;
+    processor.getQueueStats(stats);
+    BOOST_CHECK_EQUAL(5, stats.size());
+
+    setup();
+    WAIT_FOR(itemPresent(rclient, 3, u3), 1000);
+    BOOST_CHECK(queueProcessed(processor, "observable") > 0);
+    BOOST_CHECK(queueProcessed(processor, "declare") > 0);
+    BOOST_CHECK_EQUAL(0, stats.at("observable")->getDepth());
+}
+
 // test state_report after connection ready
 BOOST_FIXTURE_TEST_CASE( state_report_reconnect, StateFixture ) {
     setup();
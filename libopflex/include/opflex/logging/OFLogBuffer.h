@@ -0,0 +1,83 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file OFLogBuffer.h
+ * @brief Interface definition file for OFLogBuffer
+ */
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_LOGGING_OFLOGBUFFER_H
+#define OPFLEX_LOGGING_OFLOGBUFFER_H
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+namespace opflex {
+namespace logging {
+
+/**
+ * A buffer used to format a single log message.  Buffers are kept
+ * in a per-thread pool and reused across messages, so formatting a
+ * log message does not allocate once the pool is warm.
+ */
+class OFLogBuffer : private std::streambuf {
+public:
+    /**
+     * Get a buffer from the pool of the current thread.  The buffer
+     * is empty and its stream has default formatting flags.
+     *
+     * @return the buffer, which must be returned with release()
+     */
+    static OFLogBuffer* acquire()
+        __attribute__((no_instrument_function));
+
+    /**
+     * Return a buffer to the pool of the current thread
+     *
+     * @param buffer the buffer to return
+     */
+    static void release(OFLogBuffer* buffer)
+        __attribute__((no_instrument_function));
+
+    /**
+     * Get the stream to write the message to
+     */
+    std::ostream& stream() { return out; }
+
+    /**
+     * Get the formatted message
+     */
+    const std::string& str() const { return data; }
+
+    ~OFLogBuffer()
+        __attribute__((no_instrument_function));
+
+private:
+    OFLogBuffer()
+        __attribute__((no_instrument_function));
+
+    void reset()
+        __attribute__((no_instrument_function));
+
+    virtual int_type overflow(int_type c)
+        __attribute__((no_instrument_function));
+    virtual std::streamsize xsputn(const char* s, std::streamsize n)
+        __attribute__((no_instrument_function));
+
+    friend struct OFLogBufferPool;
+
+    std::string data;
+    std::ostream out;
+};
+
+} /* namespace logging */
+} /* namespace opflex */
+
+#endif /* OPFLEX_LOGGING_OFLOGBUFFER_H */
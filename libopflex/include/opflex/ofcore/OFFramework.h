@@ -899,6 +899,15 @@ public:
      */
     void getOpflexPeerStats(std::unordered_map<std::string, OF_SHARED_PTR<OFStats>>& stats);
 
+    /**
+     * Retrieve the counters for the ready queues of the OpFlex
+     * processor.  Queues are named "declare", "resolve", "retry",
+     * "refresh" and "observable".
+     *
+     * @param stats Map of queue names to associated queue stats
+     */
+    void getProcessorQueueStats(std::unordered_map<std::string, OF_SHARED_PTR<OFProcessorQueueStats>>& stats);
+
     /**
      * Enable/Disable reporting of observable changes to registered observers
      *
@@ -144,4 +144,47 @@ private:
     std::atomic_ullong stateReportErrs{};
 };
 
+/**
+ * OpFlex processor ready queue counters
+ */
+class OFProcessorQueueStats {
+
+public:
+
+    /**
+     * Create a new instance
+     */
+    OFProcessorQueueStats() {};
+
+    /**
+     * Destroy the instance
+     */
+    virtual ~OFProcessorQueueStats() {};
+
+    /** get the number of items waiting in the queue */
+    uint64_t getDepth() { return depth; }
+    /** get the number of items taken from the queue */
+    uint64_t getProcessed() { return processed; }
+    /** get the total time in milliseconds items waited in the queue */
+    uint64_t getTotalWaitMs() { return totalWaitMs; }
+    /** get the longest time in milliseconds an item waited in the queue */
+    uint64_t getMaxWaitMs() { return maxWaitMs; }
+
+    /** set the number of items waiting in the queue */
+    void setDepth(uint64_t d) { depth = d; }
+    /** record an item taken from the queue after waiting waitMs */
+    void addProcessed(uint64_t waitMs) {
+        processed++;
+        totalWaitMs += waitMs;
+        if (waitMs > maxWaitMs) maxWaitMs = waitMs;
+    }
+
+private:
+
+    std::atomic_ullong depth{};
+    std::atomic_ullong processed{};
+    std::atomic_ullong totalWaitMs{};
+    std::atomic_ullong maxWaitMs{};
+};
+
 #endif //OPFLEX_OFSTATS_H
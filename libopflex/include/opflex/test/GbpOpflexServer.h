@@ -141,6 +141,16 @@ public:
      */
     uint8_t getRoles() const;
 
+    /**
+     * Get message counters summed over all agent connections
+     *
+     * @param messagesSent set to the number of messages written to
+     * agents since the server started
+     * @param queueDepth set to the number of messages currently
+     * waiting to be written
+     */
+    void getStats(uint64_t& messagesSent, size_t& queueDepth) const;
+
 private:
     engine::internal::GbpOpflexServerImpl* pimpl;
 };
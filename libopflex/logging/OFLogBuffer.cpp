@@ -0,0 +1,93 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for OFLogBuffer class.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+
+#include <vector>
+
+#include "opflex/logging/OFLogBuffer.h"
+
+namespace opflex {
+namespace logging {
+
+/**
+ * Buffers larger than this are released rather than kept in the
+ * pool so that an occasional huge message does not pin its memory
+ */
+static const size_t MAX_POOLED_CAPACITY = 16 * 1024;
+
+/**
+ * Upper bound on the number of idle buffers kept per thread.  More
+ * than one is needed only when log messages are nested.
+ */
+static const size_t MAX_POOLED_BUFFERS = 4;
+
+struct OFLogBufferPool {
+    ~OFLogBufferPool() {
+        for (OFLogBuffer* b : buffers)
+            delete b;
+    }
+
+    std::vector<OFLogBuffer*> buffers;
+};
+
+static thread_local OFLogBufferPool pool;
+
+OFLogBuffer::OFLogBuffer() : out(this) {
+    data.reserve(256);
+}
+
+OFLogBuffer::~OFLogBuffer() {}
+
+void OFLogBuffer::reset() {
+    data.clear();
+    out.clear();
+    out.flags(std::ios_base::skipws | std::ios_base::dec);
+    out.width(0);
+    out.precision(6);
+    out.fill(' ');
+}
+
+OFLogBuffer::int_type OFLogBuffer::overflow(int_type c) {
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+        data.push_back(traits_type::to_char_type(c));
+    return traits_type::not_eof(c);
+}
+
+std::streamsize OFLogBuffer::xsputn(const char* s, std::streamsize n) {
+    data.append(s, n);
+    return n;
+}
+
+OFLogBuffer* OFLogBuffer::acquire() {
+    if (pool.buffers.empty())
+        return new OFLogBuffer();
+    OFLogBuffer* b = pool.buffers.back();
+    pool.buffers.pop_back();
+    return b;
+}
+
+void OFLogBuffer::release(OFLogBuffer* buffer) {
+    if (buffer->data.capacity() > MAX_POOLED_CAPACITY ||
+        pool.buffers.size() >= MAX_POOLED_BUFFERS) {
+        delete buffer;
+        return;
+    }
+    buffer->reset();
+    pool.buffers.push_back(buffer);
+}
+
+} /* namespace logging */
+} /* namespace opflex */
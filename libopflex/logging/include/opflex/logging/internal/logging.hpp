@@ -14,6 +14,7 @@
 #include <iostream>
 
 #include "opflex/logging/OFLogHandler.h"
+#include "opflex/logging/OFLogBuffer.h"
 
 namespace opflex {
 namespace logging {
@@ -48,13 +49,16 @@ class Logger {
     ~Logger()
         __attribute__((no_instrument_function));
 
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
 private:
     OFLogHandler::Level const level_;
     char const * file_;
     int const line_;
     char const * function_;
 
-    std::ostringstream buffer_;
+    OFLogBuffer* buffer_;
 };
 
 } /* namespace internal */
@@ -23,7 +23,7 @@ namespace internal {
 
 std::ostream & Logger::stream()
 {
-    return buffer_;
+    return buffer_->stream();
 }
 
 Logger::Logger(OFLogHandler::Level const level,
@@ -34,7 +34,8 @@ Logger::Logger(OFLogHandler::Level const level,
             level_(level),
             file_(file),
             line_(line),
-            function_(function)
+            function_(function),
+            buffer_(OFLogBuffer::acquire())
         {}
 
 Logger::~Logger() {
@@ -42,7 +43,8 @@ Logger::~Logger() {
                                               line_,
                                               function_,
                                               level_,
-                                              buffer_.str());
+                                              buffer_->str());
+    OFLogBuffer::release(buffer_);
 }
 
 } /* namespace internal */
@@ -281,6 +281,10 @@ void OFFramework::getOpflexPeerStats(std::unordered_map<string, OF_SHARED_PTR<OF
     pool.getOpflexPeerStats(stats);
 }
 
+void OFFramework::getProcessorQueueStats(std::unordered_map<string, OF_SHARED_PTR<OFProcessorQueueStats>>& stats) {
+    pimpl->processor.getQueueStats(stats);
+}
+
 void OFFramework::overrideObservableReporting(modb::class_id_t class_id, bool enabled) {
     pimpl->processor.overrideObservableReporting(class_id, enabled);
 }